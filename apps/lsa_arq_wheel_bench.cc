@@ -0,0 +1,150 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * ARQ bookkeeping with many outstanding frames: the rotating list the
+ * transmitters used against arq_timer_wheel. Both run the same virtual
+ * millisecond schedule: every tick one random outstanding frame is acked,
+ * one new frame is sent and at most one timed out frame is resent.
+ *
+ *  usage: lsa_arq_wheel_bench [-o outstanding] [-n ticks] [-t timeout_ms]
+ */
+
+#include <lsa/arq_timer_wheel.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <random>
+#include <vector>
+#include <unistd.h>
+
+struct pending_t{
+  uint16_t seq;
+  uint64_t deadline;
+};
+
+static void
+usage(const char* prog)
+{
+  std::fprintf(stderr,"usage: %s [-o outstanding] [-n ticks] [-t timeout_ms]\n",prog);
+  std::exit(1);
+}
+
+static void
+report(const char* name, long int nticks, long int nretx, double us)
+{
+  std::printf("%s: ns_per_tick=%.1f retransmissions=%ld\n",name,
+    (nticks>0)? us*1e3/nticks : 0.0,nretx);
+}
+
+int
+main(int argc, char** argv)
+{
+  int outstanding = 10000;
+  long int nticks = 200000;
+  int timeout = 5000;
+  int opt;
+  while((opt = getopt(argc,argv,"o:n:t:"))!=-1){
+    switch(opt){
+      case 'o':
+        outstanding = std::atoi(optarg);
+      break;
+      case 'n':
+        nticks = std::atol(optarg);
+      break;
+      case 't':
+        timeout = std::atoi(optarg);
+      break;
+      default:
+        usage(argv[0]);
+      break;
+    }
+  }
+  if(outstanding<=0 || outstanding>=0x10000 || nticks<=0 || timeout<=0){
+    usage(argv[0]);
+  }
+  // the same acks for both: an index into the outstanding frames
+  std::mt19937 gen(1234);
+  std::uniform_int_distribution<int> ack_dist(0,outstanding-1);
+  std::vector<int> acks(nticks);
+  for(long int i=0;i<nticks;++i){
+    acks[i] = ack_dist(gen);
+  }
+  std::printf("# outstanding=%d ticks=%ld timeout_ms=%d\n",outstanding,nticks,timeout);
+
+  // rotating list, linear search on ack
+  std::list<pending_t> queue;
+  std::vector<uint16_t> live(outstanding);
+  uint16_t seq = 0;
+  uint64_t now = 0;
+  long int nretx = 0;
+  for(int i=0;i<outstanding;++i,++seq){
+    pending_t p = {seq,now+timeout};
+    queue.push_back(p);
+    live[i] = seq;
+  }
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for(long int i=0;i<nticks;++i,++now){
+    const uint16_t acked = live[acks[i]];
+    for(std::list<pending_t>::iterator it=queue.begin();it!=queue.end();++it){
+      if(it->seq==acked){
+        queue.erase(it);
+        break;
+      }
+    }
+    pending_t p = {seq,now+timeout};
+    queue.push_back(p);
+    live[acks[i]] = seq++;
+    if(queue.front().deadline<=now){
+      p = queue.front();
+      p.deadline = now+timeout;
+      queue.pop_front();
+      queue.push_back(p);
+      nretx++;
+    }
+  }
+  std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+  report("list",nticks,nretx,std::chrono::duration<double,std::micro>(t1-t0).count());
+
+  // timer wheel, indexed ack
+  gr::lsa::arq_timer_wheel wheel;
+  seq = 0;
+  now = 0;
+  nretx = 0;
+  for(int i=0;i<outstanding;++i,++seq){
+    wheel.add(seq,pmt::PMT_NIL,now+timeout,now);
+    live[i] = seq;
+  }
+  t0 = std::chrono::steady_clock::now();
+  for(long int i=0;i<nticks;++i,++now){
+    wheel.remove(live[acks[i]]);
+    wheel.add(seq,pmt::PMT_NIL,now+timeout,now);
+    live[acks[i]] = seq++;
+    gr::lsa::arq_timer_wheel::frame_t* frame = wheel.next_expired(now);
+    if(frame!=NULL){
+      wheel.rearm(frame->seq,now+timeout,now);
+      nretx++;
+    }
+  }
+  t1 = std::chrono::steady_clock::now();
+  report("wheel",nticks,nretx,std::chrono::duration<double,std::micro>(t1-t0).count());
+  return 0;
+}
@@ -0,0 +1,271 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Per-frame ACKs against selective repeat block ACKs over a lossy loopback
+ * in virtual time. The transmitter sends one frame per millisecond from an
+ * arq_timer_wheel, new frames only within the window above the oldest
+ * unacked one like arq_tx does. The receiver keeps the same scoreboard as
+ * simple_rx. The retransmission timeout covers the round trip and an ACK
+ * period. Both directions drop frames with the given
+ * probability. ACK frames and the share of airtime spent on ACKs, PHY
+ * header included, are reported for both modes.
+ *
+ *  usage: lsa_block_ack_bench [-n frames] [-w window] [-a ack_period_ms]
+ *                             [-p loss] [-l payload_bytes]
+ */
+
+#include <lsa/arq_timer_wheel.h>
+#include "block_ack.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <vector>
+#include <unistd.h>
+
+// preamble, SFD and length as preamble_prefixer adds them
+static const int PHY_OVERHEAD = 6;
+static const int SEQLEN = 4;
+static const uint64_t DELAY_MS = 2;
+
+struct air_t{
+  uint64_t arrival;
+  std::vector<unsigned char> bytes;
+};
+
+struct result_t{
+  long int data_frames;
+  long int ack_frames;
+  long int data_bytes;
+  long int ack_bytes;
+  uint64_t ms;
+};
+
+static void
+usage(const char* prog)
+{
+  std::fprintf(stderr,"usage: %s [-n frames] [-w window] [-a ack_period_ms] [-p loss] [-l payload_bytes]\n",prog);
+  std::exit(1);
+}
+
+class receiver_t
+{
+ public:
+  receiver_t(int window, int ack_period)
+    : d_window(window), d_ack_period(ack_period), d_valid(false),
+      d_base(0), d_bitmap(0), d_new(0), d_delivered(0)
+  {}
+  // frames to send back for a received data frame
+  void frame_in(uint16_t seq, std::vector< std::vector<unsigned char> >& acks)
+  {
+    if(d_window==0){
+      if(d_seen.size()<=seq){
+        d_seen.resize(seq+1,false);
+      }
+      d_delivered += !d_seen[seq];
+      d_seen[seq] = true;
+      acks.push_back(single_ack(seq));
+      return;
+    }
+    if(!d_valid){
+      d_base = seq;
+      d_valid = true;
+    }
+    uint16_t offset = seq-d_base;
+    if(offset>=0x8000){
+      acks.push_back(single_ack(seq));
+      return;
+    }
+    if(offset>=d_window){
+      uint16_t shift = offset-d_window+1;
+      d_bitmap = (shift>=BLOCK_ACK_WINDOW)? 0 : d_bitmap>>shift;
+      d_base += shift;
+      offset = d_window-1;
+    }
+    const uint64_t bit = ((uint64_t)1)<<offset;
+    d_delivered += !(d_bitmap&bit);
+    d_bitmap |= bit;
+    if(++d_new>=std::max(1,d_window/2)){
+      acks.push_back(block_ack());
+    }
+  }
+  void tick(uint64_t now, std::vector< std::vector<unsigned char> >& acks)
+  {
+    if(d_window>0 && d_new>0 && now%d_ack_period==0){
+      acks.push_back(block_ack());
+    }
+  }
+  long int delivered() const{return d_delivered;}
+ private:
+  static std::vector<unsigned char> single_ack(uint16_t seq)
+  {
+    std::vector<unsigned char> ack(SEQLEN);
+    ack[0] = ack[2] = seq>>8;
+    ack[1] = ack[3] = seq&0xff;
+    return ack;
+  }
+  std::vector<unsigned char> block_ack()
+  {
+    std::vector<unsigned char> ack(BLOCK_ACK_LEN);
+    gr::lsa::block_ack_pack(d_base,d_bitmap,ack.data());
+    d_new = 0;
+    return ack;
+  }
+  const int d_window;
+  const int d_ack_period;
+  bool d_valid;
+  uint16_t d_base;
+  uint64_t d_bitmap;
+  int d_new;
+  long int d_delivered;
+  std::vector<bool> d_seen;
+};
+
+static result_t
+run(int nframes, int window, int rx_window, int ack_period, double loss, int payload)
+{
+  std::mt19937 gen(1234);
+  std::bernoulli_distribution lost(loss);
+  gr::lsa::arq_timer_wheel pending;
+  receiver_t rx(rx_window,ack_period);
+  std::deque<air_t> data_air, ack_air;
+  std::vector< std::vector<unsigned char> > acks;
+  std::vector<gr::lsa::arq_timer_wheel::frame_t> acked;
+  result_t res = {0,0,0,0,0};
+  uint16_t next_seq = 0;
+  uint16_t win_base = 0;
+  uint64_t now = 0;
+  const uint64_t rto = 2*(2*DELAY_MS+ack_period);
+  while(rx.delivered()<nframes || !pending.empty()){
+    if(++now>(uint64_t)nframes*1000){
+      std::fprintf(stderr,"no progress, giving up\n");
+      break;
+    }
+    acks.clear();
+    while(!data_air.empty() && data_air.front().arrival<=now){
+      const std::vector<unsigned char>& f = data_air.front().bytes;
+      rx.frame_in((f[0]<<8)|f[1],acks);
+      data_air.pop_front();
+    }
+    rx.tick(now,acks);
+    for(size_t i=0;i<acks.size();++i){
+      res.ack_frames++;
+      res.ack_bytes += PHY_OVERHEAD+acks[i].size();
+      if(!lost(gen)){
+        air_t a = {now+DELAY_MS,acks[i]};
+        ack_air.push_back(a);
+      }
+    }
+    while(!ack_air.empty() && ack_air.front().arrival<=now){
+      const std::vector<unsigned char>& a = ack_air.front().bytes;
+      uint16_t base;
+      uint64_t bitmap;
+      if(a.size()==SEQLEN){
+        pending.remove((a[0]<<8)|a[1]);
+      }else if(gr::lsa::block_ack_parse(a.data(),a.size(),base,bitmap)){
+        acked.clear();
+        pending.remove_block(base,bitmap,&acked);
+      }
+      ack_air.pop_front();
+    }
+    while(win_base!=next_seq && pending.find(win_base)==NULL){
+      win_base++;
+    }
+    // one frame per millisecond, retransmissions first
+    uint16_t seq;
+    gr::lsa::arq_timer_wheel::frame_t* timeout = pending.next_expired(now);
+    if(timeout!=NULL){
+      seq = timeout->seq;
+      timeout->retry++;
+      pending.rearm(seq,now+rto,now);
+    }else if(next_seq<nframes && (uint16_t)(next_seq-win_base)<window){
+      seq = next_seq++;
+      pending.add(seq,pmt::PMT_NIL,now+rto,now);
+    }else{
+      continue;
+    }
+    res.data_frames++;
+    res.data_bytes += PHY_OVERHEAD+SEQLEN+payload;
+    if(!lost(gen)){
+      air_t f;
+      f.arrival = now+DELAY_MS;
+      f.bytes.resize(SEQLEN+payload);
+      f.bytes[0] = f.bytes[2] = seq>>8;
+      f.bytes[1] = f.bytes[3] = seq&0xff;
+      data_air.push_back(f);
+    }
+  }
+  res.ms = now;
+  return res;
+}
+
+static void
+report(const char* name, const result_t& res, int nframes)
+{
+  std::printf("%s: ms=%llu data_frames=%ld ack_frames=%ld ack_bytes_per_frame=%.2f ack_airtime=%.1f%%\n",
+    name,(unsigned long long)res.ms,res.data_frames,res.ack_frames,(double)res.ack_bytes/nframes,
+    100.0*res.ack_bytes/(res.ack_bytes+res.data_bytes));
+}
+
+int
+main(int argc, char** argv)
+{
+  int nframes = 20000;
+  int window = 32;
+  int ack_period = 10;
+  double loss = 0.05;
+  int payload = 64;
+  int opt;
+  while((opt = getopt(argc,argv,"n:w:a:p:l:"))!=-1){
+    switch(opt){
+      case 'n':
+        nframes = std::atoi(optarg);
+      break;
+      case 'w':
+        window = std::atoi(optarg);
+      break;
+      case 'a':
+        ack_period = std::atoi(optarg);
+      break;
+      case 'p':
+        loss = std::atof(optarg);
+      break;
+      case 'l':
+        payload = std::atoi(optarg);
+      break;
+      default:
+        usage(argv[0]);
+      break;
+    }
+  }
+  if(nframes<=0 || nframes>0xffff || window<=0 || window>BLOCK_ACK_WINDOW
+    || ack_period<=0 || loss<0 || loss>=1 || payload<0){
+    usage(argv[0]);
+  }
+  std::printf("# frames=%d window=%d ack_period_ms=%d loss=%.3f payload=%d\n",nframes,window,ack_period,loss,payload);
+  result_t single = run(nframes,window,0,ack_period,loss,payload);
+  result_t block = run(nframes,window,window,ack_period,loss,payload);
+  report("per-frame",single,nframes);
+  report("block",block,nframes);
+  std::printf("ack airtime reduction: %.1fx\n",(block.ack_bytes>0)? (double)single.ack_bytes/block.ack_bytes : 0.0);
+  return 0;
+}
@@ -0,0 +1,148 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Chip mapping cost next to message passing cost. Random PDUs are spread
+ * with the old per byte shuffle and with chip_mapper::map_bytes, and the
+ * outputs are compared. The cost of building the output message (blob
+ * and pair) is reported for scale.
+ *
+ *  usage: lsa_chip_map_bench [-n pdus] [-l pdu_bytes]
+ */
+
+#include <lsa/chip_mapper.h>
+#include <pmt/pmt.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <unistd.h>
+
+static const unsigned int CHIPSET[16] = {
+                              3653456430,
+                              3986437410,
+                              786023250,
+                              585997365,
+                              1378802115,
+                              891481500,
+                              3276943065,
+                              2620728045,
+                              2358642555,
+                              3100205175,
+                              2072811015,
+                              2008598880,
+                              125537430,
+                              1618458825,
+                              2517072780,
+                              3378542520};
+
+static void
+usage(const char* prog)
+{
+  std::fprintf(stderr,"usage: %s [-n pdus] [-l pdu_bytes]\n",prog);
+  std::exit(1);
+}
+
+// the mapping chip_mapper used before the table
+static void
+map_reference(const unsigned char* in, int nbytes, unsigned char* out)
+{
+  for(int i=0;i<nbytes;++i){
+    const unsigned char* u8_1 = (const unsigned char*)&CHIPSET[(in[i]>>4) & 0x0f];
+    const unsigned char* u8_2 = (const unsigned char*)&CHIPSET[in[i] & 0x0f];
+    out[8*i] = u8_1[3];
+    out[8*i+1] = u8_1[2];
+    out[8*i+2] = u8_1[1];
+    out[8*i+3] = u8_1[0];
+    out[8*i+4] = u8_2[3];
+    out[8*i+5] = u8_2[2];
+    out[8*i+6] = u8_2[1];
+    out[8*i+7] = u8_2[0];
+  }
+}
+
+static void
+report(const char* name, int npdu, double us)
+{
+  std::printf("%s: ns_per_pdu=%.1f\n",name,(npdu>0)? us*1e3/npdu : 0.0);
+}
+
+int
+main(int argc, char** argv)
+{
+  int npdu = 100000;
+  int pdu_bytes = 127;
+  int opt;
+  while((opt = getopt(argc,argv,"n:l:"))!=-1){
+    switch(opt){
+      case 'n':
+        npdu = std::atoi(optarg);
+      break;
+      case 'l':
+        pdu_bytes = std::atoi(optarg);
+      break;
+      default:
+        usage(argv[0]);
+      break;
+    }
+  }
+  if(npdu<=0 || pdu_bytes<=0){
+    usage(argv[0]);
+  }
+  std::mt19937 gen(1234);
+  std::uniform_int_distribution<int> byte_dist(0,255);
+  std::vector<unsigned char> pdus(npdu*pdu_bytes);
+  for(size_t i=0;i<pdus.size();++i){
+    pdus[i] = byte_dist(gen);
+  }
+  std::vector<unsigned char> ref(pdus.size()*8);
+  std::vector<unsigned char> chips(pdus.size()*8);
+  std::printf("# pdus=%d pdu_bytes=%d\n",npdu,pdu_bytes);
+
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for(int i=0;i<npdu;++i){
+    map_reference(&pdus[i*pdu_bytes],pdu_bytes,&ref[i*pdu_bytes*8]);
+  }
+  std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+  report("per_byte",npdu,std::chrono::duration<double,std::micro>(t1-t0).count());
+
+  t0 = std::chrono::steady_clock::now();
+  for(int i=0;i<npdu;++i){
+    gr::lsa::chip_mapper::map_bytes(&pdus[i*pdu_bytes],pdu_bytes,&chips[i*pdu_bytes*8]);
+  }
+  t1 = std::chrono::steady_clock::now();
+  report("table",npdu,std::chrono::duration<double,std::micro>(t1-t0).count());
+  if(memcmp(ref.data(),chips.data(),chips.size())){
+    std::fprintf(stderr,"table mapping differs from the reference\n");
+    return 1;
+  }
+
+  // what every PDU pays anyway to leave the block
+  t0 = std::chrono::steady_clock::now();
+  for(int i=0;i<npdu;++i){
+    pmt::pmt_t blob = pmt::make_u8vector(pdu_bytes*8,0x00);
+    pmt::pmt_t msg = pmt::cons(pmt::PMT_NIL,blob);
+  }
+  t1 = std::chrono::steady_clock::now();
+  report("message",npdu,std::chrono::duration<double,std::micro>(t1-t0).count());
+  return 0;
+}
@@ -0,0 +1,106 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Converts the comma separated payload files of the file driven
+ * transmitters to a binary payload corpus they map at start up instead of
+ * parsing. With -d the records of either format are printed back as CSV.
+ *
+ *  usage: lsa_corpus_convert input.csv output.corpus
+ *         lsa_corpus_convert -d input
+ */
+
+#include <lsa/payload_corpus.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+#include <unistd.h>
+
+static void
+usage(const char* prog)
+{
+  std::fprintf(stderr,"usage: %s input.csv output.corpus\n       %s -d input\n",prog,prog);
+  std::exit(1);
+}
+
+static int
+dump(const char* filename)
+{
+  gr::lsa::payload_corpus corpus;
+  if(!corpus.open(filename)){
+    std::fprintf(stderr,"cannot read %s\n",filename);
+    return 1;
+  }
+  for(size_t i=0;i<corpus.size();++i){
+    const unsigned char* data = corpus.data(i);
+    for(size_t k=0;k<corpus.length(i);++k){
+      std::printf((k==0)? "%d" : ",%d",(int)data[k]);
+    }
+    std::printf("\n");
+  }
+  return 0;
+}
+
+int
+main(int argc, char** argv)
+{
+  bool do_dump = false;
+  int opt;
+  while((opt = getopt(argc,argv,"d"))!=-1){
+    switch(opt){
+      case 'd':
+        do_dump = true;
+      break;
+      default:
+        usage(argv[0]);
+      break;
+    }
+  }
+  if(do_dump){
+    if(argc-optind!=1){
+      usage(argv[0]);
+    }
+    return dump(argv[optind]);
+  }
+  if(argc-optind!=2){
+    usage(argv[0]);
+  }
+  try{
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    gr::lsa::csv_record_reader reader(argv[optind]);
+    gr::lsa::payload_corpus_writer writer(argv[optind+1]);
+    std::vector<unsigned char> record;
+    uint64_t nbytes = 0;
+    while(reader.next(record)){
+      writer.append(record.data(),record.size());
+      nbytes += record.size();
+    }
+    writer.close();
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    std::printf("records=%llu payload_bytes=%llu seconds=%.2f\n",(unsigned long long)writer.size(),
+      (unsigned long long)nbytes,std::chrono::duration<double>(t1-t0).count());
+  }catch(const std::exception& e){
+    std::fprintf(stderr,"%s\n",e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,178 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Hard versus soft DSSS despreading. Random symbols are spread with the SU
+ * chip set, chips get gaussian noise at the given chip SNR, then both paths
+ * despread the same frames. Symbols per second and symbol error/reject
+ * rates are reported for each path, and for the soft path accepting on the
+ * hard decision. A symbol that is wrong or rejected counts as a symbol
+ * error in the check, which fails (exit status 2) unless the soft path
+ * loses fewer symbols than the hard one at the same Eb/N0.
+ *
+ *  usage: lsa_despread_bench [-n symbols] [-f frame_bytes] [-t threshold] [-s chip_snr_db]
+ */
+
+#include <lsa/dsss_despreader.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <unistd.h>
+
+static const unsigned int CHIPSET[16] = {
+                              3653456430,
+                              3986437410,
+                              786023250,
+                              585997365,
+                              1378802115,
+                              891481500,
+                              3276943065,
+                              2620728045,
+                              2358642555,
+                              3100205175,
+                              2072811015,
+                              2008598880,
+                              125537430,
+                              1618458825,
+                              2517072780,
+                              3378542520};
+
+static void
+usage(const char* prog)
+{
+  std::fprintf(stderr,"usage: %s [-n symbols] [-f frame_bytes] [-t threshold] [-s chip_snr_db]\n",prog);
+  std::exit(1);
+}
+
+// symbol error rate counting rejects as errors
+static double
+report(const char* name, const std::vector<unsigned char>& tx,
+  const std::vector<unsigned char>& rx, double us)
+{
+  const long int nsym = tx.size();
+  long int nerr = 0, nrej = 0;
+  for(long int i=0;i<nsym;++i){
+    nrej += (rx[i]==0xff);
+    nerr += (rx[i]!=0xff && rx[i]!=tx[i]);
+  }
+  std::printf("%s: ksym_per_sec=%.1f symbol_errors=%.3e rejects=%.3e ser=%.3e\n",name,
+    (us>0)? nsym/(us/1e3) : 0.0,(double)nerr/nsym,(double)nrej/nsym,
+    (double)(nerr+nrej)/nsym);
+  return (double)(nerr+nrej)/nsym;
+}
+
+static double
+soft_pass(const gr::lsa::dsss_despreader& despread, const std::vector<float>& chips,
+  long int nframe, int frame_sym, std::vector<unsigned char>& rx)
+{
+  // one call per frame
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for(long int f=0;f<nframe;++f){
+    despread.despread(&chips[f*frame_sym*DSSS_SYMBOL_CHIPS],frame_sym,&rx[f*frame_sym]);
+  }
+  std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double,std::micro>(t1-t0).count();
+}
+
+int
+main(int argc, char** argv)
+{
+  long int nsym = 1<<20;
+  int frame_bytes = 127;
+  int threshold = 10;
+  float snr_db = 0;
+  int opt;
+  while((opt = getopt(argc,argv,"n:f:t:s:"))!=-1){
+    switch(opt){
+      case 'n':
+        nsym = std::atol(optarg);
+      break;
+      case 'f':
+        frame_bytes = std::atoi(optarg);
+      break;
+      case 't':
+        threshold = std::atoi(optarg);
+      break;
+      case 's':
+        snr_db = std::atof(optarg);
+      break;
+      default:
+        usage(argv[0]);
+      break;
+    }
+  }
+  if(nsym<=0 || frame_bytes<=0 || threshold<0){
+    usage(argv[0]);
+  }
+  const int frame_sym = frame_bytes*2;
+  const long int nframe = (nsym+frame_sym-1)/frame_sym;
+  nsym = nframe*frame_sym;
+  std::mt19937 gen(1234);
+  std::uniform_int_distribution<int> sym_dist(0,15);
+  std::normal_distribution<float> noise(0.0F,std::pow(10.0F,-snr_db/20.0F));
+  std::vector<unsigned char> tx(nsym);
+  std::vector<float> chips(nsym*DSSS_SYMBOL_CHIPS);
+  for(long int i=0;i<nsym;++i){
+    tx[i] = sym_dist(gen);
+    for(int k=0;k<DSSS_SYMBOL_CHIPS;++k){
+      float c = ((CHIPSET[tx[i]]>>(DSSS_SYMBOL_CHIPS-1-k))&0x01)? 1.0F : -1.0F;
+      chips[i*DSSS_SYMBOL_CHIPS+k] = c+noise(gen);
+    }
+  }
+  gr::lsa::dsss_despreader despread(CHIPSET,threshold);
+  std::vector<unsigned char> rx(nsym);
+  // real antipodal chips, noise variance N0/2, four bits per symbol
+  const float ebn0_db = snr_db-10.0F*std::log10(2.0F)
+    +10.0F*std::log10(DSSS_SYMBOL_CHIPS/4.0F);
+  std::printf("# symbols=%ld frame_bytes=%d threshold=%d chip_snr_db=%.1f eb_n0_db=%.1f soft_threshold=%.3f\n",
+    nsym,frame_bytes,threshold,snr_db,ebn0_db,despread.soft_threshold());
+
+  // hard path: slice chips into a register, popcount against the chip set
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for(long int i=0;i<nsym;++i){
+    unsigned int reg = 0x00000000;
+    const float* c = &chips[i*DSSS_SYMBOL_CHIPS];
+    for(int k=0;k<DSSS_SYMBOL_CHIPS;++k){
+      reg = (reg<<1) | ((c[k]>0)? 0x01 : 0x00);
+    }
+    rx[i] = despread.despread(reg);
+  }
+  std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+  const double hard_ser = report("hard",tx,rx,std::chrono::duration<double,std::micro>(t1-t0).count());
+
+  despread.set_hard_accept(true);
+  double us = soft_pass(despread,chips,nframe,frame_sym,rx);
+  report("soft_hard_accept",tx,rx,us);
+
+  despread.set_hard_accept(false);
+  us = soft_pass(despread,chips,nframe,frame_sym,rx);
+  const double soft_ser = report("soft",tx,rx,us);
+
+  const bool pass = (hard_ser>0)? soft_ser<hard_ser : soft_ser==0;
+  std::printf("check: soft ser %.3e %s hard ser %.3e at eb_n0_db=%.1f: %s\n",soft_ser,
+    (soft_ser<hard_ser)? "<" : ">=",hard_ser,ebn0_db,pass? "PASS" : "FAIL");
+  if(!pass){
+    return 2;
+  }
+  return 0;
+}
@@ -0,0 +1,127 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Offline replay of interference objects dumped by ic_resync_cc or
+ * ic_ncfo_cc. Objects are fed straight into the IC engine back to back,
+ * per-object cancellation depth and the overall throughput are reported.
+ *
+ *  usage: lsa_ic_replay [-e resync|ncfo] [-s sps] [-p sic_passes] [-r repeat] [-q] dump_file
+ */
+
+#include <lsa/ic_resync_cc.h>
+#include <lsa/ic_ncfo_cc.h>
+#include <lsa/ic_dump.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+static void
+usage(const char* prog)
+{
+  std::fprintf(stderr,"usage: %s [-e resync|ncfo] [-s sps] [-p sic_passes] [-r repeat] [-q] dump_file\n",prog);
+  std::exit(1);
+}
+
+int
+main(int argc, char** argv)
+{
+  std::string engine("resync");
+  int repeat = 1;
+  int sps = 4;
+  int sic_passes = 1;
+  bool quiet = false;
+  int opt;
+  while((opt = getopt(argc,argv,"e:s:p:r:q"))!=-1){
+    switch(opt){
+      case 'e':
+        engine = optarg;
+      break;
+      case 's':
+        sps = std::atoi(optarg);
+      break;
+      case 'p':
+        sic_passes = std::atoi(optarg);
+      break;
+      case 'r':
+        repeat = std::atoi(optarg);
+      break;
+      case 'q':
+        quiet = true;
+      break;
+      default:
+        usage(argv[0]);
+      break;
+    }
+  }
+  if(optind>=argc || repeat<=0 || (engine!="resync" && engine!="ncfo")){
+    usage(argv[0]);
+  }
+  gr::lsa::ic_dump_reader reader(argv[optind]);
+  if(reader.taps().empty()){
+    std::fprintf(stderr,"dump file carries no filter taps\n");
+    return 1;
+  }
+  gr::lsa::ic_resync_cc::sptr resync;
+  gr::lsa::ic_ncfo_cc::sptr ncfo;
+  if(engine=="resync"){
+    resync = gr::lsa::ic_resync_cc::make(reader.taps(),sps,"",0,sic_passes);
+  }else{
+    ncfo = gr::lsa::ic_ncfo_cc::make(reader.taps(),sps);
+  }
+  std::printf("# %s: %lu objects, engine=%s, repeat=%d\n",argv[optind],reader.size(),engine.c_str(),repeat);
+  if(!quiet){
+    std::printf("# seqno nsamples nretx nmatch status depth_db usec\n");
+  }
+  long int total_samples = 0;
+  int success = 0;
+  double acc_depth = 0;
+  double total_us = 0;
+  for(int r=0;r<repeat;++r){
+    for(size_t i=0;i<reader.size();++i){
+      gr::lsa::ic_dump_record rec = reader.record(i);
+      float depth = 0;
+      std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+      bool ok = (resync)? resync->replay(rec,depth) : ncfo->replay(rec,depth);
+      std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+      double us = std::chrono::duration<double,std::micro>(t1-t0).count();
+      total_us += us;
+      total_samples += rec.nsamples();
+      if(ok){
+        success++;
+        acc_depth += depth;
+      }
+      if(!quiet && r==0){
+        std::printf("%lu %d %d %d %s %.2f %.1f\n",(unsigned long)rec.seqno(),rec.nsamples(),rec.nretx(),rec.nmatch(),
+          (ok)? "ok" : "abort",(ok)? depth : 0.0f,us);
+      }
+    }
+  }
+  long int nobj = (long int)reader.size()*repeat;
+  std::printf("# objects=%ld success=%d mean_depth_db=%.2f\n",nobj,success,(success>0)? acc_depth/success : 0.0);
+  if(total_us>0){
+    std::printf("# elapsed_ms=%.3f objects_per_sec=%.1f msamples_per_sec=%.3f\n",
+      total_us/1e3,nobj/(total_us/1e6),total_samples/total_us);
+  }
+  return 0;
+}
@@ -0,0 +1,153 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Sleep-polling threads against the shared timer_service. Each of the n
+ * timers wants a callback every period milliseconds. The polling path
+ * starts one thread per timer that sleeps a period per loop like the
+ * report and timeout threads of the blocks did. The service path
+ * schedules the same timers on a private timer_service. Threads, thread
+ * wakeups and the lateness of every callback against its intended time
+ * are reported for both paths.
+ *
+ *  usage: lsa_timer_bench [-n timers] [-p period_ms] [-t seconds]
+ */
+
+#include <lsa/timer_service.h>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <unistd.h>
+
+static void
+usage(const char* prog)
+{
+  std::fprintf(stderr,"usage: %s [-n timers] [-p period_ms] [-t seconds]\n",prog);
+  std::exit(1);
+}
+
+struct probe_t{
+  uint64_t next;
+  uint64_t period;
+  std::vector<uint64_t> late;
+};
+
+static void
+poll_loop(probe_t* probe, int period_ms, uint64_t end)
+{
+  while(gr::lsa::timer_service::now_us()<end){
+    probe->next = gr::lsa::timer_service::now_us()+probe->period;
+    boost::this_thread::sleep(boost::posix_time::milliseconds(period_ms));
+    uint64_t now = gr::lsa::timer_service::now_us();
+    probe->late.push_back(now-probe->next);
+  }
+}
+
+static void
+service_tick(probe_t* probe)
+{
+  uint64_t now = gr::lsa::timer_service::now_us();
+  probe->late.push_back(now-probe->next);
+  probe->next += probe->period;
+}
+
+static void
+report(const char* name, int threads, uint64_t wakeups, const std::vector<probe_t>& probes)
+{
+  std::vector<uint64_t> late;
+  for(size_t i=0;i<probes.size();++i){
+    late.insert(late.end(),probes[i].late.begin(),probes[i].late.end());
+  }
+  if(late.empty()){
+    std::printf("%s: no callbacks\n",name);
+    return;
+  }
+  std::sort(late.begin(),late.end());
+  double sum = 0;
+  for(size_t i=0;i<late.size();++i){
+    sum += late[i];
+  }
+  std::printf("%s: threads=%d wakeups=%lu callbacks=%lu late_us mean=%.1f p50=%lu p99=%lu max=%lu\n",
+    name,threads,(unsigned long)wakeups,(unsigned long)late.size(),sum/late.size(),
+    (unsigned long)late[late.size()/2],(unsigned long)late[late.size()*99/100],
+    (unsigned long)late.back());
+}
+
+int
+main(int argc, char** argv)
+{
+  int ntimers = 16;
+  int period_ms = 10;
+  double seconds = 5;
+  int opt;
+  while((opt = getopt(argc,argv,"n:p:t:"))!=-1){
+    switch(opt){
+      case 'n':
+        ntimers = std::atoi(optarg);
+      break;
+      case 'p':
+        period_ms = std::atoi(optarg);
+      break;
+      case 't':
+        seconds = std::atof(optarg);
+      break;
+      default:
+        usage(argv[0]);
+      break;
+    }
+  }
+  if(ntimers<=0 || period_ms<=0 || seconds<=0){
+    usage(argv[0]);
+  }
+  std::printf("# timers=%d period_ms=%d seconds=%.1f\n",ntimers,period_ms,seconds);
+  const uint64_t duration = (uint64_t)(seconds*1e6);
+
+  // one sleeping thread per timer
+  std::vector<probe_t> probes(ntimers);
+  boost::thread_group threads;
+  uint64_t end = gr::lsa::timer_service::now_us()+duration;
+  for(int i=0;i<ntimers;++i){
+    probes[i].period = period_ms*1000;
+    threads.create_thread(boost::bind(&poll_loop,&probes[i],period_ms,end));
+  }
+  threads.join_all();
+  uint64_t wakeups = 0;
+  for(int i=0;i<ntimers;++i){
+    wakeups += probes[i].late.size();
+  }
+  report("polling",ntimers,wakeups,probes);
+
+  // the same timers on one service thread, spread over the period
+  probes.assign(ntimers,probe_t());
+  gr::lsa::timer_service service;
+  const uint64_t start = gr::lsa::timer_service::now_us();
+  for(int i=0;i<ntimers;++i){
+    const double delay_ms = period_ms*(double)i/ntimers;
+    probes[i].period = period_ms*1000;
+    probes[i].next = start+(uint64_t)(delay_ms*1000.0);
+    service.schedule_every(&probes,period_ms,delay_ms,boost::bind(&service_tick,&probes[i]));
+  }
+  boost::this_thread::sleep(boost::posix_time::microseconds(duration));
+  service.cancel_all(&probes);
+  report("service",1,service.wakeups(),probes);
+  return 0;
+}
@@ -0,0 +1,113 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_ARQ_TIMER_WHEEL_H
+#define INCLUDED_LSA_ARQ_TIMER_WHEEL_H
+
+#include <lsa/api.h>
+#include <pmt/pmt.h>
+#include <stdint.h>
+#include <list>
+#include <vector>
+
+namespace gr {
+  namespace lsa {
+
+    /*!
+     * \brief Outstanding ARQ frames keyed by sequence number, with
+     * millisecond retransmission deadlines.
+     *
+     * Deadlines hash into a wheel of one millisecond slots, so adding,
+     * re-arming and acknowledging a frame cost O(1) however many frames are
+     * outstanding. Expired frames are handed out in deadline order, also
+     * when a scan spans more than a turn of the wheel or a frame is added
+     * or re-armed with a deadline already passed. Frames are also kept in
+     * the order they were last (re)armed, which is the order the
+     * transmitters used to rotate their queues in.
+     */
+    class LSA_API arq_timer_wheel
+    {
+     public:
+      struct frame_t{
+        uint16_t seq;
+        pmt::pmt_t msg;
+        // monotonic milliseconds
+        uint64_t deadline;
+        uint64_t sent;
+        uint32_t retry;
+      };
+
+      arq_timer_wheel(int slots=1024);
+      ~arq_timer_wheel();
+      // monotonic clock in milliseconds
+      static uint64_t now_ms();
+
+      // false if seq is already outstanding
+      bool add(uint16_t seq, const pmt::pmt_t& msg, uint64_t deadline, uint64_t sent);
+      // acknowledged, the frame is copied to out if given
+      bool remove(uint16_t seq, frame_t* out=NULL);
+      /*
+       * block acknowledgement, bit i of bitmap acks seq base+i. Removed
+       * frames are appended to out if given, their number is returned.
+       */
+      int remove_block(uint16_t base, uint64_t bitmap, std::vector<frame_t>* out=NULL);
+      frame_t* find(uint16_t seq);
+      // frame whose deadline passed first, NULL if none did by now
+      frame_t* next_expired(uint64_t now);
+      // new deadline for a retransmitted frame
+      void rearm(uint16_t seq, uint64_t deadline, uint64_t sent);
+      // least recently (re)armed frame, NULL if empty
+      frame_t* front();
+      // all frames, least recently (re)armed first
+      void frames(std::vector<frame_t>& out) const;
+      size_t size() const{return d_order.size();}
+      bool empty() const{return d_order.empty();}
+      void clear();
+
+     private:
+      arq_timer_wheel(const arq_timer_wheel&);
+      arq_timer_wheel& operator=(const arq_timer_wheel&);
+
+      struct entry_t{
+        frame_t frame;
+        // slot index, -1 while on the expired list
+        int slot;
+        std::list<uint16_t>::iterator slot_it;
+        std::list<uint16_t>::iterator order_it;
+      };
+      void schedule(entry_t* entry);
+      void unschedule(entry_t* entry);
+      void expire(entry_t* entry);
+      void advance(uint64_t now);
+
+      const int d_nslots;
+      std::vector< std::list<uint16_t> > d_slots;
+      std::list<uint16_t> d_expired;
+      std::list<uint16_t> d_order;
+      // indexed by sequence number
+      std::vector<entry_t*> d_index;
+      // next tick to scan
+      uint64_t d_cursor;
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_ARQ_TIMER_WHEEL_H */
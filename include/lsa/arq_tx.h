@@ -23,20 +23,42 @@
 #define INCLUDED_LSA_ARQ_TX_H
 
 #include <lsa/api.h>
+#include <lsa/mac_clock.h>
 #include <gnuradio/block.h>
 
 namespace gr {
   namespace lsa {
 
     /*!
-     * \brief <+description+>
+     * \brief Selective repeat transmitter of the frames in a data file.
      *
+     * Frames are retransmitted after an adaptive timeout estimated from
+     * the round trip times of acked frames, see rtt_estimator. The current
+     * estimate is published on stats_out. Both per-frame and block ACKs
+     * of simple_rx are accepted.
+     *
+     * \param filename comma separated payload bytes, one frame per line,
+     *        or a binary corpus written by lsa_corpus_convert
+     * \param timeout initial retransmission timeout in milliseconds
+     * \param period transmission period in milliseconds
+     * \param avg_size acked frames per report on data_out
+     * \param verb print the reports
+     * \param min_timeout lower bound of the retransmission timeout (ms)
+     * \param max_timeout upper bound of the retransmission timeout (ms)
+     * \param window new frames are only sent within this many sequence
+     * numbers of the oldest unacked one, 0 for no limit. Should not exceed
+     * the receiver window when block ACKs are used.
+     * \param aggregate pack consecutive frames of the file into full
+     * payloads, see frame_aggregator
      */
     class LSA_API arq_tx : virtual public block
     {
       public:
         typedef boost::shared_ptr<arq_tx> sptr;
-        static sptr make(const std::string& filename, int timeout,int period, int avg_size,bool verb);
+        static sptr make(const std::string& filename, int timeout,int period, int avg_size,bool verb,
+          int min_timeout=10,int max_timeout=10000,int window=0,bool aggregate=false);
+        // mac_clock::wall() unless set before the flowgraph starts
+        virtual void set_clock(const mac_clock::sptr& clock) = 0;
     };
 
   } // namespace lsa
@@ -29,14 +29,19 @@ namespace gr {
   namespace lsa {
 
     /*!
-     * \brief <+description+>
+     * \brief Spreads PDU bytes to SU chip bytes, 8 per byte.
      *
+     * Input is (meta . blob), or (meta . vector of blobs) to map a batch
+     * of PDUs with one message. The output is (nil . chips) or
+     * (nil . vector of chips) respectively.
      */
     class LSA_API chip_mapper : virtual public block
     {
     public:
       typedef boost::shared_ptr<chip_mapper> sptr;
       static sptr make();
+      // nbytes bytes in, nbytes*8 chip bytes out, first chip in the MSB
+      static void map_bytes(const unsigned char* in, size_t nbytes, unsigned char* out);
     private:
     };
 
@@ -0,0 +1,105 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_DSSS_DESPREADER_H
+#define INCLUDED_LSA_DSSS_DESPREADER_H
+
+#include <lsa/api.h>
+#include <gnuradio/gr_complex.h>
+#include <gnuradio/digital/constellation.h>
+#include <vector>
+
+namespace gr {
+  namespace lsa {
+    // chips per dsss symbol, two symbols per byte
+    #define DSSS_SYMBOL_CHIPS 32
+    #define DSSS_BYTE_CHIPS 64
+
+    /*!
+     * \brief Max-log soft bits of a constellation, MSB first like
+     * decision_maker(). Positive values favour a one.
+     */
+    class LSA_API soft_demapper
+    {
+     public:
+      soft_demapper(const gr::digital::constellation_sptr& constellation);
+      int bits_per_symbol() const{return d_bps;}
+      // n symbols in, n*bits_per_symbol() soft bits out
+      void demap(const gr_complex* in, int n, float* out) const;
+     private:
+      int d_bps;
+      std::vector<gr_complex> d_points;
+      std::vector<unsigned int> d_values;
+    };
+
+    /*!
+     * \brief Soft-decision DSSS despreader.
+     *
+     * Correlates windows of 32 soft chips against the 16 codewords of a
+     * chip set (first chip in the MSB, as the hard chip registers hold
+     * it), as one product with the 16x32 codeword matrix. The first and
+     * last chips are masked out like the hard decoder does. The best
+     * correlating codeword is accepted when its cosine with the chips
+     * reaches soft_threshold(), that cosine is the metric returned with a
+     * symbol. soft_threshold() is calibrated from the hard threshold and
+     * the chips in the mask, so that noise passes on a codeword as often as
+     * it does through the hard decoder; low-amplitude chips then count
+     * less than under the sign test. set_hard_accept() falls back to
+     * accepting on the Hamming distance of the chip signs.
+     */
+    class LSA_API dsss_despreader
+    {
+     public:
+      dsss_despreader(const unsigned int* chipset, int threshold);
+      void set_threshold(int threshold);
+      int threshold() const{return d_threshold;}
+      float soft_threshold() const{return d_soft_threshold;}
+      void set_hard_accept(bool hard){d_hard_accept = hard;}
+      bool hard_accept() const{return d_hard_accept;}
+
+      // hard decision on a chip register, 0xff if rejected
+      unsigned char despread(unsigned int reg) const;
+      // one symbol of DSSS_SYMBOL_CHIPS soft chips, 0xff if rejected
+      unsigned char despread(const float* chips, float* metric=NULL) const;
+      /*
+       * nsym consecutive symbols, e.g. a whole frame. Rejected symbols are
+       * set to 0xff, the number of accepted symbols is returned.
+       */
+      int despread(const float* chips, int nsym, unsigned char* symbols,
+        float* metrics=NULL) const;
+      // nbytes bytes of two symbols, high nibble first
+      bool decode_bytes(const float* chips, int nbytes, unsigned char* out) const;
+
+     private:
+      unsigned int d_chipset[16];
+      // codeword matrix, +1/-1 per chip
+      std::vector<float> d_code;
+      int d_threshold;
+      float d_soft_threshold;
+      bool d_hard_accept;
+      // cosine of the chips with the best codeword, stored in *best
+      float correlate(const float* chips, int* best) const;
+      void calibrate();
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_DSSS_DESPREADER_H */
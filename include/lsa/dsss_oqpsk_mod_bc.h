@@ -0,0 +1,75 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_DSSS_OQPSK_MOD_BC_H
+#define INCLUDED_LSA_DSSS_OQPSK_MOD_BC_H
+
+#include <lsa/api.h>
+#include <gnuradio/block.h>
+
+namespace gr {
+  namespace lsa {
+
+    /*!
+     * \brief SU byte stream to pulse shaped baseband bursts.
+     * \ingroup lsa
+     *
+     * Spreading, optional half chip delay of the Q rail and pulse shaping
+     * fused in one block. Without the offset it is equivalent to the
+     * byte_to_symbol_bc, interp_fir_filter_ccf(sps,taps) and
+     * burst_tagger_cc chain. Bytes are taken per length tagged packet,
+     * each burst ends with the filter tail and carries tx_sob and tx_eob
+     * tags and a length tag counting samples.
+     *
+     * With a cache depth, the baseband of recent frames is kept. A frame
+     * that differs from a cached one only in the retransmission queue
+     * index and size bytes is served from memory, the samples those bytes
+     * reach are rebuilt from the nibble waveforms, so a reused frame is
+     * identical to a fresh one. Caching needs whole packets in the
+     * input buffer, as tagged stream blocks produce them.
+     */
+    class LSA_API dsss_oqpsk_mod_bc : virtual public gr::block
+    {
+     public:
+      typedef boost::shared_ptr<dsss_oqpsk_mod_bc> sptr;
+
+      /*!
+       * \brief Return a shared_ptr to a new instance of lsa::dsss_oqpsk_mod_bc.
+       *
+       * To avoid accidental use of raw pointers, lsa::dsss_oqpsk_mod_bc's
+       * constructor is in a private implementation
+       * class. lsa::dsss_oqpsk_mod_bc::make is the public interface for
+       * creating new instances.
+       *
+       * \param tagname length tag of the input packets
+       * \param sps samples per chip
+       * \param taps pulse shaping filter at sps samples per chip
+       * \param half_chip_offset delay the Q rail by sps/2 samples, sps must be even
+       * \param cache_depth modulated frames kept, 0 disables the cache
+       */
+      static sptr make(const std::string& tagname, int sps,
+        const std::vector<float>& taps, bool half_chip_offset=false,
+        int cache_depth=0);
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_DSSS_OQPSK_MOD_BC_H */
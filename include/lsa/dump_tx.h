@@ -23,24 +23,44 @@
 #define INCLUDED_LSA_DUMP_TX_H
 
 #include <lsa/api.h>
+#include <lsa/mac_clock.h>
 #include <gnuradio/block.h>
 
 namespace gr {
   namespace lsa {
 
     /*!
-     * \brief <+description+>
+     * \brief Transmits a frame of the data file on every strobe and
+     * retransmits unacked frames.
      *
+     * The retransmission timeout adapts to the measured round trip time,
+     * see rtt_estimator. The current estimate is published on stats_out.
+     * Both per-frame and block ACKs of simple_rx are accepted.
+     *
+     * \param filename comma separated payload bytes, one frame per line,
+     *        or a binary corpus written by lsa_corpus_convert
+     * \param avg_size averaging size of the reports
+     * \param timeout initial retransmission timeout in milliseconds
+     * \param verb print periodic status
+     * \param min_timeout lower bound of the retransmission timeout (ms)
+     * \param max_timeout upper bound of the retransmission timeout (ms)
+     * \param aggregate pack consecutive frames of the file into full
+     * payloads, see frame_aggregator
      */
     class LSA_API dump_tx : virtual public block
     {
       public:
         typedef boost::shared_ptr<dump_tx> sptr;
-        static sptr make(const std::string& filename,int avg_size, float timeout, bool verb);
+        static sptr make(const std::string& filename,int avg_size, float timeout, bool verb,
+          float min_timeout=10.0, float max_timeout=10000.0, bool aggregate=false);
+        // mac_clock::wall() unless set before the flowgraph starts
+        virtual void set_clock(const mac_clock::sptr& clock) = 0;
 
         virtual void set_avg_size(int avg_size)=0;
         virtual int avg_size()const=0;
+        // restarts the RTT estimation from the given timeout
         virtual void set_timeout(float timeout)=0;
+        // current retransmission timeout
         virtual float timeout()const=0;
     };
 
@@ -23,6 +23,7 @@
 #define INCLUDED_LSA_FILE_DOWNLOADER_TX_H
 
 #include <lsa/api.h>
+#include <lsa/mac_clock.h>
 #include <gnuradio/block.h>
 
 namespace gr {
@@ -36,7 +37,16 @@ namespace gr {
     {
     public:
       typedef boost::shared_ptr<file_downloader_tx> sptr;
-      static sptr make(const std::string& filename, float mean);
+      /*!
+       * \param filename comma separated payload bytes, one frame per line,
+       *        or a binary corpus written by lsa_corpus_convert
+       * \param mean mean of the poisson interval between frames (ms)
+       * \param aggregate pack consecutive frames of the file into full
+       * payloads, see frame_aggregator
+       */
+      static sptr make(const std::string& filename, float mean, bool aggregate=false);
+      // mac_clock::wall() unless set before the flowgraph starts
+      virtual void set_clock(const mac_clock::sptr& clock) = 0;
       
     
     };
@@ -0,0 +1,76 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_FRAME_AGGREGATOR_H
+#define INCLUDED_LSA_FRAME_AGGREGATOR_H
+
+#include <lsa/api.h>
+#include <lsa/mac_clock.h>
+#include <gnuradio/block.h>
+
+namespace gr {
+  namespace lsa {
+    // every aggregate starts with these two bytes
+    #define AGG_MAGIC0 0xa5
+    #define AGG_MAGIC1 0x5a
+    #define AGG_HDR_LEN 2
+    // sub-header of an aggregated record: 0x80 | record length
+    #define AGG_SUBHDR_LEN 1
+    #define AGG_MAX_RECORD 127
+
+    /*!
+     * \brief Packs small PDUs into one payload of up to max_len bytes.
+     *
+     * A payload starts with the two byte marker AGG_MAGIC0 AGG_MAGIC1, then
+     * every record is preceded by a one byte sub-header holding its length
+     * with the top bit set. A payload is sent as soon as the next record
+     * does not fit, or max_delay milliseconds after its first record
+     * arrived. frame_deaggregator splits the payloads again.
+     *
+     * \param max_len largest aggregated payload in bytes
+     * \param max_delay longest a record waits for others in milliseconds
+     */
+    class LSA_API frame_aggregator : virtual public block
+    {
+    public:
+      typedef boost::shared_ptr<frame_aggregator> sptr;
+      static sptr make(int max_len, float max_delay);
+      // mac_clock::wall() unless set before the flowgraph starts
+      virtual void set_clock(const mac_clock::sptr& clock) = 0;
+
+      /*
+       * Appends a record to a payload under construction, false if it
+       * does not fit in max_len bytes. The marker is written ahead of the
+       * first record of an empty payload.
+       */
+      static bool append(std::vector<unsigned char>& frame,
+        const unsigned char* record, size_t len, size_t max_len);
+      /*
+       * Packs records in order into as few payloads of up to max_len
+       * bytes as possible. Throws if a record cannot fit on its own.
+       */
+      static void pack(const std::vector< std::vector<unsigned char> >& records,
+        size_t max_len, std::vector< std::vector<unsigned char> >& frames);
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_FRAME_AGGREGATOR_H */
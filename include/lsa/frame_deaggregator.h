@@ -0,0 +1,64 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_FRAME_DEAGGREGATOR_H
+#define INCLUDED_LSA_FRAME_DEAGGREGATOR_H
+
+#include <lsa/api.h>
+#include <gnuradio/block.h>
+#include <utility>
+
+namespace gr {
+  namespace lsa {
+
+    /*!
+     * \brief Splits payloads of frame_aggregator back into records.
+     *
+     * Placed after phy_crc (thr_out) or a MAC receiver, every record is
+     * published with the metadata of its payload. An offset in the
+     * metadata is skipped and set to zero on the records. Only payloads
+     * that start with the frame_aggregator marker are split, others are
+     * passed on untouched.
+     *
+     * The marker is not escaped. A plain payload starting with AGG_MAGIC0
+     * AGG_MAGIC1 (0xa5 0x5a) whose following bytes chain into valid
+     * sub-headers up to its end, e.g. 0xa5 0x5a 0x81 x, is split as an
+     * aggregate. Any other payload with the marker fails the sub-header
+     * walk and is passed on whole. Flows that mix aggregated and plain
+     * PDUs must keep plain payloads from starting with the marker.
+     */
+    class LSA_API frame_deaggregator : virtual public block
+    {
+    public:
+      typedef boost::shared_ptr<frame_deaggregator> sptr;
+      static sptr make();
+
+      /*
+       * Offsets and lengths of the records in buf, false if buf lacks the
+       * marker or its records do not add up.
+       */
+      static bool unpack(const unsigned char* buf, size_t len,
+        std::vector< std::pair<size_t,size_t> >& records);
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_FRAME_DEAGGREGATOR_H */
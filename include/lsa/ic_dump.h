@@ -0,0 +1,186 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_IC_DUMP_H
+#define INCLUDED_LSA_IC_DUMP_H
+
+#include <lsa/api.h>
+#include <gnuradio/gr_complex.h>
+#include <gnuradio/thread/thread.h>
+#include <boost/shared_ptr.hpp>
+#include <pmt/pmt.h>
+#include <cstdio>
+#include <deque>
+#include <tuple>
+#include <string>
+#include <vector>
+
+namespace gr {
+  namespace lsa {
+
+    /*
+     * On-disk layout of an interference object dump. Every field is host
+     * endian and every section starts on an 8 byte boundary so the file can
+     * be mmap'ed and the samples used in place.
+     *
+     *  file   : ic_dump_file_hdr_t | float taps[ntaps] | pad | record ...
+     *  record : ic_dump_rec_hdr_t | ic_dump_retx_t[nretx] |
+     *           ic_dump_match_t[nmatch] | pad | samples | blobs
+     *
+     * Version 1 dumps carry no matched headers, their nmatch field is zero
+     * and they read as version 2.
+     */
+    #define LSA_IC_DUMP_MAGIC "LSAICDMP"
+    #define LSA_IC_DUMP_VERSION 2
+    #define LSA_IC_DUMP_REC_MAGIC 0x424f4349 // "ICOB"
+
+    struct ic_dump_file_hdr_t{
+      char magic[8];
+      uint32_t version;
+      uint32_t ntaps;
+    };
+    struct ic_dump_rec_hdr_t{
+      uint32_t magic;
+      uint32_t rec_size;      // bytes, header included
+      uint64_t seqno;         // capture order
+      uint32_t nsamples;
+      int32_t voe_begin;
+      int32_t front_pktlen;
+      float front_phase;
+      uint16_t front_qidx;
+      uint16_t front_qsize;
+      uint16_t front_base;
+      uint16_t queue_size;    // retransmission queue size at capture
+      uint16_t nretx;
+      uint16_t nmatch;
+      uint16_t reserved[2];
+    };
+    struct ic_dump_retx_t{
+      uint16_t qidx;
+      uint16_t base;
+      int32_t pktlen;
+      uint32_t blob_offset;   // from beginning of record
+      uint32_t blob_len;
+    };
+    // a decoded SU header matched inside the span
+    struct ic_dump_match_t{
+      int32_t offset;         // samples from the beginning of the span
+      int32_t pktlen;
+      float phase;
+      uint16_t qidx;
+      uint16_t qsize;
+      uint16_t base;
+      uint16_t reserved[3];
+    };
+
+    /*!
+     * \brief A read-only view of one dumped interference object.
+     * Pointers refer directly to the mapped file.
+     */
+    class LSA_API ic_dump_record
+    {
+     public:
+      ic_dump_record(const uint8_t* base);
+      ~ic_dump_record();
+      uint64_t seqno() const{return d_hdr->seqno;}
+      int nsamples() const{return d_hdr->nsamples;}
+      int voe_begin() const{return d_hdr->voe_begin;}
+      int front_pktlen() const{return d_hdr->front_pktlen;}
+      float front_phase() const{return d_hdr->front_phase;}
+      uint16_t front_qidx() const{return d_hdr->front_qidx;}
+      uint16_t front_qsize() const{return d_hdr->front_qsize;}
+      uint16_t front_base() const{return d_hdr->front_base;}
+      uint16_t queue_size() const{return d_hdr->queue_size;}
+      int nretx() const{return d_hdr->nretx;}
+      int nmatch() const{return d_hdr->nmatch;}
+      const gr_complex* samples() const{return d_samples;}
+      const ic_dump_retx_t& retx(int i) const{return d_retx[i];}
+      const uint8_t* retx_data(int i) const{return d_base+d_retx[i].blob_offset;}
+      const ic_dump_match_t& match(int i) const{return d_match[i];}
+     private:
+      const uint8_t* d_base;
+      const ic_dump_rec_hdr_t* d_hdr;
+      const ic_dump_retx_t* d_retx;
+      const ic_dump_match_t* d_match;
+      const gr_complex* d_samples;
+    };
+
+    /*!
+     * \brief Memory mapped reader for interference object dumps.
+     *
+     * A truncated last record (writer killed) is ignored, a record whose
+     * sections do not fit in its own size throws.
+     */
+    class LSA_API ic_dump_reader
+    {
+     public:
+      ic_dump_reader(const std::string& filename);
+      ~ic_dump_reader();
+      const std::vector<float>& taps() const{return d_taps;}
+      size_t size() const{return d_records.size();}
+      ic_dump_record record(size_t i) const;
+     private:
+      int d_fd;
+      uint8_t* d_map;
+      size_t d_map_size;
+      std::vector<float> d_taps;
+      std::vector<size_t> d_records;
+    };
+
+    /*!
+     * \brief Asynchronous interference object dump writer.
+     *
+     * write() serializes the object into a private buffer and returns, a
+     * background thread appends queued records to the file. Records are
+     * dropped, never blocked on, when the backlog exceeds the given limit.
+     */
+    class LSA_API ic_dump_writer
+    {
+     public:
+      typedef boost::shared_ptr<ic_dump_writer> sptr;
+      ic_dump_writer(const std::string& filename, const std::vector<float>& taps, size_t max_backlog=256*1024*1024);
+      ~ic_dump_writer();
+      void write(
+        const gr_complex* samples,
+        int nsamples,
+        int voe_begin,
+        const pmt::pmt_t& front_msg,
+        const std::vector< std::pair<int,pmt::pmt_t> >& matched,
+        const std::vector< std::tuple<int,pmt::pmt_t,uint16_t> >& retx_stack,
+        const std::vector<int>& retx_idx);
+      uint64_t dropped() const{return d_dropped;}
+     private:
+      void run();
+      FILE* d_file;
+      gr::thread::mutex d_mutex;
+      gr::thread::condition_variable d_cond;
+      boost::shared_ptr<gr::thread::thread> d_thread;
+      std::deque< std::vector<uint8_t> > d_queue;
+      size_t d_backlog;
+      const size_t d_max_backlog;
+      uint64_t d_seqno;
+      uint64_t d_dropped;
+      bool d_finished;
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_IC_DUMP_H */
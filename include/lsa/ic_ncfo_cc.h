@@ -24,6 +24,7 @@
 
 #include <lsa/api.h>
 #include <gnuradio/block.h>
+#include <lsa/ic_dump.h>
 
 namespace gr {
   namespace lsa {
@@ -45,8 +46,29 @@ namespace gr {
        * constructor is in a private implementation
        * class. lsa::ic_ncfo_cc::make is the public interface for
        * creating new instances.
+       *
+       * \param taps pulse shaping taps used to rebuild SU samples
+       * \param sps samples per chip, one of 2, 4 or 8
+       * \param dump_file optional file to dump interference objects to
+       * \param storage format of the capture buffers: 0 gr_complex,
+       *        1 interleaved int16 scaled per block of 256 samples,
+       *        2 half precision float
+       * \param nthreads number of threads cancelling interference objects
+       *        in parallel, 1 runs the IC engine inline in the work thread
+       * \param capture name of an interference capture to share with other
+       *        IC blocks fed by the same stream, empty for a private one
+       */
+      static sptr make(const std::vector<float>& taps, int sps=4, const std::string& dump_file="",
+        int storage=0, int nthreads=1, const std::string& capture="");
+
+      /*!
+       * \brief Run the IC engine on a dumped interference object.
+       *
+       * Offline entry used by lsa_ic_replay. Returns false if the engine
+       * aborted, otherwise \p depth holds the cancellation depth in dB,
+       * the mean power ratio of the captured span over the IC output.
        */
-      static sptr make(const std::vector<float>& taps);
+      virtual bool replay(const ic_dump_record& rec, float& depth) = 0;
     };
 
   } // namespace lsa
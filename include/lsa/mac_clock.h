@@ -0,0 +1,114 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef INCLUDED_LSA_MAC_CLOCK_H
+#define INCLUDED_LSA_MAC_CLOCK_H
+
+#include <lsa/api.h>
+#include <lsa/timer_service.h>
+#include <gnuradio/basic_block.h>
+#include <pmt/pmt.h>
+#include <boost/shared_ptr.hpp>
+#include <stdint.h>
+
+namespace gr {
+  namespace lsa {
+
+    /*!
+     * \brief Clock and timers of the MAC blocks.
+     *
+     * Every block that keeps time holds one, set with its set_clock()
+     * before the flowgraph starts. The default is wall(), wall clock time
+     * on timer_service::instance().
+     *
+     * make_virtual() runs discrete-event time on a timer service of its
+     * own: the clock starts at zero, stays there until every block of the
+     * clock called started() at the end of its start(), and from then on
+     * jumps to the next deadline as soon as no message between blocks of
+     * the clock is waiting to be handled.
+     * A block publishing a message on a port calls sent(), which holds the
+     * clock once for every subscriber of the port that is on the same
+     * clock. The scoped_handler of a subscriber releases the hold of the
+     * message it was given only, so a message that reaches it through a
+     * block without a clock releases nothing. Timer callbacks run one at
+     * a time, only once every message sent so far has been handled, so a
+     * message loop of blocks on one virtual clock sees the same times and
+     * produces the same results on every run. Messages a block sends to
+     * several blocks at once are still handled in the order GNU Radio
+     * schedules them.
+     *
+     * Only message hops between blocks of the clock are counted. Samples
+     * in flight through stream blocks, messages from blocks without a
+     * clock and hops through such blocks take no virtual time, and a
+     * message GNU Radio drops from a full queue keeps the clock stopped.
+     *
+     * In GRC every block with a clock has a Clock parameter. A variable
+     * set to lsa.mac_clock.make_virtual() and given to the blocks of a
+     * flowgraph puts them on one virtual clock.
+     */
+    class LSA_API mac_clock
+    {
+     public:
+      typedef boost::shared_ptr<mac_clock> sptr;
+
+      // wall clock time, shared by all blocks of the process
+      static sptr wall();
+      // virtual time on a timer service of its own
+      static sptr make_virtual();
+
+      virtual ~mac_clock(){}
+      // microseconds, monotonic
+      virtual uint64_t now_us() const = 0;
+      virtual timer_service& timers() = 0;
+      virtual bool is_virtual() const = 0;
+
+      // from set_clock() and the destructor of the block
+      virtual void attach(gr::basic_block* block) = 0;
+      virtual void detach(gr::basic_block* block) = 0;
+      // at the end of start() of the block
+      virtual void started(gr::basic_block* block) = 0;
+      // before block publishes msg on port
+      virtual void sent(gr::basic_block* block, const pmt::pmt_t& port,
+                        const pmt::pmt_t& msg) = 0;
+      // after the handler of block given msg returned
+      virtual void handled(gr::basic_block* block, const pmt::pmt_t& msg) = 0;
+
+      // marks the handler of a message as done when it goes out of scope
+      class scoped_handler
+      {
+       public:
+        scoped_handler(const sptr& clock, gr::basic_block* block,
+                       const pmt::pmt_t& msg)
+          : d_clock(clock), d_block(block), d_msg(msg){}
+        ~scoped_handler(){d_clock->handled(d_block,d_msg);}
+       private:
+        scoped_handler(const scoped_handler&);
+        scoped_handler& operator=(const scoped_handler&);
+        const sptr d_clock;
+        gr::basic_block* const d_block;
+        const pmt::pmt_t d_msg;
+      };
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_MAC_CLOCK_H */
@@ -0,0 +1,142 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_PAYLOAD_CORPUS_H
+#define INCLUDED_LSA_PAYLOAD_CORPUS_H
+
+#include <lsa/api.h>
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace gr {
+  namespace lsa {
+
+    /*
+     * On-disk layout of a payload corpus. Every field is host endian and
+     * the index starts on an 8 byte boundary so the file can be mmap'ed
+     * and used in place.
+     *
+     *  file : payload_corpus_hdr_t | payloads | pad | uint64_t offsets[count+1]
+     *
+     * Record i is bytes offsets[i] to offsets[i+1] of the payload section.
+     */
+    #define LSA_CORPUS_MAGIC "LSACORPS"
+    #define LSA_CORPUS_VERSION 1
+
+    struct payload_corpus_hdr_t{
+      char magic[8];
+      uint32_t version;
+      uint32_t reserved;
+      uint64_t count;
+      uint64_t index_offset;  // from beginning of file
+    };
+
+    /*!
+     * \brief Reads the comma separated decimal text the transmitters
+     * used to load, one record per line.
+     */
+    class LSA_API csv_record_reader
+    {
+     public:
+      csv_record_reader(const std::string& filename);
+      ~csv_record_reader();
+      // false at the end of the file
+      bool next(std::vector<unsigned char>& record);
+     private:
+      csv_record_reader(const csv_record_reader&);
+      csv_record_reader& operator=(const csv_record_reader&);
+      bool fill();
+
+      FILE* d_file;
+      std::vector<char> d_buf;
+      size_t d_pos;
+      size_t d_len;
+    };
+
+    /*!
+     * \brief Payload records of the file driven transmitters.
+     *
+     * A binary corpus is mapped and used without parsing. Anything else
+     * is parsed as CSV text into one contiguous arena with the same
+     * layout in memory.
+     */
+    class LSA_API payload_corpus
+    {
+     public:
+      payload_corpus();
+      ~payload_corpus();
+      // false if the file cannot be opened or a binary corpus is damaged
+      bool open(const std::string& filename);
+      void clear();
+      size_t size() const{return d_count;}
+      bool empty() const{return d_count==0;}
+      const unsigned char* data(size_t i) const{return d_payload+d_offsets[i];}
+      size_t length(size_t i) const{return d_offsets[i+1]-d_offsets[i];}
+      size_t max_length() const;
+      // payload bytes of all records
+      size_t bytes() const{return d_count? d_offsets[d_count]-d_offsets[0] : 0;}
+      bool mapped() const{return d_map!=NULL;}
+      /*
+       * Packs consecutive records into payloads of up to max_len bytes,
+       * see frame_aggregator. The result is held in memory.
+       */
+      void aggregate(size_t max_len);
+
+     private:
+      payload_corpus(const payload_corpus&);
+      payload_corpus& operator=(const payload_corpus&);
+      bool map(const std::string& filename);
+      void use_arena();
+
+      const unsigned char* d_payload;
+      const uint64_t* d_offsets;
+      size_t d_count;
+      void* d_map;
+      size_t d_map_size;
+      std::vector<unsigned char> d_arena;
+      std::vector<uint64_t> d_index;
+    };
+
+    /*!
+     * \brief Writes a binary payload corpus record by record.
+     */
+    class LSA_API payload_corpus_writer
+    {
+     public:
+      payload_corpus_writer(const std::string& filename);
+      ~payload_corpus_writer();
+      void append(const unsigned char* record, size_t len);
+      // writes the index, also done by the destructor
+      void close();
+      uint64_t size() const{return d_offsets.size()-1;}
+     private:
+      payload_corpus_writer(const payload_corpus_writer&);
+      payload_corpus_writer& operator=(const payload_corpus_writer&);
+
+      FILE* d_file;
+      std::vector<uint64_t> d_offsets;
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_PAYLOAD_CORPUS_H */
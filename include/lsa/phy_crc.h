@@ -29,8 +29,21 @@ namespace gr {
   namespace lsa {
 
     /*!
-     * \brief <+description+>
+     * \brief Checks the repeated sequence field of received frames.
      *
+     * Valid frames are passed on through pdu_out. Data frames are also
+     * published on thr_out as the received blob, with a dict holding
+     * seqno, pwr and offset, the MAC header bytes ahead of the payload.
+     * For SNS users a frame of BLOCK_ACK_LEN (12) bytes is a block ACK and
+     * only goes to pdu_out, so a data frame with an 8 byte payload is
+     * delivered but not counted on thr_out.
+     *
+     * The payload is never copied, but a data frame still costs about
+     * seven PMT cells: the seqno, the seqno and pwr dict entries and the
+     * two cons cells of the outputs. The pwr differs from frame to frame
+     * and seqnos rarely repeat on thr_out, so a dict kept per seqno as
+     * su_ctrl keeps its feedback would not be reused. Removing the rest
+     * needs a thr_out format without the per frame dict.
      */
     class LSA_API phy_crc : virtual public block
     {
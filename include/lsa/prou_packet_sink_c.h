@@ -0,0 +1,73 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef INCLUDED_LSA_PROU_PACKET_SINK_C_H
+#define INCLUDED_LSA_PROU_PACKET_SINK_C_H
+
+#include <lsa/api.h>
+#include <gnuradio/block.h>
+
+namespace gr {
+  namespace lsa {
+
+    /*!
+     * \brief PU packet sink on complex baseband.
+     * \ingroup lsa
+     *
+     * Quadrature demodulation, single pole DC removal, M&M clock recovery
+     * and the PU deframer fused in one block. Equivalent to the
+     * quadrature_demod_cf, x - single_pole_iir(x), clock_recovery_mm_ff
+     * and prou_packet_sink_f chain. Decoded payloads are published on
+     * "pkt_out" as (ProU . blob).
+     */
+    class LSA_API prou_packet_sink_c : virtual public gr::block
+    {
+     public:
+      typedef boost::shared_ptr<prou_packet_sink_c> sptr;
+
+      /*!
+       * \brief Return a shared_ptr to a new instance of lsa::prou_packet_sink_c.
+       *
+       * To avoid accidental use of raw pointers, lsa::prou_packet_sink_c's
+       * constructor is in a private implementation
+       * class. lsa::prou_packet_sink_c::make is the public interface for
+       * creating new instances.
+       *
+       * \param thres chip errors tolerated per symbol
+       * \param omega samples per chip, at least 1
+       * \param gain_mu M&M phase gain
+       * \param gain_omega M&M rate gain
+       * \param omega_relative_limit maximum relative deviation of omega
+       * \param alpha DC removal filter pole
+       * \param demod_gain quadrature demodulator gain
+       */
+      static sptr make(int thres, float omega=2.0, float gain_mu=0.03,
+        float gain_omega=0.000225, float omega_relative_limit=0.0002,
+        float alpha=0.00016, float demod_gain=1.0);
+
+      virtual void set_threshold(int thres) =0 ;
+      virtual int threshold()const =0;
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_PROU_PACKET_SINK_C_H */
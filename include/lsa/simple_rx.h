@@ -23,20 +23,32 @@
 #define INCLUDED_LSA_SIMPLE_RX_H
 
 #include <lsa/api.h>
+#include <lsa/mac_clock.h>
 #include <gnuradio/block.h>
 
 namespace gr {
   namespace lsa {
 
     /*!
-     * \brief <+description+>
+     * \brief Receiver side of simple_tx, arq_tx and dump_tx.
      *
+     * With a zero window every frame is acked on its own with a 4 byte
+     * ACK. Otherwise frames are acked in selective repeat fashion: a block
+     * ACK of the window base and a bitmap of the window is sent every
+     * ack_period milliseconds, or as soon as half a window of new frames
+     * arrived. The transmitter timeout should cover the ACK period.
+     *
+     * \param window selective repeat window in frames, at most 64, 0 for
+     * per-frame ACKs
+     * \param ack_period block ACK period in milliseconds
      */
     class LSA_API simple_rx: virtual public block
     {
     public:
       typedef boost::shared_ptr<simple_rx> sptr;
-      static sptr make();
+      static sptr make(int window=0, int ack_period=100);
+      // mac_clock::wall() unless set before the flowgraph starts
+      virtual void set_clock(const mac_clock::sptr& clock) = 0;
     };
 
   } // namespace lsa
@@ -23,20 +23,36 @@
 #define INCLUDED_LSA_SIMPLE_TX_H
 
 #include <lsa/api.h>
+#include <lsa/mac_clock.h>
 #include <gnuradio/block.h>
 
 namespace gr {
   namespace lsa {
 
     /*!
-     * \brief <+description+>
+     * \brief Stop-and-wait transmitter of the frames in a data file.
      *
+     * The retransmission timeout adapts to the measured round trip time,
+     * see rtt_estimator. The current estimate is published on stats_out.
+     *
+     * \param filename comma separated payload bytes, one frame per line,
+     *        or a binary corpus written by lsa_corpus_convert
+     * \param timeout initial retransmission timeout in milliseconds
+     * \param slow wait the whole timeout even when acked early
+     * \param verb print periodic status
+     * \param min_timeout lower bound of the retransmission timeout (ms)
+     * \param max_timeout upper bound of the retransmission timeout (ms)
+     * \param aggregate pack consecutive frames of the file into full
+     * payloads, see frame_aggregator
      */
     class LSA_API simple_tx : virtual public block
     {
       public:
         typedef boost::shared_ptr<simple_tx> sptr;
-        static sptr make(const std::string& filename,float timeout,bool slow,bool verb);
+        static sptr make(const std::string& filename,float timeout,bool slow,bool verb,
+          float min_timeout=10.0,float max_timeout=10000.0,bool aggregate=false);
+        // mac_clock::wall() unless set before the flowgraph starts
+        virtual void set_clock(const mac_clock::sptr& clock) = 0;
     };
 
   } // namespace lsa
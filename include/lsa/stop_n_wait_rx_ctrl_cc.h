@@ -23,6 +23,7 @@
 #define INCLUDED_LSA_STOP_N_WAIT_RX_CTRL_CC_H
 
 #include <lsa/api.h>
+#include <lsa/mac_clock.h>
 #include <gnuradio/block.h>
 
 namespace gr {
@@ -47,6 +48,8 @@ namespace gr {
        * creating new instances.
        */
       static sptr make(float ed_thres,const std::vector<gr_complex>& samples);
+      // mac_clock::wall() unless set before the flowgraph starts
+      virtual void set_clock(const mac_clock::sptr& clock) = 0;
       virtual void set_ed_threshold(float thres)=0;
       virtual float ed_threshold()const=0;
       
@@ -23,6 +23,7 @@
 #define INCLUDED_LSA_STOP_N_WAIT_TX_BB_H
 
 #include <lsa/api.h>
+#include <lsa/mac_clock.h>
 #include <gnuradio/tagged_stream_block.h>
 
 namespace gr {
@@ -45,8 +46,13 @@ namespace gr {
        * constructor is in a private implementation
        * class. lsa::stop_n_wait_tx_bb::make is the public interface for
        * creating new instances.
+       *
+       * \param aggregate pack consecutive frames of the file into full
+       * payloads, see frame_aggregator. Stream input is sent as is.
        */
-      static sptr make(const std::string& tagname, const std::string& fileanme, bool usef, bool verb, int send, float mean);
+      static sptr make(const std::string& tagname, const std::string& fileanme, bool usef, bool verb, int send, float mean, bool aggregate=false);
+      // mac_clock::wall() unless set before the flowgraph starts
+      virtual void set_clock(const mac_clock::sptr& clock) = 0;
       virtual void set_send(int send) = 0;
     };
 
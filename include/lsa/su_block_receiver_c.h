@@ -46,8 +46,14 @@ namespace gr {
        * constructor is in a private implementation
        * class. lsa::su_block_receiver_c::make is the public interface for
        * creating new instances.
+       *
+       * \param hdr_const constellation of the DSSS chips
+       * \param threshold chip errors tolerated per symbol
+       * \param chase_depth frames kept for soft combining with their
+       * retransmissions, 0 disables combining
        */
-      static sptr make(const gr::digital::constellation_sptr& hdr_const,int threshold);
+      static sptr make(const gr::digital::constellation_sptr& hdr_const,int threshold,
+        int chase_depth=64);
     };
 
   } // namespace lsa
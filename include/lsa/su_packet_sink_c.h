@@ -46,9 +46,16 @@ namespace gr {
        * constructor is in a private implementation
        * class. lsa::su_packet_sink_c::make is the public interface for
        * creating new instances.
+       *
+       * \param hdr_const constellation of the DSSS chips
+       * \param threshold chip errors tolerated per symbol
+       * \param chase_depth frames kept for soft combining with their
+       * retransmissions, 0 disables combining
+       * \param nthreads payload decoding threads. Above 1 the work thread
+       * only finds frames and hands their samples to the workers.
        */
       static sptr make(const gr::digital::constellation_sptr& hdr_const,
-        int threshold);
+        int threshold, int chase_depth=64, int nthreads=1);
     };
 
   } // namespace lsa
@@ -23,6 +23,7 @@
 #define INCLUDED_LSA_THROUGHPUT_FILE_SINK_H
 
 #include <lsa/api.h>
+#include <lsa/mac_clock.h>
 #include <gnuradio/block.h>
 
 namespace gr {
@@ -37,6 +38,8 @@ namespace gr {
     public:
       typedef boost::shared_ptr<throughput_file_sink> sptr;
       static sptr make(const std::string& filename, int sys, bool verbose);
+      // mac_clock::wall() unless set before the flowgraph starts
+      virtual void set_clock(const mac_clock::sptr& clock) = 0;
     };
 
   } // namespace lsa
@@ -0,0 +1,139 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef INCLUDED_LSA_TIMER_SERVICE_H
+#define INCLUDED_LSA_TIMER_SERVICE_H
+
+#include <lsa/api.h>
+#include <gnuradio/thread/thread.h>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <stdint.h>
+#include <map>
+#include <set>
+
+namespace gr {
+  namespace lsa {
+
+    /*!
+     * \brief Deadlines and periodic callbacks of the message blocks, run
+     * by one thread.
+     *
+     * Timers are kept in a priority queue ordered by deadline. The thread
+     * sleeps until the earliest deadline or until an earlier timer is
+     * added, so an idle block costs no wakeups. Callbacks run one at a
+     * time on the timer thread and should return quickly.
+     *
+     * Every timer carries an owner, normally the block. A block cancels
+     * single timers from anywhere, its message handlers included, and
+     * calls cancel_all() from stop() so that no callback of it runs
+     * afterwards.
+     *
+     * A service built with virtual_time runs on virtual time instead,
+     * see mac_clock::make_virtual(). Its clock starts at zero and only
+     * moves when the thread jumps it to the earliest deadline. Every
+     * message between blocks of the clock takes a hold() when it is
+     * published and a release() when its handler returns, and the thread
+     * neither runs a callback nor moves the clock while anything is held.
+     * Reading the clock never holds it.
+     */
+    class LSA_API timer_service
+    {
+     public:
+      typedef uint64_t timer_id;
+      typedef boost::function<void()> callback_t;
+
+      // wall clock, shared by all blocks of the process
+      static timer_service& instance();
+      // clock of instance() in microseconds, monotonic
+      static uint64_t now_us();
+
+      explicit timer_service(bool virtual_time=false);
+      ~timer_service();
+      uint64_t now() const;
+      bool is_virtual() const{return d_virtual;}
+      // callback once, delay_ms from now
+      timer_id schedule(const void* owner, double delay_ms, const callback_t& callback);
+      // callback every period_ms, the first one delay_ms from now
+      timer_id schedule_every(const void* owner, double period_ms, double delay_ms,
+        const callback_t& callback);
+      /*
+       * false if the callback already ran or is running right now. Never
+       * blocks, a periodic timer cancelled from its own callback stops.
+       */
+      bool cancel(timer_id id);
+      /*
+       * Drops every timer of owner and waits for a callback of owner that
+       * is running to return, unless called from that callback. Must not be
+       * called holding a lock the callbacks take.
+       */
+      void cancel_all(const void* owner);
+      size_t size() const;
+      // times the thread woke up, to compare against polling threads
+      uint64_t wakeups() const;
+      // virtual time stays put while anything is held
+      void hold();
+      void release();
+
+     private:
+      timer_service(const timer_service&);
+      timer_service& operator=(const timer_service&);
+
+      struct entry_t{
+        const void* owner;
+        uint64_t deadline;
+        // microseconds, 0 for a single shot
+        uint64_t period;
+        bool periodic;
+        callback_t callback;
+      };
+      typedef std::pair<uint64_t,timer_id> key_t;
+      timer_id add(const void* owner, uint64_t delay, uint64_t period,
+        bool periodic, const callback_t& callback);
+      // with d_mutex held
+      void drop(const void* owner);
+      void run();
+
+      // with d_mutex held
+      uint64_t clock() const;
+
+      mutable gr::thread::mutex d_mutex;
+      gr::thread::condition_variable d_changed;
+      gr::thread::condition_variable d_idle;
+      boost::shared_ptr<gr::thread::thread> d_thread;
+      std::map<timer_id,entry_t> d_timers;
+      std::set<key_t> d_queue;
+      timer_id d_next_id;
+      // timer whose callback is running, 0 if none
+      timer_id d_running;
+      const void* d_running_owner;
+      uint64_t d_wakeups;
+      bool d_finished;
+      const bool d_virtual;
+      uint64_t d_virtual_now;
+      // messages and callbacks not done yet, virtual time only
+      uint64_t d_held;
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_TIMER_SERVICE_H */
@@ -0,0 +1,240 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <lsa/arq_timer_wheel.h>
+#include <chrono>
+#include <stdexcept>
+
+namespace gr {
+  namespace lsa {
+
+    arq_timer_wheel::arq_timer_wheel(int slots)
+      : d_nslots(slots),
+        d_index(0x10000,(entry_t*)NULL)
+    {
+      if(slots<=0){
+        throw std::invalid_argument("Timer wheel needs at least one slot");
+      }
+      d_slots.resize(d_nslots);
+      // the first scan covers the whole wheel
+      d_cursor = 0;
+    }
+
+    arq_timer_wheel::~arq_timer_wheel()
+    {
+      clear();
+    }
+
+    uint64_t
+    arq_timer_wheel::now_ms()
+    {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void
+    arq_timer_wheel::schedule(entry_t* entry)
+    {
+      if(entry->frame.deadline<d_cursor){
+        // its tick was scanned already
+        expire(entry);
+      }else{
+        entry->slot = entry->frame.deadline%d_nslots;
+        std::list<uint16_t>& slot = d_slots[entry->slot];
+        entry->slot_it = slot.insert(slot.end(),entry->frame.seq);
+      }
+    }
+
+    void
+    arq_timer_wheel::unschedule(entry_t* entry)
+    {
+      if(entry->slot<0){
+        d_expired.erase(entry->slot_it);
+      }else{
+        d_slots[entry->slot].erase(entry->slot_it);
+      }
+    }
+
+    void
+    arq_timer_wheel::expire(entry_t* entry)
+    {
+      // slots are scanned in tick order but a slot holds every turn of the
+      // wheel, and late frames come after the scan: keep the list sorted,
+      // equal deadlines in the order they expired
+      std::list<uint16_t>::iterator it = d_expired.end();
+      while(it!=d_expired.begin()){
+        std::list<uint16_t>::iterator prev = it;
+        --prev;
+        if(d_index[*prev]->frame.deadline<=entry->frame.deadline){
+          break;
+        }
+        it = prev;
+      }
+      entry->slot = -1;
+      entry->slot_it = d_expired.insert(it,entry->frame.seq);
+    }
+
+    void
+    arq_timer_wheel::advance(uint64_t now)
+    {
+      if(now<d_cursor){
+        return;
+      }
+      // a whole turn or more since the last scan visits every slot once
+      const uint64_t nticks = std::min(now-d_cursor+1,(uint64_t)d_nslots);
+      for(uint64_t t=0;t<nticks;++t){
+        std::list<uint16_t>& slot = d_slots[(d_cursor+t)%d_nslots];
+        std::list<uint16_t>::iterator it = slot.begin();
+        while(it!=slot.end()){
+          entry_t* entry = d_index[*it];
+          if(entry->frame.deadline<=now){
+            // later turns of the wheel stay in the slot
+            it = slot.erase(it);
+            expire(entry);
+          }else{
+            ++it;
+          }
+        }
+      }
+      d_cursor = now+1;
+    }
+
+    bool
+    arq_timer_wheel::add(uint16_t seq, const pmt::pmt_t& msg, uint64_t deadline, uint64_t sent)
+    {
+      if(d_index[seq]!=NULL){
+        return false;
+      }
+      entry_t* entry = new entry_t;
+      entry->frame.seq = seq;
+      entry->frame.msg = msg;
+      entry->frame.deadline = deadline;
+      entry->frame.sent = sent;
+      entry->frame.retry = 0;
+      entry->order_it = d_order.insert(d_order.end(),seq);
+      schedule(entry);
+      d_index[seq] = entry;
+      return true;
+    }
+
+    bool
+    arq_timer_wheel::remove(uint16_t seq, frame_t* out)
+    {
+      entry_t* entry = d_index[seq];
+      if(entry==NULL){
+        return false;
+      }
+      if(out!=NULL){
+        *out = entry->frame;
+      }
+      unschedule(entry);
+      d_order.erase(entry->order_it);
+      d_index[seq] = NULL;
+      delete entry;
+      return true;
+    }
+
+    int
+    arq_timer_wheel::remove_block(uint16_t base, uint64_t bitmap, std::vector<frame_t>* out)
+    {
+      int nremoved = 0;
+      frame_t frame;
+      for(int i=0;bitmap!=0;++i,bitmap>>=1){
+        if((bitmap&0x01) && remove((uint16_t)(base+i),(out==NULL)? NULL : &frame)){
+          if(out!=NULL){
+            out->push_back(frame);
+          }
+          nremoved++;
+        }
+      }
+      return nremoved;
+    }
+
+    arq_timer_wheel::frame_t*
+    arq_timer_wheel::find(uint16_t seq)
+    {
+      entry_t* entry = d_index[seq];
+      return (entry==NULL)? NULL : &entry->frame;
+    }
+
+    arq_timer_wheel::frame_t*
+    arq_timer_wheel::next_expired(uint64_t now)
+    {
+      advance(now);
+      if(d_expired.empty()){
+        return NULL;
+      }
+      return &d_index[d_expired.front()]->frame;
+    }
+
+    void
+    arq_timer_wheel::rearm(uint16_t seq, uint64_t deadline, uint64_t sent)
+    {
+      entry_t* entry = d_index[seq];
+      if(entry==NULL){
+        return;
+      }
+      unschedule(entry);
+      entry->frame.deadline = deadline;
+      entry->frame.sent = sent;
+      schedule(entry);
+      d_order.splice(d_order.end(),d_order,entry->order_it);
+    }
+
+    arq_timer_wheel::frame_t*
+    arq_timer_wheel::front()
+    {
+      if(d_order.empty()){
+        return NULL;
+      }
+      return &d_index[d_order.front()]->frame;
+    }
+
+    void
+    arq_timer_wheel::frames(std::vector<frame_t>& out) const
+    {
+      out.clear();
+      std::list<uint16_t>::const_iterator it;
+      for(it=d_order.begin();it!=d_order.end();++it){
+        out.push_back(d_index[*it]->frame);
+      }
+    }
+
+    void
+    arq_timer_wheel::clear()
+    {
+      std::list<uint16_t>::iterator it;
+      for(it=d_order.begin();it!=d_order.end();++it){
+        delete d_index[*it];
+        d_index[*it] = NULL;
+      }
+      d_order.clear();
+      d_expired.clear();
+      for(int i=0;i<d_nslots;++i){
+        d_slots[i].clear();
+      }
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
@@ -24,8 +24,12 @@
 
 #include <gnuradio/io_signature.h>
 #include <lsa/arq_tx.h>
+#include <lsa/arq_timer_wheel.h>
+#include "rtt_estimator.h"
+#include "block_ack.h"
+#include "utils.h"
 #include <gnuradio/block_detail.h>
-#include <fstream>
+#include <lsa/payload_corpus.h>
 
 namespace gr {
   namespace lsa {
@@ -38,221 +42,234 @@ namespace gr {
     class arq_tx_impl : public arq_tx
     {
       public:
-        arq_tx_impl(const std::string& filename,int timeout,int period, int avg_size,bool verb): block("arq_tx",
+        arq_tx_impl(const std::string& filename,int timeout,int period, int avg_size,bool verb,
+          int min_timeout,int max_timeout,int window,bool aggregate): block("arq_tx",
                   gr::io_signature::make(0,0,0),
                   gr::io_signature::make(0,0,0)),
-                  d_timeout((long)timeout),
-                  d_period((long)period),
                   d_ack_port(pmt::mp("ack_in")),
                   d_pdu_port(pmt::mp("pdu_out")),
                   d_data_port(pmt::mp("data_out")),
+                  d_stats_port(pmt::mp("stats_out")),
+                  d_window(window),
+                  d_aggregate(aggregate),
+                  d_period((long)period),
+                  d_rtt(timeout,min_timeout,max_timeout),
                   d_avg_size(avg_size)
         {
-          if(timeout<0 || period<0 || avg_size<=0){
+          if(timeout<0 || period<0 || avg_size<=0 || window<0){
             throw std::invalid_argument("timeout or period is invalid");
           }
-          d_data_src.clear();
           if(!read_data(filename)){
             throw std::runtime_error("Failed when reading data source");
           }
           message_port_register_in(d_ack_port);
           message_port_register_out(d_pdu_port);
           message_port_register_out(d_data_port);
+          message_port_register_out(d_stats_port);
           set_msg_handler(d_ack_port,boost::bind(&arq_tx_impl::msg_in,this,_1));
+          d_clock = mac_clock::wall();
           d_seq_no =0;
           d_ack_no =0;
+          d_win_base =0;
           d_verb = verb;
           d_success_cnt=0;
           d_channel_use=0;
           d_acc_delay=0;
         }
         ~arq_tx_impl(){
-
+          d_clock->detach(this);
+        }
+        void set_clock(const mac_clock::sptr& clock)
+        {
+          if(!clock){
+            throw std::invalid_argument("Clock cannot be null");
+          }
+          d_clock->detach(this);
+          d_clock = clock;
+          d_clock->attach(this);
         }
         bool start()
         {
-          d_finished = false;
-          d_system_time = boost::posix_time::second_clock::local_time();
-          d_thread = boost::shared_ptr<gr::thread::thread>
-            (new gr::thread::thread(boost::bind(&arq_tx_impl::run,this)));
+          d_system_time = d_clock->now_us();
+          // first frame right away, then one per period
+          d_clock->timers().schedule_every(this,d_period,0,
+            boost::bind(&arq_tx_impl::tick,this));
+          d_clock->started(this);
           return block::start();
         }
         bool stop()
         {
-          d_finished = true;
-          d_thread->interrupt();
-          d_thread->join();
+          d_clock->timers().cancel_all(this);
           return block::stop();
         }
         void msg_in(pmt::pmt_t msg)
         {
+          mac_clock::scoped_handler handled(d_clock,this,msg);
           gr::thread::scoped_lock guard(d_mutex);
           pmt::pmt_t k = pmt::car(msg);
           pmt::pmt_t v = pmt::cdr(msg);
           assert(pmt::is_blob(v));
           size_t io(0);
           const uint8_t* uvec = pmt::u8vector_elements(v,io);
-          std::list<std::tuple<uint16_t,boost::posix_time::ptime,int> >::iterator it=d_pending.begin();
+          uint16_t base1, base2;
+          uint64_t bitmap;
+          d_acked.clear();
           if(io==4){
-            uint16_t base1, base2;
             base1 = uvec[0]<<8;
             base1|= uvec[1];
             base2 = uvec[2]<<8;
             base2|= uvec[3];
-            if(base1==base2){
-              // crc_passed
-              while(it!=d_pending.end()){
-                if(std::get<0>(*it)==base1){
-                  d_channel_use += std::get<2>(*it);
-                  boost::posix_time::time_duration diff= boost::posix_time::microsec_clock::local_time()-std::get<1>(*it);
-                  d_acc_delay += diff.total_milliseconds();
-                  it=d_pending.erase(it);
-                  //DEBUG<<"<ARQ TX>Acked base="<<base1<<std::endl;
-                  d_success_cnt++;
-                  break;
-                }
-                it++;
-              }
-              if(d_success_cnt%d_avg_size == 0){
-                pmt::pmt_t dict = pmt::make_dict();
-                dict = pmt::dict_add(dict,pmt::intern("acc_size"),pmt::from_long(d_avg_size));
-                dict = pmt::dict_add(dict,pmt::intern("acc_delay"),pmt::from_long(d_avg_size));
-                dict = pmt::dict_add(dict,pmt::intern("acc_ch_use"),pmt::from_long(d_avg_size));
-                dict = pmt::dict_add(dict,pmt::intern("total_suc"),pmt::from_long(d_avg_size));
-                message_port_pub(d_data_port,pmt::cons(dict,pmt::PMT_NIL));
-                // accumulate a averaging length
-                VERBOSE << "<ARQ TX> ,acc_size="<<d_avg_size<<" ,acc_delay="<<d_acc_delay<<" ,acc_channel_use="<<d_channel_use<<" ,total_success="<<d_success_cnt<<std::endl;
-                // reset
-                d_acc_delay =0;
-                d_channel_use=0;
-              }
-              if(base1 == d_ack_no){
-                //DEBUG<<"<ARQ TX>Acked base point, increment to next number, current:"<<d_ack_no<<std::endl;
-                if(d_pending.empty()){
-                  d_ack_no = d_seq_no;
-                }else{
-                  it = d_pending.begin();
-                  boost::posix_time::ptime min_time = std::get<1>(*it);
-                  uint16_t min_seq = std::get<0>(*it);
-                  while(it!=d_pending.end()){
-                    if(std::get<1>(*it)<min_time){
-                      min_time = std::get<1>(*it);
-                      min_seq = std::get<0>(*it);
-                    }
-                    ++it;
-                  }
-                  d_ack_no = min_seq;
-                } 
-              }
-            }// crc passed
+            if(base1!=base2){
+              return;
+            }
+            // crc_passed
+            arq_timer_wheel::frame_t acked;
+            if(d_pending.remove(base1,&acked)){
+              d_acked.push_back(acked);
+            }
+          }else if(block_ack_parse(uvec,io,base1,bitmap)){
+            // the whole window at once
+            d_pending.remove_block(base1,bitmap,&d_acked);
+          }else{
+            return;
+          }
+          const uint64_t now = d_clock->now_us()/1000;
+          bool sampled = false;
+          for(size_t i=0;i<d_acked.size();++i){
+            frame_acked(d_acked[i],now);
+            if(d_rtt.acked((double)(now-d_acked[i].sent),d_acked[i].retry)){
+              sampled = true;
+            }
+          }
+          if(sampled){
+            pmt::pmt_t out = pmt::cons(d_rtt.stats(),pmt::PMT_NIL);
+            d_clock->sent(this,d_stats_port,out);
+            message_port_pub(d_stats_port,out);
+          }
+          // oldest unacked frame bounds the window
+          while(d_win_base!=d_seq_no && d_pending.find(d_win_base)==NULL){
+            d_win_base++;
+          }
+          if(d_pending.find(d_ack_no)==NULL){
+            //DEBUG<<"<ARQ TX>Acked base point, increment to next number, current:"<<d_ack_no<<std::endl;
+            if(d_pending.empty()){
+              d_ack_no = d_seq_no;
+            }else{
+              // least recently sent
+              d_ack_no = d_pending.front()->seq;
+            }
           }
         }
       private:
-        void run()
+        void frame_acked(const arq_timer_wheel::frame_t& acked, uint64_t now)
+        {
+          d_channel_use += acked.retry+1;
+          d_acc_delay += now-acked.sent;
+          //DEBUG<<"<ARQ TX>Acked base="<<acked.seq<<std::endl;
+          d_success_cnt++;
+          if(d_success_cnt%d_avg_size == 0){
+            pmt::pmt_t dict = pmt::make_dict();
+            dict = pmt::dict_add(dict,pmt::intern("acc_size"),pmt::from_long(d_avg_size));
+            dict = pmt::dict_add(dict,pmt::intern("acc_delay"),pmt::from_long(d_avg_size));
+            dict = pmt::dict_add(dict,pmt::intern("acc_ch_use"),pmt::from_long(d_avg_size));
+            dict = pmt::dict_add(dict,pmt::intern("total_suc"),pmt::from_long(d_avg_size));
+            pmt::pmt_t out = pmt::cons(dict,pmt::PMT_NIL);
+            d_clock->sent(this,d_data_port,out);
+            message_port_pub(d_data_port,out);
+            // accumulate a averaging length
+            VERBOSE << "<ARQ TX> ,acc_size="<<d_avg_size<<" ,acc_delay="<<d_acc_delay<<" ,acc_channel_use="<<d_channel_use<<" ,total_success="<<d_success_cnt<<std::endl;
+            // reset
+            d_acc_delay =0;
+            d_channel_use=0;
+          }
+        }
+        void tick()
         {
-          uint16_t ack_image;
-          while(!d_finished){
-            // generate next message
-            ack_image = d_ack_no;
-            generate_msg();
+          if(generate_msg()){
+            d_clock->sent(this,d_pdu_port,d_current_msg);
             message_port_pub(d_pdu_port,d_current_msg);
-            gr::thread::scoped_lock lock(d_mutex);
-            d_ack_received.timed_wait(lock,boost::posix_time::milliseconds(d_period));
-            lock.unlock();
-            if(d_finished){
-              return;
-            }
-            /*if(ack_image!=d_ack_no){
-              // acked
-            }else{
-              // timeout
-            }*/
           }
         }
         bool read_data(const std::string& filename)
         {
           gr::thread::scoped_lock guard(d_mutex);
-          std::string str,line;
-          d_file.open(filename.c_str(),std::fstream::in);
-          if(!d_file.is_open()){
+          if(!d_data_src.open(filename)){
             return false;
           }
-          while(getline(d_file,line,'\n')){
-            std::istringstream temp(line);
-            std::vector<uint8_t> u8;
-            while(getline(temp,str,',')){
-              int tmp = std::atoi(str.c_str());
-              if(u8.size()>MAXLEN){
-                throw std::runtime_error("message exceed maximum size");
-              }
-              u8.push_back((uint8_t)tmp);
-            }
-            d_data_src.push_back(u8);
+          if(d_data_src.max_length()>MAXLEN){
+            throw std::runtime_error("message exceed maximum size");
           }
-          d_file.close();
-          return true;
+          if(d_aggregate){
+            d_data_src.aggregate(MAX_LSA_PAYLOAD-SEQLEN);
+          }
+          return !d_data_src.empty();
         }
-        void generate_msg()
+        // false when the window is full and nothing timed out
+        bool generate_msg()
         {
           gr::thread::scoped_lock guard(d_mutex);
           uint16_t seq = d_seq_no;
-          std::list<std::tuple<uint16_t,boost::posix_time::ptime,int> >::iterator it=d_pending.begin();
-          boost::posix_time::time_duration diff;
-          if(!d_pending.empty()){
-            diff = boost::posix_time::microsec_clock::local_time()-std::get<1>(*it);
-            if(diff.total_milliseconds()>=d_timeout){
-              seq = std::get<0>(*it);
-              d_pending.push_back(std::make_tuple(seq,boost::posix_time::microsec_clock::local_time(),std::get<2>(*it)+1));
-              d_pending.pop_front();
-              //DEBUG<<"<ARQ TX>Found timeout retry:"<<seq<<" ,current seqno="<<d_seq_no<<std::endl;
-            }else{
-              d_pending.push_back(std::make_tuple(seq,boost::posix_time::microsec_clock::local_time(),1));
-              d_seq_no = (d_seq_no==0xffff)? 0 : d_seq_no+1;
-              //DEBUG<<"<ARQ TX>Not timeout ,current seqno="<<d_seq_no<<std::endl;
-            }
+          const uint64_t now = d_clock->now_us()/1000;
+          arq_timer_wheel::frame_t* timeout = d_pending.next_expired(now);
+          if(timeout!=NULL){
+            seq = timeout->seq;
+            timeout->retry++;
+            d_rtt.backoff();
+            d_pending.rearm(seq,now+(uint64_t)d_rtt.rto(),now);
+            pmt::pmt_t out = pmt::cons(d_rtt.stats(),pmt::PMT_NIL);
+            d_clock->sent(this,d_stats_port,out);
+            message_port_pub(d_stats_port,out);
+            //DEBUG<<"<ARQ TX>Found timeout retry:"<<seq<<" ,current seqno="<<d_seq_no<<std::endl;
+          }else if(d_window>0 && (uint16_t)(d_seq_no-d_win_base)>=d_window){
+            return false;
           }else{
-            d_pending.push_back(std::make_tuple(seq,boost::posix_time::microsec_clock::local_time(),1));
+            // a frame still pending after a wrap around is given up
+            d_pending.remove(seq);
+            d_pending.add(seq,pmt::PMT_NIL,now+(uint64_t)d_rtt.rto(),now);
             d_seq_no = (d_seq_no==0xffff)? 0 : d_seq_no+1;
-            //DEBUG<<"<ARQ TX>Empty pending queue, current seqno="<<d_seq_no<<std::endl;
           }
           const uint8_t* u8_seq = (const uint8_t*) &seq;
           d_buf[0] = u8_seq[1];
           d_buf[1] = u8_seq[0];
           d_buf[2] = u8_seq[1];
           d_buf[3] = u8_seq[0];
-          memcpy(d_buf+SEQLEN,d_data_src[seq].data(),sizeof(char)*d_data_src[seq].size());
-          d_current_msg = pmt::cons(pmt::PMT_NIL,pmt::make_blob(d_buf,SEQLEN+d_data_src[seq].size()));
+          const size_t idx = seq%d_data_src.size();
+          memcpy(d_buf+SEQLEN,d_data_src.data(idx),sizeof(char)*d_data_src.length(idx));
+          d_current_msg = pmt::cons(pmt::PMT_NIL,pmt::make_blob(d_buf,SEQLEN+d_data_src.length(idx)));
+          return true;
         }
 
         const pmt::pmt_t d_ack_port;
         const pmt::pmt_t d_pdu_port;
         const pmt::pmt_t d_data_port;
-        boost::shared_ptr<gr::thread::thread> d_thread;
+        const pmt::pmt_t d_stats_port;
         gr::thread::mutex d_mutex;
-        gr::thread::condition_variable d_ack_received;
-        int d_window_size;
+        mac_clock::sptr d_clock;
+        const int d_window;
+        const bool d_aggregate;
+        std::vector<arq_timer_wheel::frame_t> d_acked;
         uint16_t d_seq_no;
         uint16_t d_ack_no;
-        boost::posix_time::ptime d_system_time;
-        std::list<std::tuple<uint16_t,boost::posix_time::ptime,int> > d_pending;
+        uint16_t d_win_base;
+        uint64_t d_system_time;
+        arq_timer_wheel d_pending;
         long d_period;
-        long d_timeout;
-        bool d_finished;
+        rtt_estimator d_rtt;
         int d_channel_use;
         bool d_verb;
         long int d_success_cnt;
         long int d_avg_size;
         long int d_acc_delay;
-        std::fstream d_file;
-        std::vector< std::vector<unsigned char> > d_data_src;
+        payload_corpus d_data_src;
         unsigned char d_buf[256];
         pmt::pmt_t d_current_msg;
     };
 
     arq_tx::sptr
-    arq_tx::make(const std::string& filename, int timeout,int period, int avg_size,bool verb)
+    arq_tx::make(const std::string& filename, int timeout,int period, int avg_size,bool verb,
+      int min_timeout,int max_timeout,int window,bool aggregate)
     {
-      return gnuradio::get_initial_sptr(new arq_tx_impl(filename,timeout,period,avg_size,verb));
+      return gnuradio::get_initial_sptr(new arq_tx_impl(filename,timeout,period,avg_size,verb,min_timeout,max_timeout,window,aggregate));
     }
 
   } /* namespace lsa */
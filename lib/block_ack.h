@@ -0,0 +1,71 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_BLOCK_ACK_H
+#define INCLUDED_LSA_BLOCK_ACK_H
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace gr {
+  namespace lsa {
+    /*
+     * Block ACK of a selective repeat window. Like the 4 byte ACK it starts
+     * with the base sequence number and its copy, followed by a 64 bit
+     * bitmap, most significant byte first. Bit i acknowledges base+i.
+     */
+    #define BLOCK_ACK_LEN 12
+    #define BLOCK_ACK_WINDOW 64
+
+    static inline void
+    block_ack_pack(uint16_t base, uint64_t bitmap, unsigned char* out)
+    {
+      out[0] = (unsigned char)(base>>8);
+      out[1] = (unsigned char)(base&0xff);
+      out[2] = out[0];
+      out[3] = out[1];
+      for(int i=0;i<8;++i){
+        out[4+i] = (unsigned char)(bitmap>>(56-8*i));
+      }
+    }
+
+    // false if buf is not a block ACK or its base copy mismatches
+    static inline bool
+    block_ack_parse(const unsigned char* buf, size_t len, uint16_t& base, uint64_t& bitmap)
+    {
+      if(len!=BLOCK_ACK_LEN){
+        return false;
+      }
+      base = (buf[0]<<8) | buf[1];
+      uint16_t base_copy = (buf[2]<<8) | buf[3];
+      if(base!=base_copy){
+        return false;
+      }
+      bitmap = 0;
+      for(int i=0;i<8;++i){
+        bitmap = (bitmap<<8) | buf[4+i];
+      }
+      return true;
+    }
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_BLOCK_ACK_H */
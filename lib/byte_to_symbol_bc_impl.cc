@@ -24,6 +24,7 @@
 
 #include <gnuradio/io_signature.h>
 #include "byte_to_symbol_bc_impl.h"
+#include "su_chip_map.h"
 
 namespace gr {
   namespace lsa {
@@ -31,27 +32,7 @@ namespace gr {
     
     #define CHIPRATE 8
     #define SYMBITS 4
-    typedef std::complex<float> CPX;
     static const int d_rate = CHIPRATE*SYMBITS;
-    static const int d_symbol_size = 16;
-    static const CPX d_map[][16] = {
-{CPX(1,1),CPX(-1,1),CPX(1,-1),CPX(-1,1),CPX(1,1),CPX(-1,-1),CPX(-1,-1),CPX(1,1),CPX(-1,1),CPX(-1,1),CPX(-1,-1),CPX(1,-1),CPX(-1,-1),CPX(1,-1),CPX(1,1),CPX(1,-1)},
-{CPX(1,1),CPX(1,-1),CPX(1,1),CPX(-1,1),CPX(1,-1),CPX(-1,1),CPX(1,1),CPX(-1,-1),CPX(-1,-1),CPX(1,1),CPX(-1,1),CPX(-1,1),CPX(-1,-1),CPX(1,-1),CPX(-1,-1),CPX(1,-1)},
-{CPX(-1,-1),CPX(1,-1),CPX(1,1),CPX(1,-1),CPX(1,1),CPX(-1,1),CPX(1,-1),CPX(-1,1),CPX(1,1),CPX(-1,-1),CPX(-1,-1),CPX(1,1),CPX(-1,1),CPX(-1,1),CPX(-1,-1),CPX(1,-1)},
-{CPX(-1,-1),CPX(1,-1),CPX(-1,-1),CPX(1,-1),CPX(1,1),CPX(1,-1),CPX(1,1),CPX(-1,1),CPX(1,-1),CPX(-1,1),CPX(1,1),CPX(-1,-1),CPX(-1,-1),CPX(1,1),CPX(-1,1),CPX(-1,1)},
-{CPX(-1,1),CPX(-1,1),CPX(-1,-1),CPX(1,-1),CPX(-1,-1),CPX(1,-1),CPX(1,1),CPX(1,-1),CPX(1,1),CPX(-1,1),CPX(1,-1),CPX(-1,1),CPX(1,1),CPX(-1,-1),CPX(-1,-1),CPX(1,1)},
-{CPX(-1,-1),CPX(1,1),CPX(-1,1),CPX(-1,1),CPX(-1,-1),CPX(1,-1),CPX(-1,-1),CPX(1,-1),CPX(1,1),CPX(1,-1),CPX(1,1),CPX(-1,1),CPX(1,-1),CPX(-1,1),CPX(1,1),CPX(-1,-1)},
-{CPX(1,1),CPX(-1,-1),CPX(-1,-1),CPX(1,1),CPX(-1,1),CPX(-1,1),CPX(-1,-1),CPX(1,-1),CPX(-1,-1),CPX(1,-1),CPX(1,1),CPX(1,-1),CPX(1,1),CPX(-1,1),CPX(1,-1),CPX(-1,1)},
-{CPX(1,-1),CPX(-1,1),CPX(1,1),CPX(-1,-1),CPX(-1,-1),CPX(1,1),CPX(-1,1),CPX(-1,1),CPX(-1,-1),CPX(1,-1),CPX(-1,-1),CPX(1,-1),CPX(1,1),CPX(1,-1),CPX(1,1),CPX(-1,1)},
-{CPX(1,-1),CPX(-1,-1),CPX(1,1),CPX(-1,-1),CPX(1,-1),CPX(-1,1),CPX(-1,1),CPX(1,-1),CPX(-1,-1),CPX(-1,-1),CPX(-1,1),CPX(1,1),CPX(-1,1),CPX(1,1),CPX(1,-1),CPX(1,1)},
-{CPX(1,-1),CPX(1,1),CPX(1,-1),CPX(-1,-1),CPX(1,1),CPX(-1,-1),CPX(1,-1),CPX(-1,1),CPX(-1,1),CPX(1,-1),CPX(-1,-1),CPX(-1,-1),CPX(-1,1),CPX(1,1),CPX(-1,1),CPX(1,1)},
-{CPX(-1,1),CPX(1,1),CPX(1,-1),CPX(1,1),CPX(1,-1),CPX(-1,-1),CPX(1,1),CPX(-1,-1),CPX(1,-1),CPX(-1,1),CPX(-1,1),CPX(1,-1),CPX(-1,-1),CPX(-1,-1),CPX(-1,1),CPX(1,1)},
-{CPX(-1,1),CPX(1,1),CPX(-1,1),CPX(1,1),CPX(1,-1),CPX(1,1),CPX(1,-1),CPX(-1,-1),CPX(1,1),CPX(-1,-1),CPX(1,-1),CPX(-1,1),CPX(-1,1),CPX(1,-1),CPX(-1,-1),CPX(-1,-1)},
-{CPX(-1,-1),CPX(-1,-1),CPX(-1,1),CPX(1,1),CPX(-1,1),CPX(1,1),CPX(1,-1),CPX(1,1),CPX(1,-1),CPX(-1,-1),CPX(1,1),CPX(-1,-1),CPX(1,-1),CPX(-1,1),CPX(-1,1),CPX(1,-1)},
-{CPX(-1,1),CPX(1,-1),CPX(-1,-1),CPX(-1,-1),CPX(-1,1),CPX(1,1),CPX(-1,1),CPX(1,1),CPX(1,-1),CPX(1,1),CPX(1,-1),CPX(-1,-1),CPX(1,1),CPX(-1,-1),CPX(1,-1),CPX(-1,1)},
-{CPX(1,-1),CPX(-1,1),CPX(-1,1),CPX(1,-1),CPX(-1,-1),CPX(-1,-1),CPX(-1,1),CPX(1,1),CPX(-1,1),CPX(1,1),CPX(1,-1),CPX(1,1),CPX(1,-1),CPX(-1,-1),CPX(1,1),CPX(-1,-1)},
-{CPX(1,1),CPX(-1,-1),CPX(1,-1),CPX(-1,1),CPX(-1,1),CPX(1,-1),CPX(-1,-1),CPX(-1,-1),CPX(-1,1),CPX(1,1),CPX(-1,1),CPX(1,1),CPX(1,-1),CPX(1,1),CPX(1,-1),CPX(-1,-1)} 
-    };
 
     byte_to_symbol_bc::sptr
     byte_to_symbol_bc::make()
@@ -0,0 +1,117 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "chase_combiner.h"
+#include <volk/volk.h>
+
+namespace gr {
+  namespace lsa {
+    chase_combiner::chase_combiner(const unsigned int* chipset, int threshold, int depth)
+      : d_despread(chipset,threshold),
+        d_depth(depth)
+    {
+    }
+
+    bool
+    chase_combiner::parse_base(const unsigned char* pld, int nbytes, uint16_t& base)
+    {
+      if(nbytes<=CHASE_HDR_BYTES){
+        return false;
+      }
+      base = (pld[4]<<8) | pld[5];
+      uint16_t base_crc = (pld[6]<<8) | pld[7];
+      return base==base_crc;
+    }
+
+    bool
+    chase_combiner::decode(const float* soft, int nbytes, unsigned char* out)
+    {
+      uint16_t base;
+      if(d_depth<=0 || nbytes<=CHASE_HDR_BYTES){
+        return false;
+      }
+      // earlier copies can only be found through this copy's header
+      if(!d_despread.decode_bytes(soft,CHASE_HDR_BYTES,out) || !parse_base(out,nbytes,base)){
+        return false;
+      }
+      const float* body = soft+CHASE_HDR_BYTES*DSSS_BYTE_CHIPS;
+      const int body_bytes = nbytes-CHASE_HDR_BYTES;
+      const int nchips = body_bytes*DSSS_BYTE_CHIPS;
+      std::list<frame_t>::iterator it;
+      for(it=d_frames.begin();it!=d_frames.end();++it){
+        if(it->base==base && it->nbytes==nbytes){
+          break;
+        }
+      }
+      if(it==d_frames.end()){
+        if(d_despread.decode_bytes(body,body_bytes,out+CHASE_HDR_BYTES)){
+          return true;
+        }
+        frame_t frame;
+        frame.base = base;
+        frame.nbytes = nbytes;
+        frame.soft.assign(body,body+nchips);
+        d_frames.push_front(frame);
+        if(d_frames.size()>d_depth){
+          d_frames.pop_back();
+        }
+        return false;
+      }
+      d_frames.splice(d_frames.begin(),d_frames,it);
+      float* acc = d_frames.front().soft.data();
+      volk_32f_x2_add_32f(acc,acc,body,nchips);
+      // the chips stay until the caller accepts the frame
+      return d_despread.decode_bytes(acc,body_bytes,out+CHASE_HDR_BYTES);
+    }
+
+    bool
+    chase_combiner::frame_ok(const unsigned char* pld, int nbytes)
+    {
+      uint16_t base;
+      if(!parse_base(pld,nbytes,base)){
+        return false;
+      }
+      uint16_t qidx = (pld[0]<<8) | pld[1];
+      uint16_t qsize = (pld[2]<<8) | pld[3];
+      return qsize==0 || qidx<qsize;
+    }
+
+    void
+    chase_combiner::forget(const unsigned char* pld, int nbytes)
+    {
+      uint16_t base;
+      if(d_frames.empty() || !parse_base(pld,nbytes,base)){
+        return;
+      }
+      std::list<frame_t>::iterator it;
+      for(it=d_frames.begin();it!=d_frames.end();++it){
+        if(it->base==base && it->nbytes==nbytes){
+          d_frames.erase(it);
+          return;
+        }
+      }
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
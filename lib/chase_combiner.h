@@ -0,0 +1,83 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_CHASE_COMBINER_H
+#define INCLUDED_LSA_CHASE_COMBINER_H
+
+#include <lsa/dsss_despreader.h>
+#include <list>
+#include <vector>
+
+namespace gr {
+  namespace lsa {
+    // payload bytes ahead of the body: qidx, qsize, base, base copy
+    #define CHASE_HDR_BYTES 8
+
+    /*
+     * Chase combining of retransmitted SU frames.
+     *
+     * Soft chips of a payload that fails chip decoding are kept keyed by
+     * its base (sequence number) and length. When another copy fails, its
+     * body chips are added to the stored ones and the sum is decoded. The
+     * retransmission header bytes differ between copies and are always
+     * taken from the newest copy. Storage is bounded, the least recently
+     * used frame is dropped first.
+     *
+     * A combined decode leaves the stored chips in place, the caller drops
+     * them with forget() once the frame passes frame_ok(), the check
+     * phy_crc applies to LSA frames. A sum that clears the chip threshold
+     * but fails that check keeps combining with later copies. The check
+     * covers the retransmission header only, the body carries no crc, so
+     * a body accepted with symbol errors is passed on as phy_crc would.
+     */
+    class chase_combiner
+    {
+     public:
+      chase_combiner(const unsigned int* chipset, int threshold, int depth);
+      int depth() const{return d_depth;}
+      /*
+       * soft holds nbytes*DSSS_BYTE_CHIPS payload chips. Returns true
+       * with out filled when the copy decodes alone or combined with
+       * earlier copies.
+       */
+      bool decode(const float* soft, int nbytes, unsigned char* out);
+      // the frame was accepted, stored chips are no longer needed
+      void forget(const unsigned char* pld, int nbytes);
+      // queue index and base checks of phy_crc on an LSA payload
+      static bool frame_ok(const unsigned char* pld, int nbytes);
+      // frames with stored chips
+      size_t size() const{return d_frames.size();}
+     private:
+      struct frame_t{
+        uint16_t base;
+        int nbytes;
+        std::vector<float> soft;
+      };
+      static bool parse_base(const unsigned char* pld, int nbytes, uint16_t& base);
+
+      dsss_despreader d_despread;
+      const int d_depth;
+      std::list<frame_t> d_frames;
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_CHASE_COMBINER_H */
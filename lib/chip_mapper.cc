@@ -47,21 +47,37 @@ static const unsigned int CHIPSET[16] = {3653456430,
                                   3378542520};
 
 
+// two chip words per byte, in output byte order
+struct chip_table{
+  uint64_t word[256];
+  chip_table()
+  {
+    uint8_t u8[8];
+    for(int b=0;b<256;++b){
+      const unsigned int high = CHIPSET[(b>>4) & 0x0f];
+      const unsigned int low = CHIPSET[b & 0x0f];
+      for(int k=0;k<4;++k){
+        u8[k] = (high>>(24-8*k)) & 0xff;
+        u8[4+k] = (low>>(24-8*k)) & 0xff;
+      }
+      memcpy(&word[b],u8,sizeof(uint64_t));
+    }
+  }
+};
+static const chip_table d_table;
+
 class chip_mapper_impl :public chip_mapper
 {
   public:
    chip_mapper_impl() : block("chip_mapper",
                 gr::io_signature::make(0,0,0),
                 gr::io_signature::make(0,0,0))
-                //d_preamble_len(8)
   {
     d_pdu_in = pmt::mp("pdu_in");
     d_pdu_out= pmt::mp("pdu_out");
     message_port_register_in(d_pdu_in);
     message_port_register_out(d_pdu_out);
     set_msg_handler(d_pdu_in,boost::bind(&chip_mapper_impl::pdu_in,this,_1));
-    //for(int i=0;i<8;++i)
-      //d_u32_buf[i] = CHIPSET[0];
   }
    ~chip_mapper_impl()
    {
@@ -74,38 +90,46 @@ class chip_mapper_impl :public chip_mapper
     pmt::pmt_t k,v;
     k=pmt::car(msg);
     v=pmt::cdr(msg);
-    assert(pmt::is_blob(v));
-    size_t io(0);
-    const uint8_t* u8vec = pmt::u8vector_elements(v,io);
-    assert(io>0 && io<256);
-    //for(int i=0;i<io*2;++i){
-      //d_u32_buf[i]=CHIPSET[ (u8vec[i/2] >> (4*(1-i%2))  )& 0x0f ];
-    //}
-    for(int i=0;i<io;++i){
-      int idx1 = (u8vec[i] >> 4) & 0x0f;
-      int idx2 = u8vec[i] & 0x0f;
-      const uint8_t* u8_1 =(const uint8_t *)& CHIPSET[idx1];
-      const uint8_t* u8_2 =(const uint8_t *)& CHIPSET[idx2];
-      d_buf[8*i] = u8_1[3];
-      d_buf[8*i+1] = u8_1[2];
-      d_buf[8*i+2] = u8_1[1];
-      d_buf[8*i+3] = u8_1[0];
-
-      d_buf[8*i+4] = u8_2[3];
-      d_buf[8*i+5] = u8_2[2];
-      d_buf[8*i+6] = u8_2[1];
-      d_buf[8*i+7] = u8_2[0];
+    if(pmt::is_vector(v)){
+      // batch: one message for all PDUs
+      const size_t npdu = pmt::length(v);
+      pmt::pmt_t out = pmt::make_vector(npdu,pmt::PMT_NIL);
+      for(size_t i=0;i<npdu;++i){
+        pmt::vector_set(out,i,map_pdu(pmt::vector_ref(v,i)));
+      }
+      message_port_pub(d_pdu_out,pmt::cons(pmt::PMT_NIL,out));
+      return;
     }
-    message_port_pub(d_pdu_out,pmt::cons(pmt::PMT_NIL,pmt::make_blob(d_buf,io*8)));
+    message_port_pub(d_pdu_out,pmt::cons(pmt::PMT_NIL,map_pdu(v)));
    }
 
   private:
   pmt::pmt_t d_pdu_in;
   pmt::pmt_t d_pdu_out;
-  unsigned char d_buf[2048]; //check
-  //unsigned int d_u32_buf[1024];
-  //const size_t d_preamble_len;
+
+  pmt::pmt_t
+  map_pdu(const pmt::pmt_t& v)
+  {
+    assert(pmt::is_blob(v));
+    size_t io(0);
+    const uint8_t* u8vec = pmt::u8vector_elements(v,io);
+    // chips are written straight into the outgoing blob
+    pmt::pmt_t chips = pmt::make_u8vector(io*8,0x00);
+    size_t len(0);
+    map_bytes(u8vec,io,pmt::u8vector_writable_elements(chips,len));
+    return chips;
+  }
 };
+
+    void
+    chip_mapper::map_bytes(const unsigned char* in, size_t nbytes, unsigned char* out)
+    {
+      // one 64 bit load and store per byte, no byte shuffling
+      for(size_t i=0;i<nbytes;++i){
+        memcpy(out+8*i,&d_table.word[in[i]],sizeof(uint64_t));
+      }
+    }
+
    chip_mapper::sptr
     chip_mapper::make(){
       return gnuradio::get_initial_sptr(new chip_mapper_impl());
@@ -0,0 +1,232 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <lsa/dsss_despreader.h>
+#include <gnuradio/blocks/count_bits.h>
+#include <cmath>
+#include <limits>
+
+namespace gr {
+  namespace lsa {
+    static const unsigned int d_mask = 0x7ffffffe;
+    // chips 1..30 take part in the decision
+    static const int CORR_CHIPS = DSSS_SYMBOL_CHIPS-2;
+    // integration steps of the calibration
+    static const int CALIB_STEPS = 4096;
+
+    soft_demapper::soft_demapper(const gr::digital::constellation_sptr& constellation)
+    {
+      d_bps = constellation->bits_per_symbol();
+      d_points = constellation->points();
+      std::vector<int> code = constellation->pre_diff_code();
+      bool use_code = constellation->apply_pre_diff_code() && code.size()==d_points.size();
+      for(int i=0;i<d_points.size();++i){
+        d_values.push_back(use_code? code[i] : i);
+      }
+    }
+
+    void
+    soft_demapper::demap(const gr_complex* in, int n, float* out) const
+    {
+      const float inf = std::numeric_limits<float>::max();
+      float dist[256];
+      const int npts = std::min((int)d_points.size(),256);
+      for(int i=0;i<n;++i){
+        for(int p=0;p<npts;++p){
+          dist[p] = std::norm(in[i]-d_points[p]);
+        }
+        for(int b=0;b<d_bps;++b){
+          float min0=inf, min1=inf;
+          for(int p=0;p<npts;++p){
+            if((d_values[p]>>(d_bps-1-b))&0x01){
+              min1 = std::min(min1,dist[p]);
+            }else{
+              min0 = std::min(min0,dist[p]);
+            }
+          }
+          out[i*d_bps+b] = min0-min1;
+        }
+      }
+    }
+
+    dsss_despreader::dsss_despreader(const unsigned int* chipset, int threshold)
+      : d_code(DSSS_SYMBOL_CHIPS*16),
+        d_threshold(threshold),
+        d_soft_threshold(0),
+        d_hard_accept(false)
+    {
+      for(int i=0;i<16;++i){
+        d_chipset[i] = chipset[i];
+        for(int k=0;k<DSSS_SYMBOL_CHIPS;++k){
+          d_code[k*16+i] = ((chipset[i]>>(DSSS_SYMBOL_CHIPS-1-k))&0x01)? 1.0F : -1.0F;
+        }
+      }
+      calibrate();
+    }
+
+    void
+    dsss_despreader::set_threshold(int threshold)
+    {
+      d_threshold = threshold;
+      calibrate();
+    }
+
+    void
+    dsss_despreader::calibrate()
+    {
+      // the hard decoder lets a window of noise through on a codeword with
+      // probability sum_{d<threshold} C(n,d)/2^n, n the chips in the mask.
+      // The cosine between gaussian noise and a codeword has density
+      // (1-t^2)^((n-3)/2) on [-1,1], the soft threshold is the cosine with
+      // the same tail probability, so noise passes both decoders alike
+      const int n = CORR_CHIPS;
+      double tail = 0;
+      double binom = 1;
+      for(int d=0;d<d_threshold && d<=n;++d){
+        tail += binom;
+        binom = binom*(n-d)/(d+1);
+      }
+      tail /= std::pow(2.0,n);
+      // a cosine never leaves [-1,1]
+      if(tail<=0){
+        d_soft_threshold = 2.0F;
+        return;
+      }
+      if(tail>=1){
+        d_soft_threshold = -2.0F;
+        return;
+      }
+      const double step = 2.0/CALIB_STEPS;
+      double total = 0;
+      for(int i=0;i<CALIB_STEPS;++i){
+        double t = -1.0+(i+0.5)*step;
+        total += std::pow(1.0-t*t,0.5*(n-3));
+      }
+      double upper = 0;
+      int i = CALIB_STEPS;
+      while(i>0 && upper<tail*total){
+        --i;
+        double t = -1.0+(i+0.5)*step;
+        upper += std::pow(1.0-t*t,0.5*(n-3));
+      }
+      d_soft_threshold = -1.0+i*step;
+    }
+
+    unsigned char
+    dsss_despreader::despread(unsigned int reg) const
+    {
+      int min_thres = 33;
+      int thres;
+      unsigned char min_idx = 0;
+      for(int i=0;i<16;++i){
+        thres = gr::blocks::count_bits32( (reg & d_mask)^(d_chipset[i]&d_mask));
+        if(thres < min_thres){
+          min_idx  = (unsigned char)i;
+          min_thres = thres;
+        }
+      }
+      if(min_thres < d_threshold){
+        return min_idx & 0x0f;
+      }
+      return 0xff;
+    }
+
+    float
+    dsss_despreader::correlate(const float* chips, int* best) const
+    {
+      // chips times the codeword matrix, the inner loop over the 16
+      // codewords has no dependency and is vectorized by the compiler
+      float corr[16] = {0};
+      float energy = 0;
+      const float* code = &d_code[16];
+      for(int k=1;k<=CORR_CHIPS;++k,code+=16){
+        const float c = chips[k];
+        energy += c*c;
+        for(int i=0;i<16;++i){
+          corr[i] += c*code[i];
+        }
+      }
+      *best = 0;
+      for(int i=1;i<16;++i){
+        if(corr[i]>corr[*best]){
+          *best = i;
+        }
+      }
+      if(energy<=0){
+        return 0;
+      }
+      return corr[*best]/std::sqrt(energy*CORR_CHIPS);
+    }
+
+    unsigned char
+    dsss_despreader::despread(const float* chips, float* metric) const
+    {
+      int best;
+      const float cosine = correlate(chips,&best);
+      if(metric!=NULL){
+        *metric = cosine;
+      }
+      if(d_hard_accept){
+        unsigned int reg = 0x00000000;
+        for(int k=0;k<DSSS_SYMBOL_CHIPS;++k){
+          reg = (reg<<1) | ((chips[k]>0)? 0x01 : 0x00);
+        }
+        return (despread(reg)!=0xff)? (unsigned char) best : 0xff;
+      }
+      if(cosine>=d_soft_threshold){
+        return (unsigned char) best;
+      }
+      return 0xff;
+    }
+
+    int
+    dsss_despreader::despread(const float* chips, int nsym, unsigned char* symbols,
+      float* metrics) const
+    {
+      int nvalid = 0;
+      for(int i=0;i<nsym;++i){
+        symbols[i] = despread(chips+i*DSSS_SYMBOL_CHIPS,(metrics==NULL)? NULL : metrics+i);
+        if(symbols[i]!=0xff){
+          nvalid++;
+        }
+      }
+      return nvalid;
+    }
+
+    bool
+    dsss_despreader::decode_bytes(const float* chips, int nbytes, unsigned char* out) const
+    {
+      for(int i=0;i<nbytes;++i){
+        unsigned char high = despread(chips+i*DSSS_BYTE_CHIPS);
+        unsigned char low = despread(chips+i*DSSS_BYTE_CHIPS+DSSS_SYMBOL_CHIPS);
+        if(high==0xff || low==0xff){
+          return false;
+        }
+        out[i] = (high<<4) | low;
+      }
+      return true;
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
@@ -0,0 +1,282 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnuradio/io_signature.h>
+#include "dsss_oqpsk_mod_bc_impl.h"
+#include "su_chip_map.h"
+#include <volk/volk.h>
+
+namespace gr {
+  namespace lsa {
+    // retransmission queue index and size, right after the SU PHY header
+    static const int d_retx_begin = 6;
+    static const int d_retx_end = 10;
+
+    dsss_oqpsk_mod_bc::sptr
+    dsss_oqpsk_mod_bc::make(const std::string& tagname, int sps,
+      const std::vector<float>& taps, bool half_chip_offset, int cache_depth)
+    {
+      return gnuradio::get_initial_sptr
+        (new dsss_oqpsk_mod_bc_impl(tagname,sps,taps,half_chip_offset,cache_depth));
+    }
+
+    /*
+     * The private constructor
+     */
+    dsss_oqpsk_mod_bc_impl::dsss_oqpsk_mod_bc_impl(const std::string& tagname, int sps,
+      const std::vector<float>& taps, bool half_chip_offset, int cache_depth)
+      : gr::block("dsss_oqpsk_mod_bc",
+              gr::io_signature::make(1, 1, sizeof(unsigned char)),
+              gr::io_signature::make(1, 1, sizeof(gr_complex))),
+              d_sob_tag(pmt::intern("tx_sob")),
+              d_eob_tag(pmt::intern("tx_eob")),
+              d_tagname(pmt::intern(tagname)),
+              d_src_id(pmt::intern(alias())),
+              d_cache_depth(cache_depth)
+    {
+      if(sps<=0){
+        throw std::invalid_argument("Samples per chip should be positive");
+      }
+      if(taps.empty()){
+        throw std::invalid_argument("Pulse shaping taps should not be empty");
+      }
+      if(half_chip_offset && sps%2){
+        throw std::invalid_argument("Half chip offset needs an even samples per chip");
+      }
+      const int qdelay = (half_chip_offset)? sps/2 : 0;
+      d_step = d_symbol_size*sps;
+      d_wlen = d_step+qdelay+taps.size()-1;
+      d_tail = d_wlen-d_step;
+      // the filter is linear: a packet is the overlap-add of its nibble
+      // waveforms, d_step apart
+      d_wave.resize(16*d_wlen,gr_complex(0,0));
+      for(int n=0;n<16;++n){
+        gr_complex* wave = &d_wave[n*d_wlen];
+        for(int c=0;c<d_symbol_size;++c){
+          for(int t=0;t<taps.size();++t){
+            wave[c*sps+t] += gr_complex(d_map[n][c].real()*taps[t],0);
+            wave[c*sps+qdelay+t] += gr_complex(0,d_map[n][c].imag()*taps[t]);
+          }
+        }
+      }
+      d_acc.resize(d_wlen,gr_complex(0,0));
+      d_count = 0;
+      d_flush = false;
+      d_play = NULL;
+      d_play_len = 0;
+      d_play_pos = 0;
+      set_min_noutput_items(std::max(2*d_step,d_tail));
+      set_tag_propagation_policy(TPP_DONT);
+    }
+
+    /*
+     * Our virtual destructor.
+     */
+    dsss_oqpsk_mod_bc_impl::~dsss_oqpsk_mod_bc_impl()
+    {
+    }
+
+    bool
+    dsss_oqpsk_mod_bc_impl::start_burst(int nin)
+    {
+      std::vector<tag_t> tags;
+      get_tags_in_window(tags,0,0,nin,d_tagname);
+      for(int i=0;i<tags.size();++i){
+        if(tags[i].offset!=nitems_read(0)){
+          break;
+        }
+        d_count = pmt::to_long(tags[i].value);
+        if(d_count>0){
+          std::fill(d_acc.begin(),d_acc.end(),gr_complex(0,0));
+          add_item_tag(0,nitems_written(0),d_sob_tag,pmt::PMT_T,d_src_id);
+          add_item_tag(0,nitems_written(0),d_tagname,
+            pmt::from_long(d_count*2*d_step+d_tail),d_src_id);
+          return true;
+        }
+        d_count = 0;
+      }
+      return false;
+    }
+
+    void
+    dsss_oqpsk_mod_bc_impl::modulate(unsigned char nibble, gr_complex* out)
+    {
+      volk_32f_x2_add_32f((float*)&d_acc[0],(const float*)&d_acc[0],
+        (const float*)&d_wave[nibble*d_wlen],2*d_wlen);
+      memcpy(out,&d_acc[0],sizeof(gr_complex)*d_step);
+      memmove(&d_acc[0],&d_acc[d_step],sizeof(gr_complex)*d_tail);
+      std::fill(d_acc.begin()+d_tail,d_acc.end(),gr_complex(0,0));
+    }
+
+    bool
+    dsss_oqpsk_mod_bc_impl::same_frame(const std::vector<unsigned char>& bytes,
+      const unsigned char* in) const
+    {
+      const int nbytes = bytes.size();
+      const int begin = std::min(d_retx_begin,nbytes);
+      const int end = std::min(d_retx_end,nbytes);
+      return !memcmp(&bytes[0],in,begin) && !memcmp(&bytes[0]+end,in+end,nbytes-end);
+    }
+
+    void
+    dsss_oqpsk_mod_bc_impl::splice(frame_t& frame, const unsigned char* in)
+    {
+      const int nbytes = frame.bytes.size();
+      const int end = std::min(d_retx_end,nbytes);
+      int first = -1;
+      int last = -1;
+      for(int k=2*d_retx_begin;k<2*end;++k){
+        const int shift = (k%2)? 0 : 4;
+        if((frame.bytes[k/2]>>shift & 0x0f)!=(in[k/2]>>shift & 0x0f)){
+          first = (first<0)? k : first;
+          last = k;
+        }
+      }
+      if(first<0){
+        return;
+      }
+      memcpy(&frame.bytes[d_retx_begin],in+d_retx_begin,end-d_retx_begin);
+      // rebuild the samples the changed nibbles reach from every nibble
+      // ringing into them, added in the order modulate() adds them: the
+      // spliced frame equals a fresh one however often it is reused
+      const int begin = first*d_step;
+      const int stop = last*d_step+d_wlen;
+      std::fill(frame.samples.begin()+begin,frame.samples.begin()+stop,gr_complex(0,0));
+      for(int k=std::max(0,(begin-d_wlen)/d_step);k<2*nbytes && k*d_step<stop;++k){
+        const int w0 = std::max(begin,k*d_step);
+        const int w1 = std::min(stop,k*d_step+d_wlen);
+        if(w0>=w1){
+          continue;
+        }
+        const unsigned char nibble = frame.bytes[k/2]>>((k%2)? 0 : 4) & 0x0f;
+        float* out = (float*)&frame.samples[w0];
+        volk_32f_x2_add_32f(out,out,(const float*)&d_wave[nibble*d_wlen+w0-k*d_step],2*(w1-w0));
+      }
+    }
+
+    const std::vector<gr_complex>&
+    dsss_oqpsk_mod_bc_impl::cached_frame(const unsigned char* in, int nbytes)
+    {
+      std::list<frame_t>::iterator it;
+      for(it=d_frames.begin();it!=d_frames.end();++it){
+        if(it->bytes.size()==nbytes && same_frame(it->bytes,in)){
+          d_frames.splice(d_frames.begin(),d_frames,it);
+          splice(d_frames.front(),in);
+          return d_frames.front().samples;
+        }
+      }
+      frame_t frame;
+      frame.bytes.assign(in,in+nbytes);
+      frame.samples.resize(nbytes*2*d_step+d_tail);
+      gr_complex* out = &frame.samples[0];
+      for(int i=0;i<nbytes;++i){
+        modulate(in[i]>>4 & 0x0f,out+2*i*d_step);
+        modulate(in[i] & 0x0f,out+(2*i+1)*d_step);
+      }
+      memcpy(out+nbytes*2*d_step,&d_acc[0],sizeof(gr_complex)*d_tail);
+      d_frames.push_front(frame);
+      if(d_frames.size()>d_cache_depth){
+        d_frames.pop_back();
+      }
+      return d_frames.front().samples;
+    }
+
+    void
+    dsss_oqpsk_mod_bc_impl::forecast (int noutput_items, gr_vector_int &ninput_items_required)
+    {
+      if((d_count==0 && d_flush) || d_play!=NULL){
+        ninput_items_required[0] = 0;
+      }else{
+        ninput_items_required[0] = std::max(1,noutput_items/(2*d_step));
+      }
+    }
+
+    int
+    dsss_oqpsk_mod_bc_impl::general_work (int noutput_items,
+                       gr_vector_int &ninput_items,
+                       gr_vector_const_void_star &input_items,
+                       gr_vector_void_star &output_items)
+    {
+      const unsigned char *in = (const unsigned char *) input_items[0];
+      gr_complex *out = (gr_complex *) output_items[0];
+      int nin = ninput_items[0];
+      int consumed = 0;
+      if(d_count==0 && !d_flush && d_play==NULL){
+        if(nin==0){
+          consume_each(0);
+          return 0;
+        }
+        if(!start_burst(nin)){
+          // bytes outside of a tagged packet are dropped
+          std::vector<tag_t> tags;
+          get_tags_in_window(tags,0,1,nin,d_tagname);
+          consume_each(tags.empty()? nin : tags[0].offset-nitems_read(0));
+          return 0;
+        }
+        if(d_cache_depth>0 && nin>=d_count){
+          const std::vector<gr_complex>& samples = cached_frame(in,d_count);
+          d_play = &samples[0];
+          d_play_len = samples.size();
+          d_play_pos = 0;
+          consumed = d_count;
+          d_count = 0;
+        }
+      }
+      if(d_play!=NULL){
+        // the entry stays cached until the next burst starts
+        int nout = std::min(noutput_items,d_play_len-d_play_pos);
+        memcpy(out,d_play+d_play_pos,sizeof(gr_complex)*nout);
+        d_play_pos += nout;
+        if(d_play_pos==d_play_len){
+          add_item_tag(0,nitems_written(0)+nout-1,d_eob_tag,pmt::PMT_T,d_src_id);
+          d_play = NULL;
+        }
+        consume_each(consumed);
+        return nout;
+      }
+      int nout = 0;
+      int count = 0;
+      nin = std::min(nin,d_count);
+      while(count<nin && nout+2*d_step<=noutput_items){
+        modulate(in[count]>>4 & 0x0f,out+nout);
+        modulate(in[count] & 0x0f,out+nout+d_step);
+        nout += 2*d_step;
+        count++;
+      }
+      d_count -= count;
+      if(d_count==0){
+        d_flush = true;
+      }
+      if(d_flush && nout+d_tail<=noutput_items){
+        memcpy(out+nout,&d_acc[0],sizeof(gr_complex)*d_tail);
+        nout += d_tail;
+        add_item_tag(0,nitems_written(0)+nout-1,d_eob_tag,pmt::PMT_T,d_src_id);
+        d_flush = false;
+      }
+      consume_each (count);
+      return nout;
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
@@ -0,0 +1,84 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_DSSS_OQPSK_MOD_BC_IMPL_H
+#define INCLUDED_LSA_DSSS_OQPSK_MOD_BC_IMPL_H
+
+#include <lsa/dsss_oqpsk_mod_bc.h>
+#include <list>
+
+namespace gr {
+  namespace lsa {
+
+    class dsss_oqpsk_mod_bc_impl : public dsss_oqpsk_mod_bc
+    {
+     private:
+      const pmt::pmt_t d_sob_tag;
+      const pmt::pmt_t d_eob_tag;
+      const pmt::pmt_t d_tagname;
+      const pmt::pmt_t d_src_id;
+      // samples per nibble
+      int d_step;
+      // samples a nibble rings into the following ones
+      int d_tail;
+      int d_wlen;
+      // shaped waveform of each nibble, d_wlen samples apart
+      std::vector<gr_complex> d_wave;
+      // overlap of the nibbles not yet written
+      std::vector<gr_complex> d_acc;
+      int d_count;
+      bool d_flush;
+
+      struct frame_t{
+        std::vector<unsigned char> bytes;
+        std::vector<gr_complex> samples;
+      };
+      // most recently used first
+      std::list<frame_t> d_frames;
+      const int d_cache_depth;
+      // cached burst being written
+      const gr_complex* d_play;
+      int d_play_len;
+      int d_play_pos;
+
+      bool start_burst(int nin);
+      void modulate(unsigned char nibble, gr_complex* out);
+      const std::vector<gr_complex>& cached_frame(const unsigned char* in, int nbytes);
+      bool same_frame(const std::vector<unsigned char>& bytes, const unsigned char* in) const;
+      void splice(frame_t& frame, const unsigned char* in);
+
+     public:
+      dsss_oqpsk_mod_bc_impl(const std::string& tagname, int sps,
+        const std::vector<float>& taps, bool half_chip_offset, int cache_depth);
+      ~dsss_oqpsk_mod_bc_impl();
+
+      // Where all the action really happens
+      void forecast (int noutput_items, gr_vector_int &ninput_items_required);
+
+      int general_work(int noutput_items,
+           gr_vector_int &ninput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_DSSS_OQPSK_MOD_BC_IMPL_H */
@@ -24,8 +24,11 @@
 
 #include <gnuradio/io_signature.h>
 #include <lsa/dump_tx.h>
+#include "rtt_estimator.h"
+#include "block_ack.h"
+#include "utils.h"
 #include <gnuradio/block_detail.h>
-#include <fstream>
+#include <lsa/payload_corpus.h>
 
 namespace gr {
   namespace lsa {
@@ -38,14 +41,17 @@ namespace gr {
     class dump_tx_impl : public dump_tx
     {
       public:
-        dump_tx_impl(const std::string& filename,int avg_size, float timeout, bool verb): block("dump_tx",
+        dump_tx_impl(const std::string& filename,int avg_size, float timeout, bool verb,
+          float min_timeout, float max_timeout, bool aggregate): block("dump_tx",
                   gr::io_signature::make(0,0,0),
                   gr::io_signature::make(0,0,0)),
                   d_in_port(pmt::mp("strobe")),
                   d_ack_port(pmt::mp("ack_in")),
-                  d_out_port(pmt::mp("pdu_out"))
+                  d_out_port(pmt::mp("pdu_out")),
+                  d_stats_port(pmt::mp("stats_out")),
+                  d_rtt(timeout,min_timeout,max_timeout),
+                  d_aggregate(aggregate)
         {
-          d_data_src.clear();
           if(!read_data(filename)){
             throw std::invalid_argument("filename invalid");
           }
@@ -57,49 +63,66 @@ namespace gr {
           message_port_register_in(d_ack_port);
           message_port_register_in(d_in_port);
           message_port_register_out(d_out_port);
+          message_port_register_out(d_stats_port);
           set_msg_handler(d_ack_port,boost::bind(&dump_tx_impl::ack_in,this,_1));
           set_msg_handler(d_in_port,boost::bind(&dump_tx_impl::strobe_in,this,_1));
-          d_queue.clear();
+          d_clock = mac_clock::wall();
           d_pending.clear();
           d_seqno =0;
           d_verb = verb;
           d_pkt_cnt=0;
           d_pkt_success=0;
           d_pkt_fail =0;
+          d_timeout_timer = 0;
+          d_finished = false;
+        }
+        ~dump_tx_impl()
+        {
+          d_clock->detach(this);
+        }
+        void set_clock(const mac_clock::sptr& clock)
+        {
+          if(!clock){
+            throw std::invalid_argument("Clock cannot be null");
+          }
+          d_clock->detach(this);
+          d_clock = clock;
+          d_clock->attach(this);
         }
-        ~dump_tx_impl(){}
         bool start()
         {
+          gr::thread::scoped_lock guard(d_mutex);
           d_finished = false;
-          d_thread = boost::shared_ptr<gr::thread::thread>
-            (new gr::thread::thread(boost::bind(&dump_tx_impl::run,this)));
-          d_timeout_thread = boost::shared_ptr<gr::thread::thread>
-            (new gr::thread::thread(boost::bind(&dump_tx_impl::check_timeout,this)));
-          d_thread = boost::shared_ptr<gr::thread::thread>
-            (new gr::thread::thread(boost::bind(&dump_tx_impl::report,this)));
+          d_start_time = d_clock->now_us();
+          d_clock->timers().schedule_every(this,STATUSMS,STATUSMS,
+            boost::bind(&dump_tx_impl::report,this));
+          arm_timeout();
+          d_clock->started(this);
           return block::start();
         }
 
         bool stop()
         {
-          d_finished = true;
-          d_thread->interrupt();
-          d_timeout_thread->interrupt();
-          d_report_thread->interrupt();
-          d_thread->join();
-          d_timeout_thread->join();
-          d_report_thread->join();
+          {
+            gr::thread::scoped_lock guard(d_mutex);
+            d_finished = true;
+          }
+          d_clock->timers().cancel_all(this);
           return block::stop();
         }
         void ack_in(pmt::pmt_t msg)
         {
+          mac_clock::scoped_handler handled(d_clock,this,msg);
           gr::thread::scoped_lock guard(d_mutex);
           pmt::pmt_t k = pmt::car(msg);
           pmt::pmt_t v = pmt::cdr(msg);
-          uint16_t base1, base2;
-          std::list< std::tuple<uint16_t,pmt::pmt_t,boost::posix_time::ptime,int> >::iterator it;
-          boost::posix_time::time_duration diff;
+          uint16_t base1, base2, offset;
+          uint64_t bitmap;
+          std::list< std::tuple<uint16_t,pmt::pmt_t,uint64_t,int> >::iterator it;
+          uint64_t diff;
+          uint64_t cur_time;
           int channel_use;
+          bool sampled = false;
           assert(pmt::is_blob(v));
           size_t io(0);
           const uint8_t* uvec = pmt::u8vector_elements(v,io);
@@ -110,28 +133,48 @@ namespace gr {
             base1|= uvec[1];
             base2 = uvec[2]<<8;
             base2|= uvec[3];
-            if(base1==base2){
-              // matched ack
-              for(it=d_pending.begin();it!=d_pending.end();++it){
-                if(std::get<0>(*it)==base1){
-                  // get packet information here!
-                  diff =boost::posix_time::microsec_clock::local_time()-std::get<2>(*it);
-                  channel_use = std::get<3>(*it);
-                  // milliseconds
-                  DEBUG<<"result:"<<d_pkt_cnt<<"channel use:"<<channel_use+1<<" ,RTT(msg):"<<diff.total_milliseconds()+d_timeout*channel_use<<std::endl;
-                  d_pkt_success++;
-                  d_pkt_fail+=channel_use;
-                  d_pkt_cnt++;
-                }
-              }
+            if(base1!=base2){
+              return;
             }
+            bitmap = 0x01;
+          }else if(!block_ack_parse(uvec,io,base1,bitmap)){
+            return;
+          }
+          // matched acks, one pass for a whole block
+          cur_time = d_clock->now_us();
+          it=d_pending.begin();
+          while(it!=d_pending.end()){
+            offset = std::get<0>(*it)-base1;
+            if(offset>=BLOCK_ACK_WINDOW || !((bitmap>>offset)&0x01)){
+              ++it;
+              continue;
+            }
+            // get packet information here!
+            diff = cur_time-std::get<2>(*it);
+            channel_use = std::get<3>(*it);
+            // milliseconds
+            DEBUG<<"result:"<<d_pkt_cnt<<"channel use:"<<channel_use+1<<" ,RTT(msg):"<<diff/1000+d_rtt.rto()*channel_use<<std::endl;
+            d_pkt_success++;
+            d_pkt_fail+=channel_use;
+            d_pkt_cnt++;
+            if(d_rtt.acked(diff/1000.0,channel_use)){
+              sampled = true;
+            }
+            // acked, no more retransmissions
+            it = d_pending.erase(it);
+          }
+          if(sampled){
+            pmt::pmt_t out = pmt::cons(d_rtt.stats(),pmt::PMT_NIL);
+            d_clock->sent(this,d_stats_port,out);
+            message_port_pub(d_stats_port,out);
           }
         }
         void strobe_in(pmt::pmt_t msg)
         {
+          mac_clock::scoped_handler handled(d_clock,this,msg);
           gr::thread::scoped_lock guard(d_mutex);
-          std::list< std::tuple<uint16_t,pmt::pmt_t,boost::posix_time::ptime,int> >::iterator it=d_pending.begin();
-          boost::posix_time::ptime cur_time;  
+          std::list< std::tuple<uint16_t,pmt::pmt_t,uint64_t,int> >::iterator it=d_pending.begin();
+          uint64_t cur_time;
           if(d_pending.size()>=d_queue_lim){
             DEBUG<<"<DUMP TX debug> pending queue reache limit"<<d_queue_lim<<std::endl;
             return;
@@ -141,22 +184,27 @@ namespace gr {
           d_buf[1] = u8_seq[0];
           d_buf[2] = u8_seq[1];
           d_buf[3] = u8_seq[0];
-          memcpy(d_buf+4,d_data_src[d_seqno].data(),sizeof(char)*d_data_src[d_seqno].size());
-          pmt::pmt_t pdu = pmt::make_blob(d_buf,d_data_src[d_seqno].size()+4);
-          cur_time = boost::posix_time::microsec_clock::local_time();
-          d_queue.push_back(std::make_pair(d_seqno,pdu));
+          const size_t idx = d_seqno%d_data_src.size();
+          memcpy(d_buf+4,d_data_src.data(idx),sizeof(char)*d_data_src.length(idx));
+          pmt::pmt_t pdu = pmt::make_blob(d_buf,d_data_src.length(idx)+4);
+          cur_time = d_clock->now_us();
           d_pending.push_back(std::make_tuple(d_seqno,pdu,cur_time,0));
           d_seqno = (d_seqno==0xffff)? 0:d_seqno+1;
-          d_queue_filled.notify_one();
+          pmt::pmt_t out = pmt::cons(pmt::PMT_NIL,pdu);
+          d_clock->sent(this,d_out_port,out);
+          message_port_pub(d_out_port,out);
+          if(d_timeout_timer==0){
+            arm_timeout();
+          }
         }
         void set_timeout(float timeout)
         {
           gr::thread::scoped_lock guard(d_mutex);
-          d_timeout =(timeout<=0)?1000: timeout;
+          d_rtt.reset((timeout<=0)?1000: timeout);
         }
         float timeout()const
         {
-          return d_timeout;
+          return d_rtt.rto();
         }
         void set_avg_size(int avg_size)
         {
@@ -168,119 +216,95 @@ namespace gr {
           return d_avg_size;
         }
       private:
-        pmt::pmt_t queue_pop()
+        // with d_mutex held, fires when the oldest pending frame times out
+        void arm_timeout()
         {
-          gr::thread::scoped_lock lock(d_mutex);
-          while(d_queue.size()==0){
-            d_queue_filled.wait(lock);
+          d_timeout_timer = 0;
+          if(d_finished || d_pending.empty()){
+            return;
           }
-          pmt::pmt_t msg = std::get<1>(d_queue.front());
-          d_queue.pop_front();
-          return msg;
+          uint64_t diff = d_clock->now_us()-std::get<2>(d_pending.front());
+          d_timeout_timer = d_clock->timers().schedule(this,
+            d_rtt.rto()-diff/1000.0,
+            boost::bind(&dump_tx_impl::check_timeout,this));
         }
         void check_timeout()
         {
-          uint16_t id;
-          pmt::pmt_t blob;
-          int retry;
-          boost::posix_time::ptime time_update;
-          std::list<std::tuple<uint16_t, pmt::pmt_t, boost::posix_time::ptime,int> >::iterator it;
-          boost::posix_time::time_duration diff;
-          while(!d_finished){
-            boost::this_thread::sleep(boost::posix_time::milliseconds(d_timeout/2.0));
-            if(d_finished){
-              return;
-            }
-            it=d_pending.begin();
-            if(it!=d_pending.end()){
-              diff = boost::posix_time::microsec_clock::local_time()-std::get<2>(*it);
-              if(diff.total_milliseconds()>=d_timeout){
-                id = std::get<0>(*it);
-                blob = std::get<1>(*it);
-                retry = std::get<3>(*it)+1;
-                time_update = boost::posix_time::microsec_clock::local_time();
-                d_pending.push_back(std::make_tuple(id,blob,time_update,retry));
-                d_pending.pop_front();
-                d_queue.push_back(std::make_pair(id,blob));
-                DEBUG<<"<Dump TX>Timeout found---seq="<<id<<" ,retry cnt:"<<retry<<std::endl;
-                d_queue_filled.notify_one();
-              }
+          gr::thread::scoped_lock guard(d_mutex);
+          uint64_t cur_time = d_clock->now_us();
+          const float rto = d_rtt.rto();
+          bool expired = false;
+          // oldest first, a retransmitted frame moves to the back
+          for(size_t n=d_pending.size();n>0;--n){
+            uint64_t diff = cur_time-std::get<2>(d_pending.front());
+            if(diff<rto*1000.0){
+              break;
             }
+            uint16_t id = std::get<0>(d_pending.front());
+            pmt::pmt_t blob = std::get<1>(d_pending.front());
+            int retry = std::get<3>(d_pending.front())+1;
+            d_pending.pop_front();
+            d_pending.push_back(std::make_tuple(id,blob,cur_time,retry));
+            pmt::pmt_t out = pmt::cons(pmt::PMT_NIL,blob);
+            d_clock->sent(this,d_out_port,out);
+            message_port_pub(d_out_port,out);
+            DEBUG<<"<Dump TX>Timeout found---seq="<<id<<" ,retry cnt:"<<retry<<std::endl;
+            expired = true;
           }
-        }
-        void run()
-        {
-          while(!d_finished){
-            pmt::pmt_t pdu = queue_pop();
-            //DEBUG<<"<DUMP TX DEBUG>pop from queue, transmit message"<<std::endl;
-            message_port_pub(d_out_port,pmt::cons(pmt::PMT_NIL,pdu));
-            if(d_finished){
-              return;
-            }
+          if(expired){
+            // one backoff per expiry, however many frames it covered
+            d_rtt.backoff();
+            pmt::pmt_t out = pmt::cons(d_rtt.stats(),pmt::PMT_NIL);
+            d_clock->sent(this,d_stats_port,out);
+            message_port_pub(d_stats_port,out);
           }
+          arm_timeout();
         }
         void report()
         {
-          boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
-          boost::posix_time::time_duration diff;
-          while(!d_finished){
-            boost::this_thread::sleep(boost::posix_time::seconds(10.0));
-            if(d_finished){
-              return;
-            }
-            diff = boost::posix_time::microsec_clock::local_time()-start;
-            VERBOSE<<"<Dump TX>Time(sec)"<<diff.total_seconds()<<" ,success:"<<d_pkt_success<<" ,failed:"<<d_pkt_fail<<std::endl;
-          }
+          uint64_t diff = d_clock->now_us()-d_start_time;
+          VERBOSE<<"<Dump TX>Time(sec)"<<diff/1000000<<" ,success:"<<d_pkt_success<<" ,failed:"<<d_pkt_fail<<std::endl;
         }
         bool read_data(const std::string& filename)
         {
           gr::thread::scoped_lock guard(d_mutex);
-          std::string str,line;
-          d_file.open(filename.c_str(),std::fstream::in);
-          if(!d_file.is_open()){
+          if(!d_data_src.open(filename)){
             return false;
           }
-          while(getline(d_file,line,'\n')){
-            std::istringstream temp(line);
-            std::vector<uint8_t> u8;
-            while(getline(temp,str,',')){
-              int tmp = std::atoi(str.c_str());
-              if(u8.size()>127){
-                throw std::runtime_error("message exceed maximum size");
-              }
-              u8.push_back((uint8_t)tmp);
-            }
-            d_data_src.push_back(u8);
+          if(d_data_src.max_length()>127){
+            throw std::runtime_error("message exceed maximum size");
+          }
+          if(d_aggregate){
+            d_data_src.aggregate(MAX_LSA_PAYLOAD-4);
           }
-          d_file.close();
-          return true;
+          return !d_data_src.empty();
         }
         const pmt::pmt_t d_in_port;
         const pmt::pmt_t d_ack_port;
         const pmt::pmt_t d_out_port;
+        const pmt::pmt_t d_stats_port;
         gr::thread::mutex d_mutex;
-        boost::shared_ptr<gr::thread::thread> d_thread;
-        boost::shared_ptr<gr::thread::thread> d_timeout_thread;
-        boost::shared_ptr<gr::thread::thread> d_report_thread;
+        mac_clock::sptr d_clock;
+        timer_service::timer_id d_timeout_timer;
+        uint64_t d_start_time;
         bool d_verb;
         bool d_finished;
-        gr::thread::condition_variable d_queue_filled;
-        float d_timeout;
+        rtt_estimator d_rtt;
+        const bool d_aggregate;
         int d_avg_size;
         int d_pkt_cnt;
         int d_pkt_success;
         int d_pkt_fail;
         unsigned char d_buf[256];
-        std::vector< std::vector<unsigned char> > d_data_src;
-        std::fstream d_file;
+        payload_corpus d_data_src;
         uint16_t d_seqno;
-        std::list<std::pair<uint16_t,pmt::pmt_t> > d_queue;
-        std::list<std::tuple<uint16_t,pmt::pmt_t,boost::posix_time::ptime,int> > d_pending;
+        std::list<std::tuple<uint16_t,pmt::pmt_t,uint64_t,int> > d_pending;
     };
 
-    dump_tx::sptr dump_tx::make(const std::string& filename,int avg_size, float timeout, bool verb)
+    dump_tx::sptr dump_tx::make(const std::string& filename,int avg_size, float timeout, bool verb,
+      float min_timeout, float max_timeout, bool aggregate)
     {
-      return gnuradio::get_initial_sptr(new dump_tx_impl(filename,avg_size,timeout,verb));
+      return gnuradio::get_initial_sptr(new dump_tx_impl(filename,avg_size,timeout,verb,min_timeout,max_timeout,aggregate));
     }
 
   } /* namespace lsa */
@@ -24,8 +24,9 @@
 
 #include <gnuradio/io_signature.h>
 #include <lsa/file_downloader_tx.h>
+#include "utils.h"
 #include <gnuradio/block_detail.h>
-#include <fstream>
+#include <lsa/payload_corpus.h>
 #include <boost/random/variate_generator.hpp>
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/poisson_distribution.hpp>
@@ -34,21 +35,25 @@ namespace gr {
   namespace lsa {
     #define d_debug false
     #define DEBUG d_debug && std::cout
+    // pause between two downloads
+    #define RESTARTMS 10000
 
     class file_downloader_tx_impl : public file_downloader_tx
     {
       public:
-        file_downloader_tx_impl(const std::string&filename,float mean):block("file_downloader_tx",
+        file_downloader_tx_impl(const std::string&filename,float mean,bool aggregate):block("file_downloader_tx",
             gr::io_signature::make(0,0,0),
             gr::io_signature::make(0,0,0)),
             d_ack_port(pmt::mp("ack_in")),
             d_pdu_port(pmt::mp("pdu_out")),
             d_rng(),
-            d_mean_ms(mean)
+            d_mean_ms(mean),
+            d_aggregate(aggregate)
         {
           message_port_register_in(d_ack_port);
           message_port_register_out(d_pdu_port);
           set_msg_handler(d_ack_port,boost::bind(&file_downloader_tx_impl::ack_in,this,_1));
+          d_clock = mac_clock::wall();
           // read file source
           d_total_bytes = 0;
           if(!read_data(filename)){
@@ -64,25 +69,40 @@ namespace gr {
         }
         ~file_downloader_tx_impl()
         {
-
+          d_clock->detach(this);
+        }
+        void set_clock(const mac_clock::sptr& clock)
+        {
+          if(!clock){
+            throw std::invalid_argument("Clock cannot be null");
+          }
+          gr::thread::scoped_lock guard(d_mutex);
+          d_clock->detach(this);
+          d_clock = clock;
+          d_clock->attach(this);
+          // the download started on the old clock
+          d_start_time = d_clock->now_us();
         }
         bool start()
         {
+          gr::thread::scoped_lock guard(d_mutex);
           d_finished = false;
-          d_thread = boost::shared_ptr<gr::thread::thread>(
-            new gr::thread::thread(&file_downloader_tx_impl::run,this));
+          send();
+          d_clock->started(this);
           return block::start();
         }
         bool stop()
         {
-          d_finished = true;
-          d_ack_received.notify_one();
-          d_thread->interrupt();
-          d_thread->join();
+          {
+            gr::thread::scoped_lock guard(d_mutex);
+            d_finished = true;
+          }
+          d_clock->timers().cancel_all(this);
           return block::stop();
         }
         void ack_in(pmt::pmt_t msg)
         {
+          mac_clock::scoped_handler handled(d_clock,this,msg);
           gr::thread::scoped_lock guard(d_mutex);
           pmt::pmt_t k = pmt::car(msg);
           pmt::pmt_t v = pmt::cdr(msg);
@@ -110,26 +130,17 @@ namespace gr {
         bool read_data(const std::string& filename)
         {
           gr::thread::scoped_lock guard(d_mutex);
-          std::string str,line;
-          d_file.open(filename.c_str(),std::fstream::in);
-          if(!d_file.is_open()){
+          if(!d_data_src.open(filename)){
             return false;
           }
-          while(getline(d_file,line,'\n')){
-            std::istringstream temp(line);
-            std::vector<uint8_t> u8;
-            while(getline(temp,str,',')){
-              int tmp = std::atoi(str.c_str());
-              if(u8.size()>123){
-                throw std::runtime_error("message exceed maximum size");
-              }
-              u8.push_back((uint8_t)tmp);
-            }
-            d_data_src.push_back(u8);
-            d_total_bytes+=u8.size(); // record total bytes
+          if(d_data_src.max_length()>123){
+            throw std::runtime_error("message exceed maximum size");
           }
-          d_file.close();
-          return true;
+          d_total_bytes = d_data_src.bytes(); // record total bytes
+          if(d_aggregate){
+            d_data_src.aggregate(MAX_LSA_PAYLOAD-4);
+          }
+          return !d_data_src.empty();
         }
         float next_delay()
         {
@@ -146,75 +157,77 @@ namespace gr {
           d_buf[1] = u8_seq[0];
           d_buf[2] = u8_seq[1];
           d_buf[3] = u8_seq[0];
-          memcpy(d_buf+4,d_data_src[seq].data(),sizeof(char)*d_data_src[seq].size());
-          d_current_pdu = pmt::make_blob(d_buf,4+d_data_src[seq].size()); // hold pdu
+          memcpy(d_buf+4,d_data_src.data(seq),sizeof(char)*d_data_src.length(seq));
+          d_current_pdu = pmt::make_blob(d_buf,4+d_data_src.length(seq)); // hold pdu
         }
-        void run()
+        // with d_mutex held, the frame is resent after a poisson delay unless acked
+        void send()
         {
-          int retry=0;
-          while(!d_finished)
-          {
-            generate_pdu(d_seq);
-            d_acked = false;
-            message_port_pub(d_pdu_port,pmt::cons(pmt::PMT_NIL,d_current_pdu));
-            gr::thread::scoped_lock lock(d_mutex);
-            d_ack_received.timed_wait(lock,boost::posix_time::milliseconds(next_delay()));
-            lock.unlock();
-            if(d_finished){
+          if(d_finished){
+            return;
+          }
+          generate_pdu(d_seq);
+          d_acked = false;
+          pmt::pmt_t out = pmt::cons(pmt::PMT_NIL,d_current_pdu);
+          d_clock->sent(this,d_pdu_port,out);
+          message_port_pub(d_pdu_port,out);
+          d_clock->timers().schedule(this,next_delay(),
+            boost::bind(&file_downloader_tx_impl::next,this));
+        }
+        void next()
+        {
+          gr::thread::scoped_lock guard(d_mutex);
+          if(d_acked){
+            d_seq++;
+            if(d_seq==d_data_src.size()){
+              // download complete, start over after a pause
+              record_result();
+              d_clock->timers().schedule(this,RESTARTMS,
+                boost::bind(&file_downloader_tx_impl::restart,this));
               return;
-            }else if(d_acked){
-              //acked
-              d_seq++;
-              if(d_seq==d_data_src.size()){
-                // download complete....
-                record_result();
-                boost::this_thread::sleep(boost::posix_time::milliseconds(10000));
-                reset_downloader();
-              }else{
-                retry=0;
-                // if verbose, report download progress?
-              }
-            }else{
-              //timeout
-              retry++;
             }
           }
+          send();
         }
-        void record_result()
+        void restart()
         {
           gr::thread::scoped_lock guard(d_mutex);
-          boost::posix_time::time_duration diff = boost::posix_time::microsec_clock::local_time()-d_start_time;
-          std::cout<<"total_bytes,download_time(ms):"<<d_total_bytes<<","<<diff.total_milliseconds()<<std::endl;
+          reset_downloader();
+          send();
+        }
+        void record_result()
+        {
+          uint64_t diff = d_clock->now_us()-d_start_time;
+          std::cout<<"total_bytes,download_time(ms):"<<d_total_bytes<<","<<diff/1000<<std::endl;
           // may record more detailed message such as: maximum delay, retransmission times,...etc.
         }
         void reset_downloader()
         {
           d_seq = 0;
           d_process_seq=0xffff;
-          d_start_time = boost::posix_time::microsec_clock::local_time();
+          d_start_time = d_clock->now_us();
         }
         const pmt::pmt_t d_ack_port;
         const pmt::pmt_t d_pdu_port;
         float d_mean_ms;
+        const bool d_aggregate;
         bool d_finished;
         bool d_acked;
         long int d_total_bytes;
-        boost::shared_ptr<gr::thread::thread> d_thread;
         boost::mt19937 d_rng;
         boost::shared_ptr< boost::variate_generator <boost::mt19937, boost::poisson_distribution<> > > d_variate_poisson;
         gr::thread::mutex d_mutex;
-        boost::posix_time::ptime d_start_time;
-        gr::thread::condition_variable d_ack_received;
+        mac_clock::sptr d_clock;
+        uint64_t d_start_time;
         unsigned char d_buf[256];
-        std::vector< std::vector<unsigned char> > d_data_src;
-        std::fstream d_file;
+        payload_corpus d_data_src;
         pmt::pmt_t d_current_pdu;
         uint16_t d_process_seq;
         uint16_t d_seq;
     };
-    file_downloader_tx::sptr file_downloader_tx::make(const std::string& filename,float mean)
+    file_downloader_tx::sptr file_downloader_tx::make(const std::string& filename,float mean,bool aggregate)
     {
-      return gnuradio::get_initial_sptr(new file_downloader_tx_impl(filename,mean));
+      return gnuradio::get_initial_sptr(new file_downloader_tx_impl(filename,mean,aggregate));
     }    
 
   } /* namespace lsa */
@@ -0,0 +1,187 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnuradio/io_signature.h>
+#include <lsa/frame_aggregator.h>
+#include <gnuradio/block_detail.h>
+
+namespace gr {
+  namespace lsa {
+    #define d_debug false
+    #define DEBUG d_debug && std::cout
+
+    class frame_aggregator_impl : public frame_aggregator
+    {
+      public:
+        frame_aggregator_impl(int max_len, float max_delay): block("frame_aggregator",
+                  gr::io_signature::make(0,0,0),
+                  gr::io_signature::make(0,0,0)),
+                  d_in_port(pmt::mp("pdu_in")),
+                  d_out_port(pmt::mp("pdu_out")),
+                  d_max_len(max_len),
+                  d_max_delay(max_delay)
+        {
+          if(max_len<=AGG_HDR_LEN+AGG_SUBHDR_LEN || max_delay<0){
+            throw std::invalid_argument("Invalid aggregation length or delay");
+          }
+          message_port_register_in(d_in_port);
+          message_port_register_out(d_out_port);
+          set_msg_handler(d_in_port,boost::bind(&frame_aggregator_impl::pdu_in,this,_1));
+          d_frame.reserve(d_max_len);
+          d_clock = mac_clock::wall();
+          d_flush_timer = 0;
+          d_deadline = 0;
+        }
+        ~frame_aggregator_impl()
+        {
+          d_clock->detach(this);
+        }
+        void set_clock(const mac_clock::sptr& clock)
+        {
+          if(!clock){
+            throw std::invalid_argument("Clock cannot be null");
+          }
+          d_clock->detach(this);
+          d_clock = clock;
+          d_clock->attach(this);
+        }
+        bool start()
+        {
+          d_clock->started(this);
+          return block::start();
+        }
+        bool stop()
+        {
+          {
+            gr::thread::scoped_lock guard(d_mutex);
+            // records still waiting are not lost
+            if(!d_frame.empty()){
+              flush();
+            }
+          }
+          d_clock->timers().cancel_all(this);
+          return block::stop();
+        }
+        void pdu_in(pmt::pmt_t msg)
+        {
+          mac_clock::scoped_handler handled(d_clock,this,msg);
+          gr::thread::scoped_lock guard(d_mutex);
+          pmt::pmt_t v = pmt::cdr(msg);
+          assert(pmt::is_blob(v));
+          size_t io(0);
+          const uint8_t* uvec = pmt::u8vector_elements(v,io);
+          if(!append(d_frame,uvec,io,d_max_len)){
+            flush();
+            if(!append(d_frame,uvec,io,d_max_len)){
+              throw std::runtime_error("record exceeds the aggregation length");
+            }
+          }
+          if(d_frame.size()==AGG_HDR_LEN+AGG_SUBHDR_LEN+io){
+            // first record of a payload starts the delay
+            d_deadline = d_clock->now_us()+(uint64_t)(d_max_delay*1000);
+            d_flush_timer = d_clock->timers().schedule(this,d_max_delay,
+              boost::bind(&frame_aggregator_impl::flush_due,this));
+          }
+          if(d_frame.size()+AGG_SUBHDR_LEN>=d_max_len){
+            flush();
+          }
+        }
+      private:
+        void flush()
+        {
+          DEBUG<<"<Frame Aggregator>payload of "<<d_frame.size()<<" bytes"<<std::endl;
+          pmt::pmt_t out = pmt::cons(pmt::PMT_NIL,pmt::make_blob(d_frame.data(),d_frame.size()));
+          d_clock->sent(this,d_out_port,out);
+          message_port_pub(d_out_port,out);
+          d_frame.clear();
+          d_clock->timers().cancel(d_flush_timer);
+        }
+        void flush_due()
+        {
+          gr::thread::scoped_lock guard(d_mutex);
+          // the payload may have filled up and a new one started meanwhile
+          if(!d_frame.empty() && d_clock->now_us()>=d_deadline){
+            flush();
+          }
+        }
+        const pmt::pmt_t d_in_port;
+        const pmt::pmt_t d_out_port;
+        const size_t d_max_len;
+        const float d_max_delay;
+        gr::thread::mutex d_mutex;
+        mac_clock::sptr d_clock;
+        timer_service::timer_id d_flush_timer;
+        // microseconds on d_clock
+        uint64_t d_deadline;
+        std::vector<unsigned char> d_frame;
+    };
+
+    bool
+    frame_aggregator::append(std::vector<unsigned char>& frame,
+      const unsigned char* record, size_t len, size_t max_len)
+    {
+      const size_t hdr = frame.empty()? AGG_HDR_LEN : 0;
+      if(len>AGG_MAX_RECORD || frame.size()+hdr+AGG_SUBHDR_LEN+len>max_len){
+        return false;
+      }
+      if(frame.empty()){
+        frame.push_back(AGG_MAGIC0);
+        frame.push_back(AGG_MAGIC1);
+      }
+      frame.push_back((unsigned char)(0x80|len));
+      frame.insert(frame.end(),record,record+len);
+      return true;
+    }
+
+    void
+    frame_aggregator::pack(const std::vector< std::vector<unsigned char> >& records,
+      size_t max_len, std::vector< std::vector<unsigned char> >& frames)
+    {
+      std::vector<unsigned char> frame;
+      frames.clear();
+      for(size_t i=0;i<records.size();++i){
+        if(append(frame,records[i].data(),records[i].size(),max_len)){
+          continue;
+        }
+        if(!frame.empty()){
+          frames.push_back(frame);
+          frame.clear();
+        }
+        if(!append(frame,records[i].data(),records[i].size(),max_len)){
+          throw std::runtime_error("record exceeds the aggregation length");
+        }
+      }
+      if(!frame.empty()){
+        frames.push_back(frame);
+      }
+    }
+
+    frame_aggregator::sptr
+    frame_aggregator::make(int max_len, float max_delay)
+    {
+      return gnuradio::get_initial_sptr(new frame_aggregator_impl(max_len,max_delay));
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
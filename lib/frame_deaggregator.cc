@@ -0,0 +1,111 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnuradio/io_signature.h>
+#include <lsa/frame_deaggregator.h>
+#include <lsa/frame_aggregator.h>
+#include <gnuradio/block_detail.h>
+#include <algorithm>
+
+namespace gr {
+  namespace lsa {
+    // header bytes ahead of the payload in the blob, see phy_crc
+    static const pmt::pmt_t d_offset_key = pmt::intern("offset");
+    static const pmt::pmt_t d_long_zero = pmt::from_long(0);
+
+    class frame_deaggregator_impl : public frame_deaggregator
+    {
+      public:
+        frame_deaggregator_impl(): block("frame_deaggregator",
+                  gr::io_signature::make(0,0,0),
+                  gr::io_signature::make(0,0,0)),
+                  d_in_port(pmt::mp("pdu_in")),
+                  d_out_port(pmt::mp("pdu_out"))
+        {
+          message_port_register_in(d_in_port);
+          message_port_register_out(d_out_port);
+          set_msg_handler(d_in_port,boost::bind(&frame_deaggregator_impl::pdu_in,this,_1));
+        }
+        ~frame_deaggregator_impl(){}
+        void pdu_in(pmt::pmt_t msg)
+        {
+          pmt::pmt_t k = pmt::car(msg);
+          pmt::pmt_t v = pmt::cdr(msg);
+          assert(pmt::is_blob(v));
+          size_t io(0);
+          const uint8_t* uvec = pmt::u8vector_elements(v,io);
+          size_t offset = 0;
+          if(pmt::is_dict(k) && pmt::dict_has_key(k,d_offset_key)){
+            offset = std::min(io,(size_t)pmt::to_long(pmt::dict_ref(k,d_offset_key,d_long_zero)));
+            // records are published on their own
+            k = pmt::dict_add(k,d_offset_key,d_long_zero);
+          }
+          if(!unpack(uvec+offset,io-offset,d_records)){
+            message_port_pub(d_out_port,msg);
+            return;
+          }
+          for(size_t i=0;i<d_records.size();++i){
+            message_port_pub(d_out_port,pmt::cons(k,pmt::make_blob(uvec+offset+d_records[i].first,d_records[i].second)));
+          }
+        }
+      private:
+        const pmt::pmt_t d_in_port;
+        const pmt::pmt_t d_out_port;
+        std::vector< std::pair<size_t,size_t> > d_records;
+    };
+
+    bool
+    frame_deaggregator::unpack(const unsigned char* buf, size_t len,
+      std::vector< std::pair<size_t,size_t> >& records)
+    {
+      records.clear();
+      // only payloads carrying the marker are aggregates
+      if(len<AGG_HDR_LEN || buf[0]!=AGG_MAGIC0 || buf[1]!=AGG_MAGIC1){
+        return false;
+      }
+      size_t pos = AGG_HDR_LEN;
+      while(pos<len){
+        // every sub-header has its top bit set
+        if(!(buf[pos]&0x80)){
+          return false;
+        }
+        const size_t rlen = buf[pos]&0x7f;
+        pos += AGG_SUBHDR_LEN;
+        if(pos+rlen>len){
+          return false;
+        }
+        records.push_back(std::make_pair(pos,rlen));
+        pos += rlen;
+      }
+      return !records.empty();
+    }
+
+    frame_deaggregator::sptr
+    frame_deaggregator::make()
+    {
+      return gnuradio::get_initial_sptr(new frame_deaggregator_impl());
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
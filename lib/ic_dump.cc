@@ -0,0 +1,261 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <lsa/ic_dump.h>
+#include <stdexcept>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace gr {
+  namespace lsa {
+    static inline size_t align8(size_t n)
+    {
+      return (n+7) & ~((size_t)7);
+    }
+
+    ic_dump_record::ic_dump_record(const uint8_t* base)
+    {
+      d_base = base;
+      d_hdr = (const ic_dump_rec_hdr_t*) base;
+      d_retx = (const ic_dump_retx_t*) (base+sizeof(ic_dump_rec_hdr_t));
+      d_match = (const ic_dump_match_t*) (base+sizeof(ic_dump_rec_hdr_t)+sizeof(ic_dump_retx_t)*d_hdr->nretx);
+      d_samples = (const gr_complex*) (base+align8(sizeof(ic_dump_rec_hdr_t)+sizeof(ic_dump_retx_t)*d_hdr->nretx
+        +sizeof(ic_dump_match_t)*d_hdr->nmatch));
+    }
+
+    // every section of the record lies inside rec_size
+    static bool
+    record_valid(const uint8_t* base, uint64_t rec_size)
+    {
+      const ic_dump_rec_hdr_t* hdr = (const ic_dump_rec_hdr_t*) base;
+      uint64_t smp_pos = align8(sizeof(ic_dump_rec_hdr_t)+sizeof(ic_dump_retx_t)*(uint64_t)hdr->nretx
+        +sizeof(ic_dump_match_t)*(uint64_t)hdr->nmatch);
+      uint64_t smp_end = smp_pos+sizeof(gr_complex)*(uint64_t)hdr->nsamples;
+      if(smp_end>rec_size){
+        return false;
+      }
+      const ic_dump_retx_t* retx = (const ic_dump_retx_t*) (base+sizeof(ic_dump_rec_hdr_t));
+      for(int i=0;i<hdr->nretx;++i){
+        if(retx[i].blob_offset<smp_end || (uint64_t)retx[i].blob_offset+retx[i].blob_len>rec_size){
+          return false;
+        }
+      }
+      return true;
+    }
+    ic_dump_record::~ic_dump_record(){}
+
+    ic_dump_reader::ic_dump_reader(const std::string& filename)
+    {
+      d_fd = ::open(filename.c_str(),O_RDONLY);
+      if(d_fd<0){
+        throw std::runtime_error("<IC DUMP>cannot open dump file");
+      }
+      struct stat st;
+      if(fstat(d_fd,&st)!=0 || st.st_size<(off_t)sizeof(ic_dump_file_hdr_t)){
+        ::close(d_fd);
+        throw std::runtime_error("<IC DUMP>invalid dump file");
+      }
+      d_map_size = st.st_size;
+      void* ptr = mmap(NULL,d_map_size,PROT_READ,MAP_PRIVATE,d_fd,0);
+      if(ptr==MAP_FAILED){
+        ::close(d_fd);
+        throw std::runtime_error("<IC DUMP>mmap failed");
+      }
+      d_map = (uint8_t*) ptr;
+      const ic_dump_file_hdr_t* fhdr = (const ic_dump_file_hdr_t*) d_map;
+      if(memcmp(fhdr->magic,LSA_IC_DUMP_MAGIC,8)!=0 || fhdr->version<1 || fhdr->version>LSA_IC_DUMP_VERSION){
+        munmap(d_map,d_map_size);
+        ::close(d_fd);
+        throw std::runtime_error("<IC DUMP>unknown dump format");
+      }
+      size_t pos = sizeof(ic_dump_file_hdr_t);
+      if(pos+sizeof(float)*(uint64_t)fhdr->ntaps>d_map_size){
+        munmap(d_map,d_map_size);
+        ::close(d_fd);
+        throw std::runtime_error("<IC DUMP>truncated file header");
+      }
+      const float* taps = (const float*)(d_map+pos);
+      d_taps.assign(taps,taps+fhdr->ntaps);
+      pos = align8(pos+sizeof(float)*fhdr->ntaps);
+      // index records, a truncated tail (writer killed) is ignored
+      while(pos+sizeof(ic_dump_rec_hdr_t)<=d_map_size){
+        const ic_dump_rec_hdr_t* rhdr = (const ic_dump_rec_hdr_t*)(d_map+pos);
+        if(rhdr->magic!=LSA_IC_DUMP_REC_MAGIC || rhdr->rec_size<sizeof(ic_dump_rec_hdr_t) || pos+rhdr->rec_size>d_map_size){
+          break;
+        }
+        if(!record_valid(d_map+pos,rhdr->rec_size)){
+          munmap(d_map,d_map_size);
+          ::close(d_fd);
+          throw std::runtime_error("<IC DUMP>corrupt record");
+        }
+        d_records.push_back(pos);
+        pos+=rhdr->rec_size;
+      }
+    }
+
+    ic_dump_reader::~ic_dump_reader()
+    {
+      munmap(d_map,d_map_size);
+      ::close(d_fd);
+    }
+
+    ic_dump_record
+    ic_dump_reader::record(size_t i) const
+    {
+      if(i>=d_records.size()){
+        throw std::out_of_range("<IC DUMP>record index out of range");
+      }
+      return ic_dump_record(d_map+d_records[i]);
+    }
+
+    ic_dump_writer::ic_dump_writer(const std::string& filename, const std::vector<float>& taps, size_t max_backlog)
+      : d_max_backlog(max_backlog)
+    {
+      d_file = fopen(filename.c_str(),"wb");
+      if(d_file==NULL){
+        throw std::runtime_error("<IC DUMP>cannot open dump file for writing");
+      }
+      ic_dump_file_hdr_t fhdr;
+      memcpy(fhdr.magic,LSA_IC_DUMP_MAGIC,8);
+      fhdr.version = LSA_IC_DUMP_VERSION;
+      fhdr.ntaps = taps.size();
+      std::vector<uint8_t> head(align8(sizeof(fhdr)+sizeof(float)*taps.size()),0);
+      memcpy(head.data(),&fhdr,sizeof(fhdr));
+      memcpy(head.data()+sizeof(fhdr),taps.data(),sizeof(float)*taps.size());
+      fwrite(head.data(),1,head.size(),d_file);
+      fflush(d_file);
+      d_backlog=0;
+      d_seqno=0;
+      d_dropped=0;
+      d_finished = false;
+      d_thread = boost::shared_ptr<gr::thread::thread>
+        (new gr::thread::thread(boost::bind(&ic_dump_writer::run,this)));
+    }
+
+    ic_dump_writer::~ic_dump_writer()
+    {
+      {
+        gr::thread::scoped_lock guard(d_mutex);
+        d_finished = true;
+        d_cond.notify_one();
+      }
+      d_thread->join();
+      fclose(d_file);
+    }
+
+    void
+    ic_dump_writer::write(
+      const gr_complex* samples,
+      int nsamples,
+      int voe_begin,
+      const pmt::pmt_t& front_msg,
+      const std::vector< std::pair<int,pmt::pmt_t> >& matched,
+      const std::vector< std::tuple<int,pmt::pmt_t,uint16_t> >& retx_stack,
+      const std::vector<int>& retx_idx)
+    {
+      size_t blob_size = 0;
+      for(int i=0;i<retx_idx.size();++i){
+        blob_size += align8(pmt::blob_length(std::get<1>(retx_stack[retx_idx[i]])));
+      }
+      const size_t match_pos = sizeof(ic_dump_rec_hdr_t)+sizeof(ic_dump_retx_t)*retx_idx.size();
+      size_t smp_pos = align8(match_pos+sizeof(ic_dump_match_t)*matched.size());
+      size_t blob_pos = smp_pos+align8(sizeof(gr_complex)*nsamples);
+      size_t rec_size = blob_pos+blob_size;
+      gr::thread::scoped_lock guard(d_mutex);
+      if(d_backlog+rec_size>d_max_backlog){
+        d_dropped++;
+        return;
+      }
+      std::vector<uint8_t> rec(rec_size,0);
+      ic_dump_rec_hdr_t* hdr = (ic_dump_rec_hdr_t*) rec.data();
+      hdr->magic = LSA_IC_DUMP_REC_MAGIC;
+      hdr->rec_size = rec_size;
+      hdr->seqno = d_seqno++;
+      hdr->nsamples = nsamples;
+      hdr->voe_begin = voe_begin;
+      hdr->front_pktlen = pmt::to_long(pmt::dict_ref(front_msg,pmt::intern("packet_len"),pmt::from_long(0)));
+      hdr->front_phase = pmt::to_float(pmt::dict_ref(front_msg,pmt::intern("init_phase"),pmt::from_float(0)));
+      hdr->front_qidx = pmt::to_long(pmt::dict_ref(front_msg,pmt::intern("queue_index"),pmt::from_long(0)));
+      hdr->front_qsize = pmt::to_long(pmt::dict_ref(front_msg,pmt::intern("queue_size"),pmt::from_long(0)));
+      hdr->front_base = pmt::to_long(pmt::dict_ref(front_msg,pmt::intern("base"),pmt::from_long(0)));
+      hdr->queue_size = retx_stack.size();
+      hdr->nretx = retx_idx.size();
+      hdr->nmatch = matched.size();
+      ic_dump_retx_t* retx = (ic_dump_retx_t*) (rec.data()+sizeof(ic_dump_rec_hdr_t));
+      for(int i=0;i<retx_idx.size();++i){
+        const std::tuple<int,pmt::pmt_t,uint16_t>& entry = retx_stack[retx_idx[i]];
+        size_t io(0);
+        const uint8_t* uvec = pmt::u8vector_elements(std::get<1>(entry),io);
+        retx[i].qidx = retx_idx[i];
+        retx[i].base = std::get<2>(entry);
+        retx[i].pktlen = std::get<0>(entry);
+        retx[i].blob_offset = blob_pos;
+        retx[i].blob_len = io;
+        memcpy(rec.data()+blob_pos,uvec,io);
+        blob_pos+=align8(io);
+      }
+      ic_dump_match_t* match = (ic_dump_match_t*) (rec.data()+match_pos);
+      for(int i=0;i<matched.size();++i){
+        const pmt::pmt_t& msg = matched[i].second;
+        match[i].offset = matched[i].first;
+        match[i].pktlen = pmt::to_long(pmt::dict_ref(msg,pmt::intern("packet_len"),pmt::from_long(0)));
+        match[i].phase = pmt::to_float(pmt::dict_ref(msg,pmt::intern("init_phase"),pmt::from_float(0)));
+        match[i].qidx = pmt::to_long(pmt::dict_ref(msg,pmt::intern("queue_index"),pmt::from_long(0)));
+        match[i].qsize = pmt::to_long(pmt::dict_ref(msg,pmt::intern("queue_size"),pmt::from_long(0)));
+        match[i].base = pmt::to_long(pmt::dict_ref(msg,pmt::intern("base"),pmt::from_long(0)));
+      }
+      memcpy(rec.data()+smp_pos,samples,sizeof(gr_complex)*nsamples);
+      d_backlog+=rec_size;
+      d_queue.push_back(std::vector<uint8_t>());
+      d_queue.back().swap(rec);
+      d_cond.notify_one();
+    }
+
+    void
+    ic_dump_writer::run()
+    {
+      std::vector<uint8_t> rec;
+      while(true){
+        gr::thread::scoped_lock lock(d_mutex);
+        while(d_queue.empty() && !d_finished){
+          d_cond.wait(lock);
+        }
+        if(d_queue.empty()){
+          // finished and drained
+          return;
+        }
+        rec.swap(d_queue.front());
+        d_queue.pop_front();
+        d_backlog-=rec.size();
+        lock.unlock();
+        fwrite(rec.data(),1,rec.size(),d_file);
+        fflush(d_file);
+      }
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
@@ -0,0 +1,234 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_IC_KERNELS_H
+#define INCLUDED_LSA_IC_KERNELS_H
+
+#include <gnuradio/gr_complex.h>
+#include <volk/volk.h>
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+namespace gr {
+  namespace lsa {
+    // chips per zigbee symbol
+    #define IC_SYMBOL_CHIPS 16
+
+    /*
+     * Reconstruction and cancellation kernels of the IC blocks with the
+     * samples per chip fixed at compile time, so strides and symbol lengths
+     * are constants and the inner loops can be unrolled.
+     */
+    template<int SPS>
+    struct ic_kernels
+    {
+      static const int symbol_len = IC_SYMBOL_CHIPS*SPS;
+
+      // upsample by SPS and pulse shape, accumulating into out
+      static void pulse_shape(gr_complex* out, const gr_complex* chips, int nchips,
+        const gr_complex* taps, int ntaps)
+      {
+        for(int i=0;i<nchips;++i){
+          const gr_complex c = chips[i];
+          gr_complex* o = out+SPS*i;
+          for(int j=0;j<ntaps;++j){
+            o[j]+=c*taps[j];
+          }
+        }
+      }
+
+      // half sine shaping of one symbol of chips, symbol_len samples out
+      static void half_sine(gr_complex* out, const gr_complex* chips)
+      {
+        static const float* taps = half_sine_taps();
+        for(int i=0;i<IC_SYMBOL_CHIPS;++i){
+          for(int k=0;k<SPS;++k){
+            out[SPS*i+k] = chips[i]*taps[k];
+          }
+        }
+      }
+
+      // out = in - gain*ref over one symbol, out may alias in.
+      // spelled out on floats so it vectorizes without -ffast-math
+      static void cancel(gr_complex* out, const gr_complex* in, const gr_complex* ref,
+        const gr_complex& gain)
+      {
+        const float g_re = gain.real(), g_im = gain.imag();
+        const float* x = reinterpret_cast<const float*>(in);
+        const float* r = reinterpret_cast<const float*>(ref);
+        float* y = reinterpret_cast<float*>(out);
+        for(int t=0;t<symbol_len;++t){
+          const float rr = r[2*t], ri = r[2*t+1];
+          y[2*t] = x[2*t]-(g_re*rr-g_im*ri);
+          y[2*t+1] = x[2*t+1]-(g_re*ri+g_im*rr);
+        }
+      }
+
+     private:
+      static const float* half_sine_taps()
+      {
+        static float taps[SPS];
+        for(int k=0;k<SPS;++k){
+          taps[k] = std::sin(M_PI*k/(float)SPS);
+        }
+        return taps;
+      }
+    };
+
+    // kernels bound to one instantiation, selected at construction
+    struct ic_kernel_table
+    {
+      int sps;
+      void (*pulse_shape)(gr_complex*,const gr_complex*,int,const gr_complex*,int);
+      void (*half_sine)(gr_complex*,const gr_complex*);
+      void (*cancel)(gr_complex*,const gr_complex*,const gr_complex*,const gr_complex&);
+    };
+
+    template<int SPS>
+    static inline ic_kernel_table ic_kernel_table_of()
+    {
+      ic_kernel_table table;
+      table.sps = SPS;
+      table.pulse_shape = &ic_kernels<SPS>::pulse_shape;
+      table.half_sine = &ic_kernels<SPS>::half_sine;
+      table.cancel = &ic_kernels<SPS>::cancel;
+      return table;
+    }
+
+    static inline ic_kernel_table ic_kernel_select(int sps)
+    {
+      switch(sps){
+        case 2:
+          return ic_kernel_table_of<2>();
+        case 4:
+          return ic_kernel_table_of<4>();
+        case 8:
+          return ic_kernel_table_of<8>();
+        default:
+          throw std::invalid_argument("Samples per chip must be 2, 4 or 8");
+      }
+    }
+
+    /*
+     * Leading samples dropped from a pulse shaped SU rebuild: the group
+     * delay of the ntaps filter in whole chips, the fraction is left to the
+     * timing estimate. 5 chips for the 11 chip RRC filters of the examples.
+     */
+    static inline int ic_fir_trim(int ntaps, int sps)
+    {
+      return ((ntaps-1)/2/sps)*sps;
+    }
+
+    /*
+     * Normalized lag-delay autocorrelation of the windows in[i,i+delay)
+     * and in[i+delay,i+2*delay) for every offset i in [0,n), as evaluated by
+     * the preamble search of do_ic(). The correlation and both window
+     * energies are slid one sample at a time and recomputed exactly every
+     * refresh offsets to bound the accumulated rounding error.
+     * Reads in[0,n+2*delay-1).
+     */
+    static inline void sliding_autocorr(gr_complex* out, const gr_complex* in,
+      int n, int delay, int refresh=64)
+    {
+      std::complex<double> corr;
+      double eng1=0, eng2=0;
+      for(int i=0;i<n;++i){
+        if(i%refresh==0){
+          gr_complex c, e1, e2;
+          volk_32fc_x2_conjugate_dot_prod_32fc(&c,in+i,in+i+delay,delay);
+          volk_32fc_x2_conjugate_dot_prod_32fc(&e1,in+i,in+i,delay);
+          volk_32fc_x2_conjugate_dot_prod_32fc(&e2,in+i+delay,in+i+delay,delay);
+          corr = std::complex<double>(c.real(),c.imag());
+          eng1 = e1.real();
+          eng2 = e2.real();
+        }else{
+          const gr_complex& x0 = in[i-1];
+          const gr_complex& x1 = in[i-1+delay];
+          const gr_complex& x2 = in[i-1+2*delay];
+          const gr_complex diff = x1*std::conj(x2)-x0*std::conj(x1);
+          corr += std::complex<double>(diff.real(),diff.imag());
+          eng1 += std::norm(x1)-std::norm(x0);
+          eng2 += std::norm(x2)-std::norm(x1);
+        }
+        const double den = std::sqrt(std::max(eng1*eng2,0.0));
+        out[i] = (den>0)? gr_complex(corr.real()/den,corr.imag()/den) : gr_complex(0,0);
+      }
+    }
+
+    #define FRAC_PHASES 16
+    #define FRAC_TAPS 8
+
+    /*
+     * Polyphase fractional delay bank, windowed sinc with FRAC_TAPS taps per
+     * phase. Phase p interpolates the signal p/FRAC_PHASES samples after
+     * each input sample. Phase 0 is the identity.
+     */
+    class frac_delay_bank
+    {
+     public:
+      frac_delay_bank()
+      {
+        const int half = FRAC_TAPS/2;
+        for(int p=0;p<FRAC_PHASES;++p){
+          const float t = p/(float)FRAC_PHASES;
+          float sum =0;
+          for(int k=0;k<FRAC_TAPS;++k){
+            const float u = (k-half+1)-t;
+            const float sinc = (u==0)? 1.0F : std::sin(M_PI*u)/(M_PI*u);
+            const float win = 0.5F*(1.0F+std::cos(M_PI*u/half));
+            d_taps[p][k] = sinc*win;
+            sum += d_taps[p][k];
+          }
+          // unit dc gain for every phase
+          for(int k=0;k<FRAC_TAPS;++k){
+            d_taps[p][k]/=sum;
+          }
+        }
+      }
+      // out[n] = in(n+phase/FRAC_PHASES), reads in[-FRAC_TAPS/2+1, n+FRAC_TAPS/2)
+      void interpolate(gr_complex* out, const gr_complex* in, int n, int phase) const
+      {
+        if(phase==0){
+          memcpy(out,in,sizeof(gr_complex)*n);
+          return;
+        }
+        const float* h = d_taps[phase];
+        const float* x = reinterpret_cast<const float*>(in-FRAC_TAPS/2+1);
+        float* y = reinterpret_cast<float*>(out);
+        for(int i=0;i<n;++i){
+          float re=0, im=0;
+          for(int k=0;k<FRAC_TAPS;++k){
+            re += x[2*(i+k)]*h[k];
+            im += x[2*(i+k)+1]*h[k];
+          }
+          y[2*i] = re;
+          y[2*i+1] = im;
+        }
+      }
+     private:
+      float d_taps[FRAC_PHASES][FRAC_TAPS];
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_IC_KERNELS_H */
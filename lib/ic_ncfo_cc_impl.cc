@@ -33,46 +33,44 @@ namespace gr {
     #define d_debug false
     #define DEBUG d_debug && std::cout
     #define CAPACITY 1000*128*128
-    #define LSAPHYLEN 6
-    #define MODBPS 2
-    #define CHIPRATEINV 8
-    static const int d_protect_size = 512;
-    static const int d_sps =4;
     static const int d_prelen = 128;
+    // max distance between a decoded header and its sfd tag
+    static const int d_match_dist = 64;
+    #define FRAC_CHUNK 4096
+    // zeroed samples after each job buffer, covers the preamble search
+    // windows and interpolator reach past the end of short objects
+    #define IC_JOB_PAD 4096
     
     ic_ncfo_cc::sptr
-    ic_ncfo_cc::make(const std::vector<float>& taps)
+    ic_ncfo_cc::make(const std::vector<float>& taps, int sps, const std::string& dump_file, int storage, int nthreads, const std::string& capture)
     {
       return gnuradio::get_initial_sptr
-        (new ic_ncfo_cc_impl(taps));
+        (new ic_ncfo_cc_impl(taps,sps,dump_file,storage,nthreads,capture));
     }
 
     /*
      * The private constructor
      */
-    ic_ncfo_cc_impl::ic_ncfo_cc_impl(const std::vector<float>& taps)
+    ic_ncfo_cc_impl::ic_ncfo_cc_impl(const std::vector<float>& taps, int sps, const std::string& dump_file, int storage, int nthreads, const std::string& capture)
       : gr::block("ic_ncfo_cc",
               gr::io_signature::make(1, 1, sizeof(gr_complex)),
               gr::io_signature::make(2, 2, sizeof(gr_complex))),
               d_in_port(pmt::mp("pkt_in")),
               d_cap(CAPACITY),
-              d_buff_lim(CAPACITY)
+              d_buff_lim(CAPACITY),
+              d_sps(sps),
+              d_kern(ic_kernel_select(sps)),
+              d_nthreads(nthreads)
     {
       set_tag_propagation_policy(TPP_DONT);
       message_port_register_in(d_in_port);
       set_msg_handler(d_in_port,boost::bind(&ic_ncfo_cc_impl::msg_in,this,_1));
-      d_in_mem = (gr_complex*) volk_malloc(sizeof(gr_complex)*d_cap,volk_get_alignment());
-      d_out_mem = (gr_complex*) volk_malloc(sizeof(gr_complex)*d_cap,volk_get_alignment());
-      d_demo_mem = (gr_complex*) volk_malloc(sizeof(gr_complex)*d_cap,volk_get_alignment());
-      d_intf_mem = (gr_complex*) volk_malloc(sizeof(gr_complex)*d_buff_lim,volk_get_alignment());
-      d_fir_buffer = (gr_complex*) volk_malloc(sizeof(gr_complex)*d_buff_lim,volk_get_alignment());
-      d_ic_mem = (gr_complex*) volk_malloc(sizeof(gr_complex)*d_buff_lim,volk_get_alignment());
-      d_in_idx =0;
+      d_capture = intf_capture::make(capture,sps,storage,d_cap);
+      d_engine_id = d_capture->attach(d_match_dist);
+      d_out_mem = new sample_store(d_cap,storage);
+      d_demo_mem = new sample_store(d_cap,storage);
       d_out_idx=0;
       d_out_size=0;
-      d_intf_idx=0;
-      d_voe_state = VOE_CLEAR;
-      d_cur_intf.clear();
       if(taps.empty()){
         throw std::invalid_argument("Filter taps should not be empty");
       }
@@ -80,10 +78,15 @@ namespace gr {
       for(int i=0;i<taps.size();++i){
         d_taps.push_back(gr_complex(taps[i],0));
       }
-      d_su_rebuild = std::vector<gr_complex>(d_buff_lim);
-      d_tap_buffer = std::vector<gr_complex>(taps.size());
-      d_retx_stack.clear();
-      d_retx_cnt=0;
+      if(nthreads<1){
+        throw std::invalid_argument("Number of IC threads should be at least 1");
+      }
+      d_next_seqno=0;
+      d_commit_seqno=0;
+      d_finished = false;
+      if(!dump_file.empty()){
+        d_dump = ic_dump_writer::sptr(new ic_dump_writer(dump_file,taps));
+      }
     }
 
     /*
@@ -91,390 +94,328 @@ namespace gr {
      */
     ic_ncfo_cc_impl::~ic_ncfo_cc_impl()
     {
-      volk_free(d_in_mem);
-      volk_free(d_out_mem);
-      volk_free(d_intf_mem);
-      volk_free(d_demo_mem);
-      volk_free(d_fir_buffer);
-      volk_free(d_ic_mem);
-      d_su_rebuild.clear();
-      d_tap_buffer.clear();
+      d_capture->detach(d_engine_id);
+      delete d_out_mem;
+      delete d_demo_mem;
+      for(int i=0;i<d_free_jobs.size();++i){
+        delete d_free_jobs[i];
+      }
+      for(int i=0;i<d_pending.size();++i){
+        delete d_pending[i];
+      }
+      std::map<uint64_t,ic_ncfo_job*>::iterator it;
+      for(it=d_done.begin();it!=d_done.end();++it){
+        delete it->second;
+      }
     }
 
     bool
-    ic_ncfo_cc_impl::voe_update(int idx)
+    ic_ncfo_cc_impl::start()
     {
-      bool result = false;
-      if(!d_voe_tags.empty()){
-        int offset = d_voe_tags[0].offset - nitems_read(0);
-        if(offset == idx){
-          result = pmt::to_bool(d_voe_tags[0].value);
-          if(d_voe_state==VOE_CLEAR && result){
-            result = true;
-          }else if(d_voe_state==VOE_TRIGGERED && !result){
-            result = true;
-          }else if(d_voe_state == VOE_PROTECT && result){
-            result = true;
-          }
-          d_voe_tags.erase(d_voe_tags.begin());
+      d_finished = false;
+      // with one thread objects are cancelled inline in general_work
+      if(d_nthreads>1){
+        for(int i=0;i<d_nthreads;++i){
+          d_workers.push_back(boost::shared_ptr<gr::thread::thread>
+            (new gr::thread::thread(boost::bind(&ic_ncfo_cc_impl::run_jobs,this))));
         }
       }
-      return result;
+      return block::start();
     }
 
-    void
-    ic_ncfo_cc_impl::system_update(int idx)
+    bool
+    ic_ncfo_cc_impl::stop()
     {
-      if(!d_sfd_list.empty()){
-        if(std::get<0>(d_sfd_list.front())==idx){
-          d_sfd_list.pop_front();
-        }
+      {
+        gr::thread::scoped_lock lock(d_job_mutex);
+        d_finished = true;
+        d_job_cond.notify_all();
       }
-      if(!d_block_list.empty()){
-        if(std::get<1>(d_block_list.front())==idx){
-          d_block_list.pop_front();
-        }
+      for(int i=0;i<d_workers.size();++i){
+        d_workers[i]->join();
       }
-      if(!d_pkt_history.empty()){
-        if(d_pkt_history.empty()){
-          d_pkt_history.pop_front();
-        }
+      d_workers.clear();
+      return block::stop();
+    }
+
+    ic_ncfo_job*
+    ic_ncfo_cc_impl::acquire_job()
+    {
+      gr::thread::scoped_lock lock(d_job_mutex);
+      if(d_free_jobs.empty()){
+        return new ic_ncfo_job;
       }
+      ic_ncfo_job* job = d_free_jobs.back();
+      d_free_jobs.pop_back();
+      return job;
     }
 
     void
-    ic_ncfo_cc_impl::tags_update(int idx)
+    ic_ncfo_cc_impl::release_job(ic_ncfo_job* job)
     {
-      if(!d_block_tags.empty()){
-        int offset = d_block_tags[0].offset - nitems_read(0);
-        if(offset == idx){
-          //d_offset =0;
-          d_block = pmt::to_uint64(d_block_tags[0].value);
-          d_block_list.push_back(std::make_pair(d_block,d_in_idx));
-          d_block_tags.erase(d_block_tags.begin());
-        }
-      }
-      if(!d_cross_tags.empty()){
-        int offset = d_cross_tags[0].offset - nitems_read(0);
-        if(offset == idx){
-          pmt::pmt_t sfd_msg = pmt::make_dict();
-          sfd_msg = pmt::dict_add(sfd_msg,pmt::intern("init_phase"),d_cross_tags[0].value);
-          int idx_fix = d_in_idx-d_prelen*d_sps;
-          idx_fix = (idx_fix<0)? idx_fix+d_cap:idx_fix;
-          hdr_t sfd_hdr(idx_fix,sfd_msg);
-          d_sfd_list.push_back(std::make_pair(idx_fix,sfd_hdr));
-          d_cross_tags.erase(d_cross_tags.begin());
-        }
-      }
+      // buffers keep their capacity for the next object
+      job->out.clear();
+      job->demo.clear();
+      job->tags.clear();
+      job->retx_stack.clear();
+      gr::thread::scoped_lock lock(d_job_mutex);
+      d_free_jobs.push_back(job);
     }
 
     void
-    ic_ncfo_cc_impl::msg_in(pmt::pmt_t msg)
+    ic_ncfo_cc_impl::submit_job(ic_ncfo_job* job)
     {
-      gr::thread::scoped_lock guard(d_mutex);
-      pmt::pmt_t k = pmt::car(msg);
-      pmt::pmt_t v = pmt::cdr(msg);
-      assert(pmt::is_dict(k));
-      assert(pmt::is_blob(v));
-      size_t io(0);
-      const uint8_t* uvec = u8vector_elements(v,io);
-      uint64_t block = pmt::to_uint64(pmt::dict_ref(k,pmt::intern("block_id"),pmt::from_uint64(0)));
-      int offset = pmt::to_long(pmt::dict_ref(k,pmt::intern("offset"),pmt::from_long(0)));
-      offset *= d_sps;
-      int pktlen = (io+LSAPHYLEN)*CHIPRATEINV*8/MODBPS*d_sps;
-      uint64_t base,base_crc,qsize,qidx;
-      qidx = uvec[0]<<8;
-      qidx|= uvec[1];
-      qsize= uvec[2]<<8;
-      qsize|=uvec[3];
-      base = uvec[4]<<8;
-      base|= uvec[5];
-      base_crc=uvec[6]<<8;
-      base_crc|=uvec[7];
-      if( (qsize!=0 && qidx>=qsize) || (base!=base_crc)){
-        return;
-      }
-      hdr_t hdr;
-      if(!pkt_validate(hdr,block,offset,pktlen,qidx,qsize,base)){
-        return;
-      }
-      if(!matching_pkt(hdr)){
+      job->seqno = d_next_seqno++;
+      if(d_workers.empty()){
+        do_ic(*job);
+        gr::thread::scoped_lock lock(d_job_mutex);
+        d_done[job->seqno] = job;
         return;
       }
-      d_pkt_history.push_back(hdr);
-      retx_detector(qidx,qsize,base,v,pktlen);
+      gr::thread::scoped_lock lock(d_job_mutex);
+      d_pending.push_back(job);
+      d_job_cond.notify_one();
     }
 
-    bool
-    ic_ncfo_cc_impl::pkt_validate(hdr_t& hdr,uint64_t bid,int offset, int pktlen, uint16_t qidx, uint16_t qsize,uint16_t base)
+    void
+    ic_ncfo_cc_impl::run_jobs()
     {
-      std::list< std::pair<uint64_t, int> >::reverse_iterator rit;
-      for(rit=d_block_list.rbegin();rit!=d_block_list.rend();++rit){
-        if(std::get<0>(*rit)==bid){
-          break;
-        }
-      }
-      if(rit==d_block_list.rend()){
-        return false;
-      }
-      // bid and offset at PKTLEN, should track back to preamble
-      int begin = (std::get<1>(*rit) + offset)%d_cap;
-      for(int i=0;i<(d_prelen+16*2)*d_sps;++i){
-        begin = (begin==0)? d_cap-1 : begin-1;
-        if(begin==d_in_idx){
-          DEBUG<<"<PKTVALID>failed at front"<<std::endl;
-          return false;
+      while(true){
+        ic_ncfo_job* job;
+        {
+          gr::thread::scoped_lock lock(d_job_mutex);
+          while(d_pending.empty() && !d_finished){
+            d_job_cond.wait(lock);
+          }
+          if(d_pending.empty()){
+            return;
+          }
+          job = d_pending.front();
+          d_pending.pop_front();
         }
+        do_ic(*job);
+        gr::thread::scoped_lock lock(d_job_mutex);
+        d_done[job->seqno] = job;
       }
-      pmt::pmt_t msg = pmt::make_dict();
-      msg = pmt::dict_add(msg,pmt::intern("packet_len"),pmt::from_long(pktlen));
-      msg = pmt::dict_add(msg,pmt::intern("queue_index"),pmt::from_long(qidx));
-      msg = pmt::dict_add(msg,pmt::intern("queue_size"),pmt::from_long(qsize));
-      msg = pmt::dict_add(msg,pmt::intern("base"),pmt::from_long(base));
-      hdr_t tmp_hdr(begin,msg);
-      hdr = tmp_hdr;
-      return true;
     }
-    bool
-    ic_ncfo_cc_impl::matching_pkt(hdr_t& hdr)
+
+    void
+    ic_ncfo_cc_impl::commit_jobs()
     {
-      const int min_dis = 64;
-      std::list< std::pair<int,hdr_t> >::reverse_iterator rit;
-      int idx = hdr.index();
-      for(rit=d_sfd_list.rbegin();rit!=d_sfd_list.rend();rit++){
-        int distance1 = std::abs(std::get<0>(*rit)-idx);
-        int distance2 = std::abs(std::get<0>(*rit)+d_cap-idx);
-        if(std::min(distance1,distance2)<=min_dis){
-          //DEBUG<<"<Resync>\033[34;1mMatching packets: dist1="<<distance1<<" ,dist2="<<distance2<<"\033[0m"<<std::endl;
-          // possible matched case
-          // remove other headers?
-          pmt::pmt_t tmp = (std::get<1>(*rit)).msg();
-          hdr.set_index(std::get<1>(*rit).index());
-          hdr.add_msg(pmt::intern("init_phase"),pmt::dict_ref(tmp,pmt::intern("init_phase"),pmt::from_float(0)));
-          return true;
+      while(true){
+        ic_ncfo_job* job;
+        {
+          gr::thread::scoped_lock lock(d_job_mutex);
+          std::map<uint64_t,ic_ncfo_job*>::iterator it = d_done.begin();
+          if(it==d_done.end() || it->first!=d_commit_seqno){
+            return;
+          }
+          job = it->second;
+          d_done.erase(it);
+        }
+        d_commit_seqno++;
+        const int nout = job->out.size();
+        if(d_out_size+nout>d_cap){
+          DEBUG<<"<NCFO IC>Output buffer full, dropping IC result:"<<job->seqno<<std::endl;
+        }else if(nout>0){
+          d_out_mem->write(d_out_size,job->out.data(),nout);
+          d_demo_mem->write(d_out_size,job->demo.data(),nout);
+          for(int i=0;i<job->tags.size();++i){
+            tag_t tmp_tag = job->tags[i];
+            tmp_tag.offset += d_out_size;
+            d_out_tags.push_back(tmp_tag);
+          }
+          d_out_size+=nout;
         }
+        release_job(job);
       }
-      return false;
     }
+
     void
-    ic_ncfo_cc_impl::retx_detector(uint16_t qidx,uint16_t qsize,uint16_t base,pmt::pmt_t blob,int pktlen)
+    ic_ncfo_cc_impl::msg_in(pmt::pmt_t msg)
     {
-      if(qsize!=d_retx_stack.size()){
-        d_retx_stack.clear();
-        if(qsize==0){
-          // reset signal
-          d_retx_cnt=0;
-        }else{
-          // direct change of retransmission
-          d_retx_stack.resize(qsize,std::make_tuple(0,pmt::PMT_NIL,0));
-          d_retx_stack[qidx] = std::make_tuple(pktlen,blob,base);
-          d_retx_cnt=1;
-        }
-      }else{
-        if(qsize==0){
-          // clean and also clean
-          return;
-        }
-        // equal retransmissions
-        if(pmt::is_null(std::get<1>(d_retx_stack[qidx]))){
-          d_retx_stack[qidx] = std::make_tuple(pktlen,blob,base);
-          d_retx_cnt++;
-          //DEBUG<<"<RETX> found a new one: base="<<base<<" ,idx="<<qidx<<" ,count="<<d_retx_cnt<<" ,total="<<qsize<<std::endl;
-        }
-      }
+      d_capture->pkt_in(msg);
     }
+
     bool
-    ic_ncfo_cc_impl::create_intf()
+    ic_ncfo_cc_impl::prepare_job(ic_ncfo_job& job, const ic_object& obj)
     {
-      if(!d_cur_intf.empty()){
-        return false;
-      }else if(d_intf_list.empty()){
-        DEBUG<<"Empty intference object state, reset intf index..."<<std::endl;
-        d_intf_idx=0;
-      }else if(d_intf_idx==d_buff_lim){
-        return false;
-      }
-      std::list<hdr_t>::reverse_iterator rit=d_pkt_history.rbegin();
-      if(rit==d_pkt_history.rend()){
-        return false;
-      }
-      intf_t obj;
-      int intf_begin = d_intf_idx;
-      obj.set_begin(d_intf_idx);
-      obj.set_front((*rit));
-      int pkt_begin= (*rit).index();
-      int length=0;
-      if(d_in_idx<pkt_begin){
-        length = d_in_idx+d_cap-pkt_begin;
-      }else{
-        length = d_in_idx-pkt_begin;
-      }
-      if(d_intf_idx+length>=d_buff_lim){
+      const int size = obj.size;
+      if(size>=d_buff_lim){
         return false;
       }
-      while(pkt_begin!=d_in_idx){
-        d_intf_mem[d_intf_idx++] = d_in_mem[pkt_begin++];
-        pkt_begin%=d_cap;
+      job.size = size;
+      job.voe_begin = obj.voe_begin;
+      // copy the object out of the capture buffer, the job must not touch
+      // block state once it is handed to a worker
+      job.ic_mem.assign(size+IC_JOB_PAD,gr_complex(0,0));
+      d_capture->read(job.ic_mem.data(),obj);
+      job.retx_stack = obj.retx_stack;
+      job.retx_idx = obj.retx_idx;
+      pmt::pmt_t front_msg = obj.front_msg;
+      job.is_retx = pmt::to_long(pmt::dict_ref(front_msg,pmt::intern("queue_size"),pmt::from_long(-1)))!=0;
+      if(d_dump){
+        d_dump->write(job.ic_mem.data(),size,job.voe_begin,front_msg,obj.headers,job.retx_stack,job.retx_idx);
       }
-      // record voe tag begin for ease of cancellation
-      obj.add_msg(pmt::intern("voe_begin"),pmt::from_long(d_intf_idx-intf_begin));
-      obj.set_end(d_intf_idx-1);
-      d_cur_intf= obj;
+      DEBUG<<"Calling do ic:"<<std::endl;
+      DEBUG<<"front msg:"<<front_msg<<std::endl;
+      DEBUG<<"intf_begin="<<obj.begin<<" ,intf_size="<<size<<std::endl;
+      DEBUG<<"voe begin="<<job.voe_begin<<std::endl;
       return true;
     }
+
     void
-    ic_ncfo_cc_impl::intf_detector()
-    {
-      if(d_retx_stack.empty()){
-        return;
-      }
-      bool all_done = (d_retx_stack.size()==d_retx_cnt);
-      std::list<intf_t>::iterator it;
-      for(it=d_intf_list.begin();it!=d_intf_list.end();++it){
-        bool do_ic = false;
-        std::vector<int> idx_stack;
-        // remove those intf that the front base not present in retransmission
-        pmt::pmt_t front_msg = (*it).front().msg();
-        uint16_t front_base = pmt::to_long(pmt::dict_ref(front_msg,pmt::intern("base"),pmt::from_long(-1)));
-        //DEBUG<<"<INTF>search base="<<front_base<<std::endl;
-        for(int i=0;i<d_retx_stack.size();++i){
-          uint16_t retx_base = std::get<2>(d_retx_stack[i]);
-          if(front_base == retx_base){
-            // matched in base
-            // check whether retransmission is enough for cancellation
-            int total_size = (*it).size();
-            int idx_iter = i;
-            while(total_size>0){
-              if(pmt::is_null(std::get<1>(d_retx_stack[idx_iter]))){
-                break;
-              }
-              total_size-=std::get<0>(d_retx_stack[idx_iter]);
-              idx_stack.push_back(idx_iter);
-              idx_iter=(idx_iter+1)%d_retx_stack.size();
-            }
-            if(total_size<0){
-              do_ic = true;
-              break;
-            }
-          }
-        }
-        if(do_ic){
-          // indication of ic avalability
-          DEBUG<<"<INTF DETECTOR>An intf object ready to do ic!"<<std::endl;
-          d_ic_list.push_back(std::make_pair(*it,idx_stack));
-          // DO NOT remove to prevent cleaning up before ic
-          //it = d_intf_list.erase(it);
-        }else if(all_done){
-          // outdated intf object
-          DEBUG<<"<INTF DETECTOR>An outdated intf object removed!"<<std::endl;
-          it = d_intf_list.erase(it);
-        }
-      }
-    }
-    void
-    ic_ncfo_cc_impl::do_ic(std::pair<intf_t,std::vector<int> > obj)
+    ic_ncfo_cc_impl::do_ic(ic_ncfo_job& job) const
     {
-      int begin = std::get<0>(obj).begin();
-      const int size = std::get<0>(obj).size();
-      if(size>=d_buff_lim){
-        return;
-      }
-      pmt::pmt_t intf_msg = std::get<0>(obj).msg();
-      int voe_begin = pmt::to_long(pmt::dict_ref(intf_msg,pmt::intern("voe_begin"),pmt::from_long(-1)));
-      
-      memcpy(d_ic_mem,d_intf_mem+begin,sizeof(gr_complex)*size);
-      std::vector<int> retx_idx = std::get<1>(obj);
-      // result are stored in d_intf_idx[begin] up to d_intf_idx[begin+size-1];
-      DEBUG<<"Calling do ic:"<<std::endl;
-      DEBUG<<"front tag:"<<std::get<0>(obj).front()<<std::endl;
-      DEBUG<<"intf_begin="<<begin<<" ,intf_size="<<size<<std::endl;
-      DEBUG<<"voe begin="<<voe_begin<<std::endl;
-      //DEBUG<<"Retransmissions:"<<std::endl;
+      const int size = job.size;
+      const int voe_begin = job.voe_begin;
+      const gr_complex* ic_mem = job.ic_mem.data();
       // required retransmissions 
       int length_cnt=0;
-      for(int i=0;i<retx_idx.size();++i){
-        DEBUG<<"pkt_len:"<<std::get<0>(d_retx_stack[retx_idx[i]])<<" ,base:"<<std::get<2>(d_retx_stack[retx_idx[i]])<<std::endl;
-        pmt::pmt_t blob = std::get<1>(d_retx_stack[retx_idx[i]]);
-        length_cnt+= std::get<0>(d_retx_stack[retx_idx[i]]);
+      for(int i=0;i<job.retx_idx.size();++i){
+        DEBUG<<"pkt_len:"<<std::get<0>(job.retx_stack[job.retx_idx[i]])<<" ,base:"<<std::get<2>(job.retx_stack[job.retx_idx[i]])<<std::endl;
+        length_cnt+= std::get<0>(job.retx_stack[job.retx_idx[i]]);
       }
       if(length_cnt>=d_cap/4){
         DEBUG<<"DO IC ERROR: rebuild length greater than available memory size"<<std::endl;
         return;
       }
-      pmt::pmt_t front_msg = (std::get<0>(obj)).front().msg();
-      bool is_retx = pmt::to_long(pmt::dict_ref(front_msg,pmt::intern("queue_size"),pmt::from_long(-1)))!=0;
-      std::vector<int> pkt_len;
-      rebuild_su(is_retx,retx_idx,pkt_len); // store samples of su in d_su_rebuild
-      // reset index
-      d_cancel_idx =0;
       gr_complex cross_corr, corr_eng, auto_corr, su_eng;
       uint16_t max_idx = 0;
-      const int delay = 128;
+      const int delay = 32*d_sps;
+      const int search_len = d_prelen*d_sps;
+      rebuild_su(job); // store samples of su in job.su_rebuild
+      if(job.su_rebuild.size()<search_len+size+IC_JOB_PAD){
+        job.su_rebuild.resize(search_len+size+IC_JOB_PAD,gr_complex(0,0));
+      }
+      job.frac_buf.resize(FRAC_CHUNK);
+      const gr_complex* su_rebuild = job.su_rebuild.data();
+      gr_complex* corr_test = job.corr_test;
+      gr_complex* frac_buf = job.frac_buf.data();
       int pkt_begin =0;
-      gr_complex auto_eng;
-      for(int i=0;i<512;++i){
-        int auto_idx = pkt_begin+i;
-        volk_32fc_x2_conjugate_dot_prod_32fc(&auto_corr,d_ic_mem+auto_idx,d_ic_mem+auto_idx+delay,delay);
-        volk_32fc_x2_conjugate_dot_prod_32fc(&corr_eng,d_ic_mem+auto_idx,d_ic_mem+auto_idx,delay);
-        volk_32fc_x2_conjugate_dot_prod_32fc(&auto_eng,d_ic_mem+auto_idx+delay,d_ic_mem+auto_idx+delay,delay);
-        d_corr_test[i] = auto_corr/std::sqrt(corr_eng*auto_eng);
-      }
-      volk_32fc_index_max_16u(&max_idx,d_corr_test,512);
-      if(std::abs(d_corr_test[max_idx])>0.9){
-        DEBUG<<"Step 1 passed: autocorrelation idx:"<<max_idx<<" ,value:"<<std::abs(d_corr_test[max_idx])<<std::endl;
+      sliding_autocorr(corr_test,ic_mem+pkt_begin,search_len,delay);
+      volk_32fc_index_max_16u(&max_idx,corr_test,search_len);
+      if(std::abs(corr_test[max_idx])>0.9){
+        DEBUG<<"Step 1 passed: autocorrelation idx:"<<max_idx<<" ,value:"<<std::abs(corr_test[max_idx])<<std::endl;
       }else{
-        DEBUG<<"Step 1 failed: value:"<<std::abs(d_corr_test[max_idx])<<std::endl;
+        DEBUG<<"Step 1 failed: value:"<<std::abs(corr_test[max_idx])<<std::endl;
         return;
       }
-      uint16_t sfd_idx = pkt_begin+512-d_sps;
-      volk_32fc_x2_conjugate_dot_prod_32fc(&su_eng,&d_su_rebuild[512],&d_su_rebuild[512],delay);
+      int sfd_idx = pkt_begin+search_len-d_sps;
+      volk_32fc_x2_conjugate_dot_prod_32fc(&su_eng,su_rebuild+search_len,su_rebuild+search_len,delay);
       for(int i=0;i<2*d_sps;++i){
         int cross_idx = sfd_idx +i;
-        volk_32fc_x2_conjugate_dot_prod_32fc(&cross_corr,d_ic_mem+cross_idx,&d_su_rebuild[512],delay);
-        volk_32fc_x2_conjugate_dot_prod_32fc(&corr_eng,d_ic_mem+cross_idx,d_ic_mem+cross_idx,delay);
-        d_corr_test[i] = cross_corr/std::sqrt(corr_eng*su_eng);
+        volk_32fc_x2_conjugate_dot_prod_32fc(&cross_corr,ic_mem+cross_idx,su_rebuild+search_len,delay);
+        volk_32fc_x2_conjugate_dot_prod_32fc(&corr_eng,ic_mem+cross_idx,ic_mem+cross_idx,delay);
+        corr_test[i] = cross_corr/std::sqrt(corr_eng*su_eng);
       }
-      volk_32fc_index_max_16u(&max_idx,d_corr_test,2*d_sps);
-      if(std::abs(d_corr_test[max_idx])>0.9){
-        DEBUG<<"Step 2 passed: cross correlation idx:"<<sfd_idx+max_idx<<" ,value"<<std::abs(d_corr_test[max_idx])<<std::endl;
+      volk_32fc_index_max_16u(&max_idx,corr_test,2*d_sps);
+      if(std::abs(corr_test[max_idx])>0.9){
+        DEBUG<<"Step 2 passed: cross correlation idx:"<<sfd_idx+max_idx<<" ,value"<<std::abs(corr_test[max_idx])<<std::endl;
       }else{
-        DEBUG<<"Step 2 failed: failed value:"<<std::abs(d_corr_test[max_idx])<<std::endl;
+        DEBUG<<"Step 2 failed: failed value:"<<std::abs(corr_test[max_idx])<<std::endl;
         return;
       }
       sfd_idx+=max_idx;
-      d_cancel_idx = 512;
-      d_su_phase = fast_atan2f(d_corr_test[max_idx].imag(),d_corr_test[max_idx].real());
-      d_su_gain = std::real(std::sqrt(corr_eng/su_eng));
+      int cancel_idx = search_len;
+      // refine to 1/FRAC_PHASES sample: try rebuilt su shifted within one
+      // sample either side of the integer peak
+      volk_32fc_x2_conjugate_dot_prod_32fc(&corr_eng,ic_mem+sfd_idx,ic_mem+sfd_idx,delay);
+      float best_val = -1;
+      float su_gain = 0, su_phase = 0;
+      int frac_shift = 0, frac_phase = 0;
+      for(int q=-FRAC_PHASES+1;q<FRAC_PHASES;++q){
+        int shift = (q<0)? -1 : 0;
+        int phase = (q<0)? q+FRAC_PHASES : q;
+        d_frac.interpolate(frac_buf,su_rebuild+cancel_idx+shift,delay,phase);
+        volk_32fc_x2_conjugate_dot_prod_32fc(&cross_corr,ic_mem+sfd_idx,frac_buf,delay);
+        volk_32fc_x2_conjugate_dot_prod_32fc(&su_eng,frac_buf,frac_buf,delay);
+        float val = std::abs(cross_corr)/std::sqrt(corr_eng.real()*su_eng.real());
+        if(val>best_val){
+          best_val = val;
+          frac_shift = shift;
+          frac_phase = phase;
+          su_phase = fast_atan2f(cross_corr.imag(),cross_corr.real());
+          su_gain = std::sqrt(corr_eng.real()/su_eng.real());
+        }
+      }
+      DEBUG<<"Fractional alignment: "<<frac_shift<<"+"<<frac_phase<<"/"<<FRAC_PHASES<<" ,value:"<<best_val<<std::endl;
       tag_t tmp_tag;
-      tmp_tag.offset = d_out_size;
+      tmp_tag.offset = 0;
       tmp_tag.key= pmt::intern("ic_out");
       tmp_tag.value = pmt::PMT_T;
-      d_out_tags.push_back(tmp_tag);
-      tmp_tag.offset = d_out_size+ std::max(voe_begin-sfd_idx,0);
+      job.tags.push_back(tmp_tag);
+      tmp_tag.offset = std::max(voe_begin-sfd_idx,0);
       tmp_tag.key = pmt::intern("voe_begin");
-      d_out_tags.push_back(tmp_tag);
-      for(sfd_idx;sfd_idx<size;++sfd_idx){
-        d_demo_mem[d_out_size] = d_ic_mem[sfd_idx];
-        d_out_mem[d_out_size++] = d_ic_mem[sfd_idx] - d_su_gain*gr_expj(d_su_phase)*d_su_rebuild[d_cancel_idx++];
+      job.tags.push_back(tmp_tag);
+      const gr_complex su_coeff = su_gain*gr_expj(su_phase);
+      job.demo.assign(ic_mem+sfd_idx,ic_mem+size);
+      job.out.resize(size-sfd_idx);
+      int out_idx =0;
+      while(sfd_idx<size){
+        int nblock = std::min(size-sfd_idx,FRAC_CHUNK);
+        d_frac.interpolate(frac_buf,su_rebuild+cancel_idx+frac_shift,nblock,frac_phase);
+        for(int t=0;t<nblock;++t){
+          job.out[out_idx++] = ic_mem[sfd_idx+t] - su_coeff*frac_buf[t];
+        }
+        sfd_idx+=nblock;
+        cancel_idx+=nblock;
+      }
+      DEBUG<<"<NCFO IC>IC Done, Output size:"<<job.out.size()<<std::endl;
+    }
+    bool
+    ic_ncfo_cc_impl::replay(const ic_dump_record& rec, float& depth)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      const int size = rec.nsamples();
+      if(size<=1 || size>=d_buff_lim){
+        return false;
       }
-      DEBUG<<"<NCFO IC>IC Done, Output size:"<<d_out_size<<std::endl;
+      ic_ncfo_job* job = acquire_job();
+      job->size = size;
+      job->voe_begin = rec.voe_begin();
+      job->is_retx = rec.front_qsize()!=0;
+      job->ic_mem.assign(size+IC_JOB_PAD,gr_complex(0,0));
+      memcpy(job->ic_mem.data(),rec.samples(),sizeof(gr_complex)*size);
+      job->retx_stack.resize(rec.queue_size(),std::make_tuple(0,pmt::PMT_NIL,0));
+      job->retx_idx.clear();
+      for(int i=0;i<rec.nretx();++i){
+        const ic_dump_retx_t& retx = rec.retx(i);
+        if(retx.qidx>=job->retx_stack.size()){
+          release_job(job);
+          return false;
+        }
+        job->retx_stack[retx.qidx] = std::make_tuple(retx.pktlen,pmt::make_blob(rec.retx_data(i),retx.blob_len),retx.base);
+        job->retx_idx.push_back(retx.qidx);
+      }
+      do_ic(*job);
+      const int nout = job->out.size();
+      bool result = nout>0;
+      if(result){
+        gr_complex in_eng, out_eng;
+        volk_32fc_x2_conjugate_dot_prod_32fc(&in_eng,rec.samples(),rec.samples(),size);
+        volk_32fc_x2_conjugate_dot_prod_32fc(&out_eng,job->out.data(),job->out.data(),nout);
+        depth = 10.0f*std::log10((in_eng.real()/size)/(out_eng.real()/nout));
+      }
+      release_job(job);
+      return result;
     }
+
     void
-    ic_ncfo_cc_impl::rebuild_su(bool retx, const std::vector<int>& retx_idx, std::vector<int>& pkt_len)
+    ic_ncfo_cc_impl::rebuild_su(ic_ncfo_job& job) const
     {
-      DEBUG<<"Rebuild SU samples: retransmission header?"<<retx<<std::endl;
-      // reset fir buffer;
-      std::fill(d_su_rebuild.begin(),d_su_rebuild.end(),gr_complex(0,0));
+      const std::vector<int>& retx_idx = job.retx_idx;
+      DEBUG<<"Rebuild SU samples: retransmission header?"<<job.is_retx<<std::endl;
       // d_lsaphy_idx [] in total 10 elements
       int hdr_idx[retx_idx.size()][8];
-      if(!retx){
+      if(!job.is_retx){
         for(int i=0;i<retx_idx.size();++i){
           for(int j=0;j<8;++j)
             hdr_idx[i][j]=0;
         }
       }else{
        for(int i=0;i<retx_idx.size();++i){
-         uint16_t qsize = d_retx_stack.size();
+         uint16_t qsize = job.retx_stack.size();
          uint16_t qidx = retx_idx[i];
          uint8_t * qs8 = (uint8_t*)&qsize;
          uint8_t * qi8 = (uint8_t*)&qidx;
@@ -488,44 +429,47 @@ namespace gr {
          hdr_idx[i][7] = qs8[0]&0x0f;
        }
       }
+      // size the chip and sample buffers to this object
+      int nchips =0;
+      for(int i=0;i<retx_idx.size();++i){
+        nchips += 192+32*pmt::blob_length(std::get<1>(job.retx_stack[retx_idx[i]]));
+      }
+      job.fir_buffer.resize(nchips);
+      job.su_rebuild.assign(nchips*d_sps+d_taps.size()+IC_JOB_PAD,gr_complex(0,0));
+      gr_complex* fir_buffer = job.fir_buffer.data();
       // use fir buffer to rebuild su
       int size_cnt =0;
       for(int i=0;i<retx_idx.size();++i){
-        pmt::pmt_t blob = std::get<1>(d_retx_stack[retx_idx[i]]);
+        pmt::pmt_t blob = std::get<1>(job.retx_stack[retx_idx[i]]);
         size_t io(0);
         // copy preamble
         for(int k=0;k<10;++k){
-          memcpy(d_fir_buffer+size_cnt+k*16,d_map[d_lsaphy_idx[k]],sizeof(gr_complex)*16);
+          memcpy(fir_buffer+size_cnt+k*16,d_map[d_lsaphy_idx[k]],sizeof(gr_complex)*16);
         }
         size_cnt+=160;
         const uint8_t* uvec = pmt::u8vector_elements(blob,io);
-        pkt_len.push_back((io+6)*8*8*2);
         uint8_t u8_io = (uint8_t)io;
         // copy size field
-        memcpy(d_fir_buffer+size_cnt,d_map[(u8_io>>4)&0x0f],sizeof(gr_complex)*16);
-        memcpy(d_fir_buffer+size_cnt+16,d_map[u8_io&0x0f],sizeof(gr_complex)*16);
+        memcpy(fir_buffer+size_cnt,d_map[(u8_io>>4)&0x0f],sizeof(gr_complex)*16);
+        memcpy(fir_buffer+size_cnt+16,d_map[u8_io&0x0f],sizeof(gr_complex)*16);
         size_cnt+=32;
         // paste header according to retx type
         for(int h=0;h<8;++h){
-          memcpy(d_fir_buffer+size_cnt+16*h,d_map[hdr_idx[i][h]],sizeof(gr_complex)*16);
+          memcpy(fir_buffer+size_cnt+16*h,d_map[hdr_idx[i][h]],sizeof(gr_complex)*16);
         }
         // rebuild payload
         for(int j=4;j<io;++j){
-          memcpy(d_fir_buffer+size_cnt+j*32,d_map[(uvec[j]>>4)&0x0f],sizeof(gr_complex)*16);
-          memcpy(d_fir_buffer+size_cnt+j*32+16,d_map[uvec[j]&0x0f],sizeof(gr_complex)*16);
+          memcpy(fir_buffer+size_cnt+j*32,d_map[(uvec[j]>>4)&0x0f],sizeof(gr_complex)*16);
+          memcpy(fir_buffer+size_cnt+j*32+16,d_map[uvec[j]&0x0f],sizeof(gr_complex)*16);
         }
         // 4 for subtracting header length
         size_cnt+=(32*io);
       }
       DEBUG<<"REbuild SU, generated symbols:"<<size_cnt<<std::endl;
       // fir filter
-      for(int i=0;i<size_cnt;++i){
-        volk_32fc_s32fc_multiply_32fc(d_tap_buffer.data(),d_taps.data(),d_fir_buffer[i],d_taps.size());
-        for(int j=0;j<d_taps.size();++j)
-          d_su_rebuild[d_sps*i+j]+=d_tap_buffer[j];
-      }
-      // additional taps for fir 
-      memcpy(d_su_rebuild.data(),d_su_rebuild.data()+20,sizeof(gr_complex)*size_cnt*d_sps);
+      d_kern.pulse_shape(job.su_rebuild.data(),fir_buffer,size_cnt,d_taps.data(),d_taps.size());
+      // drop the filter delay, source and destination overlap
+      memmove(job.su_rebuild.data(),job.su_rebuild.data()+ic_fir_trim(d_taps.size(),d_sps),sizeof(gr_complex)*size_cnt*d_sps);
     }
 
     void
@@ -544,7 +488,6 @@ namespace gr {
       gr_complex *out = (gr_complex *) output_items[0];
       gr_complex *demo= (gr_complex *) output_items[1];
       int nin = ninput_items[0];
-      int count=0;
       d_voe_tags.clear();
       d_cross_tags.clear();
       d_block_tags.clear();
@@ -553,108 +496,21 @@ namespace gr {
         get_tags_in_window(d_block_tags,0,0,nin,pmt::intern("block_tag"));
         get_tags_in_window(d_cross_tags,0,0,nin,pmt::intern("phase_est"));
       }
-      while(count<nin){
-        switch(d_voe_state){
-          case VOE_CLEAR:
-            while(count<nin){
-              tags_update(count);
-              if(voe_update(count)){
-                d_voe_state = VOE_TRIGGERED;
-                DEBUG<<"\033[35;1m<NCFO_IC>Found a VoE begin tag at:"<<d_in_idx<<"\033[0m"<<std::endl;
-                if(create_intf()){
-                  DEBUG<<"\033[34;1m<NCFO_IC>Created an interference object"<<"\033[0m"<<std::endl;
-                }else{
-                  DEBUG<<"\033[34;1m<NCFO_IC>Failed to create an interference object"<<"\033[0m"<<std::endl;
-                  d_intf_idx = d_cur_intf.begin();
-                  d_cur_intf.clear();
-                }
-                break;
-              }
-              d_in_mem[d_in_idx++] = in[count++];
-              d_in_idx%=d_cap;
-              system_update(d_in_idx);
-            }
-          break;
-          case VOE_TRIGGERED:
-            while(count<nin){
-              tags_update(count);
-              if(voe_update(count)){
-                DEBUG<<"\033[35;1m<NCFO_IC>Found a VoE end tag at:"<<d_in_idx<<"\033[0m"<<std::endl;
-                d_voe_state = VOE_PROTECT;
-                d_protect_cnt=0;
-                break;
-              }
-              if(!d_cur_intf.front_tag_empty()){
-                d_intf_mem[d_intf_idx++] = in[count];
-                d_cur_intf.increment();
-                if(d_intf_idx==d_buff_lim){
-                  d_intf_idx = d_cur_intf.begin();
-                  d_cur_intf.clear();
-                }
-              }
-              d_in_mem[d_in_idx++] = in[count++];
-              d_in_idx%=d_cap;
-              system_update(d_in_idx);
-            }
-          break;
-          case VOE_PROTECT:
-            while(count<nin && d_protect_cnt<d_protect_size){
-              tags_update(count);
-              if(voe_update(count)){
-                DEBUG<<"\033[35;1m<NCFO_IC>In Protect state, found a VoE tag at:"<<d_in_idx<<" ,protect_cnt:"<<d_protect_cnt<<"\033[0m"<<std::endl;
-                d_voe_state = VOE_TRIGGERED;
-                d_intf_list.push_back(d_cur_intf);
-                d_cur_intf.clear();
-                if(create_intf()){
-                  DEBUG<<"\033[34;1m<NCFO_IC> Tight collision, but still create an intf object\033[0m"<<std::endl;
-                }else{
-                  DEBUG<<"\033[34;1m<NCFO_IC> Tight collision, intf object failed\033[0m"<<std::endl;
-                  d_cur_intf.clear();
-                }
-                break;
-              }
-              d_intf_mem[d_intf_idx++] = in[count];
-              d_in_mem[d_in_idx++] = in[count++];
-              d_in_idx%=d_cap;
-              system_update(d_in_idx);
-              d_cur_intf.increment();
-              d_protect_cnt++;
-              if(d_protect_cnt==d_protect_size){
-                d_voe_state = VOE_CLEAR;
-                d_protect_cnt=0;
-                d_intf_list.push_back(d_cur_intf);
-                d_cur_intf.clear();
-                DEBUG<<"\033[35;1m<NCFO_IC>Complete collect additional samples to avoid trimming ProU signal\033[0m"<<std::endl;
-                break;
-              }else if(d_intf_idx==d_buff_lim){
-                d_intf_idx = d_cur_intf.begin();
-                d_cur_intf.clear();
-                d_voe_state = VOE_CLEAR;
-                d_protect_cnt=0;
-                break;
-              }
-            }
-          break;
-          default:
-            throw std::runtime_error("Undefined state");
-          break;
-        }
-      }
-      intf_detector();
-      std::list<intf_t>::iterator intf_it;
-      while(!d_ic_list.empty()){
-        do_ic(d_ic_list.front());
-        for(intf_it=d_intf_list.begin();intf_it!=d_intf_list.end();++intf_it){
-          if((std::get<0>(d_ic_list.front())).begin() == (*intf_it).begin()){
-            intf_it = d_intf_list.erase(intf_it);
-            break;
-          }
+      d_capture->feed(in,nin,nitems_read(0),d_block_tags,d_voe_tags,d_cross_tags);
+      ic_object obj;
+      while(d_capture->pop(d_engine_id,obj)){
+        ic_ncfo_job* job = acquire_job();
+        if(prepare_job(*job,obj)){
+          submit_job(job);
+        }else{
+          release_job(job);
         }
-        d_ic_list.pop_front();
+        d_capture->release(obj);
       }
+      commit_jobs();
       int nout = std::min(std::max(d_out_size-d_out_idx,0),noutput_items);
-      memcpy(out,d_out_mem+d_out_idx,sizeof(gr_complex)*nout);
-      memcpy(demo,d_demo_mem+d_out_idx,sizeof(gr_complex)*nout);
+      d_out_mem->read(out,d_out_idx,nout);
+      d_demo_mem->read(demo,d_out_idx,nout);
       std::list<tag_t>::iterator oit = d_out_tags.begin();
       while(oit!=d_out_tags.end()){
         tag_t check_tag = *oit;
@@ -679,7 +535,7 @@ namespace gr {
         d_out_idx=0;
         d_out_size=0;
       }
-      consume_each (count);
+      consume_each (nin);
       return nout;
     }
 
@@ -23,82 +23,96 @@
 
 #include <lsa/ic_ncfo_cc.h>
 #include "utils.h"
+#include "sample_store.h"
+#include "ic_kernels.h"
+#include "intf_capture.h"
+#include <deque>
+#include <map>
 
 namespace gr {
   namespace lsa {
 
-    enum VOESTATE{
-      VOE_CLEAR,
-      VOE_TRIGGERED,
-      VOE_PROTECT
-    };
-    enum ICSTATE{
-      CLEAR,
-      COLLECT,
-      RESET
+    /*
+     * One interference object together with all the scratch state the IC
+     * engine needs to cancel it. A job is owned by exactly one thread while
+     * it runs, so independent objects can be cancelled concurrently.
+     */
+    struct ic_ncfo_job
+    {
+      uint64_t seqno;     // capture order
+      int size;
+      int voe_begin;
+      bool is_retx;
+      std::vector< std::tuple<int,pmt::pmt_t,uint16_t> > retx_stack;
+      std::vector<int> retx_idx;
+      std::vector<gr_complex> ic_mem;
+      std::vector<gr_complex> fir_buffer;
+      std::vector<gr_complex> su_rebuild;
+      std::vector<gr_complex> frac_buf;
+      gr_complex corr_test[2048];
+      // results, tag offsets are relative to out[0]
+      std::vector<gr_complex> out;
+      std::vector<gr_complex> demo;
+      std::vector<tag_t> tags;
     };
+
     class ic_ncfo_cc_impl : public ic_ncfo_cc
     {
      private:
       const int d_cap;
       const int d_buff_lim;
+      const int d_sps;
+      const ic_kernel_table d_kern;
       const pmt::pmt_t d_in_port;
 
       std::vector<tag_t> d_voe_tags;
       std::vector<tag_t> d_block_tags;
       std::vector<tag_t> d_cross_tags;
-      gr_complex* d_in_mem;
-      gr_complex* d_out_mem;
-      gr_complex* d_demo_mem;
-      gr_complex* d_intf_mem;
-      gr_complex* d_fir_buffer;
-      gr_complex* d_ic_mem;
-      int d_in_idx;
+      intf_capture::sptr d_capture;
+      int d_engine_id;
+      sample_store* d_out_mem;
+      sample_store* d_demo_mem;
       int d_out_size;
       int d_out_idx;
-      int d_intf_idx;
-      std::vector<gr_complex> d_su_rebuild;
       std::vector<gr_complex> d_taps;
-      std::vector<gr_complex> d_tap_buffer;
-      uint64_t d_block;
       gr::thread::mutex d_mutex;
-      intf_t d_cur_intf;
-      int d_voe_state;
-      int d_protect_cnt;
-      std::list<std::pair<uint64_t,int> > d_block_list;
-      std::list<std::pair<int,hdr_t> > d_sfd_list;
-      std::list<hdr_t> d_pkt_history;
-
-      int d_retx_cnt;
-      std::vector< std::tuple<int,pmt::pmt_t,uint16_t> > d_retx_stack;
-      std::list<std::pair<intf_t,std::vector<int> > > d_ic_list;
-      std::list<intf_t> d_intf_list;
 
       std::list<tag_t> d_out_tags;
+      ic_dump_writer::sptr d_dump;
+
+      // sub-sample SU alignment
+      const frac_delay_bank d_frac;
 
-      gr_complex d_corr_test[1024];
-      float d_su_gain;
-      float d_su_phase;
-      int d_cancel_idx;
+      // IC workers, results are committed in capture order
+      const int d_nthreads;
+      std::vector< boost::shared_ptr<gr::thread::thread> > d_workers;
+      gr::thread::mutex d_job_mutex;
+      gr::thread::condition_variable d_job_cond;
+      std::deque<ic_ncfo_job*> d_pending;
+      std::map<uint64_t,ic_ncfo_job*> d_done;
+      std::vector<ic_ncfo_job*> d_free_jobs;
+      uint64_t d_next_seqno;
+      uint64_t d_commit_seqno;
+      bool d_finished;
 
-      bool voe_update(int idx);
-      void system_update(int idx);
-      void tags_update(int idx);
       void msg_in(pmt::pmt_t msg);
-      
-      // pkt matching functions
-      bool pkt_validate(hdr_t& hdr,uint64_t bid,int offset,int pktlen, uint16_t qidx,uint16_t qsize, uint16_t base);
-      bool matching_pkt(hdr_t& hdr);
-      void retx_detector(uint16_t qidx,uint16_t qsize,uint16_t base,pmt::pmt_t blob, int pktlen);
-      // TODO
-      bool create_intf();
-      void intf_detector();
-      void do_ic(std::pair<intf_t,std::vector<int> > obj);
-      void rebuild_su(bool retx,const std::vector<int>& retx_idx,std::vector<int>& pkt_len);
+
+      bool prepare_job(ic_ncfo_job& job, const ic_object& obj);
+      void do_ic(ic_ncfo_job& job) const;
+      void rebuild_su(ic_ncfo_job& job) const;
+      // job pool and workers
+      ic_ncfo_job* acquire_job();
+      void release_job(ic_ncfo_job* job);
+      void submit_job(ic_ncfo_job* job);
+      void commit_jobs();
+      void run_jobs();
      public:
-      ic_ncfo_cc_impl(const std::vector<float>& taps);
+      ic_ncfo_cc_impl(const std::vector<float>& taps, int sps, const std::string& dump_file, int storage, int nthreads, const std::string& capture);
       ~ic_ncfo_cc_impl();
 
+      bool start();
+      bool stop();
+
       // Where all the action really happens
       void forecast (int noutput_items, gr_vector_int &ninput_items_required);
 
@@ -106,6 +120,8 @@ namespace gr {
            gr_vector_int &ninput_items,
            gr_vector_const_void_star &input_items,
            gr_vector_void_star &output_items);
+
+      bool replay(const ic_dump_record& rec, float& depth);
     };
 
     // su header and physical layer info
@@ -39,23 +39,29 @@ namespace gr {
     #define MODBPS 2
     #define LSAPHYLEN 6
     #define TWO_PI M_PI*2.0F
-    static int d_sps = 4;
+    static const pmt::pmt_t d_ic_key = pmt::intern("IC_out");
+    static const pmt::pmt_t d_ic_out_tag = pmt::intern("ic_out");
+    static const pmt::pmt_t d_voe_begin_tag = pmt::intern("voe_begin");
+    static const pmt::pmt_t d_block_tag = pmt::intern("block_tag");
+    static const pmt::pmt_t d_voe_tag = pmt::intern("voe_tag");
+    static const pmt::pmt_t d_phase_tag = pmt::intern("phase_est");
     static int d_prelen = 128; // symbols 16*8
+    static const int PU_PRE_SYMS = 8; // zero symbols ahead of the PU SFD
     static int d_phylen = 192; // 0x00,0x00,0x00,0x00,0xe6,0xXX
-    static int d_protect_len = 512;
-    static const gr_complex d_pu_taps[] = {gr_complex(0,0),gr_complex(std::sin(M_PI/4.0F),0),gr_complex(1.0F,0),gr_complex(std::sin(3*M_PI/4.0F))};
+    // max distance between a decoded header and its sfd tag
+    static const int d_match_dist = 8192;
     // parameters for sync
     static float d_gain_mu = 0.03;
     static float d_gain_omega = 2.25e-4;
     static float d_omega_relative_limit = 2e-4;
     static float d_ori_mu = 0.5;
-    static float d_ori_omega = 2;
-    static inline float slice(float x){
-      return x<0?-1.0F:1.0F;
-    }
     static inline unsigned char byte_slice(const float& f){
       return (f>0)? 0x01 : 0x00;
     }
+    // geometric smoothing of a gain estimate
+    static inline float log_smooth(float g, float t, float a){
+      return std::exp(std::log(g)+a*(std::log(t)-std::log(g)));
+    }
     static inline void phase_wrap(float& phase){
       while(phase>TWO_PI)
         phase-=TWO_PI;
@@ -63,27 +69,18 @@ namespace gr {
         phase+=TWO_PI;
     }
     
-    enum VOESTATE{
-      VOE_CLEAR,
-      VOE_TRIGGERED
-    };
-    enum ICSTATE{
-      CLEAR,
-      COLLECT,
-      RESET
-    };
 
     ic_resync_cc::sptr
-    ic_resync_cc::make(const std::vector<float>& taps)
+    ic_resync_cc::make(const std::vector<float>& taps, int sps, const std::string& dump_file, int storage, int sic_passes, const std::string& capture)
     {
       return gnuradio::get_initial_sptr
-        (new ic_resync_cc_impl(taps));
+        (new ic_resync_cc_impl(taps,sps,dump_file,storage,sic_passes,capture));
     }
 
     /*
      * The private constructor
      */
-    ic_resync_cc_impl::ic_resync_cc_impl(const std::vector<float>& taps)
+    ic_resync_cc_impl::ic_resync_cc_impl(const std::vector<float>& taps, int sps, const std::string& dump_file, int storage, int sic_passes, const std::string& capture)
       : gr::block("ic_resync_cc",
               gr::io_signature::make(1, 1, sizeof(gr_complex)),
               gr::io_signature::make(1, 1, sizeof(gr_complex))),
@@ -91,29 +88,30 @@ namespace gr {
               d_out_port(pmt::intern("pdu_out")),
               d_cap(CAPACITY),
               d_buf_lim(BUFCAP),
-              d_interp(new filter::mmse_fir_interpolator_ff())
+              d_sps(sps),
+              d_kern(ic_kernel_select(sps))
     {
       set_tag_propagation_policy(TPP_DONT);
       message_port_register_in(d_in_port);
       message_port_register_out(d_out_port);
       set_msg_handler(d_in_port,boost::bind(&ic_resync_cc_impl::msg_in,this,_1));
       d_fir_buffer = (gr_complex*)volk_malloc(sizeof(gr_complex)*d_buf_lim/d_sps,volk_get_alignment());
-      d_in_mem = (gr_complex*)volk_malloc(sizeof(gr_complex)*d_cap,volk_get_alignment());
+      d_capture = intf_capture::make(capture,sps,storage,d_cap);
+      d_engine_id = d_capture->attach(d_match_dist);
       d_ic_mem = (gr_complex*)volk_malloc(sizeof(gr_complex)*d_buf_lim,volk_get_alignment());
       d_mm_mem = (float*)volk_malloc(sizeof(float)*d_buf_lim,volk_get_alignment());
       d_qmod_mem = (float*)volk_malloc(sizeof(float)*d_buf_lim,volk_get_alignment());
-      d_intf_mem = (gr_complex*)volk_malloc(sizeof(gr_complex)*d_cap,volk_get_alignment());
       d_out_mem = (gr_complex*)volk_malloc(sizeof(gr_complex)*d_buf_lim,volk_get_alignment());
+      if(sic_passes<1){
+        throw std::invalid_argument("At least one IC pass is required");
+      }
+      d_sic_passes = sic_passes;
+      d_su_fixed = false;
+      d_pu_frame_len = 0;
+      d_ic_orig = (sic_passes>1)? (gr_complex*)volk_malloc(sizeof(gr_complex)*d_buf_lim,volk_get_alignment()) : NULL;
       //d_demo_mem = (gr_complex*)volk_malloc(sizeof(gr_complex)*d_buf_lim,volk_get_alignment());
-      d_in_idx =0;
       d_out_idx=0;
       d_out_size=0;
-      d_intf_idx=0;
-      d_state = VOE_CLEAR;
-      d_intf_protect = false;
-      d_protect_cnt=0;
-      d_cur_intf.clear();
-      d_intf_list.clear();
       if(taps.empty()){
         throw std::invalid_argument("No filter taps given");
       }
@@ -121,7 +119,13 @@ namespace gr {
       for(int i=0;i<taps.size();++i){
         d_taps.push_back(gr_complex(taps[i],0));
       }
-      d_chunk_size=64;
+      // one zigbee symbol per chunk, MM works on half chips of the qmod output
+      d_chunk_size=IC_SYMBOL_CHIPS*d_sps;
+      if(d_sic_passes>1){
+        // PU symbols do not overlap, the IC span holds at most this many
+        d_pu_syms.reserve(d_buf_lim/d_chunk_size+1);
+      }
+      d_ori_omega = d_sps/2.0F;
       d_gain_gain = 0.02;
       d_tracking_gain = 0.00628;
       d_pole_alpha = 160e-6;
@@ -129,18 +133,15 @@ namespace gr {
       d_dec_threshold = 10;
       d_pu_gain_gain = 0.02;
       d_pu_cfo_gain = 0.00628;
-      d_tap_buffer = std::vector<gr_complex>(taps.size());
-      d_pu_rebuild = std::vector<gr_complex>(64);
+      d_pu_rebuild = std::vector<gr_complex>(d_chunk_size);
       d_su_rebuild = std::vector<gr_complex>(d_buf_lim);
-      d_kay_taps = std::vector<float>(64);
-      d_kay_tmp = std::vector<gr_complex>(64);
+      d_su_buf = std::vector<gr_complex>(d_chunk_size);
       d_qmod_tmp = std::vector<gr_complex>(d_chunk_size);
-      d_pu_tmp = std::vector<gr_complex>(64);
-      d_pu_cancel_buf = std::vector<gr_complex>(64);
-      float kay_len = d_chunk_size-1;
-      float kay_const = 1.5*(kay_len)/(kay_len*kay_len-1);
-      for(int i=0;i<kay_len;++i){
-        d_kay_taps.push_back(1.0-( (2.0* ((float)i+1.0)-kay_len)/kay_len )*( (2* ((float)i+1.0)-kay_len)/kay_len ));
+      d_mm.set_gains(d_gain_mu,d_gain_omega);
+      d_pu_tmp = std::vector<gr_complex>(d_chunk_size);
+      d_pu_cancel_buf = std::vector<gr_complex>(d_chunk_size);
+      if(!dump_file.empty()){
+        d_dump = ic_dump_writer::sptr(new ic_dump_writer(dump_file,taps));
       }
     }
 
@@ -149,300 +150,28 @@ namespace gr {
      */
     ic_resync_cc_impl::~ic_resync_cc_impl()
     {
+      d_capture->detach(d_engine_id);
       volk_free(d_fir_buffer);
-      volk_free(d_in_mem);
       volk_free(d_ic_mem);
       volk_free(d_mm_mem);
       volk_free(d_out_mem);
+      if(d_ic_orig){
+        volk_free(d_ic_orig);
+      }
       //volk_free(d_demo_mem);
       volk_free(d_qmod_mem);
-      volk_free(d_intf_mem);
       d_su_rebuild.clear();
       d_pu_rebuild.clear();
       d_qmod_tmp.clear();
-      d_tap_buffer.clear();
-      d_kay_taps.clear();
-      d_kay_tmp.clear();
       d_qmod_tmp.clear();
       d_pu_tmp.clear();
       d_pu_cancel_buf.clear();
-      delete d_interp;
-    }
-
-    bool
-    ic_resync_cc_impl::voe_update(int idx)
-    {
-      bool result = false;
-      if(!d_voe_tags.empty()){
-        int offset = d_voe_tags[0].offset - nitems_read(0);
-        if(offset == idx){
-          result = pmt::to_bool(d_voe_tags[0].value);
-          if(d_state == VOE_CLEAR && result){
-            result= true;
-          }else if(d_state == VOE_TRIGGERED && !result){
-            result = true;
-          }
-          d_voe_tags.erase(d_voe_tags.begin());
-        }
-      }
-      return result;
-    }
-    void
-    ic_resync_cc_impl::system_update(int idx)
-    {
-      d_offset++;
-      if(!d_sfd_list.empty()){
-        if(std::get<0>(d_sfd_list.front())==idx){
-          d_sfd_list.pop_front();
-        }
-      }
-      if(!d_block_list.empty()){
-        if(std::get<1>(d_block_list.front())==idx){
-          d_block_list.pop_front();
-        }
-      }
-      if(!d_pkt_history.empty()){
-        if(d_pkt_history.front().index()==idx){
-          d_pkt_history.pop_front();
-        }
-      }
-    }
-    void
-    ic_resync_cc_impl::tags_update(int idx)
-    {
-      if(!d_block_tags.empty()){
-        int offset = d_block_tags[0].offset-nitems_read(0);
-        if(offset == idx){
-          d_offset =0;
-          d_block = pmt::to_uint64(d_block_tags[0].value);
-          d_block_list.push_back(std::make_pair(d_block,d_in_idx));
-          d_block_tags.erase(d_block_tags.begin());
-        }
-      }
-      if(!d_sfd_tags.empty()){
-        int offset = d_sfd_tags[0].offset-nitems_read(0);
-        if(offset == idx){
-          pmt::pmt_t sfd_msg = pmt::make_dict();
-          sfd_msg = pmt::dict_add(sfd_msg,pmt::intern("init_phase"),d_sfd_tags[0].value);
-          int idx_fix = d_in_idx-d_prelen*d_sps;
-          idx_fix = (idx_fix<0)? idx_fix+d_cap : idx_fix;
-          hdr_t sfd_hdr(idx_fix,sfd_msg);
-          d_sfd_list.push_back(std::make_pair(idx_fix,sfd_hdr) );
-          d_sfd_tags.erase(d_sfd_tags.begin());
-          //DEBUG<<"<Resync>\033[33;1m"<<"found sfd at block:"<<d_block<<" ,offset:"<<d_offset<<"\033[0m"<<std::endl;
-        }
-      }
     }
 
     void
     ic_resync_cc_impl::msg_in(pmt::pmt_t msg)
     {
-      gr::thread::scoped_lock guard(d_mutex);
-      pmt::pmt_t k = pmt::car(msg);
-      pmt::pmt_t v = pmt::cdr(msg);
-      assert(pmt::is_dict(k));
-      assert(pmt::is_blob(v));
-      size_t io(0);
-      const uint8_t* uvec = u8vector_elements(v,io);
-      uint64_t block = pmt::to_uint64(pmt::dict_ref(k,pmt::intern("block_id"),pmt::from_uint64(0)));
-      int offset = pmt::to_long(pmt::dict_ref(k,pmt::intern("offset"),pmt::from_long(0)));
-      offset*= d_sps;
-      int pktlen = (io+LSAPHYLEN)*CHIPRATE*8/MODBPS*d_sps;
-      uint16_t base,base_crc, qsize,qidx;
-      qidx = uvec[0]<<8;
-      qidx|= uvec[1];
-      qsize= uvec[2]<<8;
-      qsize|=uvec[3];
-      base = uvec[4]<<8;
-      base|= uvec[5];
-      base_crc=uvec[6]<<8;
-      base_crc|=uvec[7];
-      if( (qsize!=0 && qidx>=qsize) || (base!=base_crc) ){
-        DEBUG<<"<Msg in>Low quality header!"<<std::endl;
-        return; // low quality packets
-      }
-      hdr_t hdr;
-      if(!pkt_validate(hdr,block,offset,pktlen, qidx,qsize,base)){
-        // invalid
-        DEBUG<<"<Msg in>Invalid packet!"<<std::endl;
-        return;
-      }
-      // critical information added
-      if(!matching_pkt(hdr)){
-        // not matched
-        DEBUG<<"<Msg in>Not matched with correlation tag!"<<std::endl;
-        return;
-      }
-      d_pkt_history.push_back(hdr);
-      retx_detector(qidx,qsize,base,v,pktlen);
-      //intf_detector();
-    }
-
-    void
-    ic_resync_cc_impl::retx_detector(uint16_t qidx,uint16_t qsize,uint16_t base,pmt::pmt_t blob,int pktlen)
-    {
-      if(qsize!=d_retx_stack.size()){
-        d_retx_stack.clear();
-        if(qsize==0){
-          // reset signal
-          d_retx_cnt=0;
-        }else{
-          // direct change of retransmission
-          d_retx_stack.resize(qsize,std::make_tuple(0,pmt::PMT_NIL,0));
-          d_retx_stack[qidx] = std::make_tuple(pktlen,blob,base);
-          d_retx_cnt=1;
-        }
-      }else{
-        if(qsize==0){
-          // clean and also clean
-          return;
-        }
-        // equal retransmissions
-        if(pmt::is_null(std::get<1>(d_retx_stack[qidx]))){
-          d_retx_stack[qidx] = std::make_tuple(pktlen,blob,base);
-          d_retx_cnt++;
-          //DEBUG<<"<RETX> found a new one: base="<<base<<" ,idx="<<qidx<<" ,count="<<d_retx_cnt<<" ,total="<<qsize<<std::endl;
-        }
-      }
-    }
-
-    void
-    ic_resync_cc_impl::intf_detector()
-    {
-      if(d_retx_stack.empty()){
-        return;
-      }
-      bool all_done = (d_retx_stack.size()==d_retx_cnt);
-      std::list<intf_t>::iterator it;
-      for(it=d_intf_list.begin();it!=d_intf_list.end();++it){
-        bool do_ic = false;
-        std::vector<int> idx_stack;
-        // remove those intf that the front base not present in retransmission
-        pmt::pmt_t front_msg = (*it).front().msg();
-        uint16_t front_base = pmt::to_long(pmt::dict_ref(front_msg,pmt::intern("base"),pmt::from_long(-1)));
-        //DEBUG<<"<INTF>search base="<<front_base<<std::endl;
-        for(int i=0;i<d_retx_stack.size();++i){
-          uint16_t retx_base = std::get<2>(d_retx_stack[i]);
-          if(front_base == retx_base){
-            // matched in base
-            // check whether retransmission is enough for cancellation
-            int total_size = (*it).size();
-            int idx_iter = i;
-            while(total_size>0){
-              if(pmt::is_null(std::get<1>(d_retx_stack[idx_iter]))){
-                break;
-              }
-              total_size-=std::get<0>(d_retx_stack[idx_iter]);
-              idx_stack.push_back(idx_iter);
-              idx_iter=(idx_iter+1)%d_retx_stack.size();
-            }
-            if(total_size<0){
-              do_ic = true;
-              break;
-            }
-          }
-        }
-        if(do_ic){
-          // indication of ic avalability
-          DEBUG<<"<INTF DETECTOR>An intf object ready to do ic!"<<std::endl;
-          d_ic_list.push_back(std::make_pair(*it,idx_stack));
-        }else if(all_done){
-          // outdated intf object
-          DEBUG<<"<INTF DETECTOR>An outdated intf object removed!"<<std::endl;
-          it = d_intf_list.erase(it);
-        }
-      }
-    }
-
-    bool
-    ic_resync_cc_impl::pkt_validate(hdr_t& hdr,uint64_t bid, int offset, int pktlen,uint16_t qidx,uint16_t qsize,uint16_t base)
-    {
-      std::list< std::pair<uint64_t, int> >::reverse_iterator rit;
-      for(rit=d_block_list.rbegin();rit!=d_block_list.rend();++rit){
-        if(std::get<0>(*rit)==bid){
-          break;
-        }
-      }
-      if(rit==d_block_list.rend()){
-        return false;
-      }
-      // bid and offset at PKTLEN, should track back to preamble
-      int begin = (std::get<1>(*rit) + offset)%d_cap;
-      for(int i=0;i<(d_prelen+16*2)*d_sps;++i){
-        begin = (begin==0)? d_cap-1 : begin-1;
-        if(begin==d_in_idx){
-          DEBUG<<"<PKTVALID>failed at front"<<std::endl;
-          return false;
-        }
-      }
-      pmt::pmt_t msg = pmt::make_dict();
-      msg = pmt::dict_add(msg,pmt::intern("packet_len"),pmt::from_long(pktlen));
-      msg = pmt::dict_add(msg,pmt::intern("queue_index"),pmt::from_long(qidx));
-      msg = pmt::dict_add(msg,pmt::intern("queue_size"),pmt::from_long(qsize));
-      msg = pmt::dict_add(msg,pmt::intern("base"),pmt::from_long(base));
-      hdr_t tmp_hdr(begin,msg);
-      hdr = tmp_hdr;
-      return true;
-    }
-
-    bool
-    ic_resync_cc_impl::matching_pkt(hdr_t& hdr)
-    {
-      const int min_dis = 8192;
-      std::list< std::pair<int,hdr_t> >::reverse_iterator rit;
-      int idx = hdr.index();
-      for(rit=d_sfd_list.rbegin();rit!=d_sfd_list.rend();rit++){
-        int distance1 = std::abs((double)std::get<0>(*rit)-idx);
-        int distance2 = std::abs((double)std::get<0>(*rit)+d_cap-idx);
-        if(std::min(distance1,distance2)<=min_dis){
-          //DEBUG<<"<Resync>\033[34;1mMatching packets: dist1="<<distance1<<" ,dist2="<<distance2<<"\033[0m"<<std::endl;
-          // possible matched case
-          // remove other headers?
-          pmt::pmt_t tmp = (std::get<1>(*rit)).msg();
-          hdr.set_index(std::get<1>(*rit).index());
-          hdr.add_msg(pmt::intern("init_phase"),pmt::dict_ref(tmp,pmt::intern("init_phase"),pmt::from_float(0)));
-          return true;
-        }
-      }
-      return false;
-    }
-
-    bool
-    ic_resync_cc_impl::create_intf()
-    {
-      if(!d_cur_intf.empty()){
-        return false;
-      }else if(d_intf_list.empty()){
-        DEBUG<<"Empty intference object state, reset intf index..."<<std::endl;
-        d_intf_idx=0;
-      }
-      std::list<hdr_t>::reverse_iterator rit=d_pkt_history.rbegin();
-      if(rit==d_pkt_history.rend()){
-        return false;
-      }
-      intf_t obj;
-      int intf_begin = d_intf_idx;
-      obj.set_begin(d_intf_idx);
-      obj.set_front((*rit));
-      int pkt_begin= (*rit).index();
-      int length=0;
-      if(d_in_idx<pkt_begin){
-        length = d_in_idx+d_cap-pkt_begin;
-      }else{
-        length = d_in_idx-pkt_begin;
-      }
-      if(d_intf_idx+length>=d_cap){
-        return false;
-      }
-      while(pkt_begin!=d_in_idx){
-        d_intf_mem[d_intf_idx++] = d_in_mem[pkt_begin++];
-        pkt_begin%=d_cap;
-      }
-      // record voe tag begin for ease of cancellation
-      obj.add_msg(pmt::intern("voe_begin"),pmt::from_long(d_intf_idx-intf_begin));
-      obj.set_end(d_intf_idx-1);
-      d_cur_intf= obj;
-      return true;
+      d_capture->pkt_in(msg);
     }
 
     void
@@ -485,7 +214,7 @@ namespace gr {
         }
         size_cnt+=160;
         const uint8_t* uvec = pmt::u8vector_elements(blob,io);
-        pkt_len.push_back((io+6)*8*8*2);
+        pkt_len.push_back((io+6)*32*d_sps);
         uint8_t u8_io = (uint8_t)io;
         // copy size field
         memcpy(d_fir_buffer+size_cnt,d_map[(u8_io>>4)&0x0f],sizeof(gr_complex)*16);
@@ -505,38 +234,29 @@ namespace gr {
       }
       DEBUG<<"REbuild SU, generated symbols:"<<size_cnt<<std::endl;
       // fir filter
-      for(int i=0;i<size_cnt;++i){
-        volk_32fc_s32fc_multiply_32fc(d_tap_buffer.data(),d_taps.data(),d_fir_buffer[i],d_taps.size());
-        for(int j=0;j<d_taps.size();++j)
-          d_su_rebuild[d_sps*i+j]+=d_tap_buffer[j];
-      }
-      // additional taps for fir 
-      memcpy(d_su_rebuild.data(),d_su_rebuild.data()+20,sizeof(gr_complex)*size_cnt*d_sps);
+      d_kern.pulse_shape(d_su_rebuild.data(),d_fir_buffer,size_cnt,d_taps.data(),d_taps.size());
+      // drop the filter delay, source and destination overlap
+      memmove(d_su_rebuild.data(),d_su_rebuild.data()+ic_fir_trim(d_taps.size(),d_sps),sizeof(gr_complex)*size_cnt*d_sps);
     }
 
     void
     ic_resync_cc_impl::rebuild_pu(int chip_id)
     {
-      const gr_complex* chip_ptr = d_map[chip_id];
-      for(int i=0;i<16;++i){
-        volk_32fc_s32fc_multiply_32fc(d_pu_tmp.data()+d_sps*i,d_pu_taps,chip_ptr[i],4);
-      }
-      for(int i=0;i<64;++i){
+      d_pu_chip = chip_id;
+      d_kern.half_sine(d_pu_tmp.data(),d_map[chip_id]);
+      for(int i=0;i<d_chunk_size;++i){
         d_pu_rebuild[i] = gr_complex(d_pu_tmp[i].real(),d_offset_d1);
         d_offset_d1 = d_offset_d2;
         d_offset_d2 = std::imag(d_pu_tmp[i]);
       }
+      volk_32fc_x2_conjugate_dot_prod_32fc(&d_pu_ref_eng,d_pu_rebuild.data(),d_pu_rebuild.data(),d_chunk_size);
     }
 
     void
     ic_resync_cc_impl::reset_sync()
     {
       // for mm
-      d_last_sample=0;
-      d_mu = d_ori_mu;
-      d_omega = d_ori_omega;
-      d_omega_mid = d_ori_omega;
-      d_omega_lim = d_omega_mid * d_omega_relative_limit;
+      d_mm.reset(d_ori_mu,d_ori_omega,d_omega_relative_limit);
       // counters and registers
       d_cancel_idx=0;
       d_mm_size=0;
@@ -558,12 +278,10 @@ namespace gr {
     }
 
     void
-    ic_resync_cc_impl::do_ic(std::pair<intf_t,std::vector<int> > obj)
+    ic_resync_cc_impl::do_ic(const ic_object& obj)
     {
-      int begin = std::get<0>(obj).begin();
-      const int size = std::get<0>(obj).size();
-      pmt::pmt_t intf_msg = std::get<0>(obj).msg();
-      int voe_begin = pmt::to_long(pmt::dict_ref(intf_msg,pmt::intern("voe_begin"),pmt::from_long(-1)));
+      const int size = obj.size;
+      int voe_begin = obj.voe_begin;
       if(size>d_buf_lim){
         return;
       }else if(size>(d_buf_lim-d_out_size) ){
@@ -571,12 +289,14 @@ namespace gr {
         d_out_idx=0;
         d_out_tags.clear();
       }
-      memcpy(d_ic_mem,d_intf_mem+begin,sizeof(gr_complex)*size);
-      std::vector<int> retx_idx = std::get<1>(obj);
-      // result are stored in d_intf_idx[begin] up to d_intf_idx[begin+size-1];
+      d_retx_stack = obj.retx_stack;
+      const std::vector<int>& retx_idx = obj.retx_idx;
+      if(d_dump){
+        d_dump->write(d_ic_mem,size,voe_begin,obj.front_msg,obj.headers,d_retx_stack,retx_idx);
+      }
       DEBUG<<"Calling do ic:"<<std::endl
-      <<"front tag:"<<std::get<0>(obj).front()<<std::endl
-      <<"intf_begin="<<begin<<" ,intf_size="<<size<<std::endl
+      <<"front msg:"<<obj.front_msg<<std::endl
+      <<"intf_begin="<<obj.begin<<" ,intf_size="<<size<<std::endl
       <<"voe begin="<<voe_begin<<std::endl;
       // required retransmissions 
       int length_cnt=0;
@@ -589,28 +309,23 @@ namespace gr {
         DEBUG<<"DO IC ERROR: rebuild length greater than available memory size"<<std::endl;
         return;
       }
-      pmt::pmt_t front_msg = (std::get<0>(obj)).front().msg();
-      bool is_retx = pmt::to_long(pmt::dict_ref(front_msg,pmt::intern("queue_size"),pmt::from_long(-1)))!=0;
+      bool is_retx = pmt::to_long(pmt::dict_ref(obj.front_msg,pmt::intern("queue_size"),pmt::from_long(-1)))!=0;
       std::vector<int> pkt_len;
       rebuild_su(is_retx,retx_idx,pkt_len); // store samples of su in d_su_rebuild
       reset_sync();
+      // reference energies for the per symbol gain fits
+      volk_32fc_x2_conjugate_dot_prod_32fc(&d_su_ref_eng,d_su_rebuild.data(),d_su_rebuild.data(),d_chunk_size);
       // note that there are residual samples due to fir interpolation
-      // intf samples: d_intf_mem[begin] and size;
+      // intf samples: d_ic_mem[0] and size;
       // autocorrelation for first cfo estimate, search e6 for phase, use e6 for gain estimation
       gr_complex cross_corr, corr_eng, auto_corr, su_eng, diff;
       uint16_t max_idx = 0;
-      const int delay = 128;
+      const int delay = 32*d_sps;
+      const int search_len = d_prelen*d_sps;
       int pkt_begin=0;
       // coarse estimate of pkt_begin
-      gr_complex auto_eng;
-      for(int i=0;i<512;i++){
-        int auto_idx = pkt_begin+i;
-        volk_32fc_x2_conjugate_dot_prod_32fc(&auto_corr,d_ic_mem+auto_idx,d_ic_mem+auto_idx+delay,delay);
-        volk_32fc_x2_conjugate_dot_prod_32fc(&corr_eng,d_ic_mem+auto_idx,d_ic_mem+auto_idx,delay);
-        volk_32fc_x2_conjugate_dot_prod_32fc(&auto_eng,d_ic_mem+auto_idx+delay,d_ic_mem+auto_idx+delay,delay);
-        d_corr_test[i] = auto_corr/std::sqrt(corr_eng*auto_eng);
-      }
-      volk_32fc_index_max_16u(&max_idx,d_corr_test,512);
+      sliding_autocorr(d_corr_test,d_ic_mem+pkt_begin,search_len,delay);
+      volk_32fc_index_max_16u(&max_idx,d_corr_test,search_len);
       if(std::abs(d_corr_test[max_idx])>0.9){
         DEBUG<<"Step1 passed: Autocorrelation found: idx="<<pkt_begin+max_idx<<" cfo:"<<d_su_cfo<<std::endl;
       }else{
@@ -619,7 +334,7 @@ namespace gr {
         return;
       }
       d_su_cfo = fast_atan2f(d_corr_test[max_idx].imag(),d_corr_test[max_idx].real())/(float)delay;
-      uint16_t sfd_idx = pkt_begin+512;
+      int sfd_idx = pkt_begin+search_len;
       gr_complex init_phase(1,0);
       volk_32fc_s32fc_x2_rotator_32fc(d_chunk_buf,d_su_rebuild.data()+sfd_idx,gr_expj(d_su_cfo),&init_phase,d_chunk_size);
       volk_32fc_x2_conjugate_dot_prod_32fc(&su_eng,d_chunk_buf,d_chunk_buf,d_chunk_size);
@@ -636,20 +351,29 @@ namespace gr {
       d_su_gain = std::real(std::sqrt(corr_eng/su_eng));
       // begin to cancel
       d_cancel_idx = sfd_idx;
+      const int sfd0 = sfd_idx;
+      const int out_begin = d_out_size;
+      su_state_t su_init;
+      su_init.phase = d_su_phase;
+      su_init.gain = d_su_gain;
+      su_init.cfo = d_su_cfo;
+      d_pu_syms.clear();
+      d_pu_frame_len = 0;
+      if(d_sic_passes>1){
+        memcpy(d_ic_orig,d_ic_mem,sizeof(gr_complex)*size);
+      }
       // debug tag
       tag_t tmp_tag;
       tmp_tag.offset = d_out_size;
-      tmp_tag.key = pmt::intern("ic_out");
+      tmp_tag.key = d_ic_out_tag;
       tmp_tag.value = pmt::PMT_T;
       d_out_tags.push_back(tmp_tag);
       // debugging auto correlation
       float auto_val, cross_val;
       while(d_cancel_idx<(d_su_rebuild.size()-d_chunk_size) && sfd_idx<(size-d_chunk_size-delay) && (sfd_idx+2*d_chunk_size<voe_begin) ){
         volk_32fc_s32fc_x2_rotator_32fc(d_chunk_buf,d_su_rebuild.data()+d_cancel_idx,gr_expj(d_su_cfo),&init_phase,d_chunk_size);
-        for(size_t t=0;t<d_chunk_size;++t){
-          //d_demo_mem[d_out_size] =d_ic_mem[sfd_idx+t]; // for demo purpose 
-          d_out_mem[d_out_size++]=d_ic_mem[sfd_idx+t] - d_su_gain*gr_expj(d_su_phase)*d_chunk_buf[t];
-        }
+        d_kern.cancel(d_out_mem+d_out_size,d_ic_mem+sfd_idx,d_chunk_buf,d_su_gain*gr_expj(d_su_phase));
+        d_out_size+=d_chunk_size;
         // update phase, gain and cfo
         volk_32fc_x2_conjugate_dot_prod_32fc(&auto_corr,d_ic_mem+sfd_idx,d_ic_mem+sfd_idx+delay,delay); // debug
         volk_32fc_x2_conjugate_dot_prod_32fc(&corr_eng,d_ic_mem+sfd_idx,d_ic_mem+sfd_idx,delay); // debug
@@ -665,7 +389,7 @@ namespace gr {
          (d_su_cfo + d_tracking_gain * fast_atan2f(diff.imag(),diff.real())/(float)d_chunk_size);
         //d_su_cfo = (std::abs(auto_corr)>0.95)? fast_atan2f(auto_corr.imag(),auto_corr.real())/(float)delay :
           //(d_su_cfo + d_tracking_gain * fast_atan2f(diff.imag(),diff.real())/(float)d_chunk_size);
-        d_su_gain = std::exp(std::log(d_su_gain)+d_gain_gain*(std::log(std::real(std::sqrt(corr_eng/su_eng)))-std::log(d_su_gain)));
+        d_su_gain = log_smooth(d_su_gain,std::real(std::sqrt(corr_eng/su_eng)),d_gain_gain);
         d_cancel_idx+=d_chunk_size;
         sfd_idx+=d_chunk_size;
       }
@@ -673,40 +397,80 @@ namespace gr {
       // next chunk contains interfering signal
       DEBUG<<"First part complete, next chunk contains interfering signals"<<std::endl;
       tmp_tag.offset = d_out_size;
-      tmp_tag.key = pmt::intern("voe_begin");
+      tmp_tag.key = d_voe_begin_tag;
       tmp_tag.value = pmt::PMT_T;
       d_out_tags.push_back(tmp_tag);
+      const int sfd_voe = sfd_idx;
+      const int cancel_voe = d_cancel_idx;
+      const int out_voe = d_out_size;
+      bool decoded = decode_pu(sfd_idx,size);
+      const bool found = decoded;
+      if(decoded){
+        d_pu_frame_len = d_dec_pld_len;
+        memcpy(d_pu_frame,d_dec_buf,d_pu_frame_len);
+      }
+      // successive interference cancellation: regenerate the decoded PU
+      // frame end to end, take it out of the original span, track the SU
+      // again on what is left and decode the PU once more against the new
+      // SU estimate
+      float prev_res = -1;
+      for(int pass=1;pass<d_sic_passes && decoded;++pass){
+        memcpy(d_ic_mem,d_ic_orig,sizeof(gr_complex)*size);
+        if(!subtract_pu(size)){
+          break;
+        }
+        float res = retrack_su(sfd0,out_begin,size,su_init);
+        DEBUG<<"SIC pass "<<pass<<": PU symbols="<<d_pu_syms.size()<<" ,residual="<<res<<std::endl;
+        if(prev_res>=0 && res>=prev_res){
+          break;
+        }
+        prev_res = res;
+        memcpy(d_ic_mem,d_ic_orig,sizeof(gr_complex)*size);
+        d_pu_syms.clear();
+        reset_sync();
+        d_out_size = out_voe;
+        d_cancel_idx = cancel_voe;
+        sfd_idx = sfd_voe;
+        d_su_fixed = true;
+        decoded = decode_pu(sfd_idx,size);
+        d_su_fixed = false;
+        if(decoded){
+          d_pu_frame_len = d_dec_pld_len;
+          memcpy(d_pu_frame,d_dec_buf,d_pu_frame_len);
+        }
+      }
+      if(found){
+        // published once, after the last pass that decoded it
+        pmt::pmt_t blob = pmt::make_blob(d_pu_frame,d_pu_frame_len);
+        message_port_pub(d_out_port,pmt::cons(d_ic_key,blob));
+      }
+    }
 
+    bool
+    ic_resync_cc_impl::decode_pu(int& sfd_idx, int size)
+    {
+      gr_complex init_phase(1,0);
       while(d_cancel_idx<(d_su_rebuild.size()-d_chunk_size) && sfd_idx<(size-d_chunk_size)){
         bool found_pu_symbol = false;
-        volk_32fc_s32fc_x2_rotator_32fc(d_chunk_buf,d_su_rebuild.data()+d_cancel_idx,gr_expj(d_su_cfo),&init_phase,d_chunk_size);
-        for(size_t t=0;t<d_chunk_size;++t){
-          //d_demo_mem[d_out_size+t]=d_ic_mem[sfd_idx+t];
-          d_out_mem[d_out_size+t]=d_ic_mem[sfd_idx+t]-d_su_gain*gr_expj(d_su_phase)*d_chunk_buf[t];
-          //d_out_mem[d_out_size+t] = d_ic_mem[sfd_idx+t]-d_su_gain*gr_expj(d_su_phase)*d_su_rebuild[d_cancel_idx+t];
+        if(!d_su_fixed){
+          volk_32fc_s32fc_x2_rotator_32fc(d_chunk_buf,d_su_rebuild.data()+d_cancel_idx,gr_expj(d_su_cfo),&init_phase,d_chunk_size);
+          d_kern.cancel(d_out_mem+d_out_size,d_ic_mem+sfd_idx,d_chunk_buf,d_su_gain*gr_expj(d_su_phase));
         }
         // qmod and single pole iir filter
         volk_32fc_x2_multiply_conjugate_32fc(&d_qmod_tmp[0],&d_out_mem[d_out_size],&d_out_mem[d_out_size-1],d_chunk_size);
-        for(size_t p=0;p<d_chunk_size;++p){
-          float qmod_out = gr::fast_atan2f(imag(d_qmod_tmp[p]),real(d_qmod_tmp[p]));
-          d_pole_prevo = d_pole_alpha*qmod_out + d_pole_one_alpha*d_pole_prevo;
-          d_qmod_mem[d_qmod_cnt+p] = qmod_out - d_pole_prevo;
+        float* qmod_out = d_qmod_mem+d_qmod_cnt;
+        float prevo = d_pole_prevo;
+        for(int p=0;p<d_chunk_size;++p){
+          // fast_atan2f as before batching, the decoded chips must not move
+          const float phase = gr::fast_atan2f(d_qmod_tmp[p].imag(),d_qmod_tmp[p].real());
+          prevo = d_pole_alpha*phase + d_pole_one_alpha*prevo;
+          qmod_out[p] = phase - prevo;
         }
+        d_pole_prevo = prevo;
         d_qmod_cnt+=d_chunk_size;
         // MM clock recovery on qmod output
-        float mm_val;
         int prev_mm_size = d_mm_size;
-        while(d_mm_consume<(d_qmod_cnt-d_interp->ntaps())){
-          d_mm_mem[d_mm_size] = d_interp->interpolate(&d_qmod_mem[d_mm_consume],d_mu);
-          mm_val = slice(d_last_sample)*d_mm_mem[d_mm_size]-slice(d_mm_mem[d_mm_size])*d_last_sample;
-          d_last_sample = d_mm_mem[d_mm_size];
-          d_omega = d_omega + d_gain_omega * mm_val;
-          d_omega = d_omega_mid + gr::branchless_clip(d_omega-d_omega_mid,d_omega_lim);
-          d_mu = d_mu + d_omega + d_gain_mu * mm_val;
-          d_mm_consume += (int)floor(d_mu);
-          d_mu = d_mu - floor(d_mu);
-          d_mm_size++;
-        }
+        d_mm_size+=d_mm.work(d_qmod_mem,d_qmod_cnt,d_mm_consume,d_mm_mem+d_mm_size);
         // check accumulated zig_diff bits according to state
         // if unfound, search on one bit basis
         // if found, move on for every 32 bits
@@ -826,11 +590,9 @@ namespace gr {
                   d_dec_symbol_cnt++;
                   if(d_dec_symbol_cnt/2>=d_dec_pld_len){
                     DEBUG<<"<GOOD>Complete a decoding of PU!..."<<std::endl;
-                    pmt::pmt_t blob = pmt::make_blob(d_dec_buf,d_dec_pld_len);
-                    message_port_pub(d_out_port,pmt::cons(pmt::intern("IC_out"),blob));
                     //enter_search();
                     //break;
-                    return;
+                    return true;
                   }
                 }
               }
@@ -851,62 +613,252 @@ namespace gr {
         d_cancel_idx+=d_chunk_size;
         sfd_idx+=d_chunk_size;
       }
+      return false;
+    }
+
+    int
+    ic_resync_cc_impl::pu_frame_chip(int k) const
+    {
+      // preamble zeros, SFD 0xA7 low nibble first, then length and payload
+      // high nibble first
+      if(k<PU_PRE_SYMS){
+        return 0;
+      }else if(k<PU_PRE_SYMS+2){
+        return (k==PU_PRE_SYMS)? 0x07 : 0x0a;
+      }else if(k<PU_PRE_SYMS+4){
+        return (k==PU_PRE_SYMS+2)? (d_pu_frame_len>>4)&0x0f : d_pu_frame_len&0x0f;
+      }
+      const int n = k-PU_PRE_SYMS-4;
+      return (n%2==0)? (d_pu_frame[n/2]>>4)&0x0f : d_pu_frame[n/2]&0x0f;
+    }
+
+    bool
+    ic_resync_cc_impl::subtract_pu(int size)
+    {
+      const int nsym = PU_PRE_SYMS+4+2*d_pu_frame_len;
+      if(d_pu_syms.empty() || d_pu_syms.size()==d_pu_syms.capacity()){
+        // no record, or it ran out before the end of the frame
+        return false;
+      }
+      // the decoder stops right on the last symbol, its position anchors
+      // the frame. Symbol positions come from the clock recovery and sit a
+      // few samples off, fit the whole frame within two chips of it
+      const int anchor = d_pu_syms.back().ic_begin-(nsym-1)*d_chunk_size;
+      const int span = 2*d_sps;
+      int frame_begin = -1;
+      float best = 0;
+      gr_complex cross;
+      for(int shift=-span;shift<=span;++shift){
+        const int begin = anchor+shift;
+        if(begin<0 || begin+nsym*d_chunk_size>size){
+          continue;
+        }
+        d_offset_d1 = 0;
+        d_offset_d2 = 0;
+        float metric = 0;
+        for(int k=0;k<nsym;++k){
+          rebuild_pu(pu_frame_chip(k));
+          volk_32fc_x2_conjugate_dot_prod_32fc(&cross,d_ic_mem+begin+k*d_chunk_size,d_pu_rebuild.data(),d_chunk_size);
+          metric += std::norm(cross);
+        }
+        if(metric>best){
+          best = metric;
+          frame_begin = begin;
+        }
+      }
+      if(frame_begin<0){
+        return false;
+      }
+      // regenerate the frame end to end, least squares gain and phase per
+      // symbol at the fitted timing
+      d_offset_d1 = 0;
+      d_offset_d2 = 0;
+      for(int k=0;k<nsym;++k){
+        rebuild_pu(pu_frame_chip(k));
+        gr_complex* x = d_ic_mem+frame_begin+k*d_chunk_size;
+        volk_32fc_x2_conjugate_dot_prod_32fc(&cross,x,d_pu_rebuild.data(),d_chunk_size);
+        d_kern.cancel(x,x,d_pu_rebuild.data(),cross/d_pu_ref_eng);
+      }
+      return true;
+    }
+
+    float
+    ic_resync_cc_impl::retrack_su(int sfd_idx, int out_idx, int size, const su_state_t& init)
+    {
+      // d_ic_mem holds the span with the PU removed, track the SU on it and
+      // write the SU cancelled original span to d_out_mem
+      float phase = init.phase, gain = init.gain, cfo = init.cfo;
+      int cancel_idx = sfd_idx;
+      float res =0;
+      gr_complex cross, ic_eng, su_eng, res_eng, init_phase(1,0);
+      while(cancel_idx<(d_su_rebuild.size()-d_chunk_size) && sfd_idx<(size-d_chunk_size)){
+        volk_32fc_s32fc_x2_rotator_32fc(d_chunk_buf,d_su_rebuild.data()+cancel_idx,gr_expj(cfo),&init_phase,d_chunk_size);
+        const gr_complex coeff = gain*gr_expj(phase);
+        d_kern.cancel(d_out_mem+out_idx,d_ic_orig+sfd_idx,d_chunk_buf,coeff);
+        d_kern.cancel(d_su_buf.data(),d_ic_mem+sfd_idx,d_chunk_buf,coeff);
+        volk_32fc_x2_conjugate_dot_prod_32fc(&res_eng,d_su_buf.data(),d_su_buf.data(),d_chunk_size);
+        res += res_eng.real();
+        volk_32fc_x2_conjugate_dot_prod_32fc(&cross,d_ic_mem+sfd_idx,d_chunk_buf,d_chunk_size);
+        volk_32fc_x2_conjugate_dot_prod_32fc(&ic_eng,d_ic_mem+sfd_idx,d_ic_mem+sfd_idx,d_chunk_size);
+        volk_32fc_x2_conjugate_dot_prod_32fc(&su_eng,d_chunk_buf,d_chunk_buf,d_chunk_size);
+        float cross_val = std::abs(cross)/std::sqrt(ic_eng.real()*su_eng.real());
+        if(cross_val>0.9){
+          gr_complex diff = cross*gr_expj(-phase);
+          cfo += d_tracking_gain*fast_atan2f(diff.imag(),diff.real())/(float)d_chunk_size;
+          phase = fast_atan2f(cross.imag(),cross.real());
+          gain = log_smooth(gain,std::sqrt(ic_eng.real()/su_eng.real()),d_gain_gain);
+        }else{
+          phase += cfo*d_chunk_size;
+        }
+        cancel_idx+=d_chunk_size;
+        sfd_idx+=d_chunk_size;
+        out_idx+=d_chunk_size;
+      }
+      return res;
+    }
+
+    bool
+    ic_resync_cc_impl::replay(const ic_dump_record& rec, float& depth)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      const int size = rec.nsamples();
+      if(size<=1 || size>d_buf_lim){
+        return false;
+      }
+      memcpy(d_ic_mem,rec.samples(),sizeof(gr_complex)*size);
+      ic_object obj;
+      obj.seqno = rec.seqno();
+      obj.begin = 0;
+      obj.size = size;
+      obj.voe_begin = rec.voe_begin();
+      obj.retx_stack.resize(rec.queue_size(),std::make_tuple(0,pmt::PMT_NIL,0));
+      for(int i=0;i<rec.nretx();++i){
+        const ic_dump_retx_t& retx = rec.retx(i);
+        if(retx.qidx>=obj.retx_stack.size()){
+          return false;
+        }
+        obj.retx_stack[retx.qidx] = std::make_tuple(retx.pktlen,pmt::make_blob(rec.retx_data(i),retx.blob_len),retx.base);
+        obj.retx_idx.push_back(retx.qidx);
+      }
+      pmt::pmt_t msg = pmt::make_dict();
+      msg = pmt::dict_add(msg,pmt::intern("packet_len"),pmt::from_long(rec.front_pktlen()));
+      msg = pmt::dict_add(msg,pmt::intern("queue_index"),pmt::from_long(rec.front_qidx()));
+      msg = pmt::dict_add(msg,pmt::intern("queue_size"),pmt::from_long(rec.front_qsize()));
+      msg = pmt::dict_add(msg,pmt::intern("base"),pmt::from_long(rec.front_base()));
+      msg = pmt::dict_add(msg,pmt::intern("init_phase"),pmt::from_float(rec.front_phase()));
+      obj.front_msg = msg;
+      // replay owns the output buffer
+      d_out_size=0;
+      d_out_idx=0;
+      d_out_tags.clear();
+      ic_dump_writer::sptr dump = d_dump;
+      d_dump.reset();
+      do_ic(obj);
+      d_dump = dump;
+      bool result = d_out_size>0;
+      if(result){
+        gr_complex in_eng, out_eng;
+        volk_32fc_x2_conjugate_dot_prod_32fc(&in_eng,rec.samples(),rec.samples(),size);
+        volk_32fc_x2_conjugate_dot_prod_32fc(&out_eng,d_out_mem,d_out_mem,d_out_size);
+        depth = 10.0f*std::log10((in_eng.real()/size)/(out_eng.real()/d_out_size));
+      }
+      d_out_size=0;
+      d_out_tags.clear();
+      return result;
+    }
+
+    void
+    ic_resync_cc_impl::load_span(const std::vector<gr_complex>& pu_in, const std::vector<gr_complex>& ic_in,
+      const std::vector<gr_complex>& su_ref)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      if(pu_in.size()>d_buf_lim || ic_in.size()>d_buf_lim || su_ref.size()<(size_t)d_chunk_size){
+        throw std::invalid_argument("Span does not fit the IC buffers");
+      }
+      memcpy(d_out_mem,pu_in.data(),sizeof(gr_complex)*pu_in.size());
+      memcpy(d_ic_mem,ic_in.data(),sizeof(gr_complex)*ic_in.size());
+      d_su_rebuild = su_ref;
+      volk_32fc_x2_conjugate_dot_prod_32fc(&d_su_ref_eng,d_su_rebuild.data(),d_su_rebuild.data(),d_chunk_size);
+      d_su_fixed = false;
+    }
+
+    size_t
+    ic_resync_cc_impl::cancel_span(int nsym)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      if(nsym<0 || (size_t)((nsym+2)*d_chunk_size)>std::min(d_buf_lim,d_su_rebuild.size())){
+        throw std::invalid_argument("Span longer than the loaded samples");
+      }
+      d_pu_syms.clear();
+      d_last_su_sync_idx = 0;
+      d_found_first_pu = false;
+      for(int k=0;k<nsym;++k){
+        rebuild_pu(k%16);
+        cancel_pu_and_resync(0,0,0,0,32+32*k);
+      }
+      return d_pu_syms.size();
     }
 
     void
     ic_resync_cc_impl::cancel_pu_and_resync(int cur_sync_idx,int ic_mem_idx,int su_mem_idx,int prev_mm_size,int cur_mm_idx)
     {
+      // runs once per decoded PU symbol, all buffers are preallocated
       //32 for a symbol of chips
       int offset = cur_mm_idx-prev_mm_size-32;
-      int symbol_begin = cur_sync_idx+offset*2;  // x/32*64
-      int ic_begin = ic_mem_idx+offset*2;
-      int su_begin = su_mem_idx+offset*2;
-      memcpy(d_pu_cancel_buf.data(),d_out_mem+symbol_begin,sizeof(gr_complex)*64);
-      // kay cfo
-      volk_32fc_x2_multiply_conjugate_32fc(d_kay_tmp.data(),d_pu_cancel_buf.data(),d_pu_rebuild.data(),64);
-      std::vector<gr_complex> kay_diff(64); // phase difference
-      volk_32fc_x2_multiply_conjugate_32fc(kay_diff.data(),d_kay_tmp.data()+1,d_kay_tmp.data(),63);
-      float kay_cfo=0;
-      // use precalculated kay averaging taps and the fact that msk E[ci*conj(ci)] =1
-      for(int i=0;i<63;++i){
-        kay_cfo+= fast_atan2f(kay_diff[i].imag(),kay_diff[i].real()) * d_kay_taps[i];
-      }
-      //d_pu_cfo = (d_found_first_pu)? kay_cfo : d_pu_cfo+(kay_cfo-d_pu_cfo)*d_pu_cfo_gain;
-      d_pu_cfo = kay_cfo;
-      gr_complex pu_eng, ori_eng, cross, init_phase(1,0);
-      volk_32fc_x2_conjugate_dot_prod_32fc(&pu_eng,d_pu_cancel_buf.data(),d_pu_cancel_buf.data(),64);
+      // one chip decision per half chip in samples
+      const int half_chip = d_sps/2;
+      int symbol_begin = cur_sync_idx+offset*half_chip;  // x/32*chunk
+      int ic_begin = ic_mem_idx+offset*half_chip;
+      int su_begin = su_mem_idx+offset*half_chip;
+      const gr_complex* pu_in = d_out_mem+symbol_begin;
+      // no per symbol cfo estimate, the cross correlation phase below takes
+      // up the rotation. A Kay estimator here decoded fewer PU frames.
+      d_pu_cfo = 0;
+      gr_complex pu_eng, cross, init_phase(1,0);
+      volk_32fc_x2_conjugate_dot_prod_32fc(&pu_eng,pu_in,pu_in,d_chunk_size);
       // already call rebuild_pu in do_ic!!
-      volk_32fc_x2_conjugate_dot_prod_32fc(&ori_eng,d_pu_rebuild.data(),d_pu_rebuild.data(),64);
-      float tmp_gain = std::real(std::sqrt(pu_eng/ori_eng));
-      d_pu_gain = (d_found_first_pu)? tmp_gain  : std::exp(std::log(d_pu_gain)+d_pu_gain_gain*(std::log(tmp_gain)-std::log(d_pu_gain)));
-      d_found_first_pu = (d_found_first_pu)? true : false;
+      float tmp_gain = std::real(std::sqrt(pu_eng/d_pu_ref_eng));
+      // the first symbol of a frame seeds the gain, later ones smooth it
+      d_pu_gain = (d_found_first_pu)? log_smooth(d_pu_gain,tmp_gain,d_pu_gain_gain) : tmp_gain;
+      d_found_first_pu = true;
       // cross correlation estimator
       volk_32fc_s32fc_x2_rotator_32fc(d_pu_cancel_buf.data(),d_pu_rebuild.data(),gr_expj(d_pu_cfo),&init_phase,d_chunk_size);
-      volk_32fc_x2_conjugate_dot_prod_32fc(&cross,d_out_mem+symbol_begin,d_pu_cancel_buf.data(),64);
+      volk_32fc_x2_conjugate_dot_prod_32fc(&cross,pu_in,d_pu_cancel_buf.data(),d_chunk_size);
       // phase
       d_pu_phase = fast_atan2f(cross.imag(),cross.real());
-      for(int i=0;i<64;++i){
-        d_ic_mem[ic_begin+i] = d_ic_mem[ic_begin+i] - d_pu_gain*gr_expj(d_pu_phase)* d_pu_cancel_buf[i];
+      d_kern.cancel(d_ic_mem+ic_begin,d_ic_mem+ic_begin,d_pu_cancel_buf.data(),d_pu_gain*gr_expj(d_pu_phase));
+      // only later SIC passes read the record, it never grows past its reserve
+      if(d_sic_passes>1 && d_pu_syms.size()<d_pu_syms.capacity()){
+        pu_sym_t sym;
+        sym.ic_begin = ic_begin;
+        sym.chip = d_pu_chip;
+        sym.cfo = d_pu_cfo;
+        sym.coeff = d_pu_gain*gr_expj(d_pu_phase);
+        d_pu_syms.push_back(sym);
+      }
+      if(d_su_fixed){
+        // su already cancelled from a clean estimate
+        return;
       }
       // su resync
       int distance = su_begin-d_last_su_sync_idx;
       float phase_est = d_su_phase + distance*d_su_cfo;
       //float phase_est = d_su_phase;
       phase_wrap(phase_est);
-      std::vector<gr_complex> su_buf(64);
       gr_complex su_eng, diff;
-      volk_32fc_s32fc_x2_rotator_32fc(su_buf.data(),d_su_rebuild.data()+su_begin,gr_expj(d_su_cfo),&init_phase,64);
-      volk_32fc_x2_conjugate_dot_prod_32fc(&cross,d_ic_mem+ic_begin,su_buf.data(),64);
+      volk_32fc_s32fc_x2_rotator_32fc(d_su_buf.data(),d_su_rebuild.data()+su_begin,gr_expj(d_su_cfo),&init_phase,d_chunk_size);
+      volk_32fc_x2_conjugate_dot_prod_32fc(&cross,d_ic_mem+ic_begin,d_su_buf.data(),d_chunk_size);
       //volk_32fc_x2_conjugate_dot_prod_32fc(&cross,d_ic_mem+ic_begin,&d_su_rebuild[su_begin],64);
-      volk_32fc_x2_conjugate_dot_prod_32fc(&su_eng,d_ic_mem+ic_begin,d_ic_mem+ic_begin,64);
-      volk_32fc_x2_conjugate_dot_prod_32fc(&ori_eng,d_su_rebuild.data(),d_su_rebuild.data(),64);
-      tmp_gain  = std::real(su_eng/ori_eng);
+      volk_32fc_x2_conjugate_dot_prod_32fc(&su_eng,d_ic_mem+ic_begin,d_ic_mem+ic_begin,d_chunk_size);
+      tmp_gain  = std::real(su_eng/d_su_ref_eng);
       diff = cross * gr_expj(-phase_est);
-      float cross_val = std::abs(cross/std::sqrt(su_eng*ori_eng));
+      float cross_val = std::abs(cross/std::sqrt(su_eng*d_su_ref_eng));
       // update according to cross correlation value
-      d_su_cfo =(cross_val>0.9)? d_su_cfo+d_tracking_gain*fast_atan2f(diff.imag(),diff.real())/(float)d_chunk_size : d_su_cfo;
-      d_su_gain = (cross_val>0.9)? std::exp(std::log(d_su_gain)+d_gain_gain*(std::log(tmp_gain)-std::log(d_su_gain))) : d_su_gain;
-      d_su_phase = (cross_val>0.9)? fast_atan2f(cross.imag(),cross.real()) : d_su_phase;
+      if(cross_val>0.9){
+        d_su_cfo = d_su_cfo+d_tracking_gain*fast_atan2f(diff.imag(),diff.real())/(float)d_chunk_size;
+        d_su_gain = log_smooth(d_su_gain,tmp_gain,d_gain_gain);
+        d_su_phase = fast_atan2f(cross.imag(),cross.real());
+      }
       d_last_su_sync_idx = su_begin;
     }
 
@@ -973,100 +925,20 @@ namespace gr {
       //gr_complex *demo= (gr_complex *) output_items[1];
       int nin = ninput_items[0];
       int nout = 0;
-      int count =0;
       d_voe_tags.clear();
       d_block_tags.clear();
       d_sfd_tags.clear();
-      get_tags_in_window(d_block_tags,0,0,nin,pmt::intern("block_tag"));
-      get_tags_in_window(d_voe_tags,0,0,nin,pmt::intern("voe_tag"));
-      get_tags_in_window(d_sfd_tags,0,0,nin,pmt::intern("phase_est"));
-      while(count<nin){
-        switch(d_state)
-        {
-          case VOE_CLEAR:
-            while(count<nin){
-              tags_update(count);
-              if(voe_update(count)){
-                d_state = VOE_TRIGGERED;
-                DEBUG<<"<Resync>\033[36;1m"<<"Detecting start of VoE signal...at:"<<d_in_idx<<"\033[0m"<<std::endl;
-                if(create_intf()){
-                  DEBUG<<"<Resync>\033[34;1m"<<"Create New Interference tag..."<<"\033[0m"<<std::endl;
-                  d_intf_protect = false;
-                }else{
-                  // somthing wrong
-                  DEBUG<<"<Resync>\033[34;1m"<<"Something wrong, clear intf obj..."<<"\033[0m"<<std::endl;
-                  d_intf_idx = d_cur_intf.begin();
-                  d_intf_protect=false;
-                  d_protect_cnt=0;
-                  d_cur_intf.clear();
-                }
-                break;
-              }
-              if(!d_cur_intf.front_tag_empty() && d_intf_protect){
-                d_intf_mem[d_intf_idx++] = in[count];
-                d_cur_intf.increment();
-                if(d_intf_idx==d_cap){
-                  d_intf_idx = d_cur_intf.begin();
-                  d_cur_intf.clear();
-                  d_intf_protect = false;
-                  d_protect_cnt=0;
-                }
-                d_protect_cnt++;
-                if(d_protect_cnt==d_protect_len){
-                  d_intf_protect = false;
-                  d_protect_cnt=0;
-                  DEBUG<<"<Resync>complete a intf tag,...total size="<<d_cur_intf.size()<<std::endl;
-                  d_intf_list.push_back(d_cur_intf);
-                  d_cur_intf.clear();
-                }
-              }
-              d_in_mem[d_in_idx++] = in[count++];
-              d_in_idx%=d_cap;
-              system_update(d_in_idx);
-            }
-          break;
-          case VOE_TRIGGERED:
-            while(count<nin){
-              tags_update(count);
-              if(voe_update(count)){
-                d_state = VOE_CLEAR;
-                // should record the block and idx of the event for back tracking
-                // change state to receive a end header
-                DEBUG<<"<Resync>\033[36;1m"<<"Detecting end of VoE signal...at:"<<d_in_idx<<"\033[0m"<<std::endl;
-                d_intf_protect = true;
-                d_protect_cnt=0;
-                break;
-              }
-              if(!d_cur_intf.front_tag_empty()){
-                d_intf_mem[d_intf_idx++] = in[count];
-                d_cur_intf.increment();
-                if(d_intf_idx==d_cap){
-                  d_intf_idx = d_cur_intf.begin();
-                  d_cur_intf.clear();
-                }
-              }
-              d_in_mem[d_in_idx++] = in[count++];
-              d_in_idx%=d_cap;
-              system_update(d_in_idx);
-            }
-          break;
-          default:
-            throw std::runtime_error("Undefined state");
-          break;
-        }
-      }
-      //DEBUG required
-      intf_detector();
-      std::list<intf_t>::iterator intf_it;
-      while(!d_ic_list.empty()){
-        do_ic(d_ic_list.front());
-        for(intf_it=d_intf_list.begin();intf_it!=d_intf_list.end();++intf_it){
-          if((std::get<0>(d_ic_list.front())).begin() == (*intf_it).begin() ){
-            intf_it = d_intf_list.erase(intf_it);
-            break;
-          }
+      get_tags_in_window(d_block_tags,0,0,nin,d_block_tag);
+      get_tags_in_window(d_voe_tags,0,0,nin,d_voe_tag);
+      get_tags_in_window(d_sfd_tags,0,0,nin,d_phase_tag);
+      d_capture->feed(in,nin,nitems_read(0),d_block_tags,d_voe_tags,d_sfd_tags);
+      ic_object obj;
+      while(d_capture->pop(d_engine_id,obj)){
+        if(obj.size<=d_buf_lim){
+          d_capture->read(d_ic_mem,obj);
+          do_ic(obj);
         }
-        d_ic_list.pop_front();
+        d_capture->release(obj);
       }
       nout = std::min(noutput_items,std::max(d_out_size-d_out_idx,0));
       memcpy(out,d_out_mem+d_out_idx,sizeof(gr_complex)*nout);
@@ -1093,7 +965,7 @@ namespace gr {
         d_out_idx=0;
         d_out_size=0;
       }
-      consume_each (count);
+      consume_each (nin);
       return nout;
     }
 
@@ -22,11 +22,26 @@
 #define INCLUDED_LSA_IC_RESYNC_CC_IMPL_H
 
 #include <lsa/ic_resync_cc.h>
-#include <gnuradio/filter/mmse_fir_interpolator_ff.h>
 #include "utils.h"
+#include "sample_store.h"
+#include "ic_kernels.h"
+#include "mm_kernel.h"
+#include "intf_capture.h"
 
 namespace gr {
   namespace lsa {
+    // a PU symbol taken out of the span during IC
+    struct pu_sym_t{
+      int ic_begin;
+      int chip;
+      float cfo;
+      gr_complex coeff;
+    };
+    struct su_state_t{
+      float phase;
+      float gain;
+      float cfo;
+    };
     // pu decoder state
     enum PUDECSTATE{
       SEARCH,
@@ -39,39 +54,26 @@ namespace gr {
      private:
       const size_t d_cap;
       const size_t d_buf_lim;
+      const int d_sps;
+      const ic_kernel_table d_kern;
+      float d_ori_omega;
       const pmt::pmt_t d_in_port;
       const pmt::pmt_t d_out_port;
-      bool d_intf_protect;
-      int d_protect_cnt;
-      gr_complex* d_in_mem;
+      intf_capture::sptr d_capture;
+      int d_engine_id;
       gr_complex* d_out_mem;
       //gr_complex* d_demo_mem;
-      gr_complex* d_intf_mem;
       gr_complex* d_fir_buffer;
       gr_complex* d_ic_mem;
       std::vector<gr_complex> d_taps;
-      std::vector<gr_complex> d_tap_buffer;
       std::vector<gr_complex> d_su_rebuild;
-      int d_in_idx;
       int d_out_idx;
-      int d_intf_idx;
       int d_out_size;
-      int d_offset;
-      uint64_t d_block;
-      uint64_t d_nex_block;
-      int d_nex_block_idx;
-      std::list< std::pair<uint64_t,int> > d_block_list;
       std::vector<tag_t> d_voe_tags;
       std::vector<tag_t> d_sfd_tags;
       std::vector<tag_t> d_block_tags;
-      int d_state;
       gr::thread::mutex d_mutex;
-      std::list<hdr_t> d_pkt_history;
-      std::list< std::pair<int, hdr_t> > d_sfd_list;
-      intf_t d_cur_intf;
-      std::list<intf_t> d_intf_list;
-      std::list<std::pair<intf_t,std::vector<int> > > d_ic_list;
-      int d_retx_cnt;
+      // retransmissions of the object being cancelled
       std::vector< std::tuple<int,pmt::pmt_t,uint16_t> > d_retx_stack;
       // synchronizers
       int d_last_su_sync_idx;
@@ -79,12 +81,7 @@ namespace gr {
       float d_pu_gain_gain;
       float d_pu_cfo_gain;
       // MM_ff
-      filter::mmse_fir_interpolator_ff * d_interp;
-      float d_mu;
-      float d_omega;
-      float d_last_sample;
-      float d_omega_mid;
-      float d_omega_lim;
+      mm_kernel d_mm;
       float* d_mm_mem;
       int d_mm_size;
       int d_mm_cnt;
@@ -108,7 +105,7 @@ namespace gr {
       float d_pu_gain;
       float d_tracking_gain;
       float d_gain_gain;
-      gr_complex d_corr_test[1024];
+      gr_complex d_corr_test[2048];
       gr_complex d_chunk_buf[1024];
       // prou regen
       float d_offset_d1;
@@ -116,10 +113,21 @@ namespace gr {
       std::vector<gr_complex> d_pu_rebuild;
       std::vector<gr_complex> d_pu_tmp;
       std::vector<gr_complex> d_pu_cancel_buf;
-      std::vector<float> d_kay_taps;
-      std::vector<gr_complex> d_kay_tmp;
+      std::vector<gr_complex> d_su_buf;
+      gr_complex d_su_ref_eng;
+      gr_complex d_pu_ref_eng;
+      // successive interference cancellation
+      int d_sic_passes;
+      gr_complex* d_ic_orig;
+      bool d_su_fixed;
+      int d_pu_chip;
+      std::vector<pu_sym_t> d_pu_syms;
+      // last decoded PU frame, published once all passes are done
+      unsigned char d_pu_frame[128];
+      int d_pu_frame_len;
       // debug and demo purpose
       std::list<tag_t> d_out_tags;
+      ic_dump_writer::sptr d_dump;
       // prou decoder
       int d_dec_threshold;
       PUDECSTATE d_dec_state;
@@ -136,25 +144,21 @@ namespace gr {
       unsigned char chip_decoder(const unsigned int& c, int& quality);
 
       // stream functions
-      bool voe_update(int idx);
-      void system_update(int idx);
       void msg_in(pmt::pmt_t msg);
-      bool pkt_validate(hdr_t& hdr,uint64_t bid,int offset,int pktlen, uint16_t qidx,uint16_t qsize, uint16_t base);
-      bool matching_pkt(hdr_t& hdr);
-      bool create_intf();
-      void tags_update(int idx);
-      void retx_detector(uint16_t qidx,uint16_t qsize,uint16_t base,pmt::pmt_t blob, int pktlen);
-      void intf_detector();
-      void do_ic(std::pair<intf_t,std::vector<int> > obj);
+      void do_ic(const ic_object& obj);
 
       // functions to reconstruct both su and pu signal
       void rebuild_su(bool retx,const std::vector<int>& retx_idx,std::vector<int>& pkt_len);
       void reset_sync(); // reset clock, registers
       void rebuild_pu(int chip_id);
       void cancel_pu_and_resync(int cur_sync_idx,int ic_mem_idx,int su_mem_idx,int prev_mm_size,int cur_mm_idx);
+      bool decode_pu(int& sfd_idx, int size);
+      int pu_frame_chip(int k) const;
+      bool subtract_pu(int size);
+      float retrack_su(int sfd_idx, int out_idx, int size, const su_state_t& init);
 
      public:
-      ic_resync_cc_impl(const std::vector<float>& taps);
+      ic_resync_cc_impl(const std::vector<float>& taps, int sps, const std::string& dump_file, int storage, int sic_passes, const std::string& capture);
       ~ic_resync_cc_impl();
 
       // Where all the action really happens
@@ -164,6 +168,15 @@ namespace gr {
            gr_vector_int &ninput_items,
            gr_vector_const_void_star &input_items,
            gr_vector_void_star &output_items);
+
+      bool replay(const ic_dump_record& rec, float& depth);
+      // drive the per PU symbol path on a loaded span, one symbol every
+      // chunk, without the decoder in front of it
+      void load_span(const std::vector<gr_complex>& pu_in, const std::vector<gr_complex>& ic_in,
+        const std::vector<gr_complex>& su_ref);
+      size_t cancel_span(int nsym);
+      int chunk_size() const{return d_chunk_size;}
+      size_t pu_record_capacity() const{return d_pu_syms.capacity();}
     };
 
     // su header and physical layer info
@@ -0,0 +1,595 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "intf_capture.h"
+#include <boost/weak_ptr.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+namespace gr {
+  namespace lsa {
+    #define d_debug false
+    #define DEBUG d_debug && std::cout
+    #define LSAPHYLEN 6
+    #define MODBPS 2
+    #define CHIPRATEINV 8
+    static const int d_protect_size = 512;
+    static const int d_prelen = 128;
+
+    // named captures, entries expire with their last engine
+    static gr::thread::mutex s_registry_mutex;
+    static std::map<std::string,boost::weak_ptr<intf_capture> > s_registry;
+
+    intf_capture::sptr
+    intf_capture::make(const std::string& name, int sps, int storage,
+      int capacity)
+    {
+      if(name.empty()){
+        return sptr(new intf_capture(sps,storage,capacity));
+      }
+      gr::thread::scoped_lock guard(s_registry_mutex);
+      sptr capture = s_registry[name].lock();
+      if(capture){
+        if(capture->sps()!=sps){
+          throw std::invalid_argument("Engines sharing a capture must use the same samples per chip");
+        }
+        return capture;
+      }
+      capture = sptr(new intf_capture(sps,storage,capacity));
+      s_registry[name] = capture;
+      return capture;
+    }
+
+    intf_capture::intf_capture(int sps, int storage, int capacity)
+      : d_sps(sps),
+        d_cap(capacity),
+        d_match_dist(0)
+    {
+      d_in_mem = new sample_store(d_cap,storage);
+      d_intf_mem = new sample_store(d_cap,storage);
+      d_in_idx=0;
+      d_intf_idx=0;
+      d_nitems=0;
+      for(int k=0;k<3;++k){
+        d_tags[k] = NULL;
+        d_tag_pos[k] = 0;
+      }
+      d_state = CAPTURE_CLEAR;
+      d_protect_cnt=0;
+      d_cur_intf.clear();
+      d_retx_cnt=0;
+      d_next_id=0;
+      d_seqno=0;
+      d_outstanding=0;
+    }
+
+    intf_capture::~intf_capture()
+    {
+      delete d_in_mem;
+      delete d_intf_mem;
+    }
+
+    int
+    intf_capture::attach(int match_dist)
+    {
+      if(match_dist<0){
+        throw std::invalid_argument("Match distance should not be negative");
+      }
+      gr::thread::scoped_lock guard(d_mutex);
+      int id = d_next_id++;
+      d_queues[id].match_dist = match_dist;
+      d_match_dist = std::max(d_match_dist,match_dist);
+      return id;
+    }
+
+    void
+    intf_capture::detach(int id)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      std::map<int,engine_queue>::iterator it = d_queues.find(id);
+      if(it==d_queues.end()){
+        return;
+      }
+      d_outstanding-=it->second.objs.size();
+      d_queues.erase(it);
+      d_match_dist = 0;
+      for(it=d_queues.begin();it!=d_queues.end();++it){
+        d_match_dist = std::max(d_match_dist,it->second.match_dist);
+      }
+    }
+
+    bool
+    intf_capture::pop(int id, ic_object& obj)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      std::map<int,engine_queue>::iterator it = d_queues.find(id);
+      if(it==d_queues.end()){
+        return false;
+      }
+      std::deque<ic_object>& queue = it->second.objs;
+      if(queue.empty()){
+        return false;
+      }
+      obj = queue.front();
+      queue.pop_front();
+      return true;
+    }
+
+    void
+    intf_capture::read(gr_complex* out, const ic_object& obj) const
+    {
+      // the span is not written again before the object is released, the
+      // lock keeps int16 blocks from being rescaled while they are read
+      gr::thread::scoped_lock guard(d_mutex);
+      d_intf_mem->read(out,obj.begin,obj.size);
+    }
+
+    void
+    intf_capture::release(const ic_object& obj)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      d_outstanding--;
+    }
+
+    bool
+    intf_capture::tag_at(tag_kind kind, uint64_t abs_idx, pmt::pmt_t& value)
+    {
+      const std::vector<tag_t>& tags = *d_tags[kind];
+      size_t& pos = d_tag_pos[kind];
+      // tags of samples consumed through another engine are stale
+      while(pos<tags.size() && tags[pos].offset<abs_idx){
+        pos++;
+      }
+      if(pos<tags.size() && tags[pos].offset==abs_idx){
+        value = tags[pos++].value;
+        return true;
+      }
+      return false;
+    }
+
+    bool
+    intf_capture::voe_update(uint64_t abs_idx)
+    {
+      pmt::pmt_t value;
+      if(!tag_at(TAG_VOE,abs_idx,value)){
+        return false;
+      }
+      bool result = pmt::to_bool(value);
+      if(d_state==CAPTURE_CLEAR && result){
+        result = true;
+      }else if(d_state==CAPTURE_TRIGGERED && !result){
+        result = true;
+      }else if(d_state==CAPTURE_PROTECT && result){
+        result = true;
+      }
+      return result;
+    }
+
+    void
+    intf_capture::tags_update(uint64_t abs_idx)
+    {
+      pmt::pmt_t value;
+      if(tag_at(TAG_BLOCK,abs_idx,value)){
+        d_block_list.push_back(std::make_pair(pmt::to_uint64(value),d_in_idx));
+      }
+      if(tag_at(TAG_SFD,abs_idx,value)){
+        pmt::pmt_t sfd_msg = pmt::make_dict();
+        sfd_msg = pmt::dict_add(sfd_msg,pmt::intern("init_phase"),value);
+        int idx_fix = d_in_idx-d_prelen*d_sps;
+        idx_fix = (idx_fix<0)? idx_fix+d_cap : idx_fix;
+        hdr_t sfd_hdr(idx_fix,sfd_msg);
+        d_sfd_list.push_back(std::make_pair(idx_fix,sfd_hdr));
+      }
+    }
+
+    void
+    intf_capture::system_update(int idx)
+    {
+      if(!d_sfd_list.empty()){
+        if(std::get<0>(d_sfd_list.front())==idx){
+          d_sfd_list.pop_front();
+        }
+      }
+      if(!d_block_list.empty()){
+        if(std::get<1>(d_block_list.front())==idx){
+          d_block_list.pop_front();
+        }
+      }
+      if(!d_pkt_history.empty()){
+        if(d_pkt_history.front().index()==idx){
+          d_pkt_history.pop_front();
+        }
+      }
+    }
+
+    void
+    intf_capture::put(const gr_complex& sample)
+    {
+      d_in_mem->put(d_in_idx++,sample);
+      d_in_idx%=d_cap;
+      d_nitems++;
+      system_update(d_in_idx);
+    }
+
+    void
+    intf_capture::feed(const gr_complex* in, int nin, uint64_t nread,
+      const std::vector<tag_t>& block_tags,
+      const std::vector<tag_t>& voe_tags,
+      const std::vector<tag_t>& sfd_tags)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      if(nread+nin<=d_nitems){
+        return;
+      }
+      int count = 0;
+      if(nread<d_nitems){
+        count = d_nitems-nread;
+      }else{
+        d_nitems = nread;
+      }
+      d_tags[TAG_BLOCK] = &block_tags;
+      d_tags[TAG_VOE] = &voe_tags;
+      d_tags[TAG_SFD] = &sfd_tags;
+      for(int k=0;k<3;++k){
+        d_tag_pos[k] = 0;
+      }
+      while(count<nin){
+        switch(d_state){
+          case CAPTURE_CLEAR:
+            while(count<nin){
+              tags_update(d_nitems);
+              if(voe_update(d_nitems)){
+                d_state = CAPTURE_TRIGGERED;
+                DEBUG<<"\033[35;1m<CAPTURE>Found a VoE begin tag at:"<<d_in_idx<<"\033[0m"<<std::endl;
+                if(create_intf()){
+                  DEBUG<<"\033[34;1m<CAPTURE>Created an interference object"<<"\033[0m"<<std::endl;
+                }else{
+                  DEBUG<<"\033[34;1m<CAPTURE>Failed to create an interference object"<<"\033[0m"<<std::endl;
+                  d_intf_idx = d_cur_intf.begin();
+                  d_cur_intf.clear();
+                }
+                break;
+              }
+              put(in[count++]);
+            }
+          break;
+          case CAPTURE_TRIGGERED:
+            while(count<nin){
+              tags_update(d_nitems);
+              if(voe_update(d_nitems)){
+                DEBUG<<"\033[35;1m<CAPTURE>Found a VoE end tag at:"<<d_in_idx<<"\033[0m"<<std::endl;
+                d_state = CAPTURE_PROTECT;
+                d_protect_cnt=0;
+                break;
+              }
+              if(!d_cur_intf.front_tag_empty()){
+                d_intf_mem->put(d_intf_idx++,in[count]);
+                d_cur_intf.increment();
+                if(d_intf_idx==d_cap){
+                  d_intf_idx = d_cur_intf.begin();
+                  d_cur_intf.clear();
+                }
+              }
+              put(in[count++]);
+            }
+          break;
+          case CAPTURE_PROTECT:
+            while(count<nin && d_protect_cnt<d_protect_size){
+              tags_update(d_nitems);
+              if(voe_update(d_nitems)){
+                DEBUG<<"\033[35;1m<CAPTURE>In Protect state, found a VoE tag at:"<<d_in_idx<<" ,protect_cnt:"<<d_protect_cnt<<"\033[0m"<<std::endl;
+                d_state = CAPTURE_TRIGGERED;
+                d_intf_list.push_back(d_cur_intf);
+                d_cur_intf.clear();
+                if(create_intf()){
+                  DEBUG<<"\033[34;1m<CAPTURE> Tight collision, but still create an intf object\033[0m"<<std::endl;
+                }else{
+                  DEBUG<<"\033[34;1m<CAPTURE> Tight collision, intf object failed\033[0m"<<std::endl;
+                  d_cur_intf.clear();
+                }
+                break;
+              }
+              d_intf_mem->put(d_intf_idx++,in[count]);
+              put(in[count++]);
+              d_cur_intf.increment();
+              d_protect_cnt++;
+              if(d_protect_cnt==d_protect_size){
+                d_state = CAPTURE_CLEAR;
+                d_protect_cnt=0;
+                d_intf_list.push_back(d_cur_intf);
+                d_cur_intf.clear();
+                DEBUG<<"\033[35;1m<CAPTURE>Complete collect additional samples to avoid trimming ProU signal\033[0m"<<std::endl;
+                break;
+              }else if(d_intf_idx==d_cap){
+                d_intf_idx = d_cur_intf.begin();
+                d_cur_intf.clear();
+                d_state = CAPTURE_CLEAR;
+                d_protect_cnt=0;
+                break;
+              }
+            }
+          break;
+          default:
+            throw std::runtime_error("Undefined state");
+          break;
+        }
+      }
+      for(int k=0;k<3;++k){
+        d_tags[k] = NULL;
+      }
+      intf_detector();
+    }
+
+    void
+    intf_capture::pkt_in(pmt::pmt_t msg)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      pmt::pmt_t k = pmt::car(msg);
+      pmt::pmt_t v = pmt::cdr(msg);
+      assert(pmt::is_dict(k));
+      assert(pmt::is_blob(v));
+      size_t io(0);
+      const uint8_t* uvec = u8vector_elements(v,io);
+      uint64_t block = pmt::to_uint64(pmt::dict_ref(k,pmt::intern("block_id"),pmt::from_uint64(0)));
+      int offset = pmt::to_long(pmt::dict_ref(k,pmt::intern("offset"),pmt::from_long(0)));
+      offset *= d_sps;
+      int pktlen = (io+LSAPHYLEN)*CHIPRATEINV*8/MODBPS*d_sps;
+      uint16_t base,base_crc,qsize,qidx;
+      qidx = uvec[0]<<8;
+      qidx|= uvec[1];
+      qsize= uvec[2]<<8;
+      qsize|=uvec[3];
+      base = uvec[4]<<8;
+      base|= uvec[5];
+      base_crc=uvec[6]<<8;
+      base_crc|=uvec[7];
+      if( (qsize!=0 && qidx>=qsize) || (base!=base_crc)){
+        DEBUG<<"<CAPTURE>Low quality header!"<<std::endl;
+        return;
+      }
+      hdr_t hdr;
+      if(!pkt_validate(hdr,block,offset,pktlen,qidx,qsize,base)){
+        DEBUG<<"<CAPTURE>Invalid packet!"<<std::endl;
+        return;
+      }
+      if(!matching_pkt(hdr)){
+        DEBUG<<"<CAPTURE>Not matched with correlation tag!"<<std::endl;
+        return;
+      }
+      // engines sharing a capture may all forward the same header, and
+      // headers of other packets can arrive in between
+      if(in_history(hdr)){
+        return;
+      }
+      d_pkt_history.push_back(hdr);
+      retx_detector(qidx,qsize,base,v,pktlen);
+    }
+
+    bool
+    intf_capture::pkt_validate(hdr_t& hdr,uint64_t bid,int offset, int pktlen, uint16_t qidx, uint16_t qsize,uint16_t base)
+    {
+      std::list< std::pair<uint64_t, int> >::reverse_iterator rit;
+      for(rit=d_block_list.rbegin();rit!=d_block_list.rend();++rit){
+        if(std::get<0>(*rit)==bid){
+          break;
+        }
+      }
+      if(rit==d_block_list.rend()){
+        return false;
+      }
+      // bid and offset at PKTLEN, should track back to preamble
+      int begin = (std::get<1>(*rit) + offset)%d_cap;
+      for(int i=0;i<(d_prelen+16*2)*d_sps;++i){
+        begin = (begin==0)? d_cap-1 : begin-1;
+        if(begin==d_in_idx){
+          DEBUG<<"<PKTVALID>failed at front"<<std::endl;
+          return false;
+        }
+      }
+      pmt::pmt_t msg = pmt::make_dict();
+      msg = pmt::dict_add(msg,pmt::intern("packet_len"),pmt::from_long(pktlen));
+      msg = pmt::dict_add(msg,pmt::intern("queue_index"),pmt::from_long(qidx));
+      msg = pmt::dict_add(msg,pmt::intern("queue_size"),pmt::from_long(qsize));
+      msg = pmt::dict_add(msg,pmt::intern("base"),pmt::from_long(base));
+      hdr_t tmp_hdr(begin,msg);
+      hdr = tmp_hdr;
+      return true;
+    }
+
+    bool
+    intf_capture::matching_pkt(hdr_t& hdr)
+    {
+      std::list< std::pair<int,hdr_t> >::reverse_iterator rit;
+      int idx = hdr.index();
+      for(rit=d_sfd_list.rbegin();rit!=d_sfd_list.rend();rit++){
+        int distance1 = std::abs(std::get<0>(*rit)-idx);
+        int distance2 = std::abs(std::get<0>(*rit)+d_cap-idx);
+        int distance = std::min(distance1,distance2);
+        if(distance<=d_match_dist){
+          pmt::pmt_t tmp = (std::get<1>(*rit)).msg();
+          hdr.set_index(std::get<1>(*rit).index());
+          hdr.add_msg(pmt::intern("init_phase"),pmt::dict_ref(tmp,pmt::intern("init_phase"),pmt::from_float(0)));
+          hdr.add_msg(pmt::intern("match_dist"),pmt::from_long(distance));
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool
+    intf_capture::in_history(const hdr_t& hdr) const
+    {
+      // the history only holds headers still inside the sample ring
+      std::list<hdr_t>::const_reverse_iterator rit;
+      for(rit=d_pkt_history.rbegin();rit!=d_pkt_history.rend();++rit){
+        if((*rit).index()==hdr.index()){
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void
+    intf_capture::retx_detector(uint16_t qidx,uint16_t qsize,uint16_t base,pmt::pmt_t blob,int pktlen)
+    {
+      if(qsize!=d_retx_stack.size()){
+        d_retx_stack.clear();
+        if(qsize==0){
+          // reset signal
+          d_retx_cnt=0;
+        }else{
+          // direct change of retransmission
+          d_retx_stack.resize(qsize,std::make_tuple(0,pmt::PMT_NIL,0));
+          d_retx_stack[qidx] = std::make_tuple(pktlen,blob,base);
+          d_retx_cnt=1;
+        }
+      }else{
+        if(qsize==0){
+          // clean and also clean
+          return;
+        }
+        // equal retransmissions
+        if(pmt::is_null(std::get<1>(d_retx_stack[qidx]))){
+          d_retx_stack[qidx] = std::make_tuple(pktlen,blob,base);
+          d_retx_cnt++;
+        }
+      }
+    }
+
+    bool
+    intf_capture::create_intf()
+    {
+      if(!d_cur_intf.empty()){
+        return false;
+      }else if(d_intf_list.empty() && d_outstanding==0){
+        // nothing refers to the store, start over
+        DEBUG<<"Empty intference object state, reset intf index..."<<std::endl;
+        d_intf_idx=0;
+      }else if(d_intf_idx==d_cap){
+        return false;
+      }
+      std::list<hdr_t>::reverse_iterator rit=d_pkt_history.rbegin();
+      if(rit==d_pkt_history.rend()){
+        return false;
+      }
+      intf_t obj;
+      int intf_begin = d_intf_idx;
+      obj.set_begin(d_intf_idx);
+      obj.set_front((*rit));
+      int pkt_begin= (*rit).index();
+      int length=0;
+      if(d_in_idx<pkt_begin){
+        length = d_in_idx+d_cap-pkt_begin;
+      }else{
+        length = d_in_idx-pkt_begin;
+      }
+      if(d_intf_idx+length>=d_cap){
+        return false;
+      }
+      // ring may wrap around, copy in two parts
+      int first = std::min(length,d_cap-pkt_begin);
+      d_intf_mem->copy(d_intf_idx,*d_in_mem,pkt_begin,first);
+      d_intf_mem->copy(d_intf_idx+first,*d_in_mem,0,length-first);
+      d_intf_idx+=length;
+      // record voe tag begin for ease of cancellation
+      obj.add_msg(pmt::intern("voe_begin"),pmt::from_long(d_intf_idx-intf_begin));
+      obj.set_end(d_intf_idx-1);
+      d_cur_intf= obj;
+      return true;
+    }
+
+    void
+    intf_capture::intf_detector()
+    {
+      if(d_retx_stack.empty()){
+        return;
+      }
+      bool all_done = (d_retx_stack.size()==d_retx_cnt);
+      std::list<intf_t>::iterator it=d_intf_list.begin();
+      while(it!=d_intf_list.end()){
+        bool do_ic = false;
+        std::vector<int> idx_stack;
+        // remove those intf that the front base not present in retransmission
+        pmt::pmt_t front_msg = (*it).front().msg();
+        uint16_t front_base = pmt::to_long(pmt::dict_ref(front_msg,pmt::intern("base"),pmt::from_long(-1)));
+        for(int i=0;i<d_retx_stack.size();++i){
+          uint16_t retx_base = std::get<2>(d_retx_stack[i]);
+          if(front_base == retx_base){
+            // matched in base
+            // check whether retransmission is enough for cancellation
+            int total_size = (*it).size();
+            int idx_iter = i;
+            while(total_size>0){
+              if(pmt::is_null(std::get<1>(d_retx_stack[idx_iter]))){
+                break;
+              }
+              total_size-=std::get<0>(d_retx_stack[idx_iter]);
+              idx_stack.push_back(idx_iter);
+              idx_iter=(idx_iter+1)%d_retx_stack.size();
+            }
+            if(total_size<0){
+              do_ic = true;
+              break;
+            }
+          }
+        }
+        if(do_ic){
+          DEBUG<<"<INTF DETECTOR>An intf object ready to do ic!"<<std::endl;
+          ic_object obj;
+          obj.seqno = d_seqno++;
+          obj.begin = (*it).begin();
+          obj.size = (*it).size();
+          obj.voe_begin = pmt::to_long(pmt::dict_ref((*it).msg(),pmt::intern("voe_begin"),pmt::from_long(-1)));
+          obj.front_msg = front_msg;
+          const int front_idx = (*it).front().index();
+          std::list<hdr_t>::const_iterator hit;
+          for(hit=d_pkt_history.begin();hit!=d_pkt_history.end();++hit){
+            int offset = ((int)(*hit).index()-front_idx+d_cap)%d_cap;
+            if(offset<obj.size){
+              obj.headers.push_back(std::make_pair(offset,(*hit).msg()));
+            }
+          }
+          obj.retx_stack = d_retx_stack;
+          obj.retx_idx = idx_stack;
+          // engines with a tighter distance never see looser matches
+          int front_dist = pmt::to_long(pmt::dict_ref(front_msg,pmt::intern("match_dist"),pmt::from_long(0)));
+          std::map<int,engine_queue>::iterator qit;
+          for(qit=d_queues.begin();qit!=d_queues.end();++qit){
+            if(front_dist<=qit->second.match_dist){
+              qit->second.objs.push_back(obj);
+              d_outstanding++;
+            }
+          }
+          it = d_intf_list.erase(it);
+        }else if(all_done){
+          DEBUG<<"<INTF DETECTOR>An outdated intf object removed!"<<std::endl;
+          it = d_intf_list.erase(it);
+        }else{
+          ++it;
+        }
+      }
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
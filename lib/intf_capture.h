@@ -0,0 +1,161 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_INTF_CAPTURE_H
+#define INCLUDED_LSA_INTF_CAPTURE_H
+
+#include <gnuradio/tags.h>
+#include <gnuradio/thread/thread.h>
+#include <boost/shared_ptr.hpp>
+#include "utils.h"
+#include "sample_store.h"
+#include <deque>
+#include <list>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace gr {
+  namespace lsa {
+
+    // an interference object ready for cancellation
+    struct ic_object
+    {
+      uint64_t seqno;     // capture order
+      int begin;          // first sample in the capture store
+      int size;
+      int voe_begin;
+      pmt::pmt_t front_msg;
+      // every decoded SU header matched inside the span, front included,
+      // as sample offset from begin and header dict
+      std::vector< std::pair<int,pmt::pmt_t> > headers;
+      // retransmission queue at detection, retx_idx lists the entries
+      // covering the object
+      std::vector< std::tuple<int,pmt::pmt_t,uint16_t> > retx_stack;
+      std::vector<int> retx_idx;
+    };
+
+    /*
+     * Interference capture and indexing shared by the IC engines.
+     *
+     * Owns the sample history, the VoE state machine and the matching of
+     * decoded SU headers to captured spans. Every object that becomes
+     * cancellable is queued to each attached engine, which reads the
+     * samples in place and releases the object when done. Captures created
+     * with the same non-empty name are one instance, so several IC engines
+     * fed by the same stream do the per-sample work and hold the history
+     * only once. Samples already seen through another engine are skipped.
+     * Headers are matched to sfd tags with the widest distance among the
+     * attached engines, an object is only queued to the engines whose own
+     * distance covers the match of its front header.
+     */
+    class intf_capture
+    {
+     public:
+      typedef boost::shared_ptr<intf_capture> sptr;
+      // the first engine to name a capture sets storage and capacity,
+      // later ones must use the same samples per chip
+      static sptr make(const std::string& name, int sps, int storage,
+        int capacity);
+      ~intf_capture();
+
+      int sps() const{return d_sps;}
+      // engine registration with the largest header to sfd distance in
+      // samples the engine accepts, returns the engine's queue id
+      int attach(int match_dist);
+      void detach(int id);
+
+      // samples [nread,nread+nin) of the stream with their block, voe and
+      // sfd tags
+      void feed(const gr_complex* in, int nin, uint64_t nread,
+        const std::vector<tag_t>& block_tags,
+        const std::vector<tag_t>& voe_tags,
+        const std::vector<tag_t>& sfd_tags);
+      // decoded SU header from the packet sink
+      void pkt_in(pmt::pmt_t msg);
+
+      bool pop(int id, ic_object& obj);
+      void read(gr_complex* out, const ic_object& obj) const;
+      void release(const ic_object& obj);
+
+     private:
+      enum capture_state{
+        CAPTURE_CLEAR,
+        CAPTURE_TRIGGERED,
+        CAPTURE_PROTECT
+      };
+      enum tag_kind{
+        TAG_BLOCK,
+        TAG_VOE,
+        TAG_SFD
+      };
+      struct engine_queue
+      {
+        int match_dist;
+        std::deque<ic_object> objs;
+      };
+      intf_capture(int sps, int storage, int capacity);
+
+      bool tag_at(tag_kind kind, uint64_t abs_idx, pmt::pmt_t& value);
+      bool voe_update(uint64_t abs_idx);
+      void tags_update(uint64_t abs_idx);
+      void system_update(int idx);
+      void put(const gr_complex& sample);
+      bool pkt_validate(hdr_t& hdr,uint64_t bid,int offset,int pktlen, uint16_t qidx,uint16_t qsize, uint16_t base);
+      bool matching_pkt(hdr_t& hdr);
+      bool in_history(const hdr_t& hdr) const;
+      void retx_detector(uint16_t qidx,uint16_t qsize,uint16_t base,pmt::pmt_t blob, int pktlen);
+      bool create_intf();
+      void intf_detector();
+
+      const int d_sps;
+      const int d_cap;
+      // widest match distance of the attached engines
+      int d_match_dist;
+      mutable gr::thread::mutex d_mutex;
+      sample_store* d_in_mem;
+      sample_store* d_intf_mem;
+      int d_in_idx;
+      int d_intf_idx;
+      uint64_t d_nitems;
+      // tags of the current feed() call and the next one to consume
+      const std::vector<tag_t>* d_tags[3];
+      size_t d_tag_pos[3];
+      capture_state d_state;
+      int d_protect_cnt;
+      std::list<std::pair<uint64_t,int> > d_block_list;
+      std::list<std::pair<int,hdr_t> > d_sfd_list;
+      std::list<hdr_t> d_pkt_history;
+      intf_t d_cur_intf;
+      std::list<intf_t> d_intf_list;
+      int d_retx_cnt;
+      std::vector< std::tuple<int,pmt::pmt_t,uint16_t> > d_retx_stack;
+      // per engine queues of objects ready for cancellation
+      std::map<int,engine_queue> d_queues;
+      int d_next_id;
+      uint64_t d_seqno;
+      int d_outstanding;
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_INTF_CAPTURE_H */
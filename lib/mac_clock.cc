@@ -0,0 +1,154 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <lsa/mac_clock.h>
+#include <map>
+
+namespace gr {
+  namespace lsa {
+
+    class wall_clock_impl : public mac_clock
+    {
+     public:
+      uint64_t now_us() const{return timer_service::now_us();}
+      timer_service& timers(){return timer_service::instance();}
+      bool is_virtual() const{return false;}
+      // wall clock time passes whatever the blocks do
+      void attach(gr::basic_block* block){}
+      void detach(gr::basic_block* block){}
+      void started(gr::basic_block* block){}
+      void sent(gr::basic_block* block, const pmt::pmt_t& port,
+                const pmt::pmt_t& msg){}
+      void handled(gr::basic_block* block, const pmt::pmt_t& msg){}
+    };
+
+    class virtual_clock_impl : public mac_clock
+    {
+     public:
+      virtual_clock_impl() : d_timers(true){}
+      ~virtual_clock_impl(){}
+      uint64_t now_us() const{return d_timers.now();}
+      timer_service& timers(){return d_timers;}
+      bool is_virtual() const{return true;}
+      void attach(gr::basic_block* block)
+      {
+        gr::thread::scoped_lock guard(d_mutex);
+        if(d_blocks.find(block)!=d_blocks.end()){
+          return;
+        }
+        // time stands still until the block started
+        d_blocks[block] = state_t();
+        d_timers.hold();
+      }
+      void detach(gr::basic_block* block)
+      {
+        gr::thread::scoped_lock guard(d_mutex);
+        std::map<gr::basic_block*,state_t>::iterator it = d_blocks.find(block);
+        if(it==d_blocks.end()){
+          return;
+        }
+        // never handled now
+        uint64_t held = it->second.started? 0 : 1;
+        std::map<pmt::pmt_t,uint64_t>::const_iterator mit = it->second.pending.begin();
+        for(;mit!=it->second.pending.end();++mit){
+          held += mit->second;
+        }
+        for(;held>0;--held){
+          d_timers.release();
+        }
+        d_blocks.erase(it);
+      }
+      void started(gr::basic_block* block)
+      {
+        gr::thread::scoped_lock guard(d_mutex);
+        std::map<gr::basic_block*,state_t>::iterator it = d_blocks.find(block);
+        if(it!=d_blocks.end() && !it->second.started){
+          it->second.started = true;
+          d_timers.release();
+        }
+      }
+      void sent(gr::basic_block* block, const pmt::pmt_t& port,
+                const pmt::pmt_t& msg)
+      {
+        gr::thread::scoped_lock guard(d_mutex);
+        // subscribers are (alias . port) pairs
+        pmt::pmt_t subs = block->message_subscribers(port);
+        for(;pmt::is_pair(subs);subs = pmt::cdr(subs)){
+          const pmt::pmt_t alias = pmt::car(pmt::car(subs));
+          std::map<gr::basic_block*,state_t>::iterator it = d_blocks.begin();
+          for(;it!=d_blocks.end();++it){
+            if(pmt::eq(it->first->alias_pmt(),alias)){
+              it->second.pending[msg]++;
+              d_timers.hold();
+              break;
+            }
+          }
+        }
+      }
+      void handled(gr::basic_block* block, const pmt::pmt_t& msg)
+      {
+        gr::thread::scoped_lock guard(d_mutex);
+        std::map<gr::basic_block*,state_t>::iterator it = d_blocks.find(block);
+        if(it==d_blocks.end()){
+          return;
+        }
+        // messages from blocks without this clock were not counted
+        std::map<pmt::pmt_t,uint64_t>::iterator mit = it->second.pending.find(msg);
+        if(mit==it->second.pending.end()){
+          return;
+        }
+        if(--mit->second==0){
+          it->second.pending.erase(mit);
+        }
+        d_timers.release();
+      }
+
+     private:
+      struct state_t{
+        state_t() : started(false){}
+        // messages sent to the block and not handled yet, by identity,
+        // GNU Radio hands every subscriber the object that was published
+        std::map<pmt::pmt_t,uint64_t> pending;
+        bool started;
+      };
+      gr::thread::mutex d_mutex;
+      timer_service d_timers;
+      std::map<gr::basic_block*,state_t> d_blocks;
+    };
+
+    mac_clock::sptr
+    mac_clock::wall()
+    {
+      static sptr clock(new wall_clock_impl());
+      return clock;
+    }
+
+    mac_clock::sptr
+    mac_clock::make_virtual()
+    {
+      return sptr(new virtual_clock_impl());
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
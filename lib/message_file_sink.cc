@@ -28,6 +28,7 @@
 #include <fstream>
 #include <ctime>
 #include <iomanip>
+#include <algorithm>
 
 namespace gr {
   namespace lsa {
@@ -38,6 +39,12 @@ namespace gr {
     #define SNSMACLEN 4
     #define BYTES_PER_LINE 20
     #define VERBOSEMS 1000
+    static const pmt::pmt_t d_seqno_key = pmt::intern("seqno");
+    static const pmt::pmt_t d_pwr_key = pmt::intern("pwr");
+    // header bytes ahead of the payload in the blob, see phy_crc
+    static const pmt::pmt_t d_offset_key = pmt::intern("offset");
+    static const pmt::pmt_t d_long_zero = pmt::from_long(0);
+    static const pmt::pmt_t d_float_zero = pmt::from_float(0);
     enum SYSTEM{
       LSA=0,
       SNS=1,
@@ -56,6 +63,7 @@ namespace gr {
           d_verb = verb;
           message_port_register_in(d_in_port);
           set_msg_handler(d_in_port,boost::bind(&message_file_sink_impl::msg_in,this,_1));
+          d_clock = mac_clock::wall();
           update_file(filename);
           std::time(&d_timer); // start of this block
           switch(sys){
@@ -71,7 +79,7 @@ namespace gr {
           d_pkt_cnt =0;
           d_byte_cnt=0;
           d_acc_pkt =0;
-          d_start_time = boost::posix_time::second_clock::local_time();
+          d_start_time = d_clock->now_us();
         }
         ~message_file_sink_impl()
         {
@@ -79,6 +87,18 @@ namespace gr {
             d_file->close();
           }
           delete d_file;
+          d_clock->detach(this);
+        }
+        void set_clock(const mac_clock::sptr& clock)
+        {
+          if(!clock){
+            throw std::invalid_argument("Clock cannot be null");
+          }
+          gr::thread::scoped_lock guard(d_mutex);
+          d_clock->detach(this);
+          d_clock = clock;
+          d_clock->attach(this);
+          d_start_time = d_clock->now_us();
         }
         void update_file(const std::string& filename)
         {
@@ -102,35 +122,28 @@ namespace gr {
         }
         bool start()
         {
-          d_finished = false;
-          d_thread = boost::shared_ptr<gr::thread::thread>
-          (new gr::thread::thread(boost::bind(&message_file_sink_impl::run,this)));
+          d_clock->timers().schedule_every(this,VERBOSEMS,VERBOSEMS,
+            boost::bind(&message_file_sink_impl::status,this));
+          d_clock->started(this);
           return block::start();
         }
         bool stop()
         {
-          d_finished = true;
-          d_thread->interrupt();
-          d_thread->join();
+          d_clock->timers().cancel_all(this);
           return block::stop();
         }
       private:
-        void run()
+        void status()
         {
-          while(!d_finished){
-            boost::this_thread::sleep(boost::posix_time::milliseconds(VERBOSEMS));
-            if(d_finished){
-              return;
-            }
-            boost::posix_time::time_duration diff = boost::posix_time::second_clock::local_time() - d_start_time;
-            if(d_verb){
-              std::printf("<Message File Sink> Accumulated results:%d, elapsed time:%d\n",d_acc_pkt,diff.total_seconds());
-              std::fflush(stdout);
-            }
+          uint64_t diff = d_clock->now_us()-d_start_time;
+          if(d_verb){
+            std::printf("<Message File Sink> Accumulated results:%d, elapsed time:%d\n",d_acc_pkt,(int)(diff/1000000));
+            std::fflush(stdout);
           }
         }
         void msg_in(pmt::pmt_t msg)
         {
+          mac_clock::scoped_handler handled(d_clock,this,msg);
           gr::thread::scoped_lock guard(d_mutex);
           // change to local time, only have precision to second
           // maybe need to use clock to find higher precision throughput
@@ -151,10 +164,13 @@ namespace gr {
           }
           uint16_t seq=0;
           float pwr=0;
-          seq = pmt::to_long(pmt::dict_ref(k,pmt::intern("seqno"),pmt::from_long(0)));
-          pwr = pmt::to_float(pmt::dict_ref(k,pmt::intern("pwr"),pmt::from_float(0)));
+          seq = pmt::to_long(pmt::dict_ref(k,d_seqno_key,d_long_zero));
+          pwr = pmt::to_float(pmt::dict_ref(k,d_pwr_key,d_float_zero));
           size_t io(0);
           const uint8_t* uvec = pmt::u8vector_elements(v,io);
+          const size_t offset = std::min(io,(size_t)pmt::to_long(pmt::dict_ref(k,d_offset_key,d_long_zero)));
+          uvec += offset;
+          io -= offset;
           d_pkt_cnt++;
           d_byte_cnt+=io;
           switch(d_sys){
@@ -202,8 +218,8 @@ namespace gr {
         const pmt::pmt_t d_in_port;
         std::fstream* d_file;
         gr::thread::mutex d_mutex;
-        boost::shared_ptr<gr::thread::thread> d_thread;
-        boost::posix_time::ptime d_start_time;
+        mac_clock::sptr d_clock;
+        uint64_t d_start_time;
         time_t d_timer;
         int d_sys;
         int d_pkt_cnt;
@@ -211,7 +227,6 @@ namespace gr {
         unsigned int d_acc_pkt;
         bool d_append;
         bool d_verb;
-        bool d_finished;
     };
 
     message_file_sink::sptr 
@@ -0,0 +1,56 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "mm_kernel.h"
+#include <gnuradio/filter/interpolator_taps.h>
+#include <volk/volk.h>
+
+namespace gr {
+  namespace lsa {
+
+    mm_kernel::mm_kernel()
+      : d_mu(0.5),
+        d_omega(2),
+        d_omega_mid(2),
+        d_omega_lim(0),
+        d_last_sample(0),
+        d_gain_mu(0),
+        d_gain_omega(0)
+    {
+      d_bank = (float*)volk_malloc(sizeof(float)*MM_NTAPS*(MM_NSTEPS+1),volk_get_alignment());
+      // fir filters run over reversed taps, fold that into the bank
+      for(int i=0;i<=MM_NSTEPS;++i){
+        for(int k=0;k<MM_NTAPS;++k){
+          d_bank[MM_NTAPS*i+k] = taps[i][MM_NTAPS-1-k];
+        }
+      }
+    }
+
+    mm_kernel::~mm_kernel()
+    {
+      volk_free(d_bank);
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
@@ -0,0 +1,113 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_MM_KERNEL_H
+#define INCLUDED_LSA_MM_KERNEL_H
+
+#include <gnuradio/math.h>
+#include <cmath>
+#include <stdexcept>
+
+namespace gr {
+  namespace lsa {
+    #define MM_NTAPS 8
+    #define MM_NSTEPS 128
+
+    /*
+     * Mueller and Muller clock recovery on real samples. Uses the same
+     * 8 tap, 128 step mmse interpolator as filter::mmse_fir_interpolator_ff
+     * but with the filter bank held inline, so a whole chunk is processed
+     * per call without virtual calls or allocations.
+     */
+    class mm_kernel
+    {
+     public:
+      mm_kernel();
+      ~mm_kernel();
+      int ntaps() const{return MM_NTAPS;}
+      void reset(float mu, float omega, float omega_relative_limit)
+      {
+        d_mu = mu;
+        d_omega = omega;
+        d_omega_mid = omega;
+        d_omega_lim = omega*omega_relative_limit;
+        d_last_sample = 0;
+      }
+      void set_gains(float gain_mu, float gain_omega)
+      {
+        d_gain_mu = gain_mu;
+        d_gain_omega = gain_omega;
+      }
+      /*
+       * Consume in[consumed] up to in[ninput-ntaps()-1], write one output
+       * per recovered symbol. Returns the number of outputs written.
+       */
+      inline int work(const float* in, int ninput, int& consumed, float* out)
+      {
+        int nout =0;
+        int idx = consumed;
+        float mu = d_mu, omega = d_omega, last = d_last_sample;
+        const int lim = ninput-MM_NTAPS;
+        while(idx<lim){
+          const int imu = (int)rintf(mu*MM_NSTEPS);
+          if(imu<0 || imu>MM_NSTEPS){
+            // same failure as mmse_fir_interpolator_ff on a diverged loop
+            throw std::runtime_error("mm_kernel: imu out of bounds.");
+          }
+          const float* f = d_bank+MM_NTAPS*imu;
+          const float* x = in+idx;
+          float y = x[0]*f[0]+x[1]*f[1]+x[2]*f[2]+x[3]*f[3]
+                   +x[4]*f[4]+x[5]*f[5]+x[6]*f[6]+x[7]*f[7];
+          float mm_val = slice(last)*y-slice(y)*last;
+          last = y;
+          out[nout++] = y;
+          omega = omega + d_gain_omega*mm_val;
+          omega = d_omega_mid + gr::branchless_clip(omega-d_omega_mid,d_omega_lim);
+          mu = mu + omega + d_gain_mu*mm_val;
+          float step = floorf(mu);
+          idx += (int)step;
+          mu -= step;
+        }
+        consumed = idx;
+        d_mu = mu;
+        d_omega = omega;
+        d_last_sample = last;
+        return nout;
+      }
+     private:
+      mm_kernel(const mm_kernel&);
+      mm_kernel& operator=(const mm_kernel&);
+      static inline float slice(float x){return x<0?-1.0F:1.0F;}
+      // (MM_NSTEPS+1) x MM_NTAPS, row i holds the filter for mu=i/MM_NSTEPS
+      // in input order
+      float* d_bank;
+      float d_mu;
+      float d_omega;
+      float d_omega_mid;
+      float d_omega_lim;
+      float d_last_sample;
+      float d_gain_mu;
+      float d_gain_omega;
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_MM_KERNEL_H */
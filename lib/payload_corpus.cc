@@ -0,0 +1,327 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <lsa/payload_corpus.h>
+#include <lsa/frame_aggregator.h>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace gr {
+  namespace lsa {
+    static const size_t CSV_BUFSIZE = 1<<16;
+
+    csv_record_reader::csv_record_reader(const std::string& filename)
+      : d_buf(CSV_BUFSIZE),
+        d_pos(0),
+        d_len(0)
+    {
+      d_file = fopen(filename.c_str(),"r");
+      if(d_file==NULL){
+        throw std::runtime_error("cannot open CSV payload file");
+      }
+    }
+
+    csv_record_reader::~csv_record_reader()
+    {
+      fclose(d_file);
+    }
+
+    bool
+    csv_record_reader::fill()
+    {
+      d_pos = 0;
+      d_len = fread(d_buf.data(),1,d_buf.size(),d_file);
+      return d_len>0;
+    }
+
+    /*
+     * Same records getline() and atoi() gave: every comma ends a field, a
+     * field left at the end of the line counts if it is not empty, and a
+     * field is the integer its leading characters spell.
+     */
+    bool
+    csv_record_reader::next(std::vector<unsigned char>& record)
+    {
+      record.clear();
+      bool line = false;
+      bool field = false;
+      // 0: leading blanks, 1: digits, 2: rest of the field is ignored
+      int state = 0;
+      int sign = 1;
+      int value = 0;
+      while(d_pos<d_len || fill()){
+        const char c = d_buf[d_pos++];
+        line = true;
+        if(c=='\n'){
+          if(field){
+            record.push_back((unsigned char)(sign*value));
+          }
+          return true;
+        }
+        if(c==','){
+          record.push_back((unsigned char)(sign*value));
+          field = false;
+          state = 0;
+          sign = 1;
+          value = 0;
+          continue;
+        }
+        field = true;
+        if(state==0 && (c==' ' || c=='\t' || c=='\r' || c=='\v' || c=='\f')){
+          continue;
+        }
+        if(state==0 && (c=='-' || c=='+')){
+          sign = (c=='-')? -1 : 1;
+          state = 1;
+        }else if(state<2 && c>='0' && c<='9'){
+          value = value*10+(c-'0');
+          state = 1;
+        }else{
+          state = 2;
+        }
+      }
+      if(field){
+        record.push_back((unsigned char)(sign*value));
+      }
+      return line;
+    }
+
+    payload_corpus::payload_corpus()
+      : d_payload(NULL),
+        d_offsets(NULL),
+        d_count(0),
+        d_map(NULL),
+        d_map_size(0)
+    {
+    }
+
+    payload_corpus::~payload_corpus()
+    {
+      clear();
+    }
+
+    void
+    payload_corpus::clear()
+    {
+      if(d_map!=NULL){
+        munmap(d_map,d_map_size);
+        d_map = NULL;
+        d_map_size = 0;
+      }
+      d_arena.clear();
+      d_index.clear();
+      d_payload = NULL;
+      d_offsets = NULL;
+      d_count = 0;
+    }
+
+    void
+    payload_corpus::use_arena()
+    {
+      d_payload = d_arena.data();
+      d_offsets = d_index.data();
+      d_count = d_index.size()-1;
+    }
+
+    bool
+    payload_corpus::open(const std::string& filename)
+    {
+      clear();
+      char magic[8];
+      FILE* file = fopen(filename.c_str(),"rb");
+      if(file==NULL){
+        return false;
+      }
+      const bool binary = fread(magic,1,8,file)==8 && memcmp(magic,LSA_CORPUS_MAGIC,8)==0;
+      fclose(file);
+      if(binary){
+        return map(filename);
+      }
+      csv_record_reader reader(filename);
+      std::vector<unsigned char> record;
+      d_index.push_back(0);
+      while(reader.next(record)){
+        d_arena.insert(d_arena.end(),record.begin(),record.end());
+        d_index.push_back(d_arena.size());
+      }
+      use_arena();
+      return true;
+    }
+
+    bool
+    payload_corpus::map(const std::string& filename)
+    {
+      int fd = ::open(filename.c_str(),O_RDONLY);
+      if(fd<0){
+        return false;
+      }
+      struct stat st;
+      if(fstat(fd,&st)!=0 || st.st_size<(off_t)sizeof(payload_corpus_hdr_t)){
+        ::close(fd);
+        return false;
+      }
+      void* ptr = mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+      // the mapping outlives the descriptor
+      ::close(fd);
+      if(ptr==MAP_FAILED){
+        return false;
+      }
+      d_map = ptr;
+      d_map_size = st.st_size;
+      const unsigned char* base = (const unsigned char*) d_map;
+      const payload_corpus_hdr_t* hdr = (const payload_corpus_hdr_t*) base;
+      const uint64_t payload_size = hdr->index_offset-sizeof(payload_corpus_hdr_t);
+      if(hdr->version!=LSA_CORPUS_VERSION || hdr->index_offset%8!=0
+        || hdr->index_offset<sizeof(payload_corpus_hdr_t) || hdr->index_offset>d_map_size
+        || hdr->count>=(d_map_size-hdr->index_offset)/sizeof(uint64_t)){
+        clear();
+        return false;
+      }
+      const uint64_t* offsets = (const uint64_t*)(base+hdr->index_offset);
+      // one pass over the index keeps length() from ever underflowing
+      if(offsets[0]!=0 || offsets[hdr->count]>payload_size){
+        clear();
+        return false;
+      }
+      for(uint64_t i=0;i<hdr->count;++i){
+        if(offsets[i+1]<offsets[i]){
+          clear();
+          return false;
+        }
+      }
+      d_payload = base+sizeof(payload_corpus_hdr_t);
+      d_offsets = offsets;
+      d_count = hdr->count;
+      return true;
+    }
+
+    size_t
+    payload_corpus::max_length() const
+    {
+      size_t max_len = 0;
+      for(size_t i=0;i<d_count;++i){
+        max_len = std::max(max_len,length(i));
+      }
+      return max_len;
+    }
+
+    void
+    payload_corpus::aggregate(size_t max_len)
+    {
+      std::vector<unsigned char> arena;
+      std::vector<uint64_t> index(1,0);
+      std::vector<unsigned char> frame;
+      for(size_t i=0;i<d_count;++i){
+        if(frame_aggregator::append(frame,data(i),length(i),max_len)){
+          continue;
+        }
+        if(!frame.empty()){
+          arena.insert(arena.end(),frame.begin(),frame.end());
+          index.push_back(arena.size());
+          frame.clear();
+        }
+        if(!frame_aggregator::append(frame,data(i),length(i),max_len)){
+          throw std::runtime_error("record exceeds the aggregation length");
+        }
+      }
+      if(!frame.empty()){
+        arena.insert(arena.end(),frame.begin(),frame.end());
+        index.push_back(arena.size());
+      }
+      clear();
+      d_arena.swap(arena);
+      d_index.swap(index);
+      use_arena();
+    }
+
+    payload_corpus_writer::payload_corpus_writer(const std::string& filename)
+      : d_offsets(1,0)
+    {
+      d_file = fopen(filename.c_str(),"wb");
+      if(d_file==NULL){
+        throw std::runtime_error("cannot open payload corpus for writing");
+      }
+      // patched by close()
+      payload_corpus_hdr_t hdr;
+      memset(&hdr,0,sizeof(hdr));
+      if(fwrite(&hdr,sizeof(hdr),1,d_file)!=1){
+        fclose(d_file);
+        throw std::runtime_error("cannot write payload corpus");
+      }
+    }
+
+    payload_corpus_writer::~payload_corpus_writer()
+    {
+      try{
+        close();
+      }catch(const std::exception&){
+      }
+    }
+
+    void
+    payload_corpus_writer::append(const unsigned char* record, size_t len)
+    {
+      if(d_file==NULL){
+        throw std::runtime_error("payload corpus already closed");
+      }
+      if(len>0 && fwrite(record,1,len,d_file)!=len){
+        throw std::runtime_error("cannot write payload corpus");
+      }
+      d_offsets.push_back(d_offsets.back()+len);
+    }
+
+    void
+    payload_corpus_writer::close()
+    {
+      if(d_file==NULL){
+        return;
+      }
+      FILE* file = d_file;
+      d_file = NULL;
+      static const unsigned char pad[8] = {0};
+      const uint64_t end = sizeof(payload_corpus_hdr_t)+d_offsets.back();
+      const size_t npad = (8-end%8)%8;
+      payload_corpus_hdr_t hdr;
+      memset(&hdr,0,sizeof(hdr));
+      memcpy(hdr.magic,LSA_CORPUS_MAGIC,8);
+      hdr.version = LSA_CORPUS_VERSION;
+      hdr.count = d_offsets.size()-1;
+      hdr.index_offset = end+npad;
+      bool ok = fwrite(pad,1,npad,file)==npad
+        && fwrite(d_offsets.data(),sizeof(uint64_t),d_offsets.size(),file)==d_offsets.size()
+        && fseek(file,0,SEEK_SET)==0
+        && fwrite(&hdr,sizeof(hdr),1,file)==1;
+      ok = (fclose(file)==0) && ok;
+      if(!ok){
+        throw std::runtime_error("cannot write payload corpus");
+      }
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
@@ -25,6 +25,7 @@
 #include <gnuradio/io_signature.h>
 #include <lsa/phy_crc.h>
 #include <gnuradio/block_detail.h>
+#include "block_ack.h"
 
 namespace gr {
   namespace lsa {
@@ -36,6 +37,11 @@ namespace gr {
     #define PROUMINLEN 4
     #define LSAMINLEN 8
     #define SNSMINLEN 4
+    static const pmt::pmt_t d_seqno_key = pmt::intern("seqno");
+    static const pmt::pmt_t d_pwr_key = pmt::intern("pwr");
+    static const pmt::pmt_t d_pwr_zero = pmt::from_float(0);
+    // payload starts this many bytes into the published blob
+    static const pmt::pmt_t d_offset_key = pmt::intern("offset");
     enum USERTYPE{
       PROU=0,
       LSA=1,
@@ -75,6 +81,8 @@ namespace gr {
             break;
           }
           d_user = user;
+          // thr_out carries the received blob, the MAC header is skipped
+          d_thr_meta = pmt::dict_add(pmt::make_dict(),d_offset_key,pmt::from_long(d_min_len));
         }
         ~phy_crc_impl(){}
 
@@ -87,12 +95,14 @@ namespace gr {
           assert(pmt::is_blob(v));
           size_t io(0);
           const uint8_t* uvec = pmt::u8vector_elements(v,io);
-          if(io<=d_min_len){
+          // a block ACK is as long as a data frame with an 8 byte payload,
+          // SNS takes that length as control
+          if(io<=d_min_len || (d_user==SNS && io==BLOCK_ACK_LEN)){
             if(ctrl_crc(uvec,io)){
               message_port_pub(d_out_port,msg);
             }
           }else if(io<=d_max_len){
-            pmt::pmt_t pwr = pmt::from_float(0);
+            pmt::pmt_t pwr = d_pwr_zero;
             if(pmt::is_number(k)){
               // have pwr tag
               pwr = k;
@@ -102,11 +112,9 @@ namespace gr {
               return;
             }
             // crc passed
-            pmt::pmt_t thr_msg;
-            pmt::pmt_t dict = pmt::make_dict();
-            dict = pmt::dict_add(dict, pmt::intern("seqno"),pmt::from_long(d_seq));
-            dict = pmt::dict_add(dict, pmt::intern("pwr"),pwr);
-            thr_msg = pmt::make_blob(uvec+d_min_len,io-d_min_len);
+            pmt::pmt_t thr_msg = v;
+            pmt::pmt_t dict = pmt::dict_add(d_thr_meta, d_seqno_key,pmt::from_long(d_seq));
+            dict = pmt::dict_add(dict, d_pwr_key,pwr);
             if(d_user == LSA){
               if(d_qsize!=d_lsa_queue_table.size()){
                 d_lsa_queue_table.clear();
@@ -125,7 +133,7 @@ namespace gr {
               // for throughput measurement and ber calculation
               message_port_pub(d_thr_port,pmt::cons(dict,thr_msg));
             }
-              message_port_pub(d_out_port,pmt::cons(pmt::PMT_NIL,v));
+              message_port_pub(d_out_port,pmt::is_null(k)? msg : pmt::cons(pmt::PMT_NIL,v));
           }
         }
 
@@ -212,6 +220,10 @@ namespace gr {
                 return uvec[0]==0x00 && uvec[1]==0xff && uvec[2]==0x0f;
               }else if(io==4){
                 return uvec[0]==uvec[2] && uvec[1]==uvec[3];
+              }else if(io==BLOCK_ACK_LEN){
+                uint16_t base;
+                uint64_t bitmap;
+                return block_ack_parse(uvec,io,base,bitmap);
               }else{
                 return false;
               }
@@ -230,6 +242,7 @@ namespace gr {
         std::vector<bool> d_lsa_queue_table;
         int d_min_len;
         int d_max_len;
+        pmt::pmt_t d_thr_meta;
         uint16_t d_qidx;
         uint16_t d_qsize;
         uint16_t d_seq;
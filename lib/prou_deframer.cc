@@ -0,0 +1,231 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "prou_deframer.h"
+#include <gnuradio/blocks/count_bits.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace gr {
+  namespace lsa {
+
+    static const unsigned int d_mask = 0x7ffffffe;
+    static const int MAXPLD = 128-1;
+    static const unsigned int CHIPSET[16] = {
+      3765939820,
+      3456596710,
+      1826650030,
+      1724778362,
+      778887287,
+      2061946375,
+      4155403488,
+      2272978638,
+      2676511123,
+      2985854233,
+      320833617,
+      422705285,
+      1368596360,
+      85537272,
+      2287047455,
+      4169472305
+    };
+    enum PKTSTATE{
+      SEARCH,
+      SYNC,
+      PAYLOAD
+    };
+
+    inline unsigned char slice(const float& f)
+    {
+      return (f>0)? 0x01:0x00;
+    }
+    
+    prou_deframer::prou_deframer(int threshold)
+      : d_despread(CHIPSET,threshold)
+    {
+      set_threshold(threshold);
+      d_chips = std::vector<float>(MAXPLD*DSSS_BYTE_CHIPS);
+      enter_search();
+    }
+
+    void
+    prou_deframer::set_threshold(int thres)
+    {
+      if(thres<0){
+        throw std::runtime_error("Threshold cannot be negative");
+      }
+      d_threshold = thres;
+      d_despread.set_threshold(thres);
+    }
+
+    void
+    prou_deframer::reset()
+    {
+      enter_search();
+    }
+
+    void
+    prou_deframer::enter_search()
+    {
+      d_state = SEARCH;
+      d_pre_cnt = 0;
+      d_data_reg = 0x00000000;
+      d_chip_cnt =0;
+      d_byte_reg = 0x00;
+    }
+    void
+    prou_deframer::enter_sync()
+    {
+      d_state = SYNC;
+      d_pre_cnt =0;
+      d_chip_cnt =0;
+      d_data_reg = 0x00000000;
+      d_symbol_cnt = 0;
+      d_pld_len =0;
+      d_byte_reg = 0x00;
+    }
+    void
+    prou_deframer::enter_payload(const unsigned char& pld_len)
+    {
+      d_pld_len = pld_len;
+      d_state = PAYLOAD;
+      d_data_reg = 0x00000000;
+      d_chip_cnt =0;
+      d_symbol_cnt = 0;
+      d_byte_reg = 0x00;
+    }
+
+    int
+    prou_deframer::work(const float* chips, int nchips, bool& frame_done)
+    {
+      int count = 0;
+      frame_done = false;
+      while(count<nchips){
+        switch(d_state)
+        {
+          case SEARCH:
+            while(count<nchips){
+              d_data_reg = (d_data_reg << 1) | (slice(chips[count++])&0x01);
+              if(d_pre_cnt>0){
+                d_chip_cnt++;
+              }
+              if(d_pre_cnt ==0){
+                int thres = gr::blocks::count_bits32( (d_data_reg & d_mask) ^ (CHIPSET[0] & d_mask) );
+                if(thres < d_threshold){
+                  //std::cerr<<"prou packet sink:found a zero, thres:"<<thres<<std::endl;
+                  d_pre_cnt++;
+                }
+              }
+              else{
+                if(d_chip_cnt == 32){
+                  d_chip_cnt = 0;
+                  if(d_byte_reg == 0)
+                  {
+                    if(gr::blocks::count_bits32((d_data_reg&d_mask)^(CHIPSET[0]&d_mask))<=d_threshold){
+                      d_pre_cnt++;
+                      d_byte_reg = 0x00;
+                    }
+                    else if(gr::blocks::count_bits32((d_data_reg&d_mask)^(CHIPSET[7]&d_mask)) <=d_threshold ){
+                      d_byte_reg = 0x70;
+                    }
+                    else{
+                      enter_search();
+                      break;
+                    }
+                  }
+                  else{
+                    if(gr::blocks::count_bits32((d_data_reg&d_mask)^(CHIPSET[10]&d_mask))<=d_threshold){
+                      d_byte_reg |= 0x0A;
+                      enter_sync();
+                      break;
+                    }
+                    else{
+                      enter_search();
+                      break;
+                    }
+                  }
+                }
+              }
+            }
+          break;
+          case SYNC:
+            while(count<nchips){
+              d_chips[d_chip_cnt++] = chips[count++];
+              if(d_chip_cnt==32){
+                d_chip_cnt=0;
+                unsigned char c = d_despread.despread(d_chips.data());
+                if(c == 0xff){
+                  enter_search();
+                  break;
+                }
+                else{
+                  if(d_symbol_cnt == 0){
+                    d_byte_reg = c<<4;
+                    d_symbol_cnt++;
+                  }
+                  else{
+                    d_byte_reg |= c;
+                    if(d_byte_reg <= MAXPLD){
+                      enter_payload(d_byte_reg);
+                      break;
+                    }
+                    else{
+                      enter_search();
+                      break;
+                    }
+                  }
+                }
+              }
+            }
+          break;
+          case PAYLOAD:
+          {
+            // collect the whole frame, then despread it in one call
+            int ncopy = std::min(nchips-count,d_pld_len*DSSS_BYTE_CHIPS-d_chip_cnt);
+            memcpy(&d_chips[d_chip_cnt],chips+count,sizeof(float)*ncopy);
+            count += ncopy;
+            d_chip_cnt += ncopy;
+            if(d_chip_cnt==d_pld_len*DSSS_BYTE_CHIPS){
+              int nsym = d_pld_len*2;
+              if(d_despread.despread(d_chips.data(),nsym,d_symbols)==nsym){
+                for(int i=0;i<d_pld_len;++i){
+                  d_buf[i] = (d_symbols[2*i]<<4) | d_symbols[2*i+1];
+                }
+                frame_done = true;
+              }
+              enter_search();
+              return count;
+            }
+          }
+          break;
+          default:
+            throw std::runtime_error("ProU deframer enter undefined state");
+          break;
+        }
+      }
+      return count;
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
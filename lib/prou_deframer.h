@@ -0,0 +1,73 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_PROU_DEFRAMER_H
+#define INCLUDED_LSA_PROU_DEFRAMER_H
+
+#include <lsa/dsss_despreader.h>
+#include <vector>
+
+namespace gr {
+  namespace lsa {
+
+    /*
+     * SEARCH/SYNC/PAYLOAD deframer of the PU packet sinks. Takes soft
+     * chips, the preamble and SFD are found on sliced chips, the length
+     * field and payload are despread soft.
+     */
+    class prou_deframer
+    {
+     public:
+      prou_deframer(int threshold);
+      void set_threshold(int thres);
+      int threshold() const{return d_threshold;}
+      void reset();
+      /*
+       * Consume up to nchips chips, returns the number consumed. Stops
+       * right after a frame ends, frame_done is set if it decoded and
+       * the payload is then in payload()/payload_len().
+       */
+      int work(const float* chips, int nchips, bool& frame_done);
+      const unsigned char* payload() const{return d_buf;}
+      int payload_len() const{return d_pld_len;}
+     private:
+      void enter_search();
+      void enter_sync();
+      void enter_payload(const unsigned char& pld_len);
+
+      int d_threshold;
+      int d_state;
+      int d_pre_cnt;
+      int d_chip_cnt;
+      int d_symbol_cnt;
+      int d_pld_len;
+      unsigned int d_data_reg;
+      unsigned char d_buf[1024];
+      unsigned char d_byte_reg;
+      // soft chips of the length field and payload
+      dsss_despreader d_despread;
+      std::vector<float> d_chips;
+      unsigned char d_symbols[256];
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_PROU_DEFRAMER_H */
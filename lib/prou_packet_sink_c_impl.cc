@@ -0,0 +1,160 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnuradio/io_signature.h>
+#include "prou_packet_sink_c_impl.h"
+#include <volk/volk.h>
+#include <cmath>
+#include <cstring>
+
+namespace gr {
+  namespace lsa {
+    static const pmt::pmt_t d_prou_key = pmt::intern("ProU");
+    #define PROU_CHUNK 4096
+
+    prou_packet_sink_c::sptr
+    prou_packet_sink_c::make(int thres, float omega, float gain_mu,
+      float gain_omega, float omega_relative_limit,
+      float alpha, float demod_gain)
+    {
+      return gnuradio::get_initial_sptr
+        (new prou_packet_sink_c_impl(thres,omega,gain_mu,gain_omega,
+          omega_relative_limit,alpha,demod_gain));
+    }
+
+    /*
+     * The private constructor
+     */
+    prou_packet_sink_c_impl::prou_packet_sink_c_impl(int thres, float omega, float gain_mu,
+      float gain_omega, float omega_relative_limit,
+      float alpha, float demod_gain)
+      : gr::block("prou_packet_sink_c",
+              gr::io_signature::make(1, 1, sizeof(gr_complex)),
+              gr::io_signature::make(0, 0, 0)),
+              d_deframer(thres),
+              d_demod_gain(demod_gain),
+              d_alpha(alpha),
+              d_one_alpha(1.0F-alpha)
+    {
+      if(omega<1.0F){
+        throw std::invalid_argument("Omega should be at least one sample per chip");
+      }
+      if(alpha<0.0F || alpha>1.0F){
+        throw std::invalid_argument("Alpha should be in [0,1]");
+      }
+      if(demod_gain==0.0F){
+        throw std::invalid_argument("Demodulator gain cannot be zero");
+      }
+      d_mm.set_gains(gain_mu,gain_omega);
+      d_mm.reset(0.5,omega,omega_relative_limit);
+      d_prevo = 0;
+      d_last = gr_complex(0,0);
+      d_qmod_tmp = std::vector<gr_complex>(PROU_CHUNK);
+      d_qmod_phase = std::vector<float>(PROU_CHUNK);
+      // a chunk plus the interpolator tail and one overshooting step
+      d_qmod_mem = std::vector<float>(PROU_CHUNK+2*d_mm.ntaps()+(int)std::ceil(omega*(1.0F+omega_relative_limit))+1);
+      d_qmod_cnt = 0;
+      d_mm_consume = 0;
+      d_chips = std::vector<float>(2*d_qmod_mem.size());
+      d_pkt_out = pmt::mp("pkt_out");
+      message_port_register_out(d_pkt_out);
+    }
+
+    /*
+     * Our virtual destructor.
+     */
+    prou_packet_sink_c_impl::~prou_packet_sink_c_impl()
+    {
+    }
+
+    void
+    prou_packet_sink_c_impl::set_threshold(int thres)
+    {
+      d_deframer.set_threshold(thres);
+    }
+
+    int
+    prou_packet_sink_c_impl::threshold() const
+    {
+      return d_deframer.threshold();
+    }
+
+    void
+    prou_packet_sink_c_impl::forecast (int noutput_items, gr_vector_int &ninput_items_required)
+    {
+      ninput_items_required[0] = noutput_items;
+    }
+
+    int
+    prou_packet_sink_c_impl::general_work (int noutput_items,
+                       gr_vector_int &ninput_items,
+                       gr_vector_const_void_star &input_items,
+                       gr_vector_void_star &output_items)
+    {
+      const gr_complex *in = (const gr_complex *) input_items[0];
+      int nin = ninput_items[0];
+      int count = 0;
+      while(count<nin){
+        const int n = std::min(nin-count,PROU_CHUNK);
+        const gr_complex* x = in+count;
+        // quadrature demod, the first sample against the previous chunk
+        d_qmod_tmp[0] = x[0]*std::conj(d_last);
+        if(n>1){
+          volk_32fc_x2_multiply_conjugate_32fc(&d_qmod_tmp[1],x+1,x,n-1);
+        }
+        d_last = x[n-1];
+        volk_32fc_s32f_atan2_32f(d_qmod_phase.data(),d_qmod_tmp.data(),1.0F/d_demod_gain,n);
+        // dc removal by single pole iir
+        float* qmod_out = d_qmod_mem.data()+d_qmod_cnt;
+        float prevo = d_prevo;
+        for(int p=0;p<n;++p){
+          prevo = d_alpha*d_qmod_phase[p] + d_one_alpha*prevo;
+          qmod_out[p] = d_qmod_phase[p] - prevo;
+        }
+        d_prevo = prevo;
+        d_qmod_cnt += n;
+        // MM clock recovery, one soft chip per output
+        int nchips = d_mm.work(d_qmod_mem.data(),d_qmod_cnt,d_mm_consume,d_chips.data());
+        int shift = std::min(d_mm_consume,d_qmod_cnt);
+        memmove(d_qmod_mem.data(),d_qmod_mem.data()+shift,sizeof(float)*(d_qmod_cnt-shift));
+        d_qmod_cnt -= shift;
+        d_mm_consume -= shift;
+        // deframe
+        int chip_cnt = 0;
+        while(chip_cnt<nchips){
+          bool frame_done;
+          chip_cnt += d_deframer.work(d_chips.data()+chip_cnt,nchips-chip_cnt,frame_done);
+          if(frame_done){
+            pmt::pmt_t blob = pmt::make_blob(d_deframer.payload(),d_deframer.payload_len());
+            message_port_pub(d_pkt_out,pmt::cons(d_prou_key,blob));
+          }
+        }
+        count += n;
+      }
+      consume_each (nin);
+      return 0;
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
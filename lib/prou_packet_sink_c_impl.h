@@ -0,0 +1,72 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_PROU_PACKET_SINK_C_IMPL_H
+#define INCLUDED_LSA_PROU_PACKET_SINK_C_IMPL_H
+
+#include <lsa/prou_packet_sink_c.h>
+#include "prou_deframer.h"
+#include "mm_kernel.h"
+
+namespace gr {
+  namespace lsa {
+
+    class prou_packet_sink_c_impl : public prou_packet_sink_c
+    {
+     private:
+      prou_deframer d_deframer;
+      mm_kernel d_mm;
+      pmt::pmt_t d_pkt_out;
+      const float d_demod_gain;
+      const float d_alpha;
+      const float d_one_alpha;
+      float d_prevo;
+      gr_complex d_last;
+      // one chunk of demodulator state, kept small to stay in cache
+      std::vector<gr_complex> d_qmod_tmp;
+      std::vector<float> d_qmod_phase;
+      // filtered phase waiting for the interpolator
+      std::vector<float> d_qmod_mem;
+      int d_qmod_cnt;
+      int d_mm_consume;
+      std::vector<float> d_chips;
+
+     public:
+      prou_packet_sink_c_impl(int thres, float omega, float gain_mu,
+        float gain_omega, float omega_relative_limit,
+        float alpha, float demod_gain);
+      ~prou_packet_sink_c_impl();
+
+      void set_threshold(int thres);
+      int threshold()const;
+
+      // Where all the action really happens
+      void forecast (int noutput_items, gr_vector_int &ninput_items_required);
+
+      int general_work(int noutput_items,
+           gr_vector_int &ninput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_PROU_PACKET_SINK_C_IMPL_H */
@@ -24,42 +24,11 @@
 
 #include <gnuradio/io_signature.h>
 #include "prou_packet_sink_f_impl.h"
-#include <gnuradio/blocks/count_bits.h>
 
 namespace gr {
   namespace lsa {
+    static const pmt::pmt_t d_prou_key = pmt::intern("ProU");
 
-    static const unsigned int d_mask = 0x7ffffffe;
-    static const int MAXPLD = 128-1;
-    static const unsigned int CHIPSET[16] = {
-      3765939820,
-      3456596710,
-      1826650030,
-      1724778362,
-      778887287,
-      2061946375,
-      4155403488,
-      2272978638,
-      2676511123,
-      2985854233,
-      320833617,
-      422705285,
-      1368596360,
-      85537272,
-      2287047455,
-      4169472305
-    };
-    enum PKTSTATE{
-      SEARCH,
-      SYNC,
-      PAYLOAD
-    };
-
-    inline unsigned char slice(const float& f)
-    {
-      return (f>0)? 0x01:0x00;
-    }
-    
     prou_packet_sink_f::sptr
     prou_packet_sink_f::make(int thres)
     {
@@ -73,63 +42,13 @@ namespace gr {
     prou_packet_sink_f_impl::prou_packet_sink_f_impl(int thres)
       : gr::block("prou_packet_sink_f",
               gr::io_signature::make(1, 1, sizeof(float)),
-              gr::io_signature::make(0, 0, 0))
+              gr::io_signature::make(0, 0, 0)),
+              d_deframer(thres)
     {
-      set_threshold(thres);
-      enter_search();
       d_pkt_out = pmt::mp("pkt_out");
       message_port_register_out(d_pkt_out);
     }
 
-    void
-    prou_packet_sink_f_impl::enter_search()
-    {
-      d_state = SEARCH;
-      d_pre_cnt = 0;
-      d_data_reg = 0x00000000;
-      d_chip_cnt =0;
-      d_byte_reg = 0x00;
-    }
-    void
-    prou_packet_sink_f_impl::enter_sync()
-    {
-      d_state = SYNC;
-      d_pre_cnt =0;
-      d_chip_cnt =0;
-      d_data_reg = 0x00000000;
-      d_symbol_cnt = 0;
-      d_pld_len =0;
-      d_byte_reg = 0x00;
-    }
-    void
-    prou_packet_sink_f_impl::enter_payload(const unsigned char& pld_len)
-    {
-      d_pld_len = pld_len;
-      d_state = PAYLOAD;
-      d_data_reg = 0x00000000;
-      d_chip_cnt =0;
-      d_symbol_cnt = 0;
-      d_byte_reg = 0x00;
-    }
-
-    unsigned char
-    prou_packet_sink_f_impl::chip_decoder(const unsigned int& c)
-    {
-      unsigned char d;
-      int min_thres = 33;
-      int thres;
-      for(int i=0;i<16;++i){
-        thres = gr::blocks::count_bits32( (c & d_mask)^(CHIPSET[i] & d_mask) );
-        if(thres < min_thres){
-        min_thres = thres;
-        d = (unsigned char)i;
-        }
-      }
-      if(min_thres < d_threshold){
-        return d & 0x0f;
-      }
-      return 0xff;
-    }
     /*
      * Our virtual destructor.
      */
@@ -140,16 +59,13 @@ namespace gr {
     void
     prou_packet_sink_f_impl::set_threshold(int thres)
     {
-      if(thres<0){
-        throw std::runtime_error("Threshold cannot be negative");
-      }
-      d_threshold = thres;
+      d_deframer.set_threshold(thres);
     }
 
     int
     prou_packet_sink_f_impl::threshold() const
     {
-      return d_threshold;
+      return d_deframer.threshold();
     }
 
     void
@@ -168,120 +84,13 @@ namespace gr {
       int nin = ninput_items[0];
       int count = 0;
       while(count<nin){
-        switch(d_state)
-        {
-          case SEARCH:
-            while(count<nin){
-              d_data_reg = (d_data_reg << 1) | (slice(in[count++])&0x01);
-              if(d_pre_cnt>0){
-                d_chip_cnt++;
-              }
-              if(d_pre_cnt ==0){
-                int thres = gr::blocks::count_bits32( (d_data_reg & d_mask) ^ (CHIPSET[0] & d_mask) );
-                if(thres < d_threshold){
-                  //std::cerr<<"prou packet sink:found a zero, thres:"<<thres<<std::endl;
-                  d_pre_cnt++;
-                }
-              }
-              else{
-                if(d_chip_cnt == 32){
-                  d_chip_cnt = 0;
-                  if(d_byte_reg == 0)
-                  {
-                    if(gr::blocks::count_bits32((d_data_reg&d_mask)^(CHIPSET[0]&d_mask))<=d_threshold){
-                      d_pre_cnt++;
-                      d_byte_reg = 0x00;
-                    }
-                    else if(gr::blocks::count_bits32((d_data_reg&d_mask)^(CHIPSET[7]&d_mask)) <=d_threshold ){
-                      d_byte_reg = 0x70;
-                    }
-                    else{
-                      enter_search();
-                      break;
-                    }
-                  }
-                  else{
-                    if(gr::blocks::count_bits32((d_data_reg&d_mask)^(CHIPSET[10]&d_mask))<=d_threshold){
-                      d_byte_reg |= 0x0A;
-                      enter_sync();
-                      break;
-                    }
-                    else{
-                      enter_search();
-                      break;
-                    }
-                  }
-                }
-              }
-            }
-          break;
-          case SYNC:
-            while(count<nin){
-              d_data_reg = (d_data_reg<<1) | (slice(in[count++])&0x01 );
-              d_chip_cnt++;
-              if(d_chip_cnt==32){
-                d_chip_cnt=0;
-                unsigned char c = chip_decoder(d_data_reg);
-                if(c == 0xff){
-                  enter_search();
-                  break;
-                }
-                else{
-                  if(d_symbol_cnt == 0){
-                    d_byte_reg = c<<4;
-                    d_symbol_cnt++;
-                  }
-                  else{
-                    d_byte_reg |= c;
-                    if(d_byte_reg <= MAXPLD){
-                      enter_payload(d_byte_reg);
-                      break;
-                    }
-                    else{
-                      enter_search();
-                      break;
-                    }
-                  }
-                }
-              }
-            }
-          break;
-          case PAYLOAD:
-            while(count<nin){
-              d_data_reg = (d_data_reg<<1 ) | (slice(in[count++])&0x01);
-              d_chip_cnt++;
-              if(d_chip_cnt==32){
-                d_chip_cnt=0;
-                unsigned char c = chip_decoder(d_data_reg);
-                if(c==0xff){
-                  enter_search();
-                  break;
-                }
-                else{
-                  if(d_symbol_cnt%2==0){
-                    d_buf[d_symbol_cnt/2] = c<<4;
-                  }
-                  else{
-                    d_buf[d_symbol_cnt/2] |= c;
-                  }
-                  d_symbol_cnt++;
-                  if(d_symbol_cnt/2>=d_pld_len){
-                    pmt::pmt_t blob = pmt::make_blob(d_buf,d_pld_len);
-                    message_port_pub(d_pkt_out,pmt::cons(pmt::intern("ProU"),blob));
-                    enter_search();
-                    break;
-                  }
-                }
-              }
-            }
-          break;
-          default:
-            throw std::runtime_error("ProU packet sink enter undefined state");
-          break;
+        bool frame_done;
+        count += d_deframer.work(in+count,nin-count,frame_done);
+        if(frame_done){
+          pmt::pmt_t blob = pmt::make_blob(d_deframer.payload(),d_deframer.payload_len());
+          message_port_pub(d_pkt_out,pmt::cons(d_prou_key,blob));
         }
       }
-
-
       consume_each (nin);
       return 0;
     }
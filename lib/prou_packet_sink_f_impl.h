@@ -22,6 +22,7 @@
 #define INCLUDED_LSA_PROU_PACKET_SINK_F_IMPL_H
 
 #include <lsa/prou_packet_sink_f.h>
+#include "prou_deframer.h"
 
 namespace gr {
   namespace lsa {
@@ -29,24 +30,9 @@ namespace gr {
     class prou_packet_sink_f_impl : public prou_packet_sink_f
     {
      private:
-      int d_threshold;
-      int d_state;
-      int d_pre_cnt;
-      int d_chip_cnt;
-      int d_symbol_cnt;
-      int d_pld_len;
-      unsigned int d_data_reg;
-      unsigned char d_buf[1024];
-      unsigned char d_byte_reg;
-
+      prou_deframer d_deframer;
       pmt::pmt_t d_pkt_out;
 
-      void enter_search();
-      void enter_sync();
-      void enter_payload(const unsigned char& pld_len);
-      unsigned char chip_decoder(const unsigned int& c);
-      
-
 
      public:
       prou_packet_sink_f_impl(int thres);
@@ -0,0 +1,122 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_arq_timer_wheel.h"
+#include <lsa/arq_timer_wheel.h>
+#include <cppunit/TestAssert.h>
+#include <vector>
+
+using gr::lsa::arq_timer_wheel;
+
+namespace {
+
+  // sequence numbers in the order next_expired() hands them out, each
+  // expired frame is removed like an acknowledgement would
+  std::vector<int> drain(arq_timer_wheel& wheel, uint64_t now)
+  {
+    std::vector<int> seqs;
+    arq_timer_wheel::frame_t* frame;
+    while((frame=wheel.next_expired(now))!=NULL){
+      seqs.push_back(frame->seq);
+      wheel.remove(frame->seq);
+    }
+    return seqs;
+  }
+
+} // namespace
+
+void
+qa_arq_timer_wheel::t1_expired_order_across_turns()
+{
+  // eight slots, the scan at 40 spans five turns of the wheel
+  arq_timer_wheel wheel(8);
+  const uint64_t deadlines[] = {20,3,11,5,30,12,4};
+  for(int i=0;i<7;++i){
+    CPPUNIT_ASSERT(wheel.add(i,pmt::PMT_NIL,deadlines[i],0));
+  }
+  CPPUNIT_ASSERT(!wheel.add(3,pmt::PMT_NIL,50,0));
+  CPPUNIT_ASSERT(wheel.next_expired(2)==NULL);
+  const int expected[] = {1,6,3,2,5,0,4};
+  std::vector<int> seqs = drain(wheel,40);
+  CPPUNIT_ASSERT_EQUAL((size_t)7,seqs.size());
+  for(int i=0;i<7;++i){
+    CPPUNIT_ASSERT_EQUAL(expected[i],seqs[i]);
+  }
+  CPPUNIT_ASSERT(wheel.empty());
+}
+
+void
+qa_arq_timer_wheel::t2_late_add_and_rearm()
+{
+  arq_timer_wheel wheel(8);
+  wheel.add(1,pmt::PMT_NIL,45,0);
+  wheel.add(2,pmt::PMT_NIL,60,0);
+  CPPUNIT_ASSERT_EQUAL(1,(int)wheel.next_expired(50)->seq);
+  // ticks up to 50 were scanned, these go straight to the expired list
+  wheel.add(3,pmt::PMT_NIL,10,0);
+  wheel.add(4,pmt::PMT_NIL,47,0);
+  CPPUNIT_ASSERT_EQUAL(3,(int)wheel.next_expired(50)->seq);
+  // re-armed two turns ahead, then back into the past
+  wheel.rearm(3,70,50);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)70,wheel.find(3)->deadline);
+  CPPUNIT_ASSERT_EQUAL(1,(int)wheel.next_expired(50)->seq);
+  wheel.rearm(1,46,50);
+  std::vector<int> seqs = drain(wheel,55);
+  CPPUNIT_ASSERT_EQUAL((size_t)2,seqs.size());
+  CPPUNIT_ASSERT_EQUAL(1,seqs[0]);
+  CPPUNIT_ASSERT_EQUAL(4,seqs[1]);
+  CPPUNIT_ASSERT(wheel.next_expired(59)==NULL);
+  seqs = drain(wheel,80);
+  CPPUNIT_ASSERT_EQUAL((size_t)2,seqs.size());
+  CPPUNIT_ASSERT_EQUAL(2,seqs[0]);
+  CPPUNIT_ASSERT_EQUAL(3,seqs[1]);
+  // re-arming moves a frame to the back of the rotation
+  wheel.add(5,pmt::PMT_NIL,90,80);
+  wheel.add(6,pmt::PMT_NIL,91,80);
+  wheel.rearm(5,95,81);
+  CPPUNIT_ASSERT_EQUAL(6,(int)wheel.front()->seq);
+}
+
+void
+qa_arq_timer_wheel::t3_remove_across_seq_wrap()
+{
+  arq_timer_wheel wheel(8);
+  const uint16_t seqs[] = {65534,65535,0,1};
+  for(int i=0;i<4;++i){
+    wheel.add(seqs[i],pmt::PMT_NIL,100+i,0);
+  }
+  arq_timer_wheel::frame_t frame;
+  CPPUNIT_ASSERT(wheel.remove(0,&frame));
+  CPPUNIT_ASSERT_EQUAL((uint64_t)102,frame.deadline);
+  CPPUNIT_ASSERT(!wheel.remove(0));
+  // bits 0, 1 and 3 from 65534 ack 65534, 65535 and 1
+  std::vector<arq_timer_wheel::frame_t> acked;
+  CPPUNIT_ASSERT_EQUAL(3,wheel.remove_block(65534,0x0b,&acked));
+  CPPUNIT_ASSERT_EQUAL((size_t)3,acked.size());
+  CPPUNIT_ASSERT_EQUAL(65534,(int)acked[0].seq);
+  CPPUNIT_ASSERT_EQUAL(65535,(int)acked[1].seq);
+  CPPUNIT_ASSERT_EQUAL(1,(int)acked[2].seq);
+  CPPUNIT_ASSERT(wheel.empty());
+  CPPUNIT_ASSERT(wheel.next_expired(200)==NULL);
+  // the removed numbers can be used again
+  CPPUNIT_ASSERT(wheel.add(65535,pmt::PMT_NIL,210,200));
+  CPPUNIT_ASSERT_EQUAL(0,wheel.remove_block(0,0x03));
+  CPPUNIT_ASSERT_EQUAL(65535,(int)wheel.next_expired(210)->seq);
+}
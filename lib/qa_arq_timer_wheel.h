@@ -0,0 +1,42 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QA_ARQ_TIMER_WHEEL_H_
+#define _QA_ARQ_TIMER_WHEEL_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestCase.h>
+
+class qa_arq_timer_wheel : public CppUnit::TestCase
+{
+ public:
+  CPPUNIT_TEST_SUITE(qa_arq_timer_wheel);
+  CPPUNIT_TEST(t1_expired_order_across_turns);
+  CPPUNIT_TEST(t2_late_add_and_rearm);
+  CPPUNIT_TEST(t3_remove_across_seq_wrap);
+  CPPUNIT_TEST_SUITE_END();
+
+ private:
+  void t1_expired_order_across_turns();
+  void t2_late_add_and_rearm();
+  void t3_remove_across_seq_wrap();
+};
+
+#endif /* _QA_ARQ_TIMER_WHEEL_H_ */
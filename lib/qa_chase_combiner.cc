@@ -0,0 +1,152 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_chase_combiner.h"
+#include "chase_combiner.h"
+#include <cppunit/TestAssert.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#define QA_THRESHOLD 10
+#define QA_PLD_BYTES 40
+#define QA_NOISE_STD 0.5F
+// amplitude of the chips inside a deep fade
+#define QA_FADE 0.05F
+
+namespace {
+
+  const unsigned int CHIPSET[16] = {
+    3765939820,
+    3456596710,
+    1826650030,
+    1724778362,
+    778887287,
+    2061946375,
+    4155403488,
+    2272978638,
+    2676511123,
+    2985854233,
+    320833617,
+    422705285,
+    1368596360,
+    85537272,
+    2287047455,
+    4169472305
+  };
+
+  // LSA payload: qidx, qsize, base twice, then the body
+  std::vector<unsigned char> make_payload(uint16_t qidx, uint16_t qsize, uint16_t base)
+  {
+    std::vector<unsigned char> pld(QA_PLD_BYTES);
+    pld[0] = qidx>>8;
+    pld[1] = qidx&0xff;
+    pld[2] = qsize>>8;
+    pld[3] = qsize&0xff;
+    pld[4] = pld[6] = base>>8;
+    pld[5] = pld[7] = base&0xff;
+    for(int i=CHASE_HDR_BYTES;i<QA_PLD_BYTES;++i){
+      pld[i] = (unsigned char)(i*37+11);
+    }
+    return pld;
+  }
+
+  /*
+   * Soft chips of a payload, +1 for a one chip, high nibble first, body
+   * symbols [fade_begin,fade_end) in a deep fade. Noise only goes on the
+   * body, the header has to decode for the combiner to find the earlier
+   * copy. Box-Muller on mt19937 keeps the draws the same on every
+   * standard library.
+   */
+  std::vector<float> spread(const std::vector<unsigned char>& pld, unsigned int seed,
+    int fade_begin, int fade_end)
+  {
+    std::mt19937 rng(seed);
+    std::vector<float> soft(pld.size()*DSSS_BYTE_CHIPS);
+    for(size_t i=0;i<pld.size()*2;++i){
+      const unsigned char sym = (i%2)? pld[i/2]&0x0f : pld[i/2]>>4;
+      for(int k=0;k<DSSS_SYMBOL_CHIPS;++k){
+        float chip = ((CHIPSET[sym]>>(DSSS_SYMBOL_CHIPS-1-k))&0x01)? 1.0F : -1.0F;
+        const int body_sym = (int)i-CHASE_HDR_BYTES*2;
+        if(body_sym>=fade_begin && body_sym<fade_end){
+          chip *= QA_FADE;
+        }
+        if(body_sym>=0){
+          double u1 = (rng()+1.0)/4294967297.0;
+          double u2 = rng()/4294967296.0;
+          chip += QA_NOISE_STD*std::sqrt(-2.0*std::log(u1))*std::cos(2.0*M_PI*u2);
+        }
+        soft[i*DSSS_SYMBOL_CHIPS+k] = chip;
+      }
+    }
+    return soft;
+  }
+
+} // namespace
+
+void
+qa_chase_combiner::t1_two_copies_combine()
+{
+  gr::lsa::dsss_despreader despread(CHIPSET,QA_THRESHOLD);
+  gr::lsa::chase_combiner chase(CHIPSET,QA_THRESHOLD,4);
+  // the retransmission differs in the queue index only
+  std::vector<unsigned char> first = make_payload(0,2,77);
+  std::vector<unsigned char> second = make_payload(1,2,77);
+  // each copy fades over a different part of the body
+  std::vector<float> soft1 = spread(first,1,0,16);
+  std::vector<float> soft2 = spread(second,2,40,56);
+  std::vector<unsigned char> out(QA_PLD_BYTES);
+  CPPUNIT_ASSERT(!despread.decode_bytes(soft1.data(),QA_PLD_BYTES,out.data()));
+  CPPUNIT_ASSERT(!despread.decode_bytes(soft2.data(),QA_PLD_BYTES,out.data()));
+
+  CPPUNIT_ASSERT(!chase.decode(soft1.data(),QA_PLD_BYTES,out.data()));
+  CPPUNIT_ASSERT_EQUAL((size_t)1,chase.size());
+  CPPUNIT_ASSERT(chase.decode(soft2.data(),QA_PLD_BYTES,out.data()));
+  // header of the newest copy, combined body
+  for(int i=0;i<QA_PLD_BYTES;++i){
+    CPPUNIT_ASSERT_EQUAL((int)second[i],(int)out[i]);
+  }
+}
+
+void
+qa_chase_combiner::t2_kept_until_accepted()
+{
+  gr::lsa::chase_combiner chase(CHIPSET,QA_THRESHOLD,4);
+  std::vector<unsigned char> out(QA_PLD_BYTES);
+  // a queue index past the queue size fails the phy_crc check
+  std::vector<unsigned char> bad = make_payload(3,2,90);
+  std::vector<float> soft1 = spread(bad,3,0,16);
+  std::vector<float> soft2 = spread(bad,4,16,32);
+  CPPUNIT_ASSERT(!chase.decode(soft1.data(),QA_PLD_BYTES,out.data()));
+  CPPUNIT_ASSERT(chase.decode(soft2.data(),QA_PLD_BYTES,out.data()));
+  CPPUNIT_ASSERT(!gr::lsa::chase_combiner::frame_ok(out.data(),QA_PLD_BYTES));
+  // not accepted, the sum is still there for the next copy
+  CPPUNIT_ASSERT_EQUAL((size_t)1,chase.size());
+
+  std::vector<unsigned char> good = make_payload(0,0,91);
+  std::vector<float> soft3 = spread(good,5,8,24);
+  std::vector<float> soft4 = spread(good,6,32,48);
+  CPPUNIT_ASSERT(!chase.decode(soft3.data(),QA_PLD_BYTES,out.data()));
+  CPPUNIT_ASSERT(chase.decode(soft4.data(),QA_PLD_BYTES,out.data()));
+  CPPUNIT_ASSERT(gr::lsa::chase_combiner::frame_ok(out.data(),QA_PLD_BYTES));
+  CPPUNIT_ASSERT_EQUAL((size_t)2,chase.size());
+  chase.forget(out.data(),QA_PLD_BYTES);
+  CPPUNIT_ASSERT_EQUAL((size_t)1,chase.size());
+}
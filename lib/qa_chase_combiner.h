@@ -0,0 +1,40 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QA_CHASE_COMBINER_H_
+#define _QA_CHASE_COMBINER_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestCase.h>
+
+class qa_chase_combiner : public CppUnit::TestCase
+{
+ public:
+  CPPUNIT_TEST_SUITE(qa_chase_combiner);
+  CPPUNIT_TEST(t1_two_copies_combine);
+  CPPUNIT_TEST(t2_kept_until_accepted);
+  CPPUNIT_TEST_SUITE_END();
+
+ private:
+  void t1_two_copies_combine();
+  void t2_kept_until_accepted();
+};
+
+#endif /* _QA_CHASE_COMBINER_H_ */
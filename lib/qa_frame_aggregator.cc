@@ -0,0 +1,155 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_frame_aggregator.h"
+#include <lsa/frame_aggregator.h>
+#include <lsa/frame_deaggregator.h>
+#include <cppunit/TestAssert.h>
+#include <stdexcept>
+#include <vector>
+
+using gr::lsa::frame_aggregator;
+using gr::lsa::frame_deaggregator;
+
+namespace {
+
+  typedef std::vector< std::pair<size_t,size_t> > records_t;
+
+  std::vector<unsigned char> record(size_t len, unsigned char first)
+  {
+    std::vector<unsigned char> rec(len);
+    for(size_t i=0;i<len;++i){
+      rec[i] = (unsigned char)(first+i);
+    }
+    return rec;
+  }
+
+  bool unpack(const std::vector<unsigned char>& buf, records_t& records)
+  {
+    return frame_deaggregator::unpack(buf.data(),buf.size(),records);
+  }
+
+} // namespace
+
+void
+qa_frame_aggregator::t1_pack_unpack()
+{
+  // LSA payloads after the 4 byte sequence field
+  const size_t max_len = 117;
+  const size_t sizes[] = {1,5,40,0,70,2,110,3,3};
+  std::vector< std::vector<unsigned char> > records;
+  for(int i=0;i<9;++i){
+    records.push_back(record(sizes[i],i*16));
+  }
+  std::vector< std::vector<unsigned char> > frames;
+  frame_aggregator::pack(records,max_len,frames);
+  // 1+5+40+0 | 70+2 | 110+3 | 3, each record costs a sub-header byte
+  CPPUNIT_ASSERT_EQUAL((size_t)4,frames.size());
+  std::vector< std::vector<unsigned char> > out;
+  records_t pos;
+  for(size_t f=0;f<frames.size();++f){
+    CPPUNIT_ASSERT(frames[f].size()<=max_len);
+    CPPUNIT_ASSERT(unpack(frames[f],pos));
+    for(size_t r=0;r<pos.size();++r){
+      out.push_back(std::vector<unsigned char>(frames[f].begin()+pos[r].first,
+        frames[f].begin()+pos[r].first+pos[r].second));
+    }
+  }
+  CPPUNIT_ASSERT(out==records);
+}
+
+void
+qa_frame_aggregator::t2_sub_headers()
+{
+  records_t pos;
+  const unsigned char one[] = {0xa5,0x5a,0x81,0x42};
+  CPPUNIT_ASSERT(frame_deaggregator::unpack(one,4,pos));
+  CPPUNIT_ASSERT_EQUAL((size_t)1,pos.size());
+  CPPUNIT_ASSERT_EQUAL((size_t)3,pos[0].first);
+  CPPUNIT_ASSERT_EQUAL((size_t)1,pos[0].second);
+  // five bytes announced, three left
+  const unsigned char cut[] = {0xa5,0x5a,0x85,0x01,0x02,0x03};
+  CPPUNIT_ASSERT(!frame_deaggregator::unpack(cut,6,pos));
+  // a sub-header without its top bit
+  const unsigned char plain[] = {0xa5,0x5a,0x81,0x42,0x05,0x01};
+  CPPUNIT_ASSERT(!frame_deaggregator::unpack(plain,6,pos));
+  // marker alone, or no marker
+  CPPUNIT_ASSERT(!frame_deaggregator::unpack(one,2,pos));
+  CPPUNIT_ASSERT(!frame_deaggregator::unpack(one,1,pos));
+  CPPUNIT_ASSERT(!frame_deaggregator::unpack(one+1,3,pos));
+}
+
+void
+qa_frame_aggregator::t3_long_records()
+{
+  std::vector<unsigned char> frame;
+  std::vector<unsigned char> big = record(AGG_MAX_RECORD+1,0);
+  // the sub-header holds 7 bits of length
+  CPPUNIT_ASSERT(!frame_aggregator::append(frame,big.data(),big.size(),1024));
+  CPPUNIT_ASSERT(frame.empty());
+  std::vector<unsigned char> max = record(AGG_MAX_RECORD,0);
+  CPPUNIT_ASSERT(frame_aggregator::append(frame,max.data(),max.size(),AGG_HDR_LEN+AGG_SUBHDR_LEN+AGG_MAX_RECORD));
+  records_t pos;
+  CPPUNIT_ASSERT(unpack(frame,pos));
+  CPPUNIT_ASSERT_EQUAL((size_t)AGG_MAX_RECORD,pos[0].second);
+
+  std::vector< std::vector<unsigned char> > records(1,big);
+  std::vector< std::vector<unsigned char> > frames;
+  CPPUNIT_ASSERT_THROW(frame_aggregator::pack(records,1024,frames),std::runtime_error);
+  // one byte short of marker, sub-header and record
+  records[0] = max;
+  CPPUNIT_ASSERT_THROW(frame_aggregator::pack(records,AGG_MAX_RECORD+AGG_HDR_LEN,frames),std::runtime_error);
+}
+
+void
+qa_frame_aggregator::t4_record_offsets()
+{
+  std::vector<unsigned char> frame;
+  std::vector<unsigned char> a = record(3,1);
+  std::vector<unsigned char> c = record(2,9);
+  CPPUNIT_ASSERT(frame_aggregator::append(frame,a.data(),a.size(),16));
+  CPPUNIT_ASSERT(frame_aggregator::append(frame,NULL,0,16));
+  CPPUNIT_ASSERT(frame_aggregator::append(frame,c.data(),c.size(),16));
+  // 2+1+3+1+0+1+2 bytes, the next record does not fit
+  CPPUNIT_ASSERT_EQUAL((size_t)10,frame.size());
+  CPPUNIT_ASSERT(!frame_aggregator::append(frame,c.data(),c.size(),12));
+  CPPUNIT_ASSERT_EQUAL((size_t)10,frame.size());
+  records_t pos;
+  CPPUNIT_ASSERT(unpack(frame,pos));
+  CPPUNIT_ASSERT_EQUAL((size_t)3,pos.size());
+  CPPUNIT_ASSERT_EQUAL((size_t)3,pos[0].first);
+  CPPUNIT_ASSERT_EQUAL((size_t)3,pos[0].second);
+  CPPUNIT_ASSERT_EQUAL((size_t)7,pos[1].first);
+  CPPUNIT_ASSERT_EQUAL((size_t)0,pos[1].second);
+  CPPUNIT_ASSERT_EQUAL((size_t)8,pos[2].first);
+  CPPUNIT_ASSERT_EQUAL((size_t)2,pos[2].second);
+  CPPUNIT_ASSERT_EQUAL(9,(int)frame[pos[2].first]);
+}
+
+void
+qa_frame_aggregator::t5_marker_collision()
+{
+  // a plain payload that starts like an aggregate and whose bytes happen
+  // to chain into sub-headers is split, see frame_deaggregator.h
+  const unsigned char plain[] = {0xa5,0x5a,0x82,0x10,0x20,0x80};
+  records_t pos;
+  CPPUNIT_ASSERT(frame_deaggregator::unpack(plain,6,pos));
+  CPPUNIT_ASSERT_EQUAL((size_t)2,pos.size());
+}
@@ -0,0 +1,109 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_ic_resync_cc.h"
+#include "ic_resync_cc_impl.h"
+#include <cppunit/TestAssert.h>
+#include <boost/thread/thread.hpp>
+#include <cstdlib>
+#include <new>
+
+// operator new only counts while d_count_allocs is set, and only on the
+// thread that set it, every other test in the binary sees plain malloc
+static volatile bool d_count_allocs = false;
+static boost::thread::id d_count_thread;
+static long d_allocs = 0;
+
+void*
+operator new(size_t size)
+{
+  if(d_count_allocs && boost::this_thread::get_id()==d_count_thread){
+    d_allocs++;
+  }
+  void* p = std::malloc(size ? size : 1);
+  if(p==NULL){
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void*
+operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void
+operator delete(void* p) throw()
+{
+  std::free(p);
+}
+
+void
+operator delete[](void* p) throw()
+{
+  std::free(p);
+}
+
+long
+qa_ic_resync_cc::allocs_per_span(int sic_passes)
+{
+  std::vector<float> taps(11,0.1F);
+  gr::lsa::ic_resync_cc::sptr blk = gr::lsa::ic_resync_cc::make(taps,4,"",0,sic_passes);
+  gr::lsa::ic_resync_cc_impl* ic = dynamic_cast<gr::lsa::ic_resync_cc_impl*>(blk.get());
+  CPPUNIT_ASSERT(ic!=NULL);
+  // one PU symbol every 32 half chips, a frame longer than a small reserve
+  const int nsym = 2048;
+  const int span = (nsym+2)*ic->chunk_size();
+  std::vector<gr_complex> pu_in(span), ic_in(span);
+  for(int i=0;i<span;++i){
+    pu_in[i] = gr_complex(std::cos(0.3F*i),std::sin(0.7F*i));
+    ic_in[i] = gr_complex(std::sin(0.2F*i),std::cos(0.5F*i));
+  }
+  ic->load_span(pu_in,ic_in,std::vector<gr_complex>(span,gr_complex(0.5F,-0.5F)));
+  // the record is sized at construction, not on the first long frame
+  const size_t cap = ic->pu_record_capacity();
+  size_t nrec = ic->cancel_span(nsym);
+  ic->load_span(pu_in,ic_in,std::vector<gr_complex>(span,gr_complex(0.5F,-0.5F)));
+  d_allocs = 0;
+  d_count_thread = boost::this_thread::get_id();
+  d_count_allocs = true;
+  nrec = ic->cancel_span(nsym);
+  d_count_allocs = false;
+  CPPUNIT_ASSERT_EQUAL(cap,ic->pu_record_capacity());
+  if(sic_passes>1){
+    CPPUNIT_ASSERT_EQUAL((size_t)nsym,nrec);
+  }else{
+    CPPUNIT_ASSERT_EQUAL((size_t)0,nrec);
+  }
+  return d_allocs;
+}
+
+void
+qa_ic_resync_cc::t1_single_pass_no_alloc()
+{
+  CPPUNIT_ASSERT_EQUAL(0L,allocs_per_span(1));
+}
+
+void
+qa_ic_resync_cc::t2_sic_no_alloc()
+{
+  CPPUNIT_ASSERT_EQUAL(0L,allocs_per_span(3));
+}
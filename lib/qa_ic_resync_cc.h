@@ -0,0 +1,43 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QA_IC_RESYNC_CC_H_
+#define _QA_IC_RESYNC_CC_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestCase.h>
+
+class qa_ic_resync_cc : public CppUnit::TestCase
+{
+ public:
+  CPPUNIT_TEST_SUITE(qa_ic_resync_cc);
+  CPPUNIT_TEST(t1_single_pass_no_alloc);
+  CPPUNIT_TEST(t2_sic_no_alloc);
+  CPPUNIT_TEST_SUITE_END();
+
+ private:
+  void t1_single_pass_no_alloc();
+  void t2_sic_no_alloc();
+  // operator new calls of one cancel_pu_and_resync per PU symbol of a
+  // span, after a warm-up span
+  long allocs_per_span(int sic_passes);
+};
+
+#endif /* _QA_IC_RESYNC_CC_H_ */
@@ -26,11 +26,25 @@
  */
 
 #include "qa_lsa.h"
+#include "qa_arq_timer_wheel.h"
+#include "qa_chase_combiner.h"
+#include "qa_frame_aggregator.h"
+#include "qa_ic_resync_cc.h"
+#include "qa_mac_clock.h"
+#include "qa_rtt_estimator.h"
+#include "qa_timer_service.h"
 
 CppUnit::TestSuite *
 qa_lsa::suite()
 {
   CppUnit::TestSuite *s = new CppUnit::TestSuite("lsa");
+  s->addTest(qa_arq_timer_wheel::suite());
+  s->addTest(qa_chase_combiner::suite());
+  s->addTest(qa_frame_aggregator::suite());
+  s->addTest(qa_ic_resync_cc::suite());
+  s->addTest(qa_mac_clock::suite());
+  s->addTest(qa_rtt_estimator::suite());
+  s->addTest(qa_timer_service::suite());
 
   return s;
 }
@@ -0,0 +1,119 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_mac_clock.h"
+#include <lsa/mac_clock.h>
+#include <gnuradio/block.h>
+#include <gnuradio/io_signature.h>
+#include <cppunit/TestAssert.h>
+
+namespace {
+
+  // message ports only, the clock never calls into the block
+  class node_t : public gr::block
+  {
+   public:
+    node_t(const std::string& name)
+      : gr::block(name,gr::io_signature::make(0,0,0),gr::io_signature::make(0,0,0)),
+        d_in_port(pmt::mp("msg_in")),
+        d_out_port(pmt::mp("msg_out"))
+    {
+      message_port_register_in(d_in_port);
+      message_port_register_out(d_out_port);
+    }
+    void connect(node_t& to)
+    {
+      message_port_sub(d_out_port,pmt::cons(to.alias_pmt(),to.d_in_port));
+    }
+    const pmt::pmt_t d_in_port;
+    const pmt::pmt_t d_out_port;
+  };
+
+  // true once the timer setting done ran, within 5 s of real time
+  bool
+  fires(bool& done)
+  {
+    for(int i=0;i<500 && !done;++i){
+      boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    }
+    return done;
+  }
+
+  void
+  idle()
+  {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+  }
+
+}
+
+void
+qa_mac_clock::t1_holds_per_message()
+{
+  gr::lsa::mac_clock::sptr clock = gr::lsa::mac_clock::make_virtual();
+  node_t tx("tx"), rx("rx"), other("other");
+  tx.connect(rx);
+  tx.connect(other);
+  clock->attach(&tx);
+  clock->attach(&rx);
+  clock->started(&tx);
+  clock->started(&rx);
+  bool done = false;
+  clock->timers().schedule(&tx,10,[&done](){done = true;});
+  // other is not on the clock, the same message is sent twice to rx
+  pmt::pmt_t frame = pmt::cons(pmt::PMT_NIL,pmt::make_blob("data",4));
+  pmt::pmt_t ack = pmt::cons(pmt::PMT_NIL,pmt::make_blob("ack",3));
+  clock->sent(&tx,tx.d_out_port,frame);
+  clock->sent(&tx,tx.d_out_port,frame);
+  // a message never sent on the clock releases nothing
+  clock->handled(&rx,ack);
+  clock->handled(&other,frame);
+  idle();
+  CPPUNIT_ASSERT(!done);
+  clock->handled(&rx,frame);
+  idle();
+  CPPUNIT_ASSERT(!done);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)0,clock->now_us());
+  clock->handled(&rx,frame);
+  CPPUNIT_ASSERT(fires(done));
+  CPPUNIT_ASSERT_EQUAL((uint64_t)10000,clock->now_us());
+  clock->detach(&rx);
+  clock->detach(&tx);
+}
+
+void
+qa_mac_clock::t2_detach_releases()
+{
+  gr::lsa::mac_clock::sptr clock = gr::lsa::mac_clock::make_virtual();
+  node_t tx("tx"), rx("rx");
+  tx.connect(rx);
+  clock->attach(&tx);
+  clock->attach(&rx);
+  clock->started(&tx);
+  bool done = false;
+  clock->timers().schedule(&tx,10,[&done](){done = true;});
+  clock->sent(&tx,tx.d_out_port,pmt::PMT_T);
+  idle();
+  CPPUNIT_ASSERT(!done);
+  // rx never started and never handles the message
+  clock->detach(&rx);
+  CPPUNIT_ASSERT(fires(done));
+  clock->detach(&tx);
+}
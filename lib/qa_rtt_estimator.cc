@@ -0,0 +1,112 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_rtt_estimator.h"
+#include "rtt_estimator.h"
+#include <cppunit/TestAssert.h>
+#include <stdexcept>
+
+using gr::lsa::rtt_estimator;
+
+// every value below is exact in binary
+#define QA_EPS 1e-9
+
+void
+qa_rtt_estimator::t1_first_sample()
+{
+  rtt_estimator rtt(1000,10,10000);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(1000,rtt.rto(),QA_EPS);
+  // a negative time is a clock glitch, not a sample
+  rtt.sample(-5);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(1000,rtt.rto(),QA_EPS);
+  // SRTT = R, RTTVAR = R/2, RTO = SRTT+4*RTTVAR
+  rtt.sample(100);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(100,rtt.srtt(),QA_EPS);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(50,rtt.rttvar(),QA_EPS);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(300,rtt.rto(),QA_EPS);
+  // starting over, the next sample is a first one again
+  rtt.reset(2000);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(2000,rtt.rto(),QA_EPS);
+  rtt.sample(40);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(40,rtt.srtt(),QA_EPS);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(20,rtt.rttvar(),QA_EPS);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(120,rtt.rto(),QA_EPS);
+}
+
+void
+qa_rtt_estimator::t2_smoothing()
+{
+  rtt_estimator rtt(1000,10,10000);
+  rtt.sample(100);
+  // RTTVAR = 3/4*50+1/4*|100-140|, SRTT = 7/8*100+1/8*140
+  rtt.sample(140);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(47.5,rtt.rttvar(),QA_EPS);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(105,rtt.srtt(),QA_EPS);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(295,rtt.rto(),QA_EPS);
+  // a steady RTT drains the variance, the RTO keeps a clock tick above
+  for(int i=0;i<400;++i){
+    rtt.sample(64);
+  }
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(64,rtt.srtt(),1e-6);
+  CPPUNIT_ASSERT(rtt.rttvar()<1e-6);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(65,rtt.rto(),1e-6);
+}
+
+void
+qa_rtt_estimator::t3_backoff_and_karn()
+{
+  rtt_estimator rtt(1000,10,10000);
+  rtt.sample(100);
+  rtt.sample(140);
+  rtt.backoff();
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(590,rtt.rto(),QA_EPS);
+  rtt.backoff();
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(1180,rtt.rto(),QA_EPS);
+  // acked after a retransmission: no sample, the backoff stays
+  CPPUNIT_ASSERT(!rtt.acked(30,1));
+  CPPUNIT_ASSERT(!rtt.acked(30,3));
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(1180,rtt.rto(),QA_EPS);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(105,rtt.srtt(),QA_EPS);
+  // acked on the first transmission: sampled, the backoff ends
+  CPPUNIT_ASSERT(rtt.acked(120,0));
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(39.375,rtt.rttvar(),QA_EPS);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(106.875,rtt.srtt(),QA_EPS);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(264.375,rtt.rto(),QA_EPS);
+}
+
+void
+qa_rtt_estimator::t4_clamping()
+{
+  CPPUNIT_ASSERT_THROW(rtt_estimator(100,0,1000),std::invalid_argument);
+  CPPUNIT_ASSERT_THROW(rtt_estimator(100,50,10),std::invalid_argument);
+  // the initial RTO is clamped too
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(10,rtt_estimator(5,10,100).rto(),QA_EPS);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(100,rtt_estimator(500,10,100).rto(),QA_EPS);
+  rtt_estimator rtt(50,10,100);
+  // 1+max(1,4*0.5) is below the minimum
+  rtt.sample(1);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(10,rtt.rto(),QA_EPS);
+  for(int i=0;i<10;++i){
+    rtt.backoff();
+  }
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(100,rtt.rto(),QA_EPS);
+  rtt.sample(400);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(100,rtt.rto(),QA_EPS);
+}
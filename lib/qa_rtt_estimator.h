@@ -0,0 +1,44 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QA_RTT_ESTIMATOR_H_
+#define _QA_RTT_ESTIMATOR_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestCase.h>
+
+class qa_rtt_estimator : public CppUnit::TestCase
+{
+ public:
+  CPPUNIT_TEST_SUITE(qa_rtt_estimator);
+  CPPUNIT_TEST(t1_first_sample);
+  CPPUNIT_TEST(t2_smoothing);
+  CPPUNIT_TEST(t3_backoff_and_karn);
+  CPPUNIT_TEST(t4_clamping);
+  CPPUNIT_TEST_SUITE_END();
+
+ private:
+  void t1_first_sample();
+  void t2_smoothing();
+  void t3_backoff_and_karn();
+  void t4_clamping();
+};
+
+#endif /* _QA_RTT_ESTIMATOR_H_ */
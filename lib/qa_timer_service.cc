@@ -0,0 +1,264 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "qa_timer_service.h"
+#include <lsa/timer_service.h>
+#include <cppunit/TestAssert.h>
+#include <boost/bind.hpp>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <random>
+
+#define ARQ_FRAMES 200
+#define ARQ_RTO 25
+// each way, on top of the hop through the link thread
+#define ARQ_DELAY 10
+
+namespace {
+
+  /*
+   * Messages of a flowgraph: handled one by one on a thread of their own
+   * after a random real delay, holding the clock like a block does.
+   */
+  class link_t
+  {
+   public:
+    link_t(gr::lsa::timer_service& service) : d_service(service), d_done(false)
+    {
+      d_thread = boost::shared_ptr<gr::thread::thread>(
+        new gr::thread::thread(boost::bind(&link_t::run,this)));
+    }
+    ~link_t()
+    {
+      stop();
+    }
+    // messages still queued are dropped
+    void stop()
+    {
+      {
+        gr::thread::scoped_lock guard(d_mutex);
+        d_done = true;
+        d_changed.notify_one();
+      }
+      d_thread->join();
+    }
+    void post(const boost::function<void()>& handler)
+    {
+      d_service.hold();
+      gr::thread::scoped_lock guard(d_mutex);
+      d_queue.push_back(handler);
+      d_changed.notify_one();
+    }
+   private:
+    void run()
+    {
+      std::random_device seed;
+      std::mt19937 jitter(seed());
+      gr::thread::scoped_lock lock(d_mutex);
+      while(!d_done){
+        if(d_queue.empty()){
+          d_changed.wait(lock);
+          continue;
+        }
+        boost::function<void()> handler = d_queue.front();
+        d_queue.pop_front();
+        lock.unlock();
+        boost::this_thread::sleep(boost::posix_time::microseconds(jitter()%2000));
+        handler();
+        d_service.release();
+        lock.lock();
+      }
+    }
+    gr::lsa::timer_service& d_service;
+    gr::thread::mutex d_mutex;
+    gr::thread::condition_variable d_changed;
+    std::deque< boost::function<void()> > d_queue;
+    boost::shared_ptr<gr::thread::thread> d_thread;
+    bool d_done;
+  };
+
+  // stop-and-wait over a link losing 30% of the frames
+  class arq_t
+  {
+   public:
+    arq_t(gr::lsa::timer_service& service, link_t& link, std::vector<std::string>& events)
+      : d_service(service), d_link(link), d_events(events), d_rng(7),
+        d_seq(0), d_timer(0), d_done(false){}
+    void start()
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      send();
+    }
+    bool wait_done(int ms)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      boost::system_time end = boost::get_system_time()+boost::posix_time::milliseconds(ms);
+      while(!d_done){
+        if(!d_finished.timed_wait(guard,end)){
+          return d_done;
+        }
+      }
+      return true;
+    }
+    void stop()
+    {
+      d_service.cancel_all(this);
+    }
+   private:
+    // with d_mutex held
+    void send()
+    {
+      log("tx",d_seq);
+      d_link.post(boost::bind(&arq_t::frame_in,this,d_seq));
+      d_timer = d_service.schedule(this,ARQ_RTO,boost::bind(&arq_t::timeout,this,d_seq));
+    }
+    void log(const char* what, int seq)
+    {
+      char buf[64];
+      std::snprintf(buf,sizeof(buf),"%llu %s %d",(unsigned long long)d_service.now(),what,seq);
+      d_events.push_back(buf);
+    }
+    void frame_in(int seq)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      if(d_done){
+        return;
+      }
+      if(d_rng()%10<3){
+        log("lost",seq);
+        return;
+      }
+      d_service.schedule(this,ARQ_DELAY+d_rng()%4,boost::bind(&arq_t::ack_out,this,seq));
+    }
+    void ack_out(int seq)
+    {
+      d_link.post(boost::bind(&arq_t::ack_in,this,seq));
+    }
+    void ack_in(int seq)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      if(seq!=d_seq || !d_service.cancel(d_timer)){
+        return;
+      }
+      log("ack",seq);
+      if(++d_seq==ARQ_FRAMES){
+        d_done = true;
+        d_finished.notify_all();
+        return;
+      }
+      send();
+    }
+    void timeout(int seq)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      if(seq!=d_seq || d_done){
+        return;
+      }
+      log("timeout",seq);
+      send();
+    }
+    gr::lsa::timer_service& d_service;
+    link_t& d_link;
+    std::vector<std::string>& d_events;
+    gr::thread::mutex d_mutex;
+    gr::thread::condition_variable d_finished;
+    std::mt19937 d_rng;
+    int d_seq;
+    gr::lsa::timer_service::timer_id d_timer;
+    bool d_done;
+  };
+
+} // namespace
+
+void
+qa_timer_service::arq_run(std::vector<std::string>& events)
+{
+  gr::lsa::timer_service service(true);
+  link_t link(service);
+  arq_t arq(service,link,events);
+  arq.start();
+  const bool done = arq.wait_done(20000);
+  link.stop();
+  arq.stop();
+  CPPUNIT_ASSERT(done);
+}
+
+void
+qa_timer_service::t1_virtual_repeat_run()
+{
+  std::vector<std::string> first, second;
+  arq_run(first);
+  arq_run(second);
+  CPPUNIT_ASSERT(first.size()>ARQ_FRAMES);
+  CPPUNIT_ASSERT_EQUAL(first.size(),second.size());
+  for(size_t i=0;i<first.size();++i){
+    CPPUNIT_ASSERT_EQUAL(first[i],second[i]);
+  }
+}
+
+void
+qa_timer_service::t2_clock_reads_do_not_hold()
+{
+  gr::lsa::timer_service service(true);
+  gr::thread::mutex mutex;
+  gr::thread::condition_variable fired;
+  bool done = false;
+  // a stream block reading the clock on every work call
+  std::atomic<bool> polling(true);
+  gr::thread::thread poller([&service,&polling](){
+    while(polling){
+      service.now();
+    }
+  });
+  service.schedule(&service,60000,[&](){
+    gr::thread::scoped_lock guard(mutex);
+    done = true;
+    fired.notify_all();
+  });
+  {
+    gr::thread::scoped_lock guard(mutex);
+    boost::system_time end = boost::get_system_time()+boost::posix_time::seconds(5);
+    while(!done && fired.timed_wait(guard,end)){}
+  }
+  polling = false;
+  poller.join();
+  CPPUNIT_ASSERT(done);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)60000000,service.now());
+}
+
+void
+qa_timer_service::t3_held_clock_waits()
+{
+  gr::lsa::timer_service service(true);
+  bool done = false;
+  service.hold();
+  service.schedule(&service,10,[&done](){done = true;});
+  boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+  CPPUNIT_ASSERT(!done);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)0,service.now());
+  service.release();
+  for(int i=0;i<500 && service.size()!=0;++i){
+    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+  }
+  CPPUNIT_ASSERT_EQUAL((size_t)0,service.size());
+  CPPUNIT_ASSERT(done);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)10000,service.now());
+}
@@ -0,0 +1,46 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _QA_TIMER_SERVICE_H_
+#define _QA_TIMER_SERVICE_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/TestCase.h>
+#include <string>
+#include <vector>
+
+class qa_timer_service : public CppUnit::TestCase
+{
+ public:
+  CPPUNIT_TEST_SUITE(qa_timer_service);
+  CPPUNIT_TEST(t1_virtual_repeat_run);
+  CPPUNIT_TEST(t2_clock_reads_do_not_hold);
+  CPPUNIT_TEST(t3_held_clock_waits);
+  CPPUNIT_TEST_SUITE_END();
+
+ private:
+  void t1_virtual_repeat_run();
+  void t2_clock_reads_do_not_hold();
+  void t3_held_clock_waits();
+  // stop-and-wait over a lossy link on virtual time, one line per event
+  void arq_run(std::vector<std::string>& events);
+};
+
+#endif /* _QA_TIMER_SERVICE_H_ */
@@ -0,0 +1,110 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "rtt_estimator.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace gr {
+  namespace lsa {
+    static const double d_alpha = 0.125;
+    static const double d_beta = 0.25;
+    // clock granularity
+    static const double d_granularity = 1.0;
+    static const pmt::pmt_t d_rto_key = pmt::intern("rto");
+    static const pmt::pmt_t d_srtt_key = pmt::intern("srtt");
+    static const pmt::pmt_t d_rttvar_key = pmt::intern("rttvar");
+
+    rtt_estimator::rtt_estimator(double initial_rto, double min_rto, double max_rto)
+      : d_min_rto(min_rto),
+        d_max_rto(max_rto)
+    {
+      if(min_rto<=0 || max_rto<min_rto){
+        throw std::invalid_argument("Timeout bounds should be positive and ordered");
+      }
+      reset(initial_rto);
+    }
+
+    double
+    rtt_estimator::clamp(double rto) const
+    {
+      return std::min(std::max(rto,d_min_rto),d_max_rto);
+    }
+
+    void
+    rtt_estimator::sample(double rtt)
+    {
+      if(rtt<0){
+        return;
+      }
+      if(!d_has_sample){
+        d_srtt = rtt;
+        d_rttvar = rtt/2.0;
+        d_has_sample = true;
+      }else{
+        d_rttvar = (1.0-d_beta)*d_rttvar+d_beta*std::fabs(d_srtt-rtt);
+        d_srtt = (1.0-d_alpha)*d_srtt+d_alpha*rtt;
+      }
+      d_rto = clamp(d_srtt+std::max(d_granularity,4.0*d_rttvar));
+    }
+
+    bool
+    rtt_estimator::acked(double rtt, int retries)
+    {
+      // the ack of a retransmitted frame may belong to any of its copies
+      if(retries!=0){
+        return false;
+      }
+      sample(rtt);
+      return true;
+    }
+
+    void
+    rtt_estimator::backoff()
+    {
+      d_rto = clamp(2.0*d_rto);
+    }
+
+    void
+    rtt_estimator::reset(double initial_rto)
+    {
+      d_has_sample = false;
+      d_srtt = 0;
+      d_rttvar = 0;
+      d_rto = clamp(initial_rto);
+    }
+
+    pmt::pmt_t
+    rtt_estimator::stats() const
+    {
+      pmt::pmt_t dict = pmt::make_dict();
+      dict = pmt::dict_add(dict,d_rto_key,pmt::from_double(d_rto));
+      dict = pmt::dict_add(dict,d_srtt_key,pmt::from_double(d_srtt));
+      dict = pmt::dict_add(dict,d_rttvar_key,pmt::from_double(d_rttvar));
+      return dict;
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
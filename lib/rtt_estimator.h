@@ -0,0 +1,67 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_RTT_ESTIMATOR_H
+#define INCLUDED_LSA_RTT_ESTIMATOR_H
+
+#include <pmt/pmt.h>
+
+namespace gr {
+  namespace lsa {
+
+    /*
+     * Retransmission timeout from measured round trip times, RFC 6298.
+     *
+     * SRTT and RTTVAR are smoothed with gains 1/8 and 1/4 and the RTO is
+     * SRTT+4*RTTVAR, clamped to [min, max]. Every timeout doubles the RTO
+     * until the next sample. acked() applies Karn's rule: only frames
+     * acknowledged on their first transmission are sampled, so a backed
+     * off RTO stays until one is. All times are in milliseconds.
+     */
+    class rtt_estimator
+    {
+     public:
+      rtt_estimator(double initial_rto, double min_rto, double max_rto);
+      void sample(double rtt);
+      // an acknowledgement after retries retransmissions, true if sampled
+      bool acked(double rtt, int retries);
+      void backoff();
+      // forget the samples, start over from initial_rto
+      void reset(double initial_rto);
+      double rto() const{return d_rto;}
+      double srtt() const{return d_srtt;}
+      double rttvar() const{return d_rttvar;}
+      // dict of rto, srtt and rttvar for a stats port
+      pmt::pmt_t stats() const;
+     private:
+      double clamp(double rto) const;
+
+      const double d_min_rto;
+      const double d_max_rto;
+      bool d_has_sample;
+      double d_srtt;
+      double d_rttvar;
+      double d_rto;
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_RTT_ESTIMATOR_H */
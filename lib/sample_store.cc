@@ -0,0 +1,252 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sample_store.h"
+#include <volk/volk.h>
+#include <stdexcept>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define LSA_HAVE_F16C
+#endif
+
+namespace gr {
+  namespace lsa {
+    const float sample_store::STORE_GAIN_MAX = 16777216.0f; // 2^24
+    const float sample_store::STORE_GAIN_MIN = 1.0f/65536.0f;
+
+#ifdef LSA_HAVE_F16C
+    // built for F16C whatever the compiler flags, run only if the cpu has it
+    __attribute__((target("avx,f16c")))
+    static size_t
+    f16c_to_half(uint16_t* out, const float* in, size_t n)
+    {
+      size_t i=0;
+      for(;i+8<=n;i+=8){
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in+i),_MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i*)(out+i),h);
+      }
+      return i;
+    }
+
+    __attribute__((target("avx,f16c")))
+    static size_t
+    f16c_to_float(float* out, const uint16_t* in, size_t n)
+    {
+      size_t i=0;
+      for(;i+8<=n;i+=8){
+        __m128i h = _mm_loadu_si128((const __m128i*)(in+i));
+        _mm256_storeu_ps(out+i,_mm256_cvtph_ps(h));
+      }
+      return i;
+    }
+#endif
+
+    sample_store::sample_store(size_t cap, int format)
+      : d_cap(cap),
+        d_format(format),
+        d_gain((cap+STORE_BLOCK-1)/STORE_BLOCK,STORE_GAIN_MAX),
+        d_f16c(false)
+    {
+      switch(format){
+        case STORE_FC32:
+          d_item_size = sizeof(gr_complex);
+        break;
+        case STORE_SC16:
+        case STORE_FP16:
+          d_item_size = 2*sizeof(int16_t);
+        break;
+        default:
+          throw std::invalid_argument("Undefined sample storage format");
+        break;
+      }
+#ifdef LSA_HAVE_F16C
+      __builtin_cpu_init();
+      d_f16c = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+#endif
+      d_mem = volk_malloc(d_item_size*d_cap,volk_get_alignment());
+      if(d_mem==NULL){
+        throw std::bad_alloc();
+      }
+      d_fc32 = (gr_complex*) d_mem;
+      d_sc16 = (int16_t*) d_mem;
+      d_fp16 = (uint16_t*) d_mem;
+    }
+
+    sample_store::~sample_store()
+    {
+      volk_free(d_mem);
+    }
+
+    float
+    sample_store::gain_for(float peak)
+    {
+      if(!(peak*STORE_GAIN_MAX>32767.0f)){
+        return STORE_GAIN_MAX;
+      }
+      int exp;
+      std::frexp(32767.0f/peak,&exp);
+      return std::max(std::ldexp(1.0f,exp-1),STORE_GAIN_MIN);
+    }
+
+    void
+    sample_store::lower(size_t blk, size_t end, float gain)
+    {
+      if(gain>=d_gain[blk]){
+        return;
+      }
+      int shift = std::ilogb(d_gain[blk])-std::ilogb(gain);
+      d_gain[blk] = gain;
+      int16_t* v = d_sc16+2*blk*STORE_BLOCK;
+      const size_t n = 2*(end-blk*STORE_BLOCK);
+      if(shift>=16){
+        memset(v,0,n*sizeof(int16_t));
+        return;
+      }
+      // power of two ratio, a rounding shift
+      const int32_t half = 1<<(shift-1);
+      for(size_t i=0;i<n;++i){
+        v[i] = (int16_t)((v[i]+half)>>shift);
+      }
+    }
+
+    void
+    sample_store::write(size_t idx, const gr_complex* in, size_t n)
+    {
+      const float* fin = (const float*) in;
+      switch(d_format){
+        case STORE_SC16:
+          // one scale per block segment
+          while(n>0){
+            const size_t blk = idx/STORE_BLOCK;
+            const size_t cnt = std::min(n,(blk+1)*STORE_BLOCK-idx);
+            float peak = 0;
+            for(size_t i=0;i<2*cnt;++i){
+              peak = std::max(peak,std::fabs(fin[i]));
+            }
+            if(idx%STORE_BLOCK==0){
+              d_gain[blk] = gain_for(peak);
+            }else{
+              lower(blk,idx,gain_for(peak));
+            }
+            volk_32f_s32f_convert_16i(d_sc16+2*idx,fin,d_gain[blk],2*cnt);
+            idx+=cnt;
+            fin+=2*cnt;
+            n-=cnt;
+          }
+        break;
+        case STORE_FP16:
+        {
+          size_t i=0;
+#ifdef LSA_HAVE_F16C
+          if(d_f16c){
+            i = f16c_to_half(d_fp16+2*idx,fin,2*n);
+          }
+#endif
+          for(;i<2*n;++i){
+            d_fp16[2*idx+i] = float_to_half(fin[i]);
+          }
+        }
+        break;
+        default:
+          memcpy(d_fc32+idx,in,sizeof(gr_complex)*n);
+        break;
+      }
+    }
+
+    void
+    sample_store::read(gr_complex* out, size_t idx, size_t n) const
+    {
+      float* fout = (float*) out;
+      switch(d_format){
+        case STORE_SC16:
+          while(n>0){
+            const size_t blk = idx/STORE_BLOCK;
+            const size_t cnt = std::min(n,(blk+1)*STORE_BLOCK-idx);
+            volk_16i_s32f_convert_32f(fout,d_sc16+2*idx,d_gain[blk],2*cnt);
+            idx+=cnt;
+            fout+=2*cnt;
+            n-=cnt;
+          }
+        break;
+        case STORE_FP16:
+        {
+          size_t i=0;
+#ifdef LSA_HAVE_F16C
+          if(d_f16c){
+            i = f16c_to_float(fout,d_fp16+2*idx,2*n);
+          }
+#endif
+          for(;i<2*n;++i){
+            fout[i] = half_to_float(d_fp16[2*idx+i]);
+          }
+        }
+        break;
+        default:
+          memcpy(out,d_fc32+idx,sizeof(gr_complex)*n);
+        break;
+      }
+    }
+
+    void
+    sample_store::copy(size_t idx, const sample_store& src, size_t src_idx, size_t n)
+    {
+      if(src.d_format!=d_format){
+        throw std::invalid_argument("Sample stores have different formats");
+      }
+      if(d_format!=STORE_SC16){
+        memmove((uint8_t*)d_mem+idx*d_item_size,(const uint8_t*)src.d_mem+src_idx*d_item_size,n*d_item_size);
+        return;
+      }
+      // pieces within one block of either store, rescaled to the coarser scale
+      while(n>0){
+        const size_t blk = idx/STORE_BLOCK;
+        const size_t src_blk = src_idx/STORE_BLOCK;
+        const size_t cnt = std::min(n,std::min((blk+1)*STORE_BLOCK-idx,(src_blk+1)*STORE_BLOCK-src_idx));
+        const float src_gain = src.d_gain[src_blk];
+        if(idx%STORE_BLOCK==0){
+          d_gain[blk] = src_gain;
+        }else{
+          lower(blk,idx,src_gain);
+        }
+        const int16_t* v = src.d_sc16+2*src_idx;
+        int16_t* o = d_sc16+2*idx;
+        const int shift = std::ilogb(src_gain)-std::ilogb(d_gain[blk]);
+        if(shift==0){
+          memmove(o,v,2*cnt*sizeof(int16_t));
+        }else if(shift>=16){
+          memset(o,0,2*cnt*sizeof(int16_t));
+        }else{
+          const int32_t half = 1<<(shift-1);
+          for(size_t i=0;i<2*cnt;++i){
+            o[i] = (int16_t)((v[i]+half)>>shift);
+          }
+        }
+        idx+=cnt;
+        src_idx+=cnt;
+        n-=cnt;
+      }
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
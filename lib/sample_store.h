@@ -0,0 +1,181 @@
+/* -*- c++ -*- */
+/* 
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ * 
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_LSA_SAMPLE_STORE_H
+#define INCLUDED_LSA_SAMPLE_STORE_H
+
+#include <gnuradio/gr_complex.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+namespace gr {
+  namespace lsa {
+    // storage formats of long-lived sample buffers
+    enum SAMPLEFORMAT{
+      STORE_FC32=0,
+      STORE_SC16=1,
+      STORE_FP16=2
+    };
+
+    static inline uint16_t float_to_half(float f)
+    {
+      uint32_t x;
+      memcpy(&x,&f,4);
+      uint32_t sign = (x>>16) & 0x8000;
+      int32_t exp = ((x>>23) & 0xff) - 127 + 15;
+      uint32_t man = x & 0x007fffff;
+      if(exp<=0){
+        // subnormal or zero in half precision
+        if(exp<-10){
+          return sign;
+        }
+        man |= 0x00800000;
+        uint32_t shift = 14-exp;
+        uint32_t half = man>>shift;
+        uint32_t rem = man & ((1u<<shift)-1);
+        uint32_t mid = 1u<<(shift-1);
+        if(rem>mid || (rem==mid && (half&0x1))){
+          half++;
+        }
+        return sign | half;
+      }else if(exp>=0x1f){
+        // overflow saturates to inf, nan keeps a payload bit
+        return (((x>>23)&0xff)==0xff && man)? (sign|0x7e00) : (sign|0x7c00);
+      }
+      uint32_t half = sign | (exp<<10) | (man>>13);
+      uint32_t rem = man & 0x1fff;
+      if(rem>0x1000 || (rem==0x1000 && (half&0x1))){
+        half++;
+      }
+      return half;
+    }
+
+    static inline float half_to_float(uint16_t h)
+    {
+      uint32_t sign = (uint32_t)(h&0x8000)<<16;
+      uint32_t exp = (h>>10) & 0x1f;
+      uint32_t man = h & 0x03ff;
+      uint32_t x;
+      if(exp==0){
+        if(man==0){
+          x = sign;
+        }else{
+          // normalize subnormal
+          exp = 127-15+1;
+          while(!(man&0x0400)){
+            man<<=1;
+            exp--;
+          }
+          x = sign | (exp<<23) | ((man&0x03ff)<<13);
+        }
+      }else if(exp==0x1f){
+        x = sign | 0x7f800000 | (man<<13);
+      }else{
+        x = sign | ((exp-15+127)<<23) | (man<<13);
+      }
+      float f;
+      memcpy(&f,&x,4);
+      return f;
+    }
+
+    // samples sharing one int16 scale
+    #define STORE_BLOCK 256
+
+    /*!
+     * Sample memory kept either as gr_complex or in a compact format,
+     * interleaved int16 or IEEE half precision. Spans are converted back
+     * to gr_complex on read.
+     *
+     * Every block of STORE_BLOCK int16 samples has its own power of two
+     * scale, set from the peak of the block so that weak bursts keep
+     * their resolution and strong ones do not clip. Blocks are written
+     * front to back, a block written from its first sample starts with
+     * the finest scale and a stronger sample lowers it, shifting the
+     * samples already in the block.
+     */
+    class sample_store
+    {
+     public:
+      sample_store(size_t cap, int format);
+      ~sample_store();
+      size_t capacity() const{return d_cap;}
+      int format() const{return d_format;}
+      size_t bytes() const{return d_cap*d_item_size;}
+      inline void put(size_t idx, const gr_complex& s)
+      {
+        switch(d_format){
+          case STORE_SC16:
+          {
+            const size_t blk = idx/STORE_BLOCK;
+            if(idx%STORE_BLOCK==0){
+              d_gain[blk] = STORE_GAIN_MAX;
+            }
+            const float peak = std::max(std::fabs(s.real()),std::fabs(s.imag()));
+            if(peak*d_gain[blk]>32767.0f){
+              lower(blk,idx,gain_for(peak));
+            }
+            d_sc16[2*idx] = to_sc16(s.real(),d_gain[blk]);
+            d_sc16[2*idx+1] = to_sc16(s.imag(),d_gain[blk]);
+          }
+          break;
+          case STORE_FP16:
+            d_fp16[2*idx] = float_to_half(s.real());
+            d_fp16[2*idx+1] = float_to_half(s.imag());
+          break;
+          default:
+            d_fc32[idx] = s;
+          break;
+        }
+      }
+      void write(size_t idx, const gr_complex* in, size_t n);
+      void read(gr_complex* out, size_t idx, size_t n) const;
+      // raw copy between stores of the same format
+      void copy(size_t idx, const sample_store& src, size_t src_idx, size_t n);
+     private:
+      static const float STORE_GAIN_MAX;
+      static const float STORE_GAIN_MIN;
+      static inline int16_t to_sc16(float f, float gain)
+      {
+        float v = f*gain;
+        v = (v>32767.0f)? 32767.0f : (v<-32768.0f)? -32768.0f : v;
+        return (int16_t)((v<0)? v-0.5f : v+0.5f);
+      }
+      // largest power of two scale that holds peak
+      static float gain_for(float peak);
+      // scales block blk down to gain, samples [blk*STORE_BLOCK,end) are kept
+      void lower(size_t blk, size_t end, float gain);
+      const size_t d_cap;
+      const int d_format;
+      size_t d_item_size;
+      void* d_mem;
+      gr_complex* d_fc32;
+      int16_t* d_sc16;
+      uint16_t* d_fp16;
+      std::vector<float> d_gain;
+      bool d_f16c;
+    };
+
+  } // namespace lsa
+} // namespace gr
+
+#endif /* INCLUDED_LSA_SAMPLE_STORE_H */
@@ -24,6 +24,8 @@
 
 #include <gnuradio/io_signature.h>
 #include <lsa/simple_rx.h>
+#include "block_ack.h"
+#include <algorithm>
 #include <gnuradio/block_detail.h>
 
 namespace gr {
@@ -34,18 +36,30 @@ namespace gr {
     #define RESETLIMIT 5
     #define MAXLEN 123
     #define MINLEN 4
+    static const pmt::pmt_t d_seqno_key = pmt::intern("seqno");
+    static const pmt::pmt_t d_pwr_key = pmt::intern("pwr");
+    // pdu_out carries the received blob, the sequence field is skipped
+    static const pmt::pmt_t d_pdu_meta = pmt::dict_add(pmt::make_dict(),pmt::intern("offset"),pmt::from_long(SEQLEN));
 
     class simple_rx_impl : public simple_rx
     {
       public:
-        simple_rx_impl():block("simple_rx",
+        simple_rx_impl(int window, int ack_period):block("simple_rx",
                 gr::io_signature::make(0,0,0),
                 gr::io_signature::make(0,0,0)),
                 d_in_port(pmt::mp("pdu_in")),
                 d_pwr_port(pmt::mp("pwr_in")),
                 d_out_port(pmt::mp("ack_out")),
-                d_pdu_port(pmt::mp("pdu_out"))
+                d_pdu_port(pmt::mp("pdu_out")),
+                d_window(window),
+                d_ack_period(ack_period)
         {
+          if(window<0 || window>BLOCK_ACK_WINDOW){
+            throw std::invalid_argument("Window should be between 0 and 64");
+          }
+          if(window>0 && ack_period<=0){
+            throw std::invalid_argument("Block ACK period should be positive");
+          }
           reset();
           message_port_register_in(d_in_port);
           message_port_register_in(d_pwr_port);
@@ -53,11 +67,39 @@ namespace gr {
           message_port_register_out(d_pdu_port);
           set_msg_handler(d_in_port,boost::bind(&simple_rx_impl::msg_in,this,_1));
           set_msg_handler(d_pwr_port,boost::bind(&simple_rx_impl::pwr_in,this,_1));
+          d_clock = mac_clock::wall();
           d_pwr_tag = pmt::from_float(0);
         }
-        ~simple_rx_impl(){}
+        ~simple_rx_impl()
+        {
+          d_clock->detach(this);
+        }
+        void set_clock(const mac_clock::sptr& clock)
+        {
+          if(!clock){
+            throw std::invalid_argument("Clock cannot be null");
+          }
+          d_clock->detach(this);
+          d_clock = clock;
+          d_clock->attach(this);
+        }
+        bool start()
+        {
+          if(d_window>0){
+            d_clock->timers().schedule_every(this,d_ack_period,d_ack_period,
+              boost::bind(&simple_rx_impl::block_ack_timer,this));
+          }
+          d_clock->started(this);
+          return block::start();
+        }
+        bool stop()
+        {
+          d_clock->timers().cancel_all(this);
+          return block::stop();
+        }
         void pwr_in(pmt::pmt_t pwr)
         {
+          mac_clock::scoped_handler handled(d_clock,this,pwr);
           gr::thread::scoped_lock guard(d_mutex);
           pmt::pmt_t k = pmt::car(pwr);
           pmt::pmt_t v = pmt::cdr(pwr);
@@ -69,6 +111,7 @@ namespace gr {
         }
         void msg_in(pmt::pmt_t msg)
         {
+          mac_clock::scoped_handler handled(d_clock,this,msg);
           gr::thread::scoped_lock guard(d_mutex);
           pmt::pmt_t k = pmt::car(msg);
           pmt::pmt_t v = pmt::cdr(msg);
@@ -82,7 +125,10 @@ namespace gr {
             base1|= uvec[1];
             base2 = uvec[2]<<8;
             base2|= uvec[3];
-            if(base1 == base2){
+            if(base1 == base2 && d_window>0){
+              DEBUG<<"<SIMPLE RX>Received valid seqno:"<<base1<<std::endl;
+              selective_repeat(base1,v);
+            }else if(base1 == base2){
               DEBUG<<"<SIMPLE RX>Received valid seqno:"<<base1<<std::endl;
               // crc passed
               const uint8_t* u8 = (const uint8_t*) &base1;
@@ -91,7 +137,9 @@ namespace gr {
               d_buf[2] = u8[1];
               d_buf[3] = u8[0];
               pmt::pmt_t msg_out = pmt::make_blob(d_buf,SEQLEN);
-              message_port_pub(d_out_port,pmt::cons(pmt::PMT_NIL,msg_out));
+              pmt::pmt_t out = pmt::cons(pmt::PMT_NIL,msg_out);
+              d_clock->sent(this,d_out_port,out);
+              message_port_pub(d_out_port,out);
               d_reset_cnt++;
               if(d_reset_cnt>=RESETLIMIT || base1 == d_expect_seq){
                 DEBUG<<"<SIMPLE RX>Increase seq number to:"<<base1<<" ,reset_cnt:"<<d_reset_cnt<<std::endl;
@@ -99,12 +147,12 @@ namespace gr {
                 // sync to this number
                 d_rx_seq = base1;
                 d_expect_seq = (base1==0xffff)? 0:base1+1;
-                pmt::pmt_t pdu_out = pmt::make_blob(uvec+SEQLEN,io-SEQLEN);
-                pmt::pmt_t dict = pmt::make_dict();
-                dict = pmt::dict_add(dict,pmt::intern("seqno"),pmt::from_long(base1));
-                dict = pmt::dict_add(dict,pmt::intern("pwr"),d_pwr_tag);
+                pmt::pmt_t dict = pmt::dict_add(d_pdu_meta,d_seqno_key,pmt::from_long(base1));
+                dict = pmt::dict_add(dict,d_pwr_key,d_pwr_tag);
                 // export valid pdu only...
-                message_port_pub(d_pdu_port,pmt::cons(dict,pdu_out));
+                pmt::pmt_t out = pmt::cons(dict,v);
+                d_clock->sent(this,d_pdu_port,out);
+                message_port_pub(d_pdu_port,out);
               }
             }
           }
@@ -115,12 +163,87 @@ namespace gr {
           d_expect_seq =0;
           d_rx_seq=0;
           d_reset_cnt=0;
+          d_ba_valid = false;
+          d_ba_base = 0;
+          d_ba_bitmap = 0;
+          d_ba_new = 0;
+        }
+        void send_ack(uint16_t seq)
+        {
+          d_buf[0] = (unsigned char)(seq>>8);
+          d_buf[1] = (unsigned char)(seq&0xff);
+          d_buf[2] = d_buf[0];
+          d_buf[3] = d_buf[1];
+          pmt::pmt_t out = pmt::cons(pmt::PMT_NIL,pmt::make_blob(d_buf,SEQLEN));
+          d_clock->sent(this,d_out_port,out);
+          message_port_pub(d_out_port,out);
+        }
+        void send_block_ack()
+        {
+          block_ack_pack(d_ba_base,d_ba_bitmap,d_buf);
+          pmt::pmt_t out = pmt::cons(pmt::PMT_NIL,pmt::make_blob(d_buf,BLOCK_ACK_LEN));
+          d_clock->sent(this,d_out_port,out);
+          message_port_pub(d_out_port,out);
+          d_ba_new = 0;
+        }
+        /*
+         * Scoreboard of the last d_window sequence numbers. The window only
+         * slides when a frame falls beyond it, so every block ACK repeats
+         * the frames still in the window and a lost block ACK costs no
+         * retransmission once the next one gets through.
+         */
+        void selective_repeat(uint16_t seq, const pmt::pmt_t& blob)
+        {
+          if(!d_ba_valid){
+            d_ba_base = seq;
+            d_ba_bitmap = 0;
+            d_ba_valid = true;
+          }
+          uint16_t offset = seq-d_ba_base;
+          if(offset>=0x8000){
+            // behind the window, may be a duplicate so it is acked only
+            send_ack(seq);
+            return;
+          }
+          if(offset>=d_window){
+            uint16_t shift = offset-d_window+1;
+            d_ba_bitmap = (shift>=BLOCK_ACK_WINDOW)? 0 : d_ba_bitmap>>shift;
+            d_ba_base += shift;
+            offset = d_window-1;
+          }
+          const uint64_t bit = ((uint64_t)1)<<offset;
+          if(!(d_ba_bitmap&bit)){
+            d_ba_bitmap |= bit;
+            pmt::pmt_t dict = pmt::dict_add(d_pdu_meta,d_seqno_key,pmt::from_long(seq));
+            dict = pmt::dict_add(dict,d_pwr_key,d_pwr_tag);
+            pmt::pmt_t out = pmt::cons(dict,blob);
+            d_clock->sent(this,d_pdu_port,out);
+            message_port_pub(d_pdu_port,out);
+          }
+          // do not let the transmitter window stall until the next period
+          if(++d_ba_new>=std::max(1,d_window/2)){
+            send_block_ack();
+          }
+        }
+        void block_ack_timer()
+        {
+          gr::thread::scoped_lock guard(d_mutex);
+          if(d_ba_new>0){
+            send_block_ack();
+          }
         }
         gr::thread::mutex d_mutex;
+        mac_clock::sptr d_clock;
         const pmt::pmt_t d_in_port;
         const pmt::pmt_t d_pwr_port;
         const pmt::pmt_t d_out_port;
         const pmt::pmt_t d_pdu_port;
+        const int d_window;
+        const long d_ack_period;
+        bool d_ba_valid;
+        uint16_t d_ba_base;
+        uint64_t d_ba_bitmap;
+        int d_ba_new;
         pmt::pmt_t d_pwr_tag;
         uint16_t d_rx_seq;
         uint16_t d_expect_seq;
@@ -128,9 +251,9 @@ namespace gr {
         unsigned char d_buf[256];
     };
     simple_rx::sptr 
-    simple_rx::make()
+    simple_rx::make(int window, int ack_period)
     {
-      return gnuradio::get_initial_sptr(new simple_rx_impl());
+      return gnuradio::get_initial_sptr(new simple_rx_impl(window,ack_period));
     }
 
   } /* namespace lsa */
@@ -24,8 +24,10 @@
 
 #include <gnuradio/io_signature.h>
 #include <lsa/simple_tx.h>
+#include "rtt_estimator.h"
+#include "utils.h"
 #include <gnuradio/block_detail.h>
-#include <fstream>
+#include <lsa/payload_corpus.h>
 
 namespace gr {
   namespace lsa {
@@ -39,53 +41,74 @@ namespace gr {
     class simple_tx_impl : public simple_tx
     {
       public:
-        simple_tx_impl(const std::string& filename, float timeout,bool slow, bool verb): block("simple_tx",
+        simple_tx_impl(const std::string& filename, float timeout,bool slow, bool verb,
+          float min_timeout, float max_timeout, bool aggregate): block("simple_tx",
                   gr::io_signature::make(0,0,0),
                   gr::io_signature::make(0,0,0)),
-                  d_timeout(timeout),
                   d_retry_limit(RETRYLIMIT),
                   d_in_port(pmt::mp("ack_in")),
-                  d_out_port(pmt::mp("pdu_out"))
+                  d_out_port(pmt::mp("pdu_out")),
+                  d_stats_port(pmt::mp("stats_out")),
+                  d_aggregate(aggregate),
+                  d_rtt(timeout,min_timeout,max_timeout)
         {
           if(timeout<=0){
             throw std::invalid_argument("Timeout should be positive");
           }
-          d_data_src.clear();
           if(!read_data(filename)){
             throw std::runtime_error("File cannot be opened");
           }
           message_port_register_in(d_in_port);
           message_port_register_out(d_out_port);
+          message_port_register_out(d_stats_port);
           set_msg_handler(d_in_port,boost::bind(&simple_tx_impl::msg_in,this,_1));
+          d_clock = mac_clock::wall();
           d_seqno = 0;
           d_slow = slow;
           d_verb = verb;
           d_pkt_success_cnt=0;
           d_pkt_failed_cnt=0;
+          d_acked = false;
+          d_timer = 0;
+        }
+        ~simple_tx_impl()
+        {
+          d_clock->detach(this);
+        }
+        void set_clock(const mac_clock::sptr& clock)
+        {
+          if(!clock){
+            throw std::invalid_argument("Clock cannot be null");
+          }
+          d_clock->detach(this);
+          d_clock = clock;
+          d_clock->attach(this);
         }
-        ~simple_tx_impl(){}
         bool start()
         {
+          gr::thread::scoped_lock guard(d_mutex);
           d_finished = false;
-          d_system_time = boost::posix_time::second_clock::local_time();
-          d_thread = boost::shared_ptr<gr::thread::thread>
-            (new gr::thread::thread(boost::bind(&simple_tx_impl::run,this)));
-          d_status_thread = boost::shared_ptr<gr::thread::thread>
-            (new gr::thread::thread(boost::bind(&simple_tx_impl::status,this)));
+          d_system_time = d_clock->now_us();
+          d_clock->timers().schedule_every(this,STATUSMS,STATUSMS,
+            boost::bind(&simple_tx_impl::status,this));
+          d_retry_cnt = 0;
+          send();
+          d_clock->started(this);
           return block::start();
 
         }
         bool stop()
         {
-          d_finished = true;
-          d_thread->interrupt();
-          d_status_thread->interrupt();
-          d_thread->join();
-          d_status_thread->join();
+          {
+            gr::thread::scoped_lock guard(d_mutex);
+            d_finished = true;
+          }
+          d_clock->timers().cancel_all(this);
           return block::stop();
         }
         void msg_in(pmt::pmt_t msg)
         {
+          mac_clock::scoped_handler handled(d_clock,this,msg);
           gr::thread::scoped_lock guard(d_mutex);
           pmt::pmt_t k = pmt::car(msg);
           pmt::pmt_t v = pmt::cdr(msg);
@@ -100,11 +123,13 @@ namespace gr {
             base2|= uvec[3];
             if(base1==base2){
               // crc passed
-              if(base1 == d_seqno){
-                if(!d_slow){
-                  d_ack_received.notify_one();
-                }
+              if(base1 == d_seqno && !d_acked){
+                d_ack_time = d_clock->now_us();
                 d_acked = true;
+                // otherwise the timeout callback is already on its way
+                if(!d_slow && d_clock->timers().cancel(d_timer)){
+                  complete();
+                }
               }
             }
           }
@@ -113,105 +138,110 @@ namespace gr {
         bool read_data(const std::string& filename)
         {
           gr::thread::scoped_lock guard(d_mutex);
-          std::string str,line;
-          d_file.open(filename.c_str(),std::fstream::in);
-          if(!d_file.is_open()){
+          if(!d_data_src.open(filename)){
             return false;
           }
-          while(getline(d_file,line,'\n')){
-            std::istringstream temp(line);
-            std::vector<uint8_t> u8;
-            while(getline(temp,str,',')){
-              int tmp = std::atoi(str.c_str());
-              if(u8.size()>MAXLEN){
-                throw std::runtime_error("message to be transmitted exceed the maximum payload length");
-              }
-              u8.push_back((uint8_t)tmp);
-            }
-            d_data_src.push_back(u8);
+          if(d_data_src.max_length()>MAXLEN){
+            throw std::runtime_error("message to be transmitted exceed the maximum payload length");
+          }
+          if(d_aggregate){
+            d_data_src.aggregate(MAX_LSA_PAYLOAD-SEQLEN);
           }
-          d_file.close();
-          return true;
+          return !d_data_src.empty();
         }
         void status()
         {
-          while(!d_finished){
-            boost::this_thread::sleep(boost::posix_time::milliseconds(10000));
-            if(d_finished){
-              return;
-            }
-            boost::posix_time::time_duration diff = boost::posix_time::second_clock::local_time()-d_system_time;
-            VERBOSE<<"<Simple TX>Time(sec):"<<diff.total_seconds()<<" ,success:"<<d_pkt_success_cnt<<" ,failed:"<<d_pkt_failed_cnt<<std::endl;
+          uint64_t diff = d_clock->now_us()-d_system_time;
+          VERBOSE<<"<Simple TX>Time(sec):"<<diff/1000000<<" ,success:"<<d_pkt_success_cnt<<" ,failed:"<<d_pkt_failed_cnt<<std::endl;
+        }
+        // with d_mutex held
+        void send()
+        {
+          if(d_finished){
+            return;
           }
+          DEBUG<<"<SIMPLE TX>sending seq:"<<d_seqno<<std::endl;
+          d_acked = false;
+          generate_msg();
+          d_sent_time = d_clock->now_us();
+          d_clock->sent(this,d_out_port,d_current_msg);
+          message_port_pub(d_out_port,d_current_msg);
+          d_retry_cnt++;
+          d_timer = d_clock->timers().schedule(this,d_rtt.rto(),
+            boost::bind(&simple_tx_impl::timeout,this));
         }
-        void run()
+        void timeout()
         {
-          int retry =0;
-          while(!d_finished){
-            DEBUG<<"<SIMPLE TX>sending seq:"<<d_seqno<<std::endl;
-            d_acked = false;
-            generate_msg();
-            message_port_pub(d_out_port,d_current_msg);
-            retry++;
-            gr::thread::scoped_lock lock(d_mutex);
-            d_ack_received.timed_wait(lock,boost::posix_time::milliseconds(d_timeout));
-            lock.unlock();
-            if(d_finished){
-              return;
-            }
-            if(d_acked || retry>=d_retry_limit){
-              // successfully acked or exceed retry limit
-              if(d_acked){
-                d_pkt_success_cnt++;
-                d_pkt_failed_cnt = (retry>1)? d_pkt_failed_cnt+retry-1:d_pkt_failed_cnt;
-                DEBUG<<"<SIMPLE TX>Acked"<<std::endl;
-              }else{
-                d_pkt_failed_cnt += retry;
-                DEBUG<<"Exceed retry limit"<<std::endl;
-              }
-              retry=0;
-              d_seqno = (d_seqno == 0xffff)? 0 : d_seqno+1;
+          gr::thread::scoped_lock guard(d_mutex);
+          complete();
+        }
+        // acked or timed out, with d_mutex held
+        void complete()
+        {
+          if(d_acked){
+            d_rtt.acked((d_ack_time-d_sent_time)/1000.0,d_retry_cnt-1);
+          }else{
+            d_rtt.backoff();
+          }
+          pmt::pmt_t out = pmt::cons(d_rtt.stats(),pmt::PMT_NIL);
+          d_clock->sent(this,d_stats_port,out);
+          message_port_pub(d_stats_port,out);
+          if(d_acked || d_retry_cnt>=d_retry_limit){
+            // successfully acked or exceed retry limit
+            if(d_acked){
+              d_pkt_success_cnt++;
+              d_pkt_failed_cnt = (d_retry_cnt>1)? d_pkt_failed_cnt+d_retry_cnt-1:d_pkt_failed_cnt;
+              DEBUG<<"<SIMPLE TX>Acked"<<std::endl;
+            }else{
+              d_pkt_failed_cnt += d_retry_cnt;
+              DEBUG<<"Exceed retry limit"<<std::endl;
             }
+            d_retry_cnt=0;
+            d_seqno = (d_seqno == 0xffff)? 0 : d_seqno+1;
           }
+          send();
         }
-        
+
         void generate_msg(){
-          gr::thread::scoped_lock guard(d_mutex);
           const uint8_t* u8_seq = (const uint8_t*) &d_seqno;
           d_buf[0] = u8_seq[1];
           d_buf[1] = u8_seq[0];
           d_buf[2] = u8_seq[1];
           d_buf[3] = u8_seq[0];
-          memcpy(d_buf+SEQLEN,d_data_src[d_seqno].data(),sizeof(char)*d_data_src[d_seqno].size());
-          pmt::pmt_t blob = pmt::make_blob(d_buf,SEQLEN+d_data_src[d_seqno].size());
+          const size_t idx = d_seqno%d_data_src.size();
+          memcpy(d_buf+SEQLEN,d_data_src.data(idx),sizeof(char)*d_data_src.length(idx));
+          pmt::pmt_t blob = pmt::make_blob(d_buf,SEQLEN+d_data_src.length(idx));
           d_current_msg = pmt::cons(pmt::PMT_NIL,blob);
         }
         const int d_retry_limit;
         const pmt::pmt_t d_in_port;
         const pmt::pmt_t d_out_port;
+        const pmt::pmt_t d_stats_port;
+        const bool d_aggregate;
         gr::thread::mutex d_mutex;
-        gr::thread::condition_variable d_ack_received;
-        boost::shared_ptr<gr::thread::thread> d_thread;
-        boost::shared_ptr<gr::thread::thread> d_status_thread;
-        boost::posix_time::ptime d_system_time;
+        mac_clock::sptr d_clock;
+        timer_service::timer_id d_timer;
+        uint64_t d_system_time;
+        uint64_t d_sent_time;
+        uint64_t d_ack_time;
         bool d_finished;
         bool d_acked;
         bool d_slow;
         bool d_verb;
         int d_retry_cnt;
         uint16_t d_seqno;
-        float d_timeout;
+        rtt_estimator d_rtt;
         pmt::pmt_t d_current_msg;
-        std::fstream d_file;
-        std::vector< std::vector<unsigned char> > d_data_src;
+        payload_corpus d_data_src;
         unsigned char d_buf[256];
         long int d_pkt_success_cnt;
         long int d_pkt_failed_cnt;
     };
     simple_tx::sptr
-    simple_tx::make(const std::string& filename,float timeout,bool slow,bool verb)
+    simple_tx::make(const std::string& filename,float timeout,bool slow,bool verb,
+      float min_timeout,float max_timeout,bool aggregate)
     {
-      return gnuradio::get_initial_sptr(new simple_tx_impl(filename,timeout,slow,verb));
+      return gnuradio::get_initial_sptr(new simple_tx_impl(filename,timeout,slow,verb,min_timeout,max_timeout,aggregate));
     }
   } /* namespace lsa */
 } /* namespace gr */
@@ -55,6 +55,7 @@ namespace gr {
       set_ed_threshold(ed_thres);
       enter_listen();
       message_port_register_out(d_out_port);
+      d_clock = mac_clock::wall();
       set_tag_propagation_policy(TPP_DONT);
       d_buf = (gr_complex*) volk_malloc(sizeof(gr_complex)*(1024+samples.size()),volk_get_alignment());
     }
@@ -64,8 +65,35 @@ namespace gr {
      */
     stop_n_wait_rx_ctrl_cc_impl::~stop_n_wait_rx_ctrl_cc_impl()
     {
+      d_clock->timers().cancel_all(this);
+      d_clock->detach(this);
       volk_free(d_buf);
     }
+
+    bool
+    stop_n_wait_rx_ctrl_cc_impl::start()
+    {
+      d_clock->started(this);
+      return block::start();
+    }
+
+    bool
+    stop_n_wait_rx_ctrl_cc_impl::stop()
+    {
+      d_clock->timers().cancel_all(this);
+      return block::stop();
+    }
+
+    void
+    stop_n_wait_rx_ctrl_cc_impl::set_clock(const mac_clock::sptr& clock)
+    {
+      if(!clock){
+        throw std::invalid_argument("Clock cannot be null");
+      }
+      d_clock->detach(this);
+      d_clock = clock;
+      d_clock->attach(this);
+    }
     
     void
     stop_n_wait_rx_ctrl_cc_impl::enter_listen()
@@ -107,18 +135,17 @@ namespace gr {
     void
     stop_n_wait_rx_ctrl_cc_impl::notify_clear()
     {
-      //message_port_pub(d_out_port,pmt::cons(pmt::PMT_NIL,pmt::make_blob(d_sns_clear,3)));
-      gr::thread::thread(&stop_n_wait_rx_ctrl_cc_impl::pub_clear,this).detach();
+      // sent twice, 25 ms apart
+      pub_clear();
+      d_clock->timers().schedule(this,25,
+        boost::bind(&stop_n_wait_rx_ctrl_cc_impl::pub_clear,this));
     }
     void
     stop_n_wait_rx_ctrl_cc_impl::pub_clear()
     {
-      int count =0;
-      while(count<2){
-        message_port_pub(d_out_port,pmt::cons(pmt::PMT_NIL,pmt::make_blob(d_sns_clear,3)));
-        boost::this_thread::sleep(boost::posix_time::milliseconds(25));
-        count++;
-      }
+      pmt::pmt_t out = pmt::cons(pmt::PMT_NIL,pmt::make_blob(d_sns_clear,3));
+      d_clock->sent(this,d_out_port,out);
+      message_port_pub(d_out_port,out);
       DEBUG<<"<SNS CTRL DEBUG>pub message complete"<<std::endl;
     }
     void
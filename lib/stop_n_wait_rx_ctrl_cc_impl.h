@@ -54,6 +54,7 @@ namespace gr {
       std::vector<gr_complex> d_samples;
       gr_complex d_sample_eng;
       gr::thread::mutex d_mutex;
+      mac_clock::sptr d_clock;
       bool d_silent_trig;
       std::vector<tag_t> d_tags;
       int d_voe_cnt;
@@ -68,6 +69,9 @@ namespace gr {
      public:
       stop_n_wait_rx_ctrl_cc_impl(float ed_thres,const std::vector<gr_complex>& samples);
       ~stop_n_wait_rx_ctrl_cc_impl();
+      bool start();
+      bool stop();
+      void set_clock(const mac_clock::sptr& clock);
       void set_ed_threshold(float thres);
       float ed_threshold() const;
       // Where all the action really happens
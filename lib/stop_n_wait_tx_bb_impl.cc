@@ -27,15 +27,19 @@
 
 namespace gr {
   namespace lsa {
+    // retransmission timeout in milliseconds
+    static const uint64_t d_arq_timeout = LSATIMEOUT*1000;
+    // stop state held after the last collision report
+    static const double d_collision_ms = 5000;
 
     stop_n_wait_tx_bb::sptr
     stop_n_wait_tx_bb::make(const std::string& tagname, 
                             const std::string& filename, 
                             bool usef,bool verb,int send,
-                            float mean)
+                            float mean,bool aggregate)
     {
       return gnuradio::get_initial_sptr
-        (new stop_n_wait_tx_bb_impl(tagname,filename,usef,verb,send, mean));
+        (new stop_n_wait_tx_bb_impl(tagname,filename,usef,verb,send, mean,aggregate));
     }
 
     /*
@@ -44,14 +48,15 @@ namespace gr {
     stop_n_wait_tx_bb_impl::stop_n_wait_tx_bb_impl(const std::string& tagname,
                                                    const std::string& filename, 
                                                    bool usef,bool verb, int send,
-                                                   float mean)
+                                                   float mean, bool aggregate)
       : gr::tagged_stream_block("stop_n_wait_tx_bb",
               gr::io_signature::make(1, 1, sizeof(char)),
               gr::io_signature::make(1, 1, sizeof(char)), tagname),
               d_in_port(pmt::mp("msg_in")),
               d_tagname(pmt::intern(tagname)),
               d_rng(),
-              d_mean(mean)
+              d_mean(mean),
+              d_aggregate(aggregate)
     {
       boost::poisson_distribution<> pd(d_mean);
       d_variate_poisson = boost::shared_ptr< boost::variate_generator<boost::mt19937, boost::poisson_distribution<> > >(
@@ -59,8 +64,10 @@ namespace gr {
       d_sns_stop = false; // waiting for receiver approve transmission
       message_port_register_in(d_in_port);
       set_msg_handler(d_in_port, boost::bind(&stop_n_wait_tx_bb_impl::msg_handler,this, _1));
+      d_clock = mac_clock::wall();
       memcpy(d_buf,d_phy_field,sizeof(char)*PHYLEN);
       d_seq = 0x0000;
+      d_due_msg = pmt::PMT_NIL;
       d_usef = usef;
       d_verb = verb;
       if(usef){
@@ -75,6 +82,8 @@ namespace gr {
       }
       set_send(send);
       d_send_cnt=0;
+      d_collision_timer = 0;
+      d_collision_end = 0;
     }
 
     /*
@@ -82,42 +91,37 @@ namespace gr {
      */
     stop_n_wait_tx_bb_impl::~stop_n_wait_tx_bb_impl()
     {
+      d_clock->detach(this);
+    }
+
+    void
+    stop_n_wait_tx_bb_impl::set_clock(const mac_clock::sptr& clock)
+    {
+      if(!clock){
+        throw std::invalid_argument("Clock cannot be null");
+      }
+      d_clock->detach(this);
+      d_clock = clock;
+      d_clock->attach(this);
     }
 
     bool
     stop_n_wait_tx_bb_impl::read_data(const std::string& filename)
     {
       gr::thread::scoped_lock guard(d_mutex);
-      std::string str,line;
-      if(d_file.is_open()){
-        d_file.close();
+      if(!d_data_src.open(filename)){
+        return false;
       }
-      if(!d_data_src.empty()){
-        for(int i=0;i<d_data_src.size();++i)
-          d_data_src[i].clear();
-        d_data_src.clear();
-      }
-      d_file.open(filename.c_str(),std::fstream::in);
-      if(d_file.is_open()){
-        while(getline(d_file,line,'\n')){
-          std::istringstream temp(line);
-          std::vector<unsigned char> u8;
-          while(getline(temp,str,',')){
-            int tmp = std::atoi(str.c_str());
-            u8.push_back((unsigned char)tmp);
-          }
-          d_data_src.push_back(u8);
-        }
-      }else{
-        d_data_src.clear();
+      if(d_aggregate){
+        d_data_src.aggregate(MAX_LSA_PAYLOAD-MACLEN);
       }
-      d_file.close();
       return !d_data_src.empty();
     }
 
     void
     stop_n_wait_tx_bb_impl::msg_handler(pmt::pmt_t msg)
     {
+      mac_clock::scoped_handler handled(d_clock,this,msg);
       gr::thread::scoped_lock guard(d_mutex);
       if(!pmt::dict_has_key(msg,pmt::intern("SNS_ctrl"))){
         return;
@@ -125,25 +129,23 @@ namespace gr {
       size_t ctrl_type = pmt::to_long(pmt::dict_ref(msg,pmt::intern("SNS_ctrl"),pmt::from_long(-1)));
       int seqno = pmt::to_long(pmt::dict_ref(msg,pmt::intern("base"),pmt::from_long(-1)));
       if(ctrl_type == SNS_COLLISION){
-        d_collision=true;
         if(!d_sns_stop){
           d_sns_stop = true;
           d_gate_tag = true;
         }
-        d_collision_rx.notify_one();
+        // every report restarts the quiet period
+        d_collision_end = d_clock->now_us()+(uint64_t)(d_collision_ms*1000);
+        d_clock->timers().cancel(d_collision_timer);
+        d_collision_timer = d_clock->timers().schedule(this,d_collision_ms,
+          boost::bind(&stop_n_wait_tx_bb_impl::collision_timeout,this));
       }else if(ctrl_type == SNS_CLEAR){
         if(d_sns_stop){
           d_sns_stop = false;
           d_send_cnt=0;
         }
       }else if(seqno>=0){
-        std::list<srArq_t>::iterator it;
-        for(it = d_arq_list.begin();it!=d_arq_list.end();++it){
-          if(seqno == it->seq()){
-            it = d_arq_list.erase(it);
-            d_pkt_success_cnt++;
-            break;
-          }
+        if(d_arq.remove(seqno)){
+          d_pkt_success_cnt++;
         }
       }else{
         return;
@@ -161,9 +163,30 @@ namespace gr {
       d_buf[PHYLEN+2] = u8_seq[1];
       d_buf[PHYLEN+3] = u8_seq[0];
       pmt::pmt_t blob = pmt::make_blob(d_buf,pkt_len+PHYLEN);
-      d_arq_list.push_back(srArq_t(d_seq,blob));
+      const uint64_t now = d_clock->now_us()/1000;
+      // a frame still pending after a wrap around is given up
+      d_arq.remove(d_seq);
+      d_arq.add(d_seq,blob,now+d_arq_timeout,now);
       d_seq = (d_seq==0xffff)? 0 : d_seq+1;
     }
+    bool
+    stop_n_wait_tx_bb_impl::peek_due()
+    {
+      // work() sends exactly the frame the length was set for, it may
+      // not have run since the last call
+      if(!pmt::is_null(d_due_msg)){
+        return true;
+      }
+      const uint64_t now = d_clock->now_us()/1000;
+      arq_timer_wheel::frame_t* frame = d_arq.next_expired(now);
+      if(frame==NULL){
+        return false;
+      }
+      frame->retry++;
+      d_arq.rearm(frame->seq,now+d_arq_timeout,now);
+      d_due_msg = frame->msg;
+      return true;
+    }
     void
     stop_n_wait_tx_bb_impl::set_send(int send)
     {
@@ -177,58 +200,37 @@ namespace gr {
       return d_variate_poisson->operator()();
     }
     void
-    stop_n_wait_tx_bb_impl::collision_timer()
+    stop_n_wait_tx_bb_impl::collision_timeout()
     {
-      while(!d_finished){
-        if(d_collision){
-          d_collision = false;
-          gr::thread::scoped_lock lock(d_mutex);
-          d_collision_rx.timed_wait(lock,boost::posix_time::milliseconds(5000));
-          lock.unlock();
-          if(!d_collision && d_sns_stop){
-            d_sns_stop = false;
-            d_send_cnt=0;
-          }
-        }else{
-          gr::thread::scoped_lock lock(d_mutex);
-          d_collision_rx.wait(lock);
-          lock.unlock();
-        }
-        if(d_finished){
-          return;
-        }
+      gr::thread::scoped_lock guard(d_mutex);
+      // a later report may have come in while this one was due
+      if(d_clock->now_us()<d_collision_end){
+        return;
+      }
+      if(d_sns_stop){
+        d_sns_stop = false;
+        d_send_cnt=0;
       }
     }
     void
-    stop_n_wait_tx_bb_impl::wait()
+    stop_n_wait_tx_bb_impl::resume()
     {
-      while(!d_finished){
-        gr::thread::scoped_lock lock(d_mutex);
-        d_wait_delay.wait(lock);
-        lock.unlock();
-        if(d_finished){
-          return;
-        }
-        boost::this_thread::sleep(boost::posix_time::milliseconds(next_delay()));
-        if(d_finished){
-          return;
-        }
-        d_sns_stop = false;
-      }
+      gr::thread::scoped_lock guard(d_mutex);
+      d_sns_stop = false;
     }
     int
     stop_n_wait_tx_bb_impl::calculate_output_stream_length(const gr_vector_int &ninput_items)
     {
+      gr::thread::scoped_lock guard(d_mutex);
       int noutput_items =0;
       if(!d_sns_stop){
-        std::list<srArq_t>::iterator it = d_arq_list.begin();
-        if(d_arq_list.empty()){
+        if(!peek_due()){
           noutput_items = ninput_items[0] + PHYLEN + MACLEN;
           if(d_usef){
-            noutput_items = d_data_src[d_seq%d_data_src.size()].size() + PHYLEN+MACLEN;
+            noutput_items = d_data_src.length(d_seq%d_data_src.size()) + PHYLEN+MACLEN;
           }
         }else{
-          noutput_items = it->blob_length();
+          noutput_items = pmt::blob_length(d_due_msg);
         }
       }else{
         if(!d_gate_tag){
@@ -244,15 +246,16 @@ namespace gr {
                        gr_vector_const_void_star &input_items,
                        gr_vector_void_star &output_items)
     {
+      gr::thread::scoped_lock guard(d_mutex);
       const unsigned char *in = (const unsigned char *) input_items[0];
       unsigned char *out = (unsigned char *) output_items[0];
       int nin = ninput_items[0];
       if(d_usef){
-        in = d_data_src[d_seq%d_data_src.size()].data();
-        nin = d_data_src[d_seq%d_data_src.size()].size();
+        in = d_data_src.data(d_seq%d_data_src.size());
+        nin = d_data_src.length(d_seq%d_data_src.size());
       }
-      std::list<srArq_t>::iterator it = d_arq_list.begin();
-      pmt::pmt_t blob;
+      pmt::pmt_t blob = d_due_msg;
+      d_due_msg = pmt::PMT_NIL;
       int nout =0;
       if(d_sns_stop){
         if(!d_gate_tag){
@@ -264,21 +267,7 @@ namespace gr {
           return 0;
         }
       }else{
-        // check arq 
-        while(it!=d_arq_list.end()){
-          if(it->timeout()){
-            it->inc_retry();
-            blob = it->msg();
-            d_arq_list.push_back(*it);
-            d_arq_list.pop_front();
-            break;
-          }else{
-            // found a pkt that is not timeout...
-            it = d_arq_list.end();
-            break;
-          }
-        }
-        if(it==d_arq_list.end()){
+        if(pmt::is_null(blob)){
           // add new pkt
           // filling PKT_LEN+MAC SEQ
           int pkt_len = nin + MACLEN;
@@ -301,7 +290,9 @@ namespace gr {
           d_send_cnt=0;
           d_sns_stop = true;
           d_gate_tag = false;
-          d_wait_delay.notify_one();
+          // poisson distributed pause before the next burst
+          d_clock->timers().schedule(this,next_delay(),
+            boost::bind(&stop_n_wait_tx_bb_impl::resume,this));
         }
         return nout;
       }
@@ -309,42 +300,25 @@ namespace gr {
     bool 
     stop_n_wait_tx_bb_impl::start()
     {
-      d_finished = false;
-      d_start_time = boost::posix_time::second_clock::local_time();
-      d_thread = boost::shared_ptr<gr::thread::thread>
-        (new gr::thread::thread(boost::bind(&stop_n_wait_tx_bb_impl::run,this)));
-      d_stop_thread = boost::shared_ptr<gr::thread::thread>
-        (new gr::thread::thread(boost::bind(&stop_n_wait_tx_bb_impl::wait,this)));
-      d_collision_thread = boost::shared_ptr<gr::thread::thread>
-        (new gr::thread::thread(boost::bind(&stop_n_wait_tx_bb_impl::collision_timer,this)));
+      d_start_time = d_clock->now_us();
+      d_clock->timers().schedule_every(this,STATUSMS,STATUSMS,
+        boost::bind(&stop_n_wait_tx_bb_impl::status,this));
+      d_clock->started(this);
       return block::start();
     }
     bool
     stop_n_wait_tx_bb_impl::stop()
     {
-      d_finished = true;
-      d_wait_delay.notify_one();
-      d_thread->interrupt();
-      d_stop_thread->interrupt();
-      d_collision_thread->interrupt();
-      d_stop_thread->join();
-      d_thread->join();
-      d_collision_thread->join();
+      d_clock->timers().cancel_all(this);
       return block::stop();
     }
     void
-    stop_n_wait_tx_bb_impl::run()
+    stop_n_wait_tx_bb_impl::status()
     {
-      while(!d_finished){
-        boost::this_thread::sleep(boost::posix_time::milliseconds(10000));
-        if(d_finished){
-          return;
-        }
-        boost::posix_time::time_duration diff = boost::posix_time::second_clock::local_time()-d_start_time;
-        if(d_verb){
-          std::cout<<"<SNS TX>Execution time:"<<diff.total_seconds();
-          std::cout<<" total packets:"<<d_pkt_total<<" ,success packets:"<<d_pkt_success_cnt<<std::endl;
-        }
+      uint64_t diff = d_clock->now_us()-d_start_time;
+      if(d_verb){
+        std::cout<<"<SNS TX>Execution time:"<<diff/1000000;
+        std::cout<<" total packets:"<<d_pkt_total<<" ,success packets:"<<d_pkt_success_cnt<<std::endl;
       }
     }
 
@@ -23,7 +23,8 @@
 
 #include <lsa/stop_n_wait_tx_bb.h>
 #include "utils.h"
-#include <fstream>
+#include <lsa/arq_timer_wheel.h>
+#include <lsa/payload_corpus.h>
 #include <boost/random/variate_generator.hpp>
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/poisson_distribution.hpp>
@@ -48,23 +49,24 @@ namespace gr {
       boost::mt19937 d_rng;
       boost::shared_ptr< boost::variate_generator <boost::mt19937, boost::poisson_distribution<> > > d_variate_poisson;
       float d_mean;
+      const bool d_aggregate;
       float d_std;
-      boost::shared_ptr<gr::thread::thread> d_stop_thread;
-      boost::shared_ptr<gr::thread::thread> d_collision_thread;
-      gr::thread::condition_variable d_wait_delay;
-      gr::thread::condition_variable d_collision_rx;
+      timer_service::timer_id d_collision_timer;
+      // microseconds on d_clock
+      uint64_t d_collision_end;
 
       const pmt::pmt_t d_in_port;
       const pmt::pmt_t d_tagname;
-      std::list<srArq_t> d_arq_list;
+      arq_timer_wheel d_arq;
+      // frame chosen for retransmission when the output length was set
+      pmt::pmt_t d_due_msg;
       gr::thread::mutex d_mutex;
-      bool d_collision;
+      mac_clock::sptr d_clock;
       bool d_sns_stop;
       bool d_gate_tag;
       unsigned char d_buf[256];
       uint16_t d_seq;
-      std::fstream d_file;
-      std::vector< std::vector<unsigned char> > d_data_src;
+      payload_corpus d_data_src;
       bool d_usef;
       bool d_verb;
       long int d_pkt_success_cnt;
@@ -72,22 +74,21 @@ namespace gr {
       int d_send_cnt;
       int d_send_size;
 
-      boost::shared_ptr<gr::thread::thread> d_thread;
-      boost::posix_time::ptime d_start_time;
-      bool d_finished;
+      uint64_t d_start_time;
 
       float next_delay();
       bool read_data(const std::string& filename);
       void msg_handler(pmt::pmt_t msg);
       void generate_new_pkt(const unsigned char* in, int nin);
-      void run();
-      void wait();
-      void collision_timer();
+      bool peek_due();
+      void status();
+      void resume();
+      void collision_timeout();
      protected:
       int calculate_output_stream_length(const gr_vector_int &ninput_items);
 
      public:
-      stop_n_wait_tx_bb_impl(const std::string& tagname,const std::string& filename, bool usef, bool verb, int send, float mean);
+      stop_n_wait_tx_bb_impl(const std::string& tagname,const std::string& filename, bool usef, bool verb, int send, float mean, bool aggregate);
       ~stop_n_wait_tx_bb_impl();
 
       // Where all the action really happens
@@ -100,6 +101,7 @@ namespace gr {
       bool stop();
 
       void set_send(int send);
+      void set_clock(const mac_clock::sptr& clock);
     };
 
   } // namespace lsa
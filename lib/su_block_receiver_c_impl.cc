@@ -56,14 +56,21 @@ namespace gr {
     static const int CODE_RATE_INV= 8;
     static const unsigned int d_mask = 0x7ffffffe;
     static const uint8_t d_sensing[] = {0xff,0x00};
+    // published as is, never modified
+    static const pmt::pmt_t d_sensing_msg = pmt::cons(pmt::PMT_NIL,pmt::make_blob(d_sensing,2));
+    static const pmt::pmt_t d_voe_tag = pmt::intern("voe_tag");
+    static const pmt::pmt_t d_block_tag = pmt::intern("block_tag");
+    static const pmt::pmt_t d_block_id_key = pmt::intern("block_id");
+    static const pmt::pmt_t d_offset_key = pmt::intern("offset");
 
     su_block_receiver_c::sptr
     su_block_receiver_c::make(
       const gr::digital::constellation_sptr& hdr_const,
-      int threshold)
+      int threshold,
+      int chase_depth)
     {
       return gnuradio::get_initial_sptr
-        (new su_block_receiver_c_impl(hdr_const,threshold));
+        (new su_block_receiver_c_impl(hdr_const,threshold,chase_depth));
     }
 
     /*
@@ -71,12 +78,20 @@ namespace gr {
      */
     su_block_receiver_c_impl::su_block_receiver_c_impl(
       const gr::digital::constellation_sptr& hdr_const,
-      int threshold)
+      int threshold,
+      int chase_depth)
       : gr::sync_block("su_block_receiver_c",
               gr::io_signature::make(1, 1, sizeof(gr_complex)),
               gr::io_signature::make(0, 0, 0)),
-              d_out_port(pmt::mp("pkt_out"))
+              d_out_port(pmt::mp("pkt_out")),
+              d_demap(hdr_const),
+              d_despread(CHIPSET,(threshold<0)? 0: threshold),
+              d_chase(CHIPSET,(threshold<0)? 0: threshold,chase_depth)
     {
+      if(hdr_const->bits_per_symbol()>8){
+        throw std::invalid_argument("Soft despreading supports up to 8 bits per symbol");
+      }
+      d_soft_frame = std::vector<float>(MAX_PLD*DSSS_BYTE_CHIPS);
       d_hdr_const = hdr_const->base();
       d_hdr_bps = hdr_const->bits_per_symbol();
       d_state = SEARCH_ZERO;
@@ -126,26 +141,6 @@ namespace gr {
       d_chip_cnt=0;
       d_data_reg = 0x00000000;
     }
-    unsigned char 
-    su_block_receiver_c_impl::decode_chip(const unsigned int& reg)
-    {
-      int min_thres = 33;
-      int thres;
-      unsigned char min_idx;
-      for(int i=0;i<16;++i){
-        thres = gr::blocks::count_bits32( (reg & d_mask)^(CHIPSET[i]&d_mask));
-        if(thres < min_thres){
-          min_idx  = (unsigned char)i;
-          min_thres = thres;
-        }
-      }
-      if(min_thres < d_threshold){
-        return min_idx & 0x0f;
-      }
-      return 0xff;
-    }
-
-
     int
     su_block_receiver_c_impl::work(int noutput_items,
         gr_vector_const_void_star &input_items,
@@ -153,8 +148,8 @@ namespace gr {
     {
       const gr_complex *in = (const gr_complex *) input_items[0];
       std::vector<tag_t> voe_tags, block_tags;
-      get_tags_in_window(voe_tags,0,0,noutput_items,pmt::intern("voe_tag"));
-      get_tags_in_window(block_tags,0,0,noutput_items,pmt::intern("block_tag"));
+      get_tags_in_window(voe_tags,0,0,noutput_items,d_voe_tag);
+      get_tags_in_window(block_tags,0,0,noutput_items,d_block_tag);
       int ii=0;
       while(ii<noutput_items){
         if(!voe_tags.empty()){
@@ -164,7 +159,7 @@ namespace gr {
             d_voe_state = pmt::to_bool(voe_tags[0].value);
             if(!prev_state && d_voe_state){
               d_voe_do_not_pub=true;
-              message_port_pub(d_out_port,pmt::cons(pmt::PMT_NIL,pmt::make_blob(d_sensing,2)));
+              message_port_pub(d_out_port,d_sensing_msg);
             }else if(prev_state && !d_voe_state){
               //d_voe_do_not_pub=false;
             }
@@ -182,6 +177,7 @@ namespace gr {
           }
         }
         d_mod_buf = d_hdr_const->decision_maker(&in[ii]);
+        d_demap.demap(&in[ii],1,d_soft_sym);
         for(int i=0;i<d_hdr_bps;++i){
           switch(d_state)
           {
@@ -226,11 +222,11 @@ namespace gr {
               }
             break;
             case HAVE_SYNC:
-              d_data_reg = (d_data_reg<<1) | (0x01 & (d_mod_buf>> (d_hdr_bps-1-i)) );
+              d_soft_frame[d_symbol_cnt*DSSS_SYMBOL_CHIPS+d_chip_cnt] = d_soft_sym[i];
               d_chip_cnt++;
             if(d_chip_cnt==32){
               d_chip_cnt=0;
-              unsigned char c = decode_chip(d_data_reg);
+              unsigned char c = d_despread.despread(&d_soft_frame[d_symbol_cnt*DSSS_SYMBOL_CHIPS]);
             if(c==0xff){
               enter_search();
             }else{
@@ -257,34 +253,34 @@ namespace gr {
             }
             break;
             case LOAD_PAYLOAD:
-              d_data_reg = (d_data_reg<<1) | (0x01 & (d_mod_buf>> (d_hdr_bps-1-i)) );
+              d_soft_frame[d_symbol_cnt*DSSS_SYMBOL_CHIPS+d_chip_cnt] = d_soft_sym[i];
               d_chip_cnt++;
               if(d_chip_cnt==32){
                 d_chip_cnt=0;
-                unsigned char c = decode_chip(d_data_reg);
-                if(c==0xff){
-                  enter_search();
-                }else{
-                  if(d_symbol_cnt%2==0){
-                    d_out_buf[d_symbol_cnt/2] = (c<<4);
-                  }else{
-                    d_out_buf[d_symbol_cnt/2] |= c;
+                d_symbol_cnt++;
+                if(d_symbol_cnt/2 >= d_pkt_byte){
+                  // despread the whole frame at once
+                  bool decoded = d_despread.decode_bytes(d_soft_frame.data(),d_pkt_byte,d_out_buf);
+                  if(!decoded){
+                    decoded = d_chase.decode(d_soft_frame.data(),d_pkt_byte,d_out_buf);
                   }
-                  d_symbol_cnt++;
-                  if(d_symbol_cnt/2 >= d_pkt_byte){
-                      if(!d_voe_do_not_pub){
-                        pmt::pmt_t dict = pmt::make_dict();
-                        dict = pmt::dict_add(dict,pmt::intern("block_id"),pmt::from_uint64(d_latest_bid));
-                        dict = pmt::dict_add(dict,pmt::intern("offset"),pmt::from_long(d_latest_offset));
-                        pmt::pmt_t blob = pmt::make_blob(d_out_buf,d_pkt_byte);
-                        message_port_pub(d_out_port,pmt::cons(dict,blob));
-                        DEBUG<<"<Block RX>\033[32;1mPublishing pkt, bid="<<d_latest_bid<<" ,offset="<<d_latest_offset<<"\033[0m"<<std::endl;
-                      }else{
-                        d_voe_do_not_pub = false;
-                      }
-                    // reason: header may be intact
-                    enter_search();
+                  if(decoded && chase_combiner::frame_ok(d_out_buf,d_pkt_byte)){
+                    d_chase.forget(d_out_buf,d_pkt_byte);
                   }
+                  if(decoded){
+                    if(!d_voe_do_not_pub){
+                      pmt::pmt_t dict = pmt::make_dict();
+                      dict = pmt::dict_add(dict,d_block_id_key,pmt::from_uint64(d_latest_bid));
+                      dict = pmt::dict_add(dict,d_offset_key,pmt::from_long(d_latest_offset));
+                      pmt::pmt_t blob = pmt::make_blob(d_out_buf,d_pkt_byte);
+                      message_port_pub(d_out_port,pmt::cons(dict,blob));
+                      DEBUG<<"<Block RX>\033[32;1mPublishing pkt, bid="<<d_latest_bid<<" ,offset="<<d_latest_offset<<"\033[0m"<<std::endl;
+                    }else{
+                      d_voe_do_not_pub = false;
+                    }
+                  }
+                  // reason: header may be intact
+                  enter_search();
                 }
               }
             break;
@@ -23,6 +23,7 @@
 
 #include <lsa/su_block_receiver_c.h>
 #include <gnuradio/digital/constellation.h>
+#include "chase_combiner.h"
 
 namespace gr {
   namespace lsa {
@@ -52,14 +53,19 @@ namespace gr {
       int d_latest_offset;
       bool d_voe_state;
       bool d_voe_do_not_pub;
+      // soft chips of the current frame
+      soft_demapper d_demap;
+      dsss_despreader d_despread;
+      chase_combiner d_chase;
+      float d_soft_sym[8];
+      std::vector<float> d_soft_frame;
 
       void enter_search();
       void enter_have_sync();
       void enter_load_payload();
-      unsigned char decode_chip(const unsigned int& reg);
 
      public:
-      su_block_receiver_c_impl(const gr::digital::constellation_sptr& hdr_const, int threshold);
+      su_block_receiver_c_impl(const gr::digital::constellation_sptr& hdr_const, int threshold, int chase_depth);
       ~su_block_receiver_c_impl();
 
       // Where all the action really happens
@@ -25,6 +25,7 @@
 #include <gnuradio/io_signature.h>
 #include <lsa/su_ctrl.h>
 #include <gnuradio/block_detail.h>
+#include <algorithm>
 
 namespace gr {
   namespace lsa {
@@ -33,8 +34,13 @@ namespace gr {
     #define DEBUG d_debug && std::cerr
     #define LSAMACLEN 8
     #define LSASENLEN 2
+    // queue indices whose feedback is kept
+    #define CTRLCACHE 256
     static const unsigned char LSA_SEN = 0x02;
     static const unsigned char LSA_CTRL= 0x08;
+    static const uint8_t d_sensing[] = {0xff,0x00};
+    // published as is, never modified
+    static const pmt::pmt_t d_sensing_blob = pmt::make_blob(d_sensing,LSA_SEN);
 
     class su_ctrl_impl: public su_ctrl{
       public:
@@ -48,6 +54,9 @@ namespace gr {
         message_port_register_out(d_msg_out);
         set_msg_handler(d_msg_in,boost::bind(&su_ctrl_impl::msg_in,this,_1));
         d_prou_present = false;
+        d_cache_qsize = 0;
+        d_cache_base = 0;
+        d_cache.assign(1,pmt::PMT_NIL);
       }
       ~su_ctrl_impl(){}
 
@@ -77,7 +86,8 @@ namespace gr {
           parse_pdu(qidx,qsize,base1,base2,uvec);
           DEBUG<<"<SU CTRL DEBUG>received PHY packet--block_idx="
           <<qidx<<" ,block_size="<<qsize<<" ,base="<<base1<<std::endl;
-          blob = generate_header(qidx,qsize,base1,LSA_CTRL);  
+          message_port_pub(d_msg_out,ctrl_msg(qidx,qsize,base1,base2));
+          return;
         }else{
           // undefined
           return;
@@ -101,12 +111,27 @@ namespace gr {
         base2 = uvec[6]<<8;
         base2|= uvec[7];
       }
+      pmt::pmt_t ctrl_msg(uint16_t qidx,uint16_t qsize,uint16_t base,uint16_t base2)
+      {
+        // a queue is retransmitted as a whole, so the feedback of every
+        // index is built once per queue and base
+        if(base!=base2 || qidx>=std::max((int)qsize,1) || qidx>=CTRLCACHE){
+          return pmt::cons(pmt::PMT_NIL,generate_header(qidx,qsize,base,LSA_CTRL));
+        }
+        if(qsize!=d_cache_qsize || base!=d_cache_base){
+          d_cache.assign(std::min(std::max((int)qsize,1),CTRLCACHE),pmt::PMT_NIL);
+          d_cache_qsize = qsize;
+          d_cache_base = base;
+        }
+        if(pmt::is_null(d_cache[qidx])){
+          d_cache[qidx] = pmt::cons(pmt::PMT_NIL,generate_header(qidx,qsize,base,LSA_CTRL));
+        }
+        return d_cache[qidx];
+      }
       pmt::pmt_t generate_header(int qidx,int qsize,unsigned int base,unsigned char type)
       {
         if(type == LSA_SEN){
-          d_ctrl_buf[0]=0xff;
-          d_ctrl_buf[1]=0x00;
-          return pmt::make_blob(d_ctrl_buf,LSA_SEN);
+          return d_sensing_blob;
         }else if(type==LSA_CTRL){
           uint8_t * qi8 = (uint8_t*) &qidx;
           uint8_t * qs8 = (uint8_t*) &qsize;
@@ -127,6 +152,9 @@ namespace gr {
       const pmt::pmt_t d_msg_in;
       const pmt::pmt_t d_msg_out;
       unsigned char d_ctrl_buf[256];
+      std::vector<pmt::pmt_t> d_cache;
+      uint16_t d_cache_qsize;
+      uint16_t d_cache_base;
       bool d_prou_present;
       gr::thread::mutex d_mutex;
     };
@@ -48,8 +48,13 @@ static const unsigned int CHIPSET[16] = {
 static const int MAX_PLD = 127;
 static const int CODE_RATE_INV= 8;
 static const unsigned int d_mask = 0x7ffffffe;
+// frames in flight per decoding thread before the work thread waits
+static const int JOBS_PER_THREAD = 4;
 static const pmt::pmt_t d_pwr_tag = pmt::intern("pwr_tag");
+static const pmt::pmt_t d_voe_tag = pmt::intern("voe_tag");
 static const uint8_t d_sensing[] = {0xff,0x00};
+// published as is, never modified
+static const pmt::pmt_t d_sensing_msg = pmt::cons(pmt::PMT_NIL,pmt::make_blob(d_sensing,2));
 
 enum SYSTEMSTATE{
   SEARCH_ZERO,
@@ -60,12 +65,16 @@ enum SYSTEMSTATE{
     su_packet_sink_c::sptr
     su_packet_sink_c::make(
       const gr::digital::constellation_sptr& hdr_const,
-      int threshold)
+      int threshold,
+      int chase_depth,
+      int nthreads)
     {
       return gnuradio::get_initial_sptr
         (new su_packet_sink_c_impl(
           hdr_const,
-          threshold));
+          threshold,
+          chase_depth,
+          nthreads));
     }
 
     /*
@@ -73,13 +82,26 @@ enum SYSTEMSTATE{
      */
     su_packet_sink_c_impl::su_packet_sink_c_impl(
       const gr::digital::constellation_sptr& hdr_const,
-      int threshold)
+      int threshold,
+      int chase_depth,
+      int nthreads)
       : gr::block("su_packet_sink_c",
               gr::io_signature::make(1, 1, sizeof(gr_complex)),
               gr::io_signature::make(0, 0, 0)),
               d_msg_port(pmt::mp("msg")),
-              d_cap(8192*2)
+              d_cap(8192*2),
+              d_demap(hdr_const),
+              d_despread(CHIPSET,(threshold<0)? 0: threshold),
+              d_chase(CHIPSET,(threshold<0)? 0: threshold,chase_depth),
+              d_nthreads(nthreads),
+              d_max_jobs(JOBS_PER_THREAD*nthreads+1)
     {
+      if(hdr_const->bits_per_symbol()>8){
+        throw std::invalid_argument("Soft despreading supports up to 8 bits per symbol");
+      }
+      if(nthreads<1){
+        throw std::invalid_argument("Number of decoder threads should be at least 1");
+      }
       d_hdr_const = hdr_const->base();
       d_hdr_bps = hdr_const->bits_per_symbol();
       d_state = SEARCH_ZERO;
@@ -89,11 +111,18 @@ enum SYSTEMSTATE{
       // coded 
       d_threshold = (threshold<0)? 0: threshold;
       d_const_buf = new unsigned char[d_cap];
+      d_soft_buf = new float[d_cap];
+      d_soft_frame = std::vector<float>(MAX_PLD*DSSS_BYTE_CHIPS);
       d_current_pwr = pmt::from_float(0);
       d_voe_do_not_pub = false;
       d_voe_state = false;
       d_voe_tags.clear();
-
+      d_cur_job = NULL;
+      d_njobs = 0;
+      d_job_bits = 0;
+      d_next_seqno = 0;
+      d_commit_seqno = 0;
+      d_finished = false;
     }
 
     /*
@@ -102,6 +131,201 @@ enum SYSTEMSTATE{
     su_packet_sink_c_impl::~su_packet_sink_c_impl()
     {
       delete [] d_const_buf;
+      delete [] d_soft_buf;
+      delete d_cur_job;
+      for(int i=0;i<d_free_jobs.size();++i){
+        delete d_free_jobs[i];
+      }
+      for(int i=0;i<d_pending.size();++i){
+        delete d_pending[i];
+      }
+      std::map<uint64_t,su_sink_job*>::iterator it;
+      for(it=d_done.begin();it!=d_done.end();++it){
+        delete it->second;
+      }
+    }
+
+    bool
+    su_packet_sink_c_impl::start()
+    {
+      d_finished = false;
+      // with one thread payloads are decoded inline in general_work
+      if(d_nthreads>1){
+        for(int i=0;i<d_nthreads;++i){
+          d_workers.push_back(boost::shared_ptr<gr::thread::thread>
+            (new gr::thread::thread(boost::bind(&su_packet_sink_c_impl::run_jobs,this))));
+        }
+      }
+      return block::start();
+    }
+
+    bool
+    su_packet_sink_c_impl::stop()
+    {
+      {
+        gr::thread::scoped_lock lock(d_job_mutex);
+        d_finished = true;
+        d_job_cond.notify_all();
+      }
+      for(int i=0;i<d_workers.size();++i){
+        d_workers[i]->join();
+      }
+      d_workers.clear();
+      commit_jobs();
+      return block::stop();
+    }
+
+    su_sink_job*
+    su_packet_sink_c_impl::acquire_job()
+    {
+      gr::thread::scoped_lock lock(d_job_mutex);
+      // backpressure, the workers commit and free jobs on their own
+      while(d_free_jobs.empty() && d_njobs>=d_max_jobs){
+        d_free_cond.wait(lock);
+      }
+      if(d_free_jobs.empty()){
+        d_njobs++;
+        return new su_sink_job;
+      }
+      su_sink_job* job = d_free_jobs.back();
+      d_free_jobs.pop_back();
+      return job;
+    }
+
+    void
+    su_packet_sink_c_impl::release_job(su_sink_job* job)
+    {
+      // buffers keep their capacity for the next burst
+      job->samples.clear();
+      job->soft.clear();
+      job->pwr = pmt::PMT_NIL;
+      gr::thread::scoped_lock lock(d_job_mutex);
+      d_free_jobs.push_back(job);
+      d_free_cond.notify_one();
+    }
+
+    void
+    su_packet_sink_c_impl::submit_job(su_sink_job* job)
+    {
+      job->seqno = d_next_seqno++;
+      if(d_workers.empty() || job->sensing){
+        decode_job(*job);
+        {
+          gr::thread::scoped_lock lock(d_job_mutex);
+          d_done[job->seqno] = job;
+        }
+        commit_jobs();
+        return;
+      }
+      gr::thread::scoped_lock lock(d_job_mutex);
+      d_pending.push_back(job);
+      d_job_cond.notify_one();
+    }
+
+    void
+    su_packet_sink_c_impl::run_jobs()
+    {
+      while(true){
+        su_sink_job* job;
+        {
+          gr::thread::scoped_lock lock(d_job_mutex);
+          while(d_pending.empty() && !d_finished){
+            d_job_cond.wait(lock);
+          }
+          if(d_pending.empty()){
+            return;
+          }
+          job = d_pending.front();
+          d_pending.pop_front();
+        }
+        decode_job(*job);
+        {
+          gr::thread::scoped_lock lock(d_job_mutex);
+          d_done[job->seqno] = job;
+        }
+        // the work thread may be waiting on the pool, do not leave the
+        // frame for its next call
+        commit_jobs();
+      }
+    }
+
+    void
+    su_packet_sink_c_impl::commit_jobs()
+    {
+      gr::thread::scoped_lock commit(d_commit_mutex);
+      while(true){
+        su_sink_job* job;
+        {
+          gr::thread::scoped_lock lock(d_job_mutex);
+          std::map<uint64_t,su_sink_job*>::iterator it = d_done.begin();
+          if(it==d_done.end() || it->first!=d_commit_seqno){
+            return;
+          }
+          job = it->second;
+          d_done.erase(it);
+        }
+        d_commit_seqno++;
+        if(job->sensing){
+          d_voe_do_not_pub = true;
+          message_port_pub(d_msg_port,d_sensing_msg);
+        }else{
+          // combining keeps state, so it runs here in frame order
+          frame_done(job->soft.data()+job->bit_offset,job->buf,job->nbytes,job->decoded,job->pwr);
+        }
+        release_job(job);
+      }
+    }
+
+    void
+    su_packet_sink_c_impl::decode_job(su_sink_job& job) const
+    {
+      job.decoded = false;
+      if(job.sensing){
+        return;
+      }
+      job.soft.resize(job.samples.size()*d_hdr_bps);
+      d_demap.demap(job.samples.data(),job.samples.size(),job.soft.data());
+      job.decoded = d_despread.decode_bytes(job.soft.data()+job.bit_offset,job.nbytes,job.buf);
+    }
+
+    void
+    su_packet_sink_c_impl::begin_job(int bit)
+    {
+      d_cur_job = acquire_job();
+      d_cur_job->sensing = false;
+      d_cur_job->nbytes = d_pkt_byte;
+      d_cur_job->bit_offset = bit%d_hdr_bps;
+      d_cur_job->pwr = d_current_pwr;
+      d_job_bits = 0;
+    }
+
+    float
+    su_packet_sink_c_impl::soft_bit(const gr_complex* in, int bit) const
+    {
+      float soft[8];
+      d_demap.demap(in+bit/d_hdr_bps,1,soft);
+      return soft[bit%d_hdr_bps];
+    }
+
+    void
+    su_packet_sink_c_impl::frame_done(const float* chips, unsigned char* buf, int nbytes,
+      bool decoded, const pmt::pmt_t& pwr)
+    {
+      if(!decoded){
+        decoded = d_chase.decode(chips,nbytes,buf);
+      }
+      if(decoded && chase_combiner::frame_ok(buf,nbytes)){
+        d_chase.forget(buf,nbytes);
+      }
+      if(decoded){
+        // hide pwr tag in key field
+        if(d_voe_do_not_pub){
+          d_voe_do_not_pub = false;
+        }else{
+          pmt::pmt_t msg = pmt::cons(pwr,pmt::make_blob(buf,nbytes));
+          message_port_pub(d_msg_port,msg);
+        }
+      }
     }
 
     void
@@ -139,25 +363,6 @@ enum SYSTEMSTATE{
       ninput_items_required[0] = noutput_items;
     }
 
-    unsigned char
-    su_packet_sink_c_impl::decode_chip(const unsigned int& reg)
-    {
-      int min_thres = 33;
-      int thres;
-      unsigned char min_idx;
-      for(int i=0;i<16;++i){
-        thres = gr::blocks::count_bits32( (reg & d_mask)^(CHIPSET[i]&d_mask));
-        if(thres < min_thres){
-          min_idx  = (unsigned char)i;
-          min_thres = thres;
-        }
-      }
-      if(min_thres < d_threshold){
-        return min_idx & 0x0f;
-      }
-      return 0xff;
-    }
-
     void 
     su_packet_sink_c_impl::update_voe(int idx)
     {
@@ -168,8 +373,15 @@ enum SYSTEMSTATE{
             d_voe_state = result;
           }else if(!d_voe_state && result){
             d_voe_state = result;
-            d_voe_do_not_pub = true;
-            message_port_pub(d_msg_port,pmt::cons(pmt::PMT_NIL,pmt::make_blob(d_sensing,2)));
+            if(d_nthreads>1){
+              // keep the sensing message in order with frames in flight
+              su_sink_job* job = acquire_job();
+              job->sensing = true;
+              submit_job(job);
+            }else{
+              d_voe_do_not_pub = true;
+              message_port_pub(d_msg_port,d_sensing_msg);
+            }
           }
           d_voe_tags.erase(d_voe_tags.begin());
         }
@@ -191,7 +403,7 @@ enum SYSTEMSTATE{
       }
       d_voe_tags.clear();
       get_tags_in_window(pwr_tags,0,0,nin,d_pwr_tag);
-      get_tags_in_window(d_voe_tags,0,0,nin,pmt::intern("voe_tag"));
+      get_tags_in_window(d_voe_tags,0,0,nin,d_voe_tag);
       for(int i=0;i<d_voe_tags.size();++i){
         int offset = d_voe_tags[i].offset-nitems_read(0);
         d_voe_tags[i].offset= offset;
@@ -206,6 +418,9 @@ enum SYSTEMSTATE{
             d_const_buf[i*d_hdr_bps+j] = (temp>> (d_hdr_bps-1-j)) & 0x01;
           }
       }
+      if(d_nthreads==1){
+        d_demap.demap(in,nin,d_soft_buf);
+      }
       int nbits = nin * d_hdr_bps;
       int count =0;
       while(count<nbits){
@@ -265,11 +480,12 @@ enum SYSTEMSTATE{
           case HAVE_SYNC:
           while(count <nbits){
             update_voe(count/d_hdr_bps);
-            d_data_reg = (d_data_reg<<1) | (0x01&d_const_buf[count++]);
+            d_soft_frame[d_symbol_cnt*DSSS_SYMBOL_CHIPS+d_chip_cnt] = (d_nthreads>1)? soft_bit(in,count) : d_soft_buf[count];
+            count++;
             d_chip_cnt++;
             if(d_chip_cnt==32){
               d_chip_cnt=0;
-              unsigned char c = decode_chip(d_data_reg);
+              unsigned char c = d_despread.despread(&d_soft_frame[d_symbol_cnt*DSSS_SYMBOL_CHIPS]);
               if(c==0xff){
                 enter_search();
                 break;
@@ -291,6 +507,9 @@ enum SYSTEMSTATE{
                     }
                     else if(d_pkt_byte <= MAX_PLD){
                       enter_load_payload();
+                      if(d_nthreads>1){
+                        begin_job(count);
+                      }
                       break;
                     }
                     else{
@@ -303,35 +522,41 @@ enum SYSTEMSTATE{
             }
           break;
           case LOAD_PAYLOAD:
+          if(d_cur_job!=NULL){
+            // hand the samples of the burst to the decoding workers
+            int nb = std::min(d_pkt_byte*DSSS_BYTE_CHIPS-d_job_bits,nbits-count);
+            // calls start on a sample boundary, only the first sample of a
+            // burst can hold bits of the header
+            int first = count/d_hdr_bps;
+            int last = (count+nb-1)/d_hdr_bps;
+            for(int i=first;i<=last;++i){
+              update_voe(i);
+            }
+            d_cur_job->samples.insert(d_cur_job->samples.end(),in+first,in+last+1);
+            d_job_bits += nb;
+            count += nb;
+            if(d_job_bits==d_pkt_byte*DSSS_BYTE_CHIPS){
+              submit_job(d_cur_job);
+              d_cur_job = NULL;
+              // reason: header may be intact
+              enter_search();
+            }
+            break;
+          }
           while(count < nbits){
             update_voe(count/d_hdr_bps);
-            d_data_reg = (d_data_reg<<1) | (d_const_buf[count++]&0x01);
+            d_soft_frame[d_symbol_cnt*DSSS_SYMBOL_CHIPS+d_chip_cnt] = d_soft_buf[count++];
             d_chip_cnt++;
             if(d_chip_cnt==32){
               d_chip_cnt=0;
-              unsigned char c = decode_chip(d_data_reg);
-              if(c==0xff){
+              d_symbol_cnt++;
+              if(d_symbol_cnt/2 >= d_pkt_byte){
+                // despread the whole frame at once
+                frame_done(d_soft_frame.data(),d_buf,d_pkt_byte,
+                  d_despread.decode_bytes(d_soft_frame.data(),d_pkt_byte,d_buf),d_current_pwr);
+                // reason: header may be intact
                 enter_search();
                 break;
-              }else{
-                if(d_symbol_cnt%2==0){
-                  d_buf[d_symbol_cnt/2] = (c<<4);
-                }else{
-                  d_buf[d_symbol_cnt/2] |= c;
-                }
-                d_symbol_cnt++;
-                if(d_symbol_cnt/2 >= d_pkt_byte){
-                  // hide pwr tag in key field
-                  if(d_voe_do_not_pub){
-                    d_voe_do_not_pub = false;
-                  }else{
-                    pmt::pmt_t msg = pmt::cons(d_current_pwr,pmt::make_blob(d_buf,d_pkt_byte));
-                    message_port_pub(d_msg_port,msg);
-                  }
-                  // reason: header may be intact
-                  enter_search();
-                  break;
-                }
               }
             }
           }
@@ -341,6 +566,7 @@ enum SYSTEMSTATE{
           break;
         }
       }
+      commit_jobs();
       consume_each (nin);
       return 0;
     }
@@ -23,10 +23,32 @@
 
 #include <lsa/su_packet_sink_c.h>
 #include <gnuradio/digital/constellation.h>
+#include <gnuradio/thread/thread.h>
+#include "chase_combiner.h"
+#include <deque>
+#include <map>
 
 namespace gr {
   namespace lsa {
 
+    /*
+     * One burst handed from the front-end to a decoding worker, or a
+     * sensing marker keeping its place among the frames.
+     */
+    struct su_sink_job
+    {
+      uint64_t seqno;     // frame order
+      bool sensing;
+      int nbytes;
+      int bit_offset;     // first payload bit in samples[0]
+      pmt::pmt_t pwr;
+      std::vector<gr_complex> samples;
+      // results
+      std::vector<float> soft;
+      unsigned char buf[256];
+      bool decoded;
+    };
+
     class su_packet_sink_c_impl : public su_packet_sink_c
     {
      private:
@@ -55,17 +77,56 @@ namespace gr {
       std::vector<tag_t> d_voe_tags;
       bool d_voe_state;
       bool d_voe_do_not_pub;
+      // soft chips of the current frame
+      soft_demapper d_demap;
+      dsss_despreader d_despread;
+      chase_combiner d_chase;
+      float* d_soft_buf;
+      std::vector<float> d_soft_frame;
+
+      // burst decoding workers, frames are published in sample order
+      const int d_nthreads;
+      // jobs in the pool, the work thread waits for a free one at the cap
+      const int d_max_jobs;
+      int d_njobs;
+      std::vector< boost::shared_ptr<gr::thread::thread> > d_workers;
+      gr::thread::mutex d_job_mutex;
+      gr::thread::condition_variable d_job_cond;
+      gr::thread::condition_variable d_free_cond;
+      // whoever completes the next frame in order publishes it
+      gr::thread::mutex d_commit_mutex;
+      std::deque<su_sink_job*> d_pending;
+      std::map<uint64_t,su_sink_job*> d_done;
+      std::vector<su_sink_job*> d_free_jobs;
+      su_sink_job* d_cur_job;
+      int d_job_bits;
+      uint64_t d_next_seqno;
+      uint64_t d_commit_seqno;
+      bool d_finished;
 
-      unsigned char decode_chip(const unsigned int& reg);
       void enter_search();
       void enter_have_sync();
       void enter_load_payload();
       void update_voe(int idx);
+      void frame_done(const float* chips, unsigned char* buf, int nbytes,
+        bool decoded, const pmt::pmt_t& pwr);
+      float soft_bit(const gr_complex* in, int bit) const;
+      void begin_job(int bit);
+      void decode_job(su_sink_job& job) const;
+      // job pool and workers
+      su_sink_job* acquire_job();
+      void release_job(su_sink_job* job);
+      void submit_job(su_sink_job* job);
+      void commit_jobs();
+      void run_jobs();
 
      public:
-      su_packet_sink_c_impl(const gr::digital::constellation_sptr& hdr_const,int threshold);
+      su_packet_sink_c_impl(const gr::digital::constellation_sptr& hdr_const,int threshold,int chase_depth,int nthreads);
       ~su_packet_sink_c_impl();
 
+      bool start();
+      bool stop();
+
       // Where all the action really happens
       void forecast (int noutput_items, gr_vector_int &ninput_items_required);
 
@@ -36,23 +36,26 @@ namespace gr {
     static unsigned char LSAPHY[] = {0x00,0x00,0x00,0x00,0xE6,0x00};
     static unsigned char LSAMAC[] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};  // 2,2,2,2
     static int d_retx_retry_limit = 20;
+    // retransmission timeout in milliseconds
+    static const uint64_t d_arq_timeout = LSATIMEOUT*1000;
 
     su_sr_transmitter_bb::sptr
-    su_sr_transmitter_bb::make(const std::string& tagname, const std::string& filename, bool usef, bool verb)
+    su_sr_transmitter_bb::make(const std::string& tagname, const std::string& filename, bool usef, bool verb, bool aggregate)
     {
       return gnuradio::get_initial_sptr
-        (new su_sr_transmitter_bb_impl(tagname, filename,usef,verb));
+        (new su_sr_transmitter_bb_impl(tagname, filename,usef,verb,aggregate));
     }
 
     /*
      * The private constructor
      */
-    su_sr_transmitter_bb_impl::su_sr_transmitter_bb_impl(const std::string& tagname, const std::string& filename, bool usef, bool verb)
+    su_sr_transmitter_bb_impl::su_sr_transmitter_bb_impl(const std::string& tagname, const std::string& filename, bool usef, bool verb, bool aggregate)
       : gr::tagged_stream_block("su_sr_transmitter_bb",
               gr::io_signature::make(1, 1, sizeof(unsigned char)),
               gr::io_signature::make(1, 1, sizeof(unsigned char)), tagname),
               d_tagname(tagname),
-              d_msg_in(pmt::mp("msg_in"))
+              d_msg_in(pmt::mp("msg_in")),
+              d_aggregate(aggregate)
     {
       d_verb = verb;
       d_pkt_success_cnt=0;
@@ -66,7 +69,9 @@ namespace gr {
       d_seq = 0;
       message_port_register_in(d_msg_in);
       set_msg_handler(d_msg_in,boost::bind(&su_sr_transmitter_bb_impl::msg_in,this,_1));
+      d_clock = mac_clock::wall();
       d_prou_present = false;
+      d_due_msg = pmt::PMT_NIL;
       memcpy(d_buf,LSAPHY,sizeof(char)* LSAPHYLEN);
     }
 
@@ -75,16 +80,28 @@ namespace gr {
      */
     su_sr_transmitter_bb_impl::~su_sr_transmitter_bb_impl()
     {
+      d_clock->detach(this);
+    }
+
+    void
+    su_sr_transmitter_bb_impl::set_clock(const mac_clock::sptr& clock)
+    {
+      if(!clock){
+        throw std::invalid_argument("Clock cannot be null");
+      }
+      d_clock->detach(this);
+      d_clock = clock;
+      d_clock->attach(this);
     }
 
     int
     su_sr_transmitter_bb_impl::calculate_output_stream_length(const gr_vector_int &ninput_items)
     {
+      gr::thread::scoped_lock guard(d_mutex);
       int noutput_items = ninput_items[0]+LSAPHYLEN+LSAMACLEN;
       if(d_usef){
-        noutput_items = d_data_src[d_seq%d_data_src.size()].size()+LSAPHYLEN+LSAMACLEN;
+        noutput_items = d_data_src.length(d_seq%d_data_src.size())+LSAPHYLEN+LSAMACLEN;
       }
-      std::list<srArq_t>::iterator it;
       if(d_prou_present){        
         if(!retx_peek_front(noutput_items)){
           throw std::runtime_error("<SU SR TX>\033[33;1mERROR:In retransmission state but found no pending packets\033[0m");
@@ -100,6 +117,7 @@ namespace gr {
     {
       // should be filtered to save complexity of this block
       // only input dict with valid messages
+      mac_clock::scoped_handler handled(d_clock,this,msg);
       gr::thread::scoped_lock guard(d_mutex);
       // if is sensing information, lock current queue and change state
       // crc should handle invalid packets
@@ -107,7 +125,6 @@ namespace gr {
       int seqno = pmt::to_long(pmt::dict_ref(msg,pmt::intern("base"),pmt::from_long(-1)));
       int qidx = pmt::to_long(pmt::dict_ref(msg,pmt::intern("queue_index"),pmt::from_long(-1)));
       int qsize = pmt::to_long(pmt::dict_ref(msg,pmt::intern("queue_size"),pmt::from_long(-1)));
-      std::list<srArq_t>::iterator it;
       if(sensing){
         // alert
         if(!d_prou_present){
@@ -127,9 +144,9 @@ namespace gr {
           if(d_retx_cnt >= d_retx_size){
             d_prou_present = false;
             clear_queue();
-            boost::posix_time::time_duration diff = boost::posix_time::microsec_clock::local_time()-d_retx_time;
+            uint64_t diff = d_clock->now_us()-d_retx_time;
             DEBUG<<"<SU SR TX>"<<"\033[31;1m"<<"Retransmission complete! resume to clear state"<<"\033[0m"<<std::endl;
-            DEBUG<<"Time spend on retransmission:"<<diff.total_milliseconds()<<std::endl;
+            DEBUG<<"Time spend on retransmission:"<<diff/1000<<std::endl;
           }
         }
       }else{
@@ -137,13 +154,8 @@ namespace gr {
         if(qidx!=0 || qsize!=0){
           return;
         }
-        for(it = d_arq_queue.begin();it!=d_arq_queue.end();++it){
-          if(it->seq()==seqno){
-            d_pkt_success_cnt++;
-            it = d_arq_queue.erase(it);    
-            //DEBUG<<"<SU SR TX> dequeue seqno:"<<seqno<<std::endl;
-            return;
-          }
+        if(seqno>=0 && d_arq.remove(seqno)){
+          d_pkt_success_cnt++;
         }
       }
     }
@@ -159,26 +171,25 @@ namespace gr {
     bool
     su_sr_transmitter_bb_impl::create_retx_queue()
     {
-      std::list<srArq_t>::iterator it;
-      if(d_arq_queue.empty()){
+      std::vector<arq_timer_wheel::frame_t> frames;
+      if(d_arq.empty()){
         return false;
       }else{
-        DEBUG<<"Create retransmission of size:"<<d_arq_queue.size()<<std::endl;
+        DEBUG<<"Create retransmission of size:"<<d_arq.size()<<std::endl;
         d_retx_cnt= 0;
         d_retx_idx= 0;
         d_retx_table.clear();
         d_retx_queue.clear();
-        d_retx_size=d_arq_queue.size();
+        d_retx_size=d_arq.size();
         d_retx_table.resize(d_retx_size);
         for(int i=0;i<d_retx_size;++i){
           d_retx_table[i] = false;
         }
-        for(it=d_arq_queue.begin();it!=d_arq_queue.end();++it){
-          srArq_t tmp = *it;
-          tmp.set_retry(0);
-          d_retx_queue.push_back(tmp);
+        d_arq.frames(frames);
+        for(int i=0;i<frames.size();++i){
+          d_retx_queue.push_back(srArq_t(frames[i].seq,frames[i].msg,(time_t)(d_clock->now_us()/1000000)));
         }
-        d_retx_time = boost::posix_time::microsec_clock::local_time();
+        d_retx_time = d_clock->now_us();
       }
       return true;
     }
@@ -204,22 +215,33 @@ namespace gr {
     bool
     su_sr_transmitter_bb_impl::peek_front(int& len)
     {
-      std::list<srArq_t>::iterator it;
-      it = d_arq_queue.begin();
-        if(it!=d_arq_queue.end()){
-          if(it->timeout()){
-            if(it->retry()<LSARETRYLIM){
-              len = it->blob_length();
-            }
-          }
-        }
-      return !d_arq_queue.empty();
+      // work() sends exactly the frame the length was set for, it may
+      // not have run since the last call
+      if(!pmt::is_null(d_due_msg)){
+        len = pmt::blob_length(d_due_msg);
+        return true;
+      }
+      const uint64_t now = d_clock->now_us()/1000;
+      arq_timer_wheel::frame_t* frame = d_arq.next_expired(now);
+      while(frame!=NULL && frame->retry>=LSARETRYLIM){
+        d_pkt_failed_cnt++;
+        d_arq.remove(frame->seq);
+        frame = d_arq.next_expired(now);
+      }
+      if(frame!=NULL){
+        frame->retry++;
+        d_arq.rearm(frame->seq,now+d_arq_timeout,now);
+        d_due_msg = frame->msg;
+        len = pmt::blob_length(d_due_msg);
+      }
+      return !d_arq.empty();
     }
 
     void
     su_sr_transmitter_bb_impl::clear_queue()
     {
-      d_arq_queue.clear();
+      d_arq.clear();
+      d_due_msg = pmt::PMT_NIL;
       d_retx_table.clear();
       d_retx_queue.clear();
       d_retx_cnt =0;
@@ -228,73 +250,21 @@ namespace gr {
     pmt::pmt_t
     su_sr_transmitter_bb_impl::check_timeout()
     {
-      pmt::pmt_t nx_msg = pmt::PMT_NIL;
-      std::list<srArq_t>::iterator it = d_arq_queue.begin();
-      if(it!=d_arq_queue.end()){
-        if(it->timeout()){
-          it->inc_retry();
-          nx_msg = it->msg();
-          it->update_time();
-          d_arq_queue.push_back(*it);
-          d_arq_queue.pop_front();
-          return nx_msg;
-        }else{
-          return nx_msg;
-        }
-      }else{
-        return nx_msg;
-      }
-      /*while(it!=d_arq_queue.end()){
-        if(it->timeout()) {
-            //check retry count
-            if(it->inc_retry()){
-              // reaching limit, should abort...
-              DEBUG<<"<SU SR TX>"<<"\033[32;1m"<<"timeout..."<<*it<<"\033[0m"<<std::endl;
-              d_pkt_failed_cnt++;
-              d_arq_queue.pop_front();
-              it = d_arq_queue.begin();
-            }else{
-              // add retry
-              nx_msg = it->msg();
-              it->update_time();
-              d_arq_queue.push_back(*it);
-              d_arq_queue.pop_front();
-              break;
-            }
-          }else{
-            break;
-          }
-      }*/
-      //return nx_msg;
+      pmt::pmt_t nx_msg = d_due_msg;
+      d_due_msg = pmt::PMT_NIL;
+      return nx_msg;
     }
 
     bool
     su_sr_transmitter_bb_impl::read_data(const std::string& filename)
     {
       gr::thread::scoped_lock guard(d_mutex);
-      std::string str,line;
-      if(!d_data_src.empty()){
-        for(int i=0; i<d_data_src.size();++i)
-          d_data_src[i].clear();
-        d_data_src.clear();
+      if(!d_data_src.open(filename)){
+        return false;
       }
-      if(d_file.is_open())
-        d_file.close();
-      d_file.open(filename.c_str(),std::fstream::in);
-      if(d_file.is_open()){
-        while(getline(d_file,line,'\n')){
-          std::istringstream temp(line);
-          std::vector<unsigned char> u8;
-          while(getline(temp,str,',')){
-            int tmp = std::atoi(str.c_str());
-            u8.push_back((unsigned char)tmp);
-          }
-          d_data_src.push_back(u8);
-        }
-      }else{
-        d_data_src.clear();
+      if(d_aggregate){
+        d_data_src.aggregate(MAX_LSA_PAYLOAD-LSAMACLEN);
       }
-      d_file.close();
       return !d_data_src.empty();
     }
 
@@ -332,6 +302,7 @@ namespace gr {
                        gr_vector_const_void_star &input_items,
                        gr_vector_void_star &output_items)
     {
+      gr::thread::scoped_lock guard(d_mutex);
       const unsigned char *in = (const unsigned char *) input_items[0];
       unsigned char *out = (unsigned char *) output_items[0];
       int nin = ninput_items[0];
@@ -339,8 +310,8 @@ namespace gr {
       pmt::pmt_t nx_msg =pmt::PMT_NIL;
       if(d_usef){
         //DEBUG<<"<SR SU TX>Use file data: index="<<d_seq%d_data_src.size()<<std::endl;
-        in = d_data_src[d_seq%d_data_src.size()].data();
-        nin = d_data_src[d_seq%d_data_src.size()].size();
+        in = d_data_src.data(d_seq%d_data_src.size());
+        nin = d_data_src.length(d_seq%d_data_src.size());
       }
       if(d_prou_present){
         // should do retransmission
@@ -392,9 +363,10 @@ namespace gr {
           d_buf[LSAPHYLEN+7] = u8_idx[0];
           nout = nin + LSAPHYLEN + LSAMACLEN;
           nx_msg = pmt::make_blob(d_buf,nout);
-          d_seq = (d_seq == 0xffff)? 0:d_seq; // wrap around
-          srArq_t temp_arq(d_seq++,nx_msg);
-          d_arq_queue.push_back(temp_arq);
+          const uint64_t now = d_clock->now_us()/1000;
+          // a frame still pending after a wrap around is given up
+          d_arq.remove(d_seq);
+          d_arq.add(d_seq++,nx_msg,now+d_arq_timeout,now);
           memcpy(out,d_buf,sizeof(char)*(nout) );
         }else{
           // send existing message
@@ -410,33 +382,25 @@ namespace gr {
     bool 
     su_sr_transmitter_bb_impl::start()
     {
-      d_finished = false;
-      d_start_time = boost::posix_time::second_clock::local_time();
-      d_thread = boost::shared_ptr<gr::thread::thread>
-        (new gr::thread::thread(boost::bind(&su_sr_transmitter_bb_impl::run,this)));
+      d_start_time = d_clock->now_us();
+      d_clock->timers().schedule_every(this,STATUSMS,STATUSMS,
+        boost::bind(&su_sr_transmitter_bb_impl::status,this));
+      d_clock->started(this);
       return block::start();
     }
     bool
     su_sr_transmitter_bb_impl::stop()
     {
-      d_finished = true;
-      d_thread->interrupt();
-      d_thread->join();
+      d_clock->timers().cancel_all(this);
       return block::stop();
     }
     void
-    su_sr_transmitter_bb_impl::run()
+    su_sr_transmitter_bb_impl::status()
     {
-      while(!d_finished){
-        boost::this_thread::sleep(boost::posix_time::milliseconds(10000));
-        if(d_finished){
-          return;
-        }
-        boost::posix_time::time_duration diff = boost::posix_time::second_clock::local_time()-d_start_time;
-        if(d_verb){
-          std::cout<<"<LSA TX>Execution time:"<<diff.total_seconds();
-          std::cout<<" ,success packets:"<<d_pkt_success_cnt<<" ,failed packets:"<<d_pkt_failed_cnt<<std::endl;
-        }
+      uint64_t diff = d_clock->now_us()-d_start_time;
+      if(d_verb){
+        std::cout<<"<LSA TX>Execution time:"<<diff/1000000;
+        std::cout<<" ,success packets:"<<d_pkt_success_cnt<<" ,failed packets:"<<d_pkt_failed_cnt<<std::endl;
       }
     }
   } /* namespace lsa */
@@ -24,7 +24,8 @@
 #include <lsa/su_sr_transmitter_bb.h>
 #include <ctime>
 #include "utils.h"
-#include <fstream>
+#include <lsa/arq_timer_wheel.h>
+#include <lsa/payload_corpus.h>
 
 namespace gr {
   namespace lsa {
@@ -33,7 +34,10 @@ namespace gr {
     {
      private:
       gr::thread::mutex d_mutex;
-      std::list<srArq_t> d_arq_queue;
+      mac_clock::sptr d_clock;
+      arq_timer_wheel d_arq;
+      // frame chosen for retransmission when the output length was set
+      pmt::pmt_t d_due_msg;
       std::vector<srArq_t> d_retx_queue;
       std::vector<bool> d_retx_table;
       uint16_t d_retx_cnt;
@@ -42,20 +46,18 @@ namespace gr {
       uint16_t d_seq;
       const std::string& d_tagname;      
       const pmt::pmt_t d_msg_in;
+      const bool d_aggregate;
       bool d_prou_present;
       unsigned char d_buf[1024];
       bool d_usef;
-      std::fstream d_file;
       long int d_pkt_success_cnt;
       long int d_pkt_failed_cnt;
       bool d_verb;
-      boost::shared_ptr<gr::thread::thread> d_thread;
-      boost::posix_time::ptime d_start_time;
+      uint64_t d_start_time;
       boost::posix_time::ptime d_system_time;
-      boost::posix_time::ptime d_retx_time;
-      bool d_finished;
+      uint64_t d_retx_time;
 
-      // thread functions for d_arq_queue;
+      // thread functions for d_arq;
       void clear_queue();
       pmt::pmt_t check_timeout();
       bool peek_front(int& len);
@@ -67,14 +69,14 @@ namespace gr {
       void reset_retx_retry();
 
       // file operation
-      std::vector< std::vector<unsigned char> > d_data_src;
+      payload_corpus d_data_src;
       bool read_data(const std::string& filename);
-      void run();
+      void status();
      protected:
       int calculate_output_stream_length(const gr_vector_int &ninput_items);
 
      public:
-      su_sr_transmitter_bb_impl(const std::string& tagname, const std::string& filename, bool usef, bool verb);
+      su_sr_transmitter_bb_impl(const std::string& tagname, const std::string& filename, bool usef, bool verb, bool aggregate);
       ~su_sr_transmitter_bb_impl();
 
       void msg_in(pmt::pmt_t);
@@ -85,6 +87,7 @@ namespace gr {
            gr_vector_void_star &output_items);
       bool start();
       bool stop();
+      void set_clock(const mac_clock::sptr& clock);
     };
 
   } // namespace lsa
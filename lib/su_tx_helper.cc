@@ -25,12 +25,20 @@
 #include <gnuradio/io_signature.h>
 #include <lsa/su_tx_helper.h>
 #include <gnuradio/block_detail.h>
+#include <algorithm>
 #include <ctime>
 
 namespace gr {
   namespace lsa {
     #define LSAMACLEN 8
     #define LSASENLEN 2
+    // queue indices whose message is kept
+    #define CTRLCACHE 256
+    static const pmt::pmt_t d_queue_index_key = pmt::intern("queue_index");
+    static const pmt::pmt_t d_queue_size_key = pmt::intern("queue_size");
+    static const pmt::pmt_t d_base_key = pmt::intern("base");
+    // published as is, never modified
+    static const pmt::pmt_t d_sensing_msg = pmt::dict_add(pmt::make_dict(),pmt::intern("LSA_sensing"),pmt::PMT_T);
     
     class su_tx_helper_impl : public su_tx_helper{
       public:
@@ -43,6 +51,9 @@ namespace gr {
         message_port_register_in(d_in_port);
         message_port_register_out(d_out_port);
         set_msg_handler(d_in_port,boost::bind(&su_tx_helper_impl::msg_in,this,_1));
+        d_cache_qsize = 0;
+        d_cache_base = 0;
+        d_cache.assign(1,pmt::PMT_NIL);
        }
        ~su_tx_helper_impl(){}
        void msg_in(pmt::pmt_t msg)
@@ -56,9 +67,7 @@ namespace gr {
          const uint8_t* uvec = pmt::u8vector_elements(v,io);
          if(io==LSASENLEN){
           // sensing
-          pmt::pmt_t out = pmt::make_dict();
-          out = pmt::dict_add(out,pmt::intern("LSA_sensing"),pmt::PMT_T);
-          message_port_pub(d_out_port,out);
+          message_port_pub(d_out_port,d_sensing_msg);
          }else if(io==LSAMACLEN){
            // only control message
            uint16_t base1,base2;
@@ -74,22 +83,42 @@ namespace gr {
              return;
            }
            d_base = base1;
-           pmt::pmt_t out = pmt::make_dict();
-           out = pmt::dict_add(out,pmt::intern("queue_index"),pmt::from_long(d_qidx));
-           out = pmt::dict_add(out,pmt::intern("queue_size"),pmt::from_long(d_qsize));
-           out = pmt::dict_add(out,pmt::intern("base"),pmt::from_long(d_base));
-           message_port_pub(d_out_port,out);
+           message_port_pub(d_out_port,ctrl_msg());
          }else if(io>LSAMACLEN){
           // pdu
          }
        }
       private:
+       pmt::pmt_t ctrl_msg()
+       {
+         // the receiver acks a queue index by index and repeats itself on
+         // retransmissions, so each message is built once per queue and base
+         if(d_qsize!=d_cache_qsize || d_base!=d_cache_base){
+           d_cache.assign(std::min(std::max((int)d_qsize,1),CTRLCACHE),pmt::PMT_NIL);
+           d_cache_qsize = d_qsize;
+           d_cache_base = d_base;
+         }
+         if(d_qidx<d_cache.size() && !pmt::is_null(d_cache[d_qidx])){
+           return d_cache[d_qidx];
+         }
+         pmt::pmt_t out = pmt::make_dict();
+         out = pmt::dict_add(out,d_queue_index_key,pmt::from_long(d_qidx));
+         out = pmt::dict_add(out,d_queue_size_key,pmt::from_long(d_qsize));
+         out = pmt::dict_add(out,d_base_key,pmt::from_long(d_base));
+         if(d_qidx<d_cache.size()){
+           d_cache[d_qidx] = out;
+         }
+         return out;
+       }
        gr::thread::mutex d_mutex;
        const pmt::pmt_t d_in_port;
        const pmt::pmt_t d_out_port;
        uint16_t d_qidx;
        uint16_t d_qsize;
        uint16_t d_base;
+       std::vector<pmt::pmt_t> d_cache;
+       uint16_t d_cache_qsize;
+       uint16_t d_cache_base;
     };
 
     su_tx_helper::sptr 
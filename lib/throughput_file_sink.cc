@@ -31,6 +31,11 @@ namespace gr {
   namespace lsa {
 
     #define PERIOD 1000
+    static const pmt::pmt_t d_acc_delay_key = pmt::intern("acc_delay");
+    static const pmt::pmt_t d_acc_ch_use_key = pmt::intern("acc_ch_use");
+    static const pmt::pmt_t d_acc_size_key = pmt::intern("acc_size");
+    static const pmt::pmt_t d_total_suc_key = pmt::intern("total_suc");
+    static const pmt::pmt_t d_long_zero = pmt::from_long(0);
     enum SYSTEM{
       PROU=0,
       SU=1
@@ -41,15 +46,15 @@ namespace gr {
         const pmt::pmt_t d_in_port;
         std::fstream d_file;
         bool d_verb;
-        bool d_finished;
         gr::thread::mutex d_mutex;
+        mac_clock::sptr d_clock;
         int d_system;
         int d_iter_cnt;
-        boost::posix_time::ptime d_start_time;
-        boost::shared_ptr<gr::thread::thread> d_thread;
+        uint64_t d_start_time;
         
         void msg_in(pmt::pmt_t msg)
         {
+          mac_clock::scoped_handler handled(d_clock,this,msg);
           gr::thread::scoped_lock guard(d_mutex);
           pmt::pmt_t k = pmt::car(msg);
           pmt::pmt_t v = pmt::cdr(msg);
@@ -58,10 +63,10 @@ namespace gr {
           {
             case PROU:
               assert(pmt::is_dict(k));
-              acc_delay = pmt::to_long(pmt::dict_ref(k,pmt::intern("acc_delay"),pmt::from_long(0)));
-              acc_ch_use= pmt::to_long(pmt::dict_ref(k,pmt::intern("acc_ch_use"),pmt::from_long(0)));
-              acc_size  = pmt::to_long(pmt::dict_ref(k,pmt::intern("acc_size"),pmt::from_long(0)));
-              total_suc = pmt::to_long(pmt::dict_ref(k,pmt::intern("total_suc"),pmt::from_long(0)));
+              acc_delay = pmt::to_long(pmt::dict_ref(k,d_acc_delay_key,d_long_zero));
+              acc_ch_use= pmt::to_long(pmt::dict_ref(k,d_acc_ch_use_key,d_long_zero));
+              acc_size  = pmt::to_long(pmt::dict_ref(k,d_acc_size_key,d_long_zero));
+              total_suc = pmt::to_long(pmt::dict_ref(k,d_total_suc_key,d_long_zero));
               d_file<<acc_size<<","<<acc_delay<<","<<acc_ch_use<<","<<total_suc<<std::endl;
               d_file<<std::flush;
               d_iter_cnt++;
@@ -72,38 +77,30 @@ namespace gr {
             default:
               throw std::runtime_error("Undefined system type");
             break;
-            d_start_time = boost::posix_time::second_clock::local_time();
+            d_start_time = d_clock->now_us();
           }
         }
-        void run()
+        void status()
         {
-          while(!d_finished){
-            boost::this_thread::sleep(boost::posix_time::milliseconds(PERIOD));
-            if(d_finished){
-              return;
-            }
-            boost::posix_time::time_duration diff = boost::posix_time::second_clock::local_time()-d_start_time;
-            if(d_verb){
-              std::printf("<Throughput file sink> Accumulated results:%d ,Execution time:%d secs\n",d_iter_cnt,diff.total_seconds());
-              std::fflush(stdout);
-            }
+          uint64_t diff = d_clock->now_us()-d_start_time;
+          if(d_verb){
+            std::printf("<Throughput file sink> Accumulated results:%d ,Execution time:%d secs\n",d_iter_cnt,(int)(diff/1000000));
+            std::fflush(stdout);
           }
         }
 
       public:
         bool start()
         {
-          d_finished = false;
-          d_start_time = boost::posix_time::second_clock::local_time();
-          d_thread = boost::shared_ptr<gr::thread::thread>(
-            new gr::thread::thread(boost::bind(&throughput_file_sink_impl::run,this)));
+          d_start_time = d_clock->now_us();
+          d_clock->timers().schedule_every(this,PERIOD,PERIOD,
+            boost::bind(&throughput_file_sink_impl::status,this));
+          d_clock->started(this);
           return block::start();
         }
         bool stop()
         {
-          d_finished = true;
-          d_thread->interrupt();
-          d_thread->join();
+          d_clock->timers().cancel_all(this);
           return block::stop();
         }
         throughput_file_sink_impl(const std::string& filename,int sys, bool verbose) : block("throughput_file_sink",
@@ -113,6 +110,7 @@ namespace gr {
         {
           message_port_register_in(d_in_port);
           set_msg_handler(d_in_port,boost::bind(&throughput_file_sink_impl::msg_in,this,_1));
+          d_clock = mac_clock::wall();
           d_file.open(filename.c_str(),std::fstream::out|std::fstream::trunc);
           if(!d_file.is_open()){
             throw std::invalid_argument("Throughput file cannot be opened, abort execution...");
@@ -134,6 +132,16 @@ namespace gr {
           if(d_file.is_open()){
             d_file.close();
           }
+          d_clock->detach(this);
+        }
+        void set_clock(const mac_clock::sptr& clock)
+        {
+          if(!clock){
+            throw std::invalid_argument("Clock cannot be null");
+          }
+          d_clock->detach(this);
+          d_clock = clock;
+          d_clock->attach(this);
         }
     };
     throughput_file_sink::sptr
@@ -25,10 +25,15 @@
 #include <gnuradio/io_signature.h>
 #include <lsa/throughput_report.h>
 #include <gnuradio/block_detail.h>
+#include <algorithm>
 
 namespace gr {
   namespace lsa {
 
+    // header bytes ahead of the payload in the blob, see phy_crc
+    static const pmt::pmt_t d_offset_key = pmt::intern("offset");
+    static const pmt::pmt_t d_long_zero = pmt::from_long(0);
+
     class throughput_report_impl:public throughput_report
     {
       public:
@@ -41,6 +46,7 @@ namespace gr {
         message_port_register_in(d_in_port);
         set_msg_handler(d_in_port,boost::bind(&throughput_report_impl::msg_in,this,_1));
         message_port_register_out(d_out_port);
+        d_clock = mac_clock::wall();
         if(ms<=0){
           throw std::invalid_argument("period cannot be negative or zero");
         }
@@ -56,16 +62,32 @@ namespace gr {
         d_pkt_acc=0;
         d_byte_acc=0;
        }
-       ~throughput_report_impl(){}
+       ~throughput_report_impl()
+       {
+        d_clock->detach(this);
+       }
+       void
+       set_clock(const mac_clock::sptr& clock)
+       {
+        if(!clock){
+          throw std::invalid_argument("Clock cannot be null");
+        }
+        d_clock->detach(this);
+        d_clock = clock;
+        d_clock->attach(this);
+       }
        void 
        msg_in(pmt::pmt_t msg)
        {
+        mac_clock::scoped_handler handled(d_clock,this,msg);
         assert(pmt::is_pair(msg));
         pmt::pmt_t k = pmt::car(msg);
         pmt::pmt_t v = pmt::cdr(msg);
         if(pmt::is_blob(v)){
-          size_t io(0);
-          const uint8_t* uvec = pmt::u8vector_elements(v,io);
+          size_t io = pmt::blob_length(v);
+          if(pmt::is_dict(k)){
+            io -= std::min(io,(size_t)pmt::to_long(pmt::dict_ref(k,d_offset_key,d_long_zero)));
+          }
           d_byte_cnt+=io;
           d_byte_acc+=io;
           d_pkt_cnt++;
@@ -75,59 +97,48 @@ namespace gr {
        bool 
        start()
        {
-        d_finished = false;
-        d_thread = boost::shared_ptr<gr::thread::thread>
-          (new gr::thread::thread(boost::bind(&throughput_report_impl::run,this)));
+        d_clock->timers().schedule_every(this,d_period_ms,d_period_ms,
+          boost::bind(&throughput_report_impl::gen_throughput,this));
+        d_clock->started(this);
         return block::start();
        }
        bool 
        stop()
        {
-        d_finished = true;
-        d_thread->interrupt();
-        d_thread->join();
+        d_clock->timers().cancel_all(this);
         return block::stop();
        }
 
       private:
       void
-      run()
-      {
-        while(!d_finished){
-          boost::this_thread::sleep(boost::posix_time::milliseconds(d_period_ms));
-          if(d_finished){
-            return;
-          }
-          gen_throughput();
-        }
-      }
-      void
       gen_throughput()
       {
         float instant_throughput = d_byte_cnt/d_period_ms*1000; // unit in second
         d_history.push_back(instant_throughput);
         d_history.erase(d_history.begin());
         // can report pkts received
+        pmt::pmt_t out;
         if(d_history_len!=0){
-          message_port_pub(d_out_port,pmt::cons(pmt::PMT_NIL,pmt::init_f32vector(d_history_len,d_history.data())));
+          out = pmt::cons(pmt::PMT_NIL,pmt::init_f32vector(d_history_len,d_history.data()));
         }else{
-          message_port_pub(d_out_port,pmt::cons(pmt::PMT_NIL,pmt::init_f32vector(1,&instant_throughput)));
+          out = pmt::cons(pmt::PMT_NIL,pmt::init_f32vector(1,&instant_throughput));
         }
+        d_clock->sent(this,d_out_port,out);
+        message_port_pub(d_out_port,out);
         d_byte_cnt=0;
         d_pkt_cnt=0;
       }
 
        const pmt::pmt_t d_in_port;
        const pmt::pmt_t d_out_port;
+       mac_clock::sptr d_clock;
        std::vector<float> d_history;
        int d_history_len;
        int d_byte_cnt;
        int d_pkt_cnt;
        long int d_pkt_acc;
        long int d_byte_acc;
-       boost::shared_ptr<gr::thread::thread> d_thread;
        float d_period_ms;
-       bool d_finished;
     };
     throughput_report::sptr
     throughput_report::make(float ms, int hisLen){
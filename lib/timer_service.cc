@@ -0,0 +1,286 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2017 <+YOU OR YOUR COMPANY+>.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <lsa/timer_service.h>
+#include <boost/bind.hpp>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+namespace gr {
+  namespace lsa {
+
+    timer_service&
+    timer_service::instance()
+    {
+      static timer_service service;
+      return service;
+    }
+
+    uint64_t
+    timer_service::now_us()
+    {
+      return instance().now();
+    }
+
+    timer_service::timer_service(bool virtual_time)
+      : d_next_id(1),
+        d_running(0),
+        d_running_owner(NULL),
+        d_wakeups(0),
+        d_finished(false),
+        d_virtual(virtual_time),
+        d_virtual_now(0),
+        d_held(0)
+    {
+    }
+
+    timer_service::~timer_service()
+    {
+      {
+        gr::thread::scoped_lock guard(d_mutex);
+        d_finished = true;
+        d_changed.notify_one();
+      }
+      if(d_thread){
+        d_thread->join();
+      }
+    }
+
+    uint64_t
+    timer_service::now() const
+    {
+      if(!d_virtual){
+        return clock();
+      }
+      gr::thread::scoped_lock guard(d_mutex);
+      return d_virtual_now;
+    }
+
+    uint64_t
+    timer_service::clock() const
+    {
+      if(d_virtual){
+        return d_virtual_now;
+      }
+      return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    timer_service::timer_id
+    timer_service::schedule(const void* owner, double delay_ms, const callback_t& callback)
+    {
+      uint64_t delay = (delay_ms>0)? (uint64_t)(delay_ms*1000.0) : 0;
+      return add(owner,delay,0,false,callback);
+    }
+
+    timer_service::timer_id
+    timer_service::schedule_every(const void* owner, double period_ms, double delay_ms,
+      const callback_t& callback)
+    {
+      uint64_t period = (period_ms>0)? (uint64_t)(period_ms*1000.0) : 0;
+      uint64_t delay = (delay_ms>0)? (uint64_t)(delay_ms*1000.0) : 0;
+      return add(owner,delay,period,true,callback);
+    }
+
+    timer_service::timer_id
+    timer_service::add(const void* owner, uint64_t delay, uint64_t period,
+      bool periodic, const callback_t& callback)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      if(d_finished){
+        throw std::runtime_error("Timer service stopped");
+      }
+      const uint64_t deadline = clock()+delay;
+      const timer_id id = d_next_id++;
+      entry_t& entry = d_timers[id];
+      entry.owner = owner;
+      entry.deadline = deadline;
+      entry.period = period;
+      entry.periodic = periodic;
+      entry.callback = callback;
+      d_queue.insert(key_t(deadline,id));
+      if(!d_thread){
+        d_thread = boost::shared_ptr<gr::thread::thread>
+          (new gr::thread::thread(boost::bind(&timer_service::run,this)));
+      }else if(d_queue.begin()->second==id){
+        // earlier than what the thread sleeps for
+        d_changed.notify_one();
+      }
+      return id;
+    }
+
+    bool
+    timer_service::cancel(timer_id id)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      std::map<timer_id,entry_t>::iterator it = d_timers.find(id);
+      if(it==d_timers.end()){
+        return false;
+      }
+      if(id==d_running){
+        // not re-armed when it returns
+        d_timers.erase(it);
+        return false;
+      }
+      d_queue.erase(key_t(it->second.deadline,id));
+      d_timers.erase(it);
+      return true;
+    }
+
+    void
+    timer_service::cancel_all(const void* owner)
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      drop(owner);
+      if(d_thread && boost::this_thread::get_id()!=d_thread->get_id()){
+        while(d_running!=0 && d_running_owner==owner){
+          d_idle.wait(guard);
+        }
+        // scheduled by the callback that was running
+        drop(owner);
+      }
+    }
+
+    void
+    timer_service::drop(const void* owner)
+    {
+      std::map<timer_id,entry_t>::iterator it = d_timers.begin();
+      while(it!=d_timers.end()){
+        if(it->second.owner!=owner){
+          ++it;
+          continue;
+        }
+        if(it->first!=d_running){
+          d_queue.erase(key_t(it->second.deadline,it->first));
+        }
+        d_timers.erase(it++);
+      }
+    }
+
+    size_t
+    timer_service::size() const
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      return d_timers.size();
+    }
+
+    uint64_t
+    timer_service::wakeups() const
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      return d_wakeups;
+    }
+
+    void
+    timer_service::hold()
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      d_held++;
+    }
+
+    void
+    timer_service::release()
+    {
+      gr::thread::scoped_lock guard(d_mutex);
+      if(d_held==0){
+        throw std::logic_error("Timer service released more than held");
+      }
+      if(--d_held==0 && d_virtual){
+        d_changed.notify_one();
+      }
+    }
+
+    void
+    timer_service::run()
+    {
+      gr::thread::scoped_lock lock(d_mutex);
+      while(!d_finished){
+        if(d_queue.empty()){
+          d_changed.wait(lock);
+          d_wakeups++;
+          continue;
+        }
+        if(d_virtual && d_held!=0){
+          // messages of this instant are handled before any timer
+          d_changed.wait(lock);
+          d_wakeups++;
+          continue;
+        }
+        uint64_t now = clock();
+        const key_t next = *d_queue.begin();
+        if(next.first>now && d_virtual){
+          // nothing left to happen before the deadline
+          d_virtual_now = next.first;
+          continue;
+        }
+        if(next.first>now){
+          d_changed.timed_wait(lock,boost::posix_time::microseconds(next.first-now));
+          d_wakeups++;
+          continue;
+        }
+        // due, the entry stays in d_timers while its callback runs
+        d_queue.erase(d_queue.begin());
+        const entry_t& entry = d_timers[next.second];
+        callback_t callback = entry.callback;
+        d_running = next.second;
+        d_running_owner = entry.owner;
+        lock.unlock();
+        try{
+          callback();
+        }catch(std::exception& e){
+          std::cerr<<"<Timer Service>callback failed: "<<e.what()<<std::endl;
+        }
+        // a backlog of due timers must not keep cancel() and schedule() out
+        boost::this_thread::yield();
+        lock.lock();
+        d_running = 0;
+        d_running_owner = NULL;
+        d_idle.notify_all();
+        std::map<timer_id,entry_t>::iterator it = d_timers.find(next.second);
+        if(it==d_timers.end()){
+          // cancelled while running
+          continue;
+        }
+        if(!it->second.periodic){
+          d_timers.erase(it);
+          continue;
+        }
+        // stay on the period grid, ticks missed by a slow callback are skipped
+        now = clock();
+        uint64_t deadline = it->second.deadline+it->second.period;
+        const uint64_t period = it->second.period;
+        if(period==0 && d_virtual){
+          // virtual time would never move on
+          deadline = now+1;
+        }else if(deadline<=now){
+          deadline = (period==0)? now : now+period-(now-it->second.deadline)%period;
+        }
+        it->second.deadline = deadline;
+        d_queue.insert(key_t(deadline,next.second));
+      }
+    }
+
+  } /* namespace lsa */
+} /* namespace gr */
@@ -31,6 +31,8 @@
  #define LSATIMEOUT 5
  #define MAX_LSA_PAYLOAD 121
  #define MAX_PROU_PAYLOAD 127
+ // status print period of the transmitters (ms)
+ #define STATUSMS 10000
 
  class block_t{
       public:
@@ -139,13 +141,14 @@
     class srArq_t{
       public:
       friend std::ostream & operator <<(std::ostream& out,const srArq_t& aq){
-        out << "seq:"<<aq.d_noseq<<" ,created time:"<<std::difftime(std::time(NULL),aq.d_time)
+        out << "seq:"<<aq.d_noseq<<" ,created time:"<<aq.d_time
         <<" ,retry:"<<aq.d_retry<<" ,blob_size:"<<pmt::blob_length(aq.d_msg);
         return out;
       }
-      srArq_t(){ d_noseq=0; std::time(&d_time);d_retry=0;d_msg = pmt::PMT_NIL;}
+      srArq_t(){ d_noseq=0; d_time=0;d_retry=0;d_msg = pmt::PMT_NIL;}
       srArq_t(const srArq_t& aq){d_noseq = aq.d_noseq; d_time = aq.d_time; d_retry =aq.d_retry;d_msg = aq.d_msg;}
-      srArq_t(uint16_t noseq,const pmt::pmt_t& msg){d_noseq = noseq; std::time(&d_time); d_retry = 0;d_msg= msg;}
+      // times are seconds on the clock of the owner, see mac_clock
+      srArq_t(uint16_t noseq,const pmt::pmt_t& msg,time_t time){d_noseq = noseq; d_time = time; d_retry = 0;d_msg= msg;}
       ~srArq_t(){}
       const srArq_t& operator=(const srArq_t& aq){
         d_noseq = aq.d_noseq; d_time = aq.d_time; d_retry = aq.d_retry; d_msg=aq.d_msg;
@@ -157,9 +160,9 @@
       uint32_t retry()const{return d_retry;}
       pmt::pmt_t msg()const{return d_msg;}
       bool inc_retry(){d_retry++; return d_retry>LSARETRYLIM;}
-      bool timeout(){return std::difftime(std::time(NULL),d_time) >=LSATIMEOUT;}
-      void reset(){d_retry = 0; std::time(&d_time);}
-      void update_time(){std::time(&d_time);}
+      bool timeout(time_t now){return std::difftime(now,d_time) >=LSATIMEOUT;}
+      void reset(time_t now){d_retry = 0; d_time = now;}
+      void update_time(time_t now){d_time = now;}
       void set_retry(uint32_t re){d_retry = re;}
       void set_time(time_t time){d_time = time;}
       void set_seq(uint16_t seq){d_noseq = seq;}
@@ -11,6 +11,7 @@
 %include "lsa_swig_doc.i"
 
 %{
+#include "lsa/mac_clock.h"
 #include "lsa/eng_det_cc.h"
 #include "lsa/interference_energy_detector_cc.h"
 #include "lsa/modified_costas_loop_cc.h"
@@ -22,6 +23,7 @@
 #include "lsa/moving_average_ff.h"
 #include "lsa/coarse_sync_cc.h"
 #include "lsa/prou_packet_sink_f.h"
+#include "lsa/prou_packet_sink_c.h"
 #include "lsa/interference_tagger_cc.h"
 #include "lsa/block_tagger_cc.h"
 #include "lsa/su_sr_transmitter_bb.h"
@@ -37,7 +39,10 @@
 #include "lsa/simple_tx.h"
 #include "lsa/simple_rx.h"
 #include "lsa/phy_crc.h"
+#include "lsa/frame_aggregator.h"
+#include "lsa/frame_deaggregator.h"
 #include "lsa/byte_to_symbol_bc.h"
+#include "lsa/dsss_oqpsk_mod_bc.h"
 #include "lsa/throughput_file_sink.h"
 #include "lsa/ic_resync_cc.h"
 #include "lsa/su_block_receiver_c.h"
@@ -59,6 +64,12 @@
 %}
 %include "gnuradio/blocks/count_bits.h"
 
+// clock handed to the MAC blocks with set_clock()
+%ignore gr::lsa::mac_clock::timers;
+%ignore gr::lsa::mac_clock::scoped_handler;
+%include "lsa/mac_clock.h"
+%template(mac_clock_sptr) boost::shared_ptr<gr::lsa::mac_clock>;
+
 %include "lsa/eng_det_cc.h"
 GR_SWIG_BLOCK_MAGIC2(lsa, eng_det_cc);
 %include "lsa/interference_energy_detector_cc.h"
@@ -81,6 +92,8 @@ GR_SWIG_BLOCK_MAGIC2(lsa, moving_average_ff);
 GR_SWIG_BLOCK_MAGIC2(lsa, coarse_sync_cc);
 %include "lsa/prou_packet_sink_f.h"
 GR_SWIG_BLOCK_MAGIC2(lsa, prou_packet_sink_f);
+%include "lsa/prou_packet_sink_c.h"
+GR_SWIG_BLOCK_MAGIC2(lsa, prou_packet_sink_c);
 %include "lsa/interference_tagger_cc.h"
 GR_SWIG_BLOCK_MAGIC2(lsa, interference_tagger_cc);
 %include "lsa/block_tagger_cc.h"
@@ -111,8 +124,14 @@ GR_SWIG_BLOCK_MAGIC2(lsa, simple_tx);
 GR_SWIG_BLOCK_MAGIC2(lsa, simple_rx);
 %include "lsa/phy_crc.h"
 GR_SWIG_BLOCK_MAGIC2(lsa, phy_crc);
+%include "lsa/frame_aggregator.h"
+GR_SWIG_BLOCK_MAGIC2(lsa, frame_aggregator);
+%include "lsa/frame_deaggregator.h"
+GR_SWIG_BLOCK_MAGIC2(lsa, frame_deaggregator);
 %include "lsa/byte_to_symbol_bc.h"
 GR_SWIG_BLOCK_MAGIC2(lsa, byte_to_symbol_bc);
+%include "lsa/dsss_oqpsk_mod_bc.h"
+GR_SWIG_BLOCK_MAGIC2(lsa, dsss_oqpsk_mod_bc);
 %include "lsa/throughput_file_sink.h"
 GR_SWIG_BLOCK_MAGIC2(lsa, throughput_file_sink);
 %include "lsa/ic_resync_cc.h"